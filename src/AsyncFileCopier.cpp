@@ -15,34 +15,381 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "AsyncFileCopier.h"
+#include "CacheBase.h"
 #include "FileCacheError.h"
 
+#include <glibmm/main.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+
 #include <iostream>
 
 using namespace std;
 
+// Errors meaning a kernel copy isn't possible between the two files, as
+// opposed to the copy itself failing
+static bool
+IsUnsupportedCopy(int error)
+{
+	return (error == ENOSYS) || (error == EXDEV) || (error == EINVAL) ||
+	       (error == EOPNOTSUPP);
+}
+
+CAsyncCopier::CCancelHandler::CCancelHandler(CAsyncCopier *copier,
+        MojServiceMessage *msg)
+	: m_copier(copier)
+	, m_cancelSlot(this, &CCancelHandler::HandleCancel)
+{
+	msg->notifyCancel(m_cancelSlot);
+}
+
+MojErr
+CAsyncCopier::CCancelHandler::HandleCancel(MojServiceMessage *msg)
+{
+	if (m_copier != NULL)
+	{
+		CAsyncCopier *copier = m_copier;
+		m_copier = NULL;
+		copier->m_scheduler->Cancel(copier);
+	}
+
+	return MojErrNone;
+}
+
 CAsyncCopier::CAsyncCopier(const std::string &sourcePath,
-                           const std::string &destinationPath, MojServiceMessage *msg) :
+                           const std::string &destinationPath, MojServiceMessage *msg,
+                           CCopyScheduler *scheduler, CopyPriority priority, bool subscribed) :
 	m_msg(msg)
+	, m_sourcePath(sourcePath)
 	, m_destinationPath(destinationPath)
 	, m_sourceFile(Gio::File::create_for_path(sourcePath))
 	, m_destinationFile(Gio::File::create_for_path(destinationPath))
+	, m_cancellable(Gio::Cancellable::create())
 	, m_ready(sigc::mem_fun(*this, &CAsyncCopier::Ready))
+	, m_scheduler(scheduler)
+	, m_priority(priority)
+	, m_subscribed(subscribed)
+	, m_cancelHandler(subscribed ? new CCancelHandler(this, msg) : NULL)
+	, m_lastProgress(0)
+	, m_strategy(CopyHardLink)
+	, m_sourceFd(-1)
+	, m_destinationFd(-1)
+	, m_bytesCopied(0)
+	, m_cancelled(false)
+	, m_copyErrno(0)
+{
+	::memset(&m_sourceStat, 0, sizeof(m_sourceStat));
+	m_copyProgress.connect(sigc::mem_fun(*this, &CAsyncCopier::CopyProgress));
+	m_copyDone.connect(sigc::mem_fun(*this, &CAsyncCopier::CopyDone));
+}
+
+CAsyncCopier::~CAsyncCopier()
 {
+	if (m_cancelHandler.get() != NULL)
+	{
+		m_cancelHandler->Detach();
+	}
+	if (m_copyThread.joinable())
+	{
+		m_cancelled = true;
+		m_copyThread.join();
+	}
+	CloseFiles(m_cancelled);
+}
+
+// The name returned in the reply for each strategy
+const char *
+CAsyncCopier::GetStrategyName(CopyStrategy strategy)
+{
+	switch (strategy)
+	{
+		case CopyHardLink:
+			return "hardlink";
+		case CopyReflink:
+			return "reflink";
+		case CopyFileRange:
+			return "copy_file_range";
+		case CopySendfile:
+			return "sendfile";
+		case CopyGio:
+			break;
+	}
+
+	return "gio";
 }
 
 void CAsyncCopier::StartCopy()
 {
-	m_sourceFile->copy_async(m_destinationFile, m_ready);
+	if (m_subscribed)
+	{
+		ReplyProgress(0, -1);
+	}
+
+	if (TryLink())
+	{
+		Reply(true, "");
+		return;
+	}
+
+	if (OpenFiles())
+	{
+		if (TryReflink())
+		{
+			CloseFiles(false);
+			Reply(true, "");
+			return;
+		}
+
+		// Even a kernel copy of a large object takes a while so it
+		// runs on its own thread rather than in the main loop.
+		m_strategy = CopyFileRange;
+		m_copyThread = std::thread(&CAsyncCopier::CopyData, this);
+		return;
+	}
+
+	StartGioCopy();
+}
+
+// Stop a running copy.  The copier still finishes through the
+// scheduler but doesn't reply and removes the partial copy.
+void CAsyncCopier::Cancel()
+{
+	m_cancelled = true;
+	m_cancellable->cancel();
+}
+
+// Let a running copy finish without the scheduler, which is going away
+void CAsyncCopier::DetachScheduler()
+{
+	m_scheduler = NULL;
+}
+
+// Written objects are made read only so a link can stand in for a
+// copy without either side being able to change the other.  Objects
+// still being written are always copied.
+bool CAsyncCopier::TryLink()
+{
+	if (::stat(m_sourcePath.c_str(), &m_sourceStat) != 0)
+	{
+		::memset(&m_sourceStat, 0, sizeof(m_sourceStat));
+		return false;
+	}
+	if (!S_ISREG(m_sourceStat.st_mode) ||
+	        ((m_sourceStat.st_mode & (S_IWUSR | S_IWGRP | S_IWOTH)) != 0))
+	{
+		return false;
+	}
+	if (::link(m_sourcePath.c_str(), m_destinationPath.c_str()) != 0)
+	{
+		return false;
+	}
+	m_strategy = CopyHardLink;
+
+	return true;
+}
+
+// Open the source and create the destination with the same
+// permissions, as the GIO copy would.
+bool CAsyncCopier::OpenFiles()
+{
+	if (!S_ISREG(m_sourceStat.st_mode))
+	{
+		return false;
+	}
+	m_sourceFd = ::open(m_sourcePath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (m_sourceFd < 0)
+	{
+		return false;
+	}
+	m_destinationFd = ::open(m_destinationPath.c_str(),
+	                         O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+	                         m_sourceStat.st_mode & 07777);
+	if (m_destinationFd < 0)
+	{
+		CloseFiles(false);
+		return false;
+	}
+
+	return true;
+}
+
+// Share the source's blocks on filesystems that support it
+bool CAsyncCopier::TryReflink()
+{
+#ifdef FICLONE
+	if (::ioctl(m_destinationFd, FICLONE, m_sourceFd) == 0)
+	{
+		m_strategy = CopyReflink;
+		return true;
+	}
+#endif
+
+	return false;
+}
+
+// Runs on the copy thread.  copy_file_range is tried first, then
+// sendfile, and if neither can copy between the files m_strategy is
+// left at CopyGio for the main loop to fall back to.
+void CAsyncCopier::CopyData()
+{
+	// Background copies only get the disk when nothing else wants it
+	if (m_priority == CopyPriorityLow)
+	{
+		(void) SetIdleIoPriority();
+	}
+
+	off_t size = m_sourceStat.st_size;
+	off_t offset = 0;
+	while ((offset < size) && (m_strategy != CopyGio))
+	{
+		if (m_cancelled)
+		{
+			m_copyErrno = ECANCELED;
+			break;
+		}
+
+		size_t chunk = s_copyChunkSize;
+		if ((off_t) chunk > size - offset)
+		{
+			chunk = (size_t)(size - offset);
+		}
+
+		ssize_t copied;
+		if (m_strategy == CopyFileRange)
+		{
+			copied = ::copy_file_range(m_sourceFd, NULL, m_destinationFd, NULL, chunk,
+			                           0);
+		}
+		else
+		{
+			copied = ::sendfile(m_destinationFd, m_sourceFd, NULL, chunk);
+		}
+
+		if (copied < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if ((offset == 0) && IsUnsupportedCopy(errno))
+			{
+				m_strategy = (m_strategy == CopyFileRange) ? CopySendfile : CopyGio;
+				continue;
+			}
+			m_copyErrno = errno;
+			break;
+		}
+		if (copied == 0)
+		{
+			break;
+		}
+		offset += copied;
+		m_bytesCopied = offset;
+		if (m_subscribed)
+		{
+			m_copyProgress.emit();
+		}
+	}
+
+	m_copyDone.emit();
+}
+
+// Called in the main loop after the copy thread copies each chunk
+void CAsyncCopier::CopyProgress()
+{
+	ReplyProgress(m_bytesCopied, m_sourceStat.st_size);
 }
 
+// Called in the main loop once the copy thread has finished
+void CAsyncCopier::CopyDone()
+{
+	m_copyThread.join();
+
+	if ((m_strategy == CopyGio) && !m_cancelled)
+	{
+		CloseFiles(true);
+		StartGioCopy();
+		return;
+	}
+
+	// A cancelled copy failed whatever the thread got to, including one
+	// left to fall back to GIO
+	bool copyWorked = (m_copyErrno == 0) && !m_cancelled &&
+	                  (m_strategy != CopyGio);
+	if (m_cancelled && (m_copyErrno == 0))
+	{
+		m_copyErrno = ECANCELED;
+	}
+	if (copyWorked)
+	{
+		struct timespec times[2] = { m_sourceStat.st_atim, m_sourceStat.st_mtim };
+		(void) ::futimens(m_destinationFd, times);
+	}
+	CloseFiles(!copyWorked);
+
+	// Replying deletes the copier, which can't be done while the
+	// dispatcher is still calling it.
+	std::string what(copyWorked ? "" : ::strerror(m_copyErrno));
+	Glib::signal_idle().connect_once(sigc::bind(sigc::mem_fun(*this,
+	                                 &CAsyncCopier::Reply), copyWorked, what));
+}
+
+void CAsyncCopier::StartGioCopy()
+{
+	int ioPriority = Glib::PRIORITY_DEFAULT;
+	if (m_priority == CopyPriorityHigh)
+	{
+		ioPriority = Glib::PRIORITY_HIGH;
+	}
+	else if (m_priority == CopyPriorityLow)
+	{
+		ioPriority = Glib::PRIORITY_LOW;
+	}
+
+	m_strategy = CopyGio;
+	m_sourceFile->copy_async(m_destinationFile,
+	                         sigc::mem_fun(*this, &CAsyncCopier::GioProgress), m_ready,
+	                         m_cancellable, Gio::FILE_COPY_NONE, ioPriority);
+}
+
+// GIO reports progress for every block it copies, subscribers only get
+// a reply each s_copyChunkSize bytes.
+void CAsyncCopier::GioProgress(goffset current, goffset total)
+{
+	if (m_subscribed && (current - m_lastProgress >= (goffset) s_copyChunkSize))
+	{
+		ReplyProgress(current, total);
+	}
+}
+
+void CAsyncCopier::CloseFiles(bool removeDestination)
+{
+	if (m_sourceFd >= 0)
+	{
+		::close(m_sourceFd);
+		m_sourceFd = -1;
+	}
+	if (m_destinationFd >= 0)
+	{
+		::close(m_destinationFd);
+		m_destinationFd = -1;
+		if (removeDestination)
+		{
+			::unlink(m_destinationPath.c_str());
+		}
+	}
+}
 
 void CAsyncCopier::Ready(Glib::RefPtr<Gio::AsyncResult> &r)
 {
 	bool copyWorked = false;
 	string what = "";
-	MojObject reply;
-	MojErr err = reply.putString(_T("newPathName"), m_destinationPath.c_str());
 
 	try
 	{
@@ -57,8 +404,59 @@ void CAsyncCopier::Ready(Glib::RefPtr<Gio::AsyncResult> &r)
 	{
 	}
 
-	if (copyWorked)
+	// GIO may leave part of a cancelled copy behind, and a copy that
+	// finished as it was cancelled isn't wanted either
+	if (m_cancelled)
+	{
+		copyWorked = false;
+		::unlink(m_destinationPath.c_str());
+	}
+
+	Reply(copyWorked, what);
+}
+
+// Send a progress reply to a subscribed copy.  totalBytes is -1 until
+// the size of the source is known.
+void CAsyncCopier::ReplyProgress(long long bytesCopied, long long totalBytes)
+{
+	if (m_cancelled)
+	{
+		return;
+	}
+
+	MojObject reply;
+	MojErr err = reply.putString(_T("newPathName"), m_destinationPath.c_str());
+	err = reply.putBool(_T("subscribed"), true);
+	err = reply.putInt(_T("bytesCopied"), (MojInt64) bytesCopied);
+	if (totalBytes >= 0)
+	{
+		err = reply.putInt(_T("totalBytes"), (MojInt64) totalBytes);
+	}
+	err = m_msg->replySuccess(reply);
+	m_lastProgress = bytesCopied;
+}
+
+// Reply to the message with the result of the copy and hand the copy
+// slot back to the scheduler.  The copier is deleted so the caller
+// must return straight away.
+void CAsyncCopier::Reply(bool copyWorked, const std::string &what)
+{
+	MojObject reply;
+	MojErr err = reply.putString(_T("newPathName"), m_destinationPath.c_str());
+
+	if (m_cancelled)
+	{
+		// The caller has gone so there is no one to reply to
+	}
+	else if (copyWorked)
 	{
+		err = reply.putString(_T("copyStrategy"), GetStrategyName(m_strategy));
+		if (m_subscribed)
+		{
+			err = reply.putBool(_T("subscribed"), false);
+			err = reply.putInt(_T("bytesCopied"), (MojInt64) m_sourceStat.st_size);
+			err = reply.putInt(_T("totalBytes"), (MojInt64) m_sourceStat.st_size);
+		}
 		err = m_msg->replySuccess(reply);
 	}
 	else
@@ -74,5 +472,9 @@ void CAsyncCopier::Ready(Glib::RefPtr<Gio::AsyncResult> &r)
 		}
 		err = m_msg->replyError((MojErr) FCCopyObjectError, msgText.c_str());
 	}
+	if (m_scheduler != NULL)
+	{
+		m_scheduler->CopyFinished(this);
+	}
 	delete this;
 }
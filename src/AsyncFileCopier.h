@@ -20,26 +20,129 @@
 #include <boost/noncopyable.hpp>
 #include <giomm/file.h>
 #include <giomm/asyncresult.h>
+#include <giomm/cancellable.h>
+#include <glibmm/dispatcher.h>
+#include <atomic>
 #include <string>
+#include <thread>
+
+#include <sys/stat.h>
 
 #include "core/MojService.h"
 #include "luna/MojLunaMessage.h"
+#include "CopyScheduler.h"
+
+// The most bytes copied by one copy_file_range or sendfile call, and
+// the most copied between progress replies to a subscribed copy
+static const size_t s_copyChunkSize = 16 * 1024 * 1024;
+
+// The ways a copy can be made, cheapest first.  Each is tried in turn
+// until one works for the source and destination.
+enum CopyStrategy
+{
+	CopyHardLink,
+	CopyReflink,
+	CopyFileRange,
+	CopySendfile,
+	CopyGio
+};
 
+// Copies a cached object out of the cache and replies to the message
+// with the new path and the strategy used.  Written objects are read
+// only so they are hard linked when the destination is on the same
+// filesystem.  Otherwise the data is reflinked, copied in the kernel
+// with copy_file_range or sendfile on a thread, or as a last resort
+// copied by GIO.  A subscribed copy gets progress replies while the
+// data is copied and is stopped if the caller cancels.  Copiers are
+// run by a CCopyScheduler and delete themselves once they reply.
 class CAsyncCopier : public boost::noncopyable
 {
 public:
 	CAsyncCopier(const std::string &sourcePath, const std::string &destinationPath,
-	             MojServiceMessage *msg);
+	             MojServiceMessage *msg, CCopyScheduler *scheduler,
+	             CopyPriority priority, bool subscribed);
+
+	~CAsyncCopier();
 
 	void StartCopy();
 	void Ready(Glib::RefPtr<Gio::AsyncResult> &);
 
+	// Stop a running copy.  The copier still finishes through the
+	// scheduler but doesn't reply and removes the partial copy.
+	void Cancel();
+
+	// Let a running copy finish without telling the scheduler, for a
+	// scheduler that is destroyed before its copies finish
+	void DetachScheduler();
+
+	CopyPriority GetPriority() const
+	{
+		return m_priority;
+	}
+
+	// The name returned in the reply for each strategy
+	static const char *GetStrategyName(CopyStrategy strategy);
+
 private:
+	// Forwards the cancel of a subscribed copy to the scheduler.  It is
+	// reference counted by the message so it outlives the copier.
+	class CCancelHandler : public MojSignalHandler
+	{
+	public:
+		CCancelHandler(CAsyncCopier *copier, MojServiceMessage *msg);
+
+		void Detach()
+		{
+			m_copier = NULL;
+		}
+
+	private:
+		MojErr HandleCancel(MojServiceMessage *msg);
+
+		CAsyncCopier *m_copier;
+		MojServiceMessage::CancelSignal::Slot<CCancelHandler> m_cancelSlot;
+	};
+
+	bool TryLink();
+	bool OpenFiles();
+	bool TryReflink();
+	void CopyData();
+	void CopyProgress();
+	void CopyDone();
+	void StartGioCopy();
+	void GioProgress(goffset current, goffset total);
+	void CloseFiles(bool removeDestination);
+	void ReplyProgress(long long bytesCopied, long long totalBytes);
+	void Reply(bool copyWorked, const std::string &what);
+
 	MojRefCountedPtr<MojServiceMessage> m_msg;
+	std::string m_sourcePath;
 	std::string m_destinationPath;
 	Glib::RefPtr<Gio::File> m_sourceFile;
 	Glib::RefPtr<Gio::File> m_destinationFile;
+	Glib::RefPtr<Gio::Cancellable> m_cancellable;
 	Gio::SlotAsyncReady m_ready;
+
+	CCopyScheduler *m_scheduler;
+	CopyPriority m_priority;
+	bool m_subscribed;
+	MojRefCountedPtr<CCancelHandler> m_cancelHandler;
+	long long m_lastProgress;
+
+	CopyStrategy m_strategy;
+	struct stat m_sourceStat;
+	int m_sourceFd;
+	int m_destinationFd;
+
+	// The data copy thread signals the main loop through m_copyProgress
+	// after each chunk and through m_copyDone when it has finished,
+	// leaving its result in m_copyErrno.
+	std::thread m_copyThread;
+	Glib::Dispatcher m_copyProgress;
+	Glib::Dispatcher m_copyDone;
+	std::atomic<long long> m_bytesCopied;
+	std::atomic<bool> m_cancelled;
+	int m_copyErrno;
 };
 
 #endif
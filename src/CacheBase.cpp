@@ -17,6 +17,13 @@
 #include "CacheBase.h"
 #include "FileCacheSet.h"
 
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <zlib.h>
+
 #include "boost/filesystem.hpp"
 namespace fs = boost::filesystem;
 
@@ -46,6 +53,38 @@ GetCharNFromObjectId(const cachedObjectId_t objectId, const int n)
 	return s_charMapping[index];
 }
 
+// The value of each encoded character, indexed by the character, or
+// -1 for characters that aren't part of the encoding.
+class CCharValues
+{
+public:
+
+	CCharValues()
+	{
+		memset(m_values, -1, sizeof(m_values));
+		for (int i = 0; s_charMapping[i] != '\0'; i++)
+		{
+			m_values[(unsigned char) s_charMapping[i]] = (signed char) i;
+		}
+	}
+
+	int operator[](const unsigned char c) const
+	{
+		return m_values[c];
+	}
+
+private:
+
+	signed char m_values[256];
+};
+
+static const CCharValues &
+GetCharValues()
+{
+	static const CCharValues s_charValues;
+	return s_charValues;
+}
+
 // Returns the index of the character in the encoding array.  This
 // index is the value of the 6 bits of the object id represented by
 // this character.
@@ -53,19 +92,38 @@ paramValue_t
 GetValueForChar(const int c)
 {
 
-	// find where in the mapping array the current character resides.
-	const char *indexChar = index(s_charMapping, c);
-
-	// If we don't find a match, there is an error since the encoding is
-	// 1 to 1.
-	if (indexChar == NULL)
+	if ((c < 0) || (c > 255))
 	{
 		return -1;
 	}
 
-	// The value at this character location is the index into the
-	// encoding array.
-	return (paramValue_t)(indexChar - s_charMapping);
+	return (paramValue_t) GetCharValues()[(unsigned char) c];
+}
+
+// Writes the s_numChars encoded characters of the object id, most
+// significant first, to encodedId.  No terminating null is written.
+void
+EncodeObjectId(const cachedObjectId_t objectId, char *encodedId)
+{
+
+	for (int i = 0; i < s_numChars; i++)
+	{
+		int shiftValue = (s_numChars - i - 1) * s_maskSize;
+		encodedId[i] = s_charMapping[(objectId >> shiftValue) & s_mask];
+	}
+}
+
+// The extended attribute holding the record of an object whose file is
+// a hard link shared with other objects
+const std::string
+GetLinkAttrName(const cachedObjectId_t objectId)
+{
+
+	char encodedId[s_numChars];
+	EncodeObjectId(objectId, encodedId);
+
+	return std::string(s_objectAttrName) + "." +
+	       std::string(encodedId, s_numChars);
 }
 
 // Returns the object id from the path.  This assumes the path is of
@@ -76,70 +134,37 @@ cachedObjectId_t
 GetObjectIdFromPath(const char *filePath)
 {
 
-	long endPos;
-
 	// find the position of the last period that indicates the end of
 	// the object id and the start of the extension
-	const char *endChar = rindex(filePath, (int)'.');
-	if (endChar == NULL)
+	const char *endChar = strrchr(filePath, '.');
+	size_t endPos = (endChar == NULL) ? strlen(filePath) :
+	                (size_t)(endChar - filePath);
+
+	// The object id is the s_numChars characters before the end with
+	// a directory '/' after the first s_dirChars of them.
+	if (endPos < (size_t) s_numChars + 1)
 	{
-		endPos = (int) strlen(filePath);
+		return 0;
 	}
-	else
+	const char *idChars = filePath + endPos - s_numChars - 1;
+	if (idChars[s_dirChars] != '/')
 	{
-		endPos = endChar - filePath;
+		return 0;
 	}
 
-	// The starting position is the ending position minus the number of
-	// characters in the object id minus 1 for the directory '/'.
-	long curPos = endPos - s_numChars - 1;
-
-	// Walk the string and generate the object id char by char.
-	int i = 0;
-	bool foundDelimiter = false;
+	const CCharValues &charValues = GetCharValues();
 	cachedObjectId_t objectId = 0;
-	while (curPos < endPos)
+	for (int i = 0; i <= s_numChars; i++)
 	{
-
-		// Skip if this is the directory marker
-		if (strncmp(&(filePath[curPos]), "/", 1))
+		if (i != s_dirChars)
 		{
-
-			// Get the value for the current character and make sure it's
-			// not -1
-			paramValue_t tmp =  GetValueForChar((int)filePath[curPos]);
-			if (tmp < 0)
+			int value = charValues[(unsigned char) idChars[i]];
+			if (value < 0)
 			{
 				return 0;
 			}
-			cachedObjectId_t value = (cachedObjectId_t) tmp;
-
-			// compute the mask shift value for this character index.
-			int shiftValue = (s_numChars - i - 1) * s_maskSize;
-
-			// accumulate the object id from each characters value.
-			objectId += (value << shiftValue);
-			i++;
-		}
-		else
-		{
-			// Make sure the delimiter is in the correct position or else
-			// abort the loop
-			if (i == s_dirChars)
-			{
-				foundDelimiter = true;
-			}
-			else
-			{
-				curPos = endPos;
-			}
+			objectId = (objectId << s_maskSize) | (cachedObjectId_t) value;
 		}
-		curPos++;
-	}
-
-	if (!foundDelimiter || (i != s_numChars))
-	{
-		objectId = 0;
 	}
 
 	return objectId;
@@ -153,18 +178,60 @@ GetTypeNameFromPath(const std::string &baseDirName,
                     const std::string &filePath)
 {
 
-	std::string typeName;
-	if (baseDirName == filePath.substr(0, baseDirName.length()))
+	const char *typeName;
+	size_t length;
+	if (!FindTypeNameInPath(baseDirName, filePath.c_str(), &typeName, &length))
 	{
-		std::string::size_type startPos = baseDirName.length() + 1;
-		std::string::size_type endPos = filePath.find('/', startPos);
-		if ((endPos != std::string::npos) && (endPos > startPos))
-		{
-			typeName = filePath.substr(startPos, endPos - startPos);
-		}
+		return std::string();
 	}
 
-	return typeName;
+	return std::string(typeName, length);
+}
+
+// Finds the typeName in the path without copying it.  On success
+// typeName points into filePath and length is set to the number of
+// characters in the name.
+bool
+FindTypeNameInPath(const std::string &baseDirName, const char *filePath,
+                   const char **typeName, size_t *length)
+{
+
+	size_t baseLength = baseDirName.length();
+	if ((strncmp(filePath, baseDirName.c_str(), baseLength) != 0) ||
+	        (filePath[baseLength] == '\0'))
+	{
+		return false;
+	}
+
+	const char *startChar = filePath + baseLength + 1;
+	const char *endChar = strchr(startChar, '/');
+	if ((endChar == NULL) || (endChar == startChar))
+	{
+		return false;
+	}
+	*typeName = startChar;
+	*length = (size_t)(endChar - startChar);
+
+	return true;
+}
+
+// Returns true if the typeName in the path, or an empty name if the
+// path has none, is typeName.  This is the same as comparing the
+// result of GetTypeNameFromPath without building a string.
+bool
+PathHasTypeName(const std::string &baseDirName, const char *filePath,
+                const std::string &typeName)
+{
+
+	const char *pathTypeName;
+	size_t length;
+	if (!FindTypeNameInPath(baseDirName, filePath, &pathTypeName, &length))
+	{
+		return typeName.empty();
+	}
+
+	return (length == typeName.length()) &&
+	       (memcmp(pathTypeName, typeName.data(), length) == 0);
 }
 
 // returns the directory path for the cached object from the complete
@@ -186,18 +253,49 @@ GetDirectoryFromPath(const std::string &pathname)
 
 }
 
+// Copies the directory path for the cached object from the complete
+// pathname into dirpath, a buffer of size bytes.  Returns the length
+// of the directory path, or 0 if there is none or it doesn't fit.
+size_t
+GetDirectoryFromPath(const char *pathname, char *dirpath, size_t size)
+{
+
+	const char *endChar = strrchr(pathname, '/');
+	size_t length = (endChar == NULL) ? 0 : (size_t)(endChar - pathname);
+	if ((length == 0) || (length >= size))
+	{
+		if (size > 0)
+		{
+			dirpath[0] = '\0';
+		}
+		return 0;
+	}
+	memcpy(dirpath, pathname, length);
+	dirpath[length] = '\0';
+
+	return length;
+}
+
 // Returns the extension from a filename where the extension does not
 // include a '/' or a '.'
 const std::string
 GetFileExtension(const char *filePath)
 {
 
-	std::string tmp(filePath);
-	std::string extension("");
-	std::string::size_type startPos = tmp.find_last_of("./");
-	if ((startPos != std::string::npos) && (tmp[startPos] == '.'))
+	return std::string(FindFileExtension(filePath));
+}
+
+// Returns a pointer to the extension, including the '.', within
+// filePath, or to its terminating null if it has no extension.
+const char *
+FindFileExtension(const char *filePath)
+{
+
+	// The last '.' only starts an extension if no directory follows it
+	const char *extension = strrchr(filePath, '.');
+	if ((extension == NULL) || (strchr(extension, '/') != NULL))
 	{
-		extension = tmp.substr(startPos);
+		extension = filePath + strlen(filePath);
 	}
 
 	return extension;
@@ -229,97 +327,314 @@ BuildPathname(const cachedObjectId_t objectId, const std::string &basePath,
               bool createDir)
 {
 
+	char pathname[s_maxPathnameLength];
+	size_t length = BuildPathname(pathname, sizeof(pathname), objectId,
+	                              basePath, typeName, fileName.c_str(),
+	                              createDir);
+
+	return std::string(pathname, length);
+}
+
+// Builds the path to a cached object in pathname, a buffer of size
+// bytes, without allocating.  Returns the length of the path, or 0 if
+// the object id is 0, the path doesn't fit or the directory couldn't
+// be created.  fileName may be NULL if there is no extension.
+size_t
+BuildPathname(char *pathname, size_t size, const cachedObjectId_t objectId,
+              const std::string &basePath, const std::string &typeName,
+              const char *fileName, bool createDir)
+{
+
+	if (size > 0)
+	{
+		pathname[0] = '\0';
+	}
 	if (objectId == 0)
 	{
-		return std::string("");
+		return 0;
 	}
 
-	// Build the pathname from the parts, starting with the base path
-	std::string pathname(basePath);
-
-	// create the full path name from the file cache base directory, the
-	// typename, the id and the filename
-	pathname += std::string("/") + typeName + std::string("/");
-
-	// Use the first s_dirChars encoded chars to define a directory name
-	for (int i = (s_numChars - 1); i > (s_numChars - s_dirChars - 1); i--)
+	// The path is the base path, the typename, the first s_dirChars
+	// encoded chars as a directory name and the remaining chars as the
+	// file name along with the extension.
+	const char *extension = (fileName == NULL) ? "" : FindFileExtension(fileName);
+	size_t extensionLength = strlen(extension);
+	size_t length = basePath.length() + typeName.length() + s_numChars +
+	                extensionLength + 3;
+	if (length >= size)
 	{
-		char c = GetCharNFromObjectId(objectId, i);
-		if (c != ' ')
-		{
-			pathname += c;
-		}
-		else
-		{
-			pathname.clear();
-			break;
-		}
+		return 0;
 	}
 
-	if (createDir && !pathname.empty())
+	char encodedId[s_numChars];
+	EncodeObjectId(objectId, encodedId);
+
+	char *curChar = pathname;
+	memcpy(curChar, basePath.data(), basePath.length());
+	curChar += basePath.length();
+	*curChar++ = '/';
+	memcpy(curChar, typeName.data(), typeName.length());
+	curChar += typeName.length();
+	*curChar++ = '/';
+	memcpy(curChar, encodedId, s_dirChars);
+	curChar += s_dirChars;
+
+	if (createDir)
 	{
 		// Make sure the directory exists and set the correct directory permissions
-		int retVal = ::mkdir(pathname.c_str(), s_dirPerms);
+		*curChar = '\0';
+		int retVal = ::mkdir(pathname, s_dirPerms);
 		if (retVal != 0 && errno != EEXIST)
 		{
 			int savedErrno = errno;
 			printf("Failed to create directory \'%s\' (%s)\n",
-			       pathname.c_str(), ::strerror(savedErrno));
-			pathname.clear();
+			       pathname, ::strerror(savedErrno));
+			pathname[0] = '\0';
+			return 0;
 		}
 	}
 
-	// The remaining chars will be the file name along with the
-	// extension
-	if (!pathname.empty())
-	{
-		pathname += std::string("/");
-		for (int i = (s_numChars - s_dirChars - 1); i >= 0; i--)
-		{
-			char c = GetCharNFromObjectId(objectId, i);
-			if (c != ' ')
-			{
-				pathname += c;
-			}
-			else
-			{
-				pathname.clear();
-				break;
-			}
-		}
-		if (!fileName.empty() && !pathname.empty())
-		{
-			pathname += GetFileExtension(fileName.c_str());
-		}
-	}
+	*curChar++ = '/';
+	memcpy(curChar, encodedId + s_dirChars, s_numChars - s_dirChars);
+	curChar += s_numChars - s_dirChars;
+	memcpy(curChar, extension, extensionLength + 1);
 
-	return pathname;
+	return length;
 }
 
+// The block size space is accounted in.  It is set once at startup
+// before any threads that account space are started.
+static cacheSize_t s_fsBlockSize = s_blockSize;
+
 // Return the filesize as it resides on disk after accounting for the
 // filesystem blocksize
 cacheSize_t
 GetFilesystemFileSize(const cacheSize_t size)
 {
 
+	const cacheSize_t blockSize = s_fsBlockSize;
 	cacheSize_t realSize = 0;
 	if (size > 0)
 	{
-		realSize = (size + s_blockSize - 1) / s_blockSize;
-		realSize *= s_blockSize;
+		realSize = (size + blockSize - 1) / blockSize;
+		realSize *= blockSize;
 	}
 	else
 	{
-		realSize = s_blockSize;
+		realSize = blockSize;
 	}
 
 	// This is a hack to account for the fact that sometime ext3 isn't
 	// using the inode to store the extended attributes.
-	realSize += s_blockSize;
+	realSize += blockSize;
 
 	return realSize;
 }
 
+// The block size GetFilesystemFileSize rounds to
+cacheSize_t
+GetBlockSize()
+{
+
+	return s_fsBlockSize;
+}
+
+// Set the block size GetFilesystemFileSize rounds to
+void
+SetBlockSize(const cacheSize_t blockSize)
+{
+
+	s_fsBlockSize = blockSize;
+}
+
+// The allocation unit of the filesystem holding dirname, or -1 if it
+// can't be read
+cacheSize_t
+GetFilesystemBlockSize(const std::string &dirname)
+{
+
+	struct statvfs buf;
+	if (::statvfs(dirname.c_str(), &buf) != 0)
+	{
+		return -1;
+	}
+
+	// Older filesystems leave the fragment size 0
+	const unsigned long blockSize = (buf.f_frsize != 0) ? buf.f_frsize :
+	                                buf.f_bsize;
+	if ((blockSize < 512) || (blockSize > (1024 * 1024)))
+	{
+		return -1;
+	}
+
+	return (cacheSize_t) blockSize;
+}
+
+// The space left to unprivileged users on the filesystem holding
+// dirname, or -1 if it can't be read
+cacheSize_t
+GetFilesystemFreeSpace(const std::string &dirname)
+{
+
+	struct statvfs buf;
+	if (::statvfs(dirname.c_str(), &buf) != 0)
+	{
+		return -1;
+	}
+	const unsigned long blockSize = (buf.f_frsize != 0) ? buf.f_frsize :
+	                                buf.f_bsize;
+
+	return (cacheSize_t) buf.f_bavail * (cacheSize_t) blockSize;
+}
+
+// The percentage of the last 10 seconds some task was stalled, or -1
+// if it can't be read
+double
+GetPressure(const std::string &pathname)
+{
+
+	std::ifstream infile(pathname.c_str());
+	std::string label;
+	while ((infile >> label).good())
+	{
+		if (label == "some")
+		{
+			std::string field;
+			infile >> field;
+			if (field.compare(0, 6, "avg10=") == 0)
+			{
+				return ::strtod(field.c_str() + 6, NULL);
+			}
+			break;
+		}
+	}
+
+	return -1;
+}
+
+// The space the cache can take between minSpace and maxSpace, given
+// the free space of its filesystem and the pressure on the system,
+// and never less than guaranteedSpace
+cacheSize_t
+ComputeCacheSpace(const cacheSize_t minSpace, const cacheSize_t maxSpace,
+                  const cacheSize_t guaranteedSpace,
+                  const cacheSize_t cacheSize, const cacheSize_t freeSpace,
+                  const cacheSize_t reservedSpace, const double pressure)
+{
+
+	const cacheSize_t lowest = std::max(minSpace, guaranteedSpace);
+	cacheSize_t space = maxSpace;
+	if (freeSpace >= 0)
+	{
+		space = std::min(space, cacheSize + freeSpace - reservedSpace);
+	}
+	space = std::max(space, lowest);
+
+	if (pressure > s_pressureLow)
+	{
+		const double cut = std::min(1.0, (pressure - s_pressureLow) /
+		                            (s_pressureHigh - s_pressureLow));
+		space -= (cacheSize_t)((double)(space - lowest) * cut);
+	}
+
+	return space;
+}
+
+// Allocate the disk space for the first size bytes of a file without
+// changing its length
+bool
+ReserveFileSpace(const std::string &pathname, const cacheSize_t size,
+                 std::string &msgText)
+{
+
+#ifdef MOJ_MAC
+	errno = EOPNOTSUPP;
+	msgText = "Reserving space isn't supported.";
+	return false;
+#else
+	int fd = ::open(pathname.c_str(), O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		int savedErrno = errno;
+		msgText = "Failed to open file '" + pathname + "' to reserve space ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		errno = savedErrno;
+		return false;
+	}
+
+	int savedErrno = 0;
+	if ((size > 0) &&
+	        (::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, (off_t) size) != 0))
+	{
+		savedErrno = errno;
+		msgText = "Failed to reserve space for file '" + pathname + "' ("
+		          + std::string(::strerror(savedErrno)) + ").";
+	}
+	(void) ::close(fd);
+	errno = savedErrno;
+
+	return savedErrno == 0;
+#endif // #ifdef MOJ_MAC
+}
+
+// Give back whatever space is allocated for a file past its end.
+// Truncating a file to its own length frees the blocks past the end,
+// punching a hole there does nothing since holes stop at the end.
+bool
+ReleaseFileSpace(const std::string &pathname, std::string &msgText)
+{
+
+	int fd = ::open(pathname.c_str(), O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		int savedErrno = errno;
+		msgText = "Failed to open file '" + pathname + "' to release space ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		return false;
+	}
+
+	bool success = true;
+	struct stat buf;
+	if ((::fstat(fd, &buf) != 0) || (::ftruncate(fd, buf.st_size) != 0))
+	{
+		int savedErrno = errno;
+		msgText = "Failed to release space of file '" + pathname + "' ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		success = false;
+	}
+	(void) ::close(fd);
+
+	return success;
+}
+
+// Ask the kernel to start reading a file into the page cache
+bool
+PrefetchFile(const std::string &pathname, std::string &msgText)
+{
+
+	int fd = ::open(pathname.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		int savedErrno = errno;
+		msgText = "Failed to open file '" + pathname + "' to prefetch ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		return false;
+	}
+
+	int result = 0;
+#ifndef MOJ_MAC
+	result = ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+	if (result != 0)
+	{
+		msgText = "Failed to prefetch file '" + pathname + "' ("
+		          + std::string(::strerror(result)) + ").";
+	}
+#endif // #ifndef MOJ_MAC
+	(void) ::close(fd);
+
+	return result == 0;
+}
+
 // call fsync on the provided file
 bool
 SyncFile(const std::string &pathname, std::string &msgText)
@@ -360,6 +675,636 @@ SyncFile(const std::string &pathname, std::string &msgText)
 	return suceeded;
 }
 
+// The XXH64 primes
+static const uint64_t s_hashPrime1 = 11400714785074694791ULL;
+static const uint64_t s_hashPrime2 = 14029467366897019727ULL;
+static const uint64_t s_hashPrime3 = 1609587929392839161ULL;
+static const uint64_t s_hashPrime4 = 9650029242287828579ULL;
+static const uint64_t s_hashPrime5 = 2870177450012600261ULL;
+
+// Files are hashed and compared in blocks of this size, a multiple of
+// the 32 byte stripe so only the last block has a tail
+static const size_t s_hashBlockSize = 64 * 1024;
+
+static inline uint64_t
+RotateLeft(const uint64_t value, const int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t
+Read64(const unsigned char *data)
+{
+	uint64_t value;
+	::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static inline uint64_t
+HashRound(uint64_t acc, const uint64_t input)
+{
+	acc += input * s_hashPrime2;
+	return RotateLeft(acc, 31) * s_hashPrime1;
+}
+
+static inline uint64_t
+HashMerge(uint64_t acc, const uint64_t value)
+{
+	acc ^= HashRound(0, value);
+	return acc * s_hashPrime1 + s_hashPrime4;
+}
+
+// Read up to size bytes, only returning fewer at the end of the file.
+// Returns -1 on an error.
+static ssize_t
+ReadFully(int fd, unsigned char *buf, size_t size)
+{
+	size_t total = 0;
+	while (total < size)
+	{
+		ssize_t length = ::read(fd, buf + total, size - total);
+		if (length < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+		if (length == 0)
+		{
+			break;
+		}
+		total += (size_t) length;
+	}
+
+	return (ssize_t) total;
+}
+
+// Hash the content of a file with XXH64, seed 0.  The four lanes are
+// independent so the compiler can keep them in flight together.
+bool
+HashFile(const std::string &pathname, uint64_t &hash, std::string &msgText)
+{
+
+#ifdef MOJ_MAC
+	int fd = ::open(pathname.c_str(), O_RDONLY);
+#else
+	int fd = ::open(pathname.c_str(), O_RDONLY | O_NOATIME);
+#endif // #ifdef MOJ_MAC
+	if (fd == -1)
+	{
+		int savedErrno = errno;
+		msgText = "Failed to open file '" + pathname + "' to hash ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		return false;
+	}
+
+	std::vector<unsigned char> buf(s_hashBlockSize);
+	uint64_t v1 = s_hashPrime1 + s_hashPrime2;
+	uint64_t v2 = s_hashPrime2;
+	uint64_t v3 = 0;
+	uint64_t v4 = 0 - s_hashPrime1;
+	uint64_t totalLength = 0;
+	const unsigned char *p = buf.data();
+	size_t tail = 0;
+	ssize_t length;
+	while ((length = ReadFully(fd, buf.data(), buf.size())) > 0)
+	{
+		totalLength += (uint64_t) length;
+		const size_t stripes = (size_t) length / 32;
+		p = buf.data();
+		for (size_t i = 0; i < stripes; i++, p += 32)
+		{
+			v1 = HashRound(v1, Read64(p));
+			v2 = HashRound(v2, Read64(p + 8));
+			v3 = HashRound(v3, Read64(p + 16));
+			v4 = HashRound(v4, Read64(p + 24));
+		}
+		tail = (size_t) length % 32;
+		if ((size_t) length < buf.size())
+		{
+			break;
+		}
+	}
+	bool success = (length >= 0);
+	if (!success)
+	{
+		int savedErrno = errno;
+		msgText = "Failed to read file '" + pathname + "' to hash ("
+		          + std::string(::strerror(savedErrno)) + ").";
+	}
+	::close(fd);
+	if (!success)
+	{
+		return false;
+	}
+
+	uint64_t h;
+	if (totalLength >= 32)
+	{
+		h = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) +
+		    RotateLeft(v4, 18);
+		h = HashMerge(h, v1);
+		h = HashMerge(h, v2);
+		h = HashMerge(h, v3);
+		h = HashMerge(h, v4);
+	}
+	else
+	{
+		h = s_hashPrime5;
+	}
+	h += totalLength;
+
+	// The tail is whatever the last block left after its stripes
+	while (tail >= 8)
+	{
+		h ^= HashRound(0, Read64(p));
+		h = RotateLeft(h, 27) * s_hashPrime1 + s_hashPrime4;
+		p += 8;
+		tail -= 8;
+	}
+	if (tail >= 4)
+	{
+		uint32_t value;
+		::memcpy(&value, p, sizeof(value));
+		h ^= (uint64_t) value * s_hashPrime1;
+		h = RotateLeft(h, 23) * s_hashPrime2 + s_hashPrime3;
+		p += 4;
+		tail -= 4;
+	}
+	while (tail > 0)
+	{
+		h ^= (uint64_t) *p * s_hashPrime5;
+		h = RotateLeft(h, 11) * s_hashPrime1;
+		p++;
+		tail--;
+	}
+
+	h ^= h >> 33;
+	h *= s_hashPrime2;
+	h ^= h >> 29;
+	h *= s_hashPrime3;
+	h ^= h >> 32;
+	hash = h;
+
+	return true;
+}
+
+// Returns true if two files have the same content
+bool
+CompareFiles(const std::string &pathname1, const std::string &pathname2)
+{
+
+	int fd1 = ::open(pathname1.c_str(), O_RDONLY);
+	int fd2 = ::open(pathname2.c_str(), O_RDONLY);
+	bool same = (fd1 != -1) && (fd2 != -1);
+	struct stat buf1;
+	struct stat buf2;
+	if (same)
+	{
+		same = (::fstat(fd1, &buf1) == 0) && (::fstat(fd2, &buf2) == 0) &&
+		       (buf1.st_size == buf2.st_size);
+	}
+
+	std::vector<unsigned char> data1(same ? s_hashBlockSize : 0);
+	std::vector<unsigned char> data2(same ? s_hashBlockSize : 0);
+	while (same)
+	{
+		ssize_t length1 = ReadFully(fd1, data1.data(), data1.size());
+		ssize_t length2 = ReadFully(fd2, data2.data(), data2.size());
+		same = (length1 >= 0) && (length1 == length2) &&
+		       (::memcmp(data1.data(), data2.data(), (size_t) length1) == 0);
+		if (length1 < (ssize_t) data1.size())
+		{
+			break;
+		}
+	}
+	if (fd1 != -1)
+	{
+		::close(fd1);
+	}
+	if (fd2 != -1)
+	{
+		::close(fd2);
+	}
+
+	return same;
+}
+
+// Objects are compressed at zlib's fastest level, most of the space a
+// higher level saves isn't worth the time it costs every write
+static const int s_compressLevel = Z_BEST_SPEED;
+
+// Write all of buf to fd
+static bool
+WriteFully(int fd, const unsigned char *buf, size_t size)
+{
+	size_t total = 0;
+	while (total < size)
+	{
+		ssize_t length = ::write(fd, buf + total, size - total);
+		if (length < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return false;
+		}
+		total += (size_t) length;
+	}
+
+	return true;
+}
+
+// Run a file through zlib into a new file at outPath, deflating or
+// inflating it, and set outSize to the size of the new file.  The new
+// file is synced if it's to replace the original.
+static bool
+ZlibFile(const std::string &pathname, const std::string &outPath,
+         const bool deflating, const bool sync, cacheSize_t &outSize,
+         std::string &msgText)
+{
+
+	int inFd = ::open(pathname.c_str(), O_RDONLY);
+	if (inFd == -1)
+	{
+		int savedErrno = errno;
+		msgText = "Failed to open file '" + pathname + "' ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		return false;
+	}
+	int outFd = ::open(outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+	                   s_fileRWPerms);
+	if (outFd == -1)
+	{
+		int savedErrno = errno;
+		msgText = "Failed to create file '" + outPath + "' ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		::close(inFd);
+		return false;
+	}
+
+	z_stream stream;
+	::memset(&stream, 0, sizeof(stream));
+	int retVal = deflating ? deflateInit(&stream, s_compressLevel) :
+	             inflateInit(&stream);
+	bool success = (retVal == Z_OK);
+	if (!success)
+	{
+		msgText = "Failed to start zlib for '" + pathname + "'.";
+	}
+
+	std::vector<unsigned char> inBuf(s_hashBlockSize);
+	std::vector<unsigned char> outBuf(s_hashBlockSize);
+	outSize = 0;
+	bool atEnd = false;
+	while (success && !atEnd)
+	{
+		ssize_t length = ReadFully(inFd, inBuf.data(), inBuf.size());
+		if (length < 0)
+		{
+			int savedErrno = errno;
+			msgText = "Failed to read file '" + pathname + "' ("
+			          + std::string(::strerror(savedErrno)) + ").";
+			success = false;
+			break;
+		}
+		const bool lastBlock = ((size_t) length < inBuf.size());
+		stream.next_in = inBuf.data();
+		stream.avail_in = (uInt) length;
+		do
+		{
+			stream.next_out = outBuf.data();
+			stream.avail_out = (uInt) outBuf.size();
+			retVal = deflating ? ::deflate(&stream, lastBlock ? Z_FINISH : Z_NO_FLUSH) :
+			         ::inflate(&stream, Z_NO_FLUSH);
+			if ((retVal != Z_OK) && (retVal != Z_STREAM_END) &&
+			        (retVal != Z_BUF_ERROR))
+			{
+				msgText = "File '" + pathname + "' is not valid compressed data.";
+				success = false;
+				break;
+			}
+			const size_t have = outBuf.size() - stream.avail_out;
+			if (!WriteFully(outFd, outBuf.data(), have))
+			{
+				int savedErrno = errno;
+				msgText = "Failed to write file '" + outPath + "' ("
+				          + std::string(::strerror(savedErrno)) + ").";
+				success = false;
+				break;
+			}
+			outSize += (cacheSize_t) have;
+		}
+		while (stream.avail_out == 0);
+		atEnd = lastBlock || (retVal == Z_STREAM_END);
+	}
+
+	// A compressed file that ends before its stream does is truncated
+	if (success && !deflating && (retVal != Z_STREAM_END))
+	{
+		msgText = "File '" + pathname + "' is truncated.";
+		success = false;
+	}
+	if (deflating)
+	{
+		(void) deflateEnd(&stream);
+	}
+	else
+	{
+		(void) inflateEnd(&stream);
+	}
+
+	if (success && sync && (::fsync(outFd) != 0))
+	{
+		int savedErrno = errno;
+		msgText = "Failed to sync file '" + outPath + "' ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		success = false;
+	}
+	::close(inFd);
+	if ((::close(outFd) != 0) && success)
+	{
+		int savedErrno = errno;
+		msgText = "Failed to close file '" + outPath + "' ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		success = false;
+	}
+	if (!success)
+	{
+		(void) ::unlink(outPath.c_str());
+	}
+
+	return success;
+}
+
+// Compress a file with zlib at its fastest level into a new file at
+// compressedPath, which is synced so it can replace the original
+bool
+CompressFile(const std::string &pathname, const std::string &compressedPath,
+             cacheSize_t &storedSize, std::string &msgText)
+{
+
+	return ZlibFile(pathname, compressedPath, true, true, storedSize, msgText);
+}
+
+// Decompress a file written by CompressFile into a new file at
+// pathname.  It's only a view of the object so it isn't synced.
+bool
+DecompressFile(const std::string &compressedPath, const std::string &pathname,
+               cacheSize_t &size, std::string &msgText)
+{
+
+	return ZlibFile(compressedPath, pathname, false, false, size, msgText);
+}
+
+// Copy a file into a new file at copyPath, which is synced so it can
+// replace the original
+bool
+CopyFile(const std::string &pathname, const std::string &copyPath,
+         cacheSize_t &size, std::string &msgText)
+{
+
+	int inFd = ::open(pathname.c_str(), O_RDONLY);
+	if (inFd == -1)
+	{
+		int savedErrno = errno;
+		msgText = "Failed to open file '" + pathname + "' ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		return false;
+	}
+	int outFd = ::open(copyPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+	                   s_fileRWPerms);
+	if (outFd == -1)
+	{
+		int savedErrno = errno;
+		msgText = "Failed to create file '" + copyPath + "' ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		::close(inFd);
+		return false;
+	}
+
+	bool success = true;
+	std::vector<unsigned char> buf(s_hashBlockSize);
+	size = 0;
+	ssize_t length;
+	while ((length = ReadFully(inFd, buf.data(), buf.size())) > 0)
+	{
+		if (!WriteFully(outFd, buf.data(), (size_t) length))
+		{
+			int savedErrno = errno;
+			msgText = "Failed to write file '" + copyPath + "' ("
+			          + std::string(::strerror(savedErrno)) + ").";
+			success = false;
+			break;
+		}
+		size += (cacheSize_t) length;
+	}
+	if (success && (length < 0))
+	{
+		int savedErrno = errno;
+		msgText = "Failed to read file '" + pathname + "' ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		success = false;
+	}
+
+	if (success && (::fsync(outFd) != 0))
+	{
+		int savedErrno = errno;
+		msgText = "Failed to sync file '" + copyPath + "' ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		success = false;
+	}
+	::close(inFd);
+	if ((::close(outFd) != 0) && success)
+	{
+		int savedErrno = errno;
+		msgText = "Failed to close file '" + copyPath + "' ("
+		          + std::string(::strerror(savedErrno)) + ").";
+		success = false;
+	}
+	if (!success)
+	{
+		(void) ::unlink(copyPath.c_str());
+	}
+
+	return success;
+}
+
+// glibc has no wrapper or header for ioprio_set, these are the values
+// from linux/ioprio.h
+static const int s_ioprioWhoProcess = 1;
+static const int s_ioprioClassIdle = 3;
+static const int s_ioprioClassShift = 13;
+
+// Put the calling thread in the idle I/O scheduling class so its disk
+// I/O only runs when nothing else needs the disk
+bool
+SetIdleIoPriority()
+{
+
+	return SetIoPriority(s_ioprioClassIdle << s_ioprioClassShift);
+}
+
+// The I/O priority of the calling thread, or -1 if it can't be read
+int
+GetIoPriority()
+{
+
+#ifdef MOJ_MAC
+	return -1;
+#else
+	return (int) ::syscall(SYS_ioprio_get, s_ioprioWhoProcess, 0);
+#endif // #ifdef MOJ_MAC
+}
+
+// Set the I/O priority of the calling thread to a value returned by
+// GetIoPriority
+bool
+SetIoPriority(int ioPriority)
+{
+
+#ifdef MOJ_MAC
+	return false;
+#else
+	return (ioPriority >= 0) &&
+	       (::syscall(SYS_ioprio_set, s_ioprioWhoProcess, 0, ioPriority) == 0);
+#endif // #ifdef MOJ_MAC
+}
+
+// Make a directory unless it's already there
+static bool
+MakeDir(const std::string &dirpath)
+{
+	return (::mkdir(dirpath.c_str(), s_dirPerms) == 0) || (errno == EEXIST);
+}
+
+// Split the pathname of an object, <type>/<dir>/<name>, into the .trash
+// directory of its type and the object's directory and name.  This is
+// the one place the layout of the trash is decided.
+static bool
+SplitTrashPath(const std::string &pathname, std::string &trashDir,
+               std::string &dirName, std::string &name)
+{
+
+	const std::string::size_type namePos = pathname.rfind('/');
+	if ((namePos == std::string::npos) || (namePos == 0))
+	{
+		return false;
+	}
+	const std::string::size_type dirPos = pathname.rfind('/', namePos - 1);
+	if (dirPos == std::string::npos)
+	{
+		return false;
+	}
+
+	trashDir = pathname.substr(0, dirPos + 1) + s_trashDirName;
+	dirName = pathname.substr(dirPos + 1, namePos - dirPos - 1);
+	name = pathname.substr(namePos + 1);
+
+	return true;
+}
+
+// Move the file or directory of an object into the .trash directory of
+// its type, creating that if needed, so it can be deleted later.  The
+// object's directory and name together are unique to its id, so that
+// is the name it gets in the trash.
+bool
+MoveToTrash(const std::string &pathname, std::string &trashPath)
+{
+
+	return MakeTrashPath(pathname, std::string(), trashPath) &&
+	       (::rename(pathname.c_str(), trashPath.c_str()) == 0);
+}
+
+// Hard link target to a new name in the .trash directory next to
+// pathname.  The name is the one MoveToTrash would give pathname with
+// a .link suffix so the two can't collide.
+bool
+LinkToTrash(const std::string &target, const std::string &pathname,
+            std::string &linkPath)
+{
+
+	return MakeTrashPath(pathname, std::string(".link"), linkPath) &&
+	       (::link(target.c_str(), linkPath.c_str()) == 0);
+}
+
+// Build the name MoveToTrash would give pathname, with suffix added, in
+// the .trash directory next to it, creating that if needed
+bool
+MakeTrashPath(const std::string &pathname, const std::string &suffix,
+              std::string &trashPath)
+{
+
+	std::string trashDir, dirName, name;
+	if (!SplitTrashPath(pathname, trashDir, dirName, name))
+	{
+		return false;
+	}
+	trashPath = trashDir + "/" + dirName + name + suffix;
+
+	return MakeDir(trashDir);
+}
+
+// Build the path a compressed object at pathname is decompressed to
+// while it's subscribed, .trash/.views/<dir>/<name> in its type
+// directory.  Nothing MoveToTrash names starts with a '.' so the views
+// can't collide with removed objects.
+bool
+GetViewPath(const std::string &pathname, std::string &viewPath,
+            bool createDir)
+{
+
+	std::string trashDir, dirName, name;
+	if (!SplitTrashPath(pathname, trashDir, dirName, name))
+	{
+		return false;
+	}
+	const std::string viewDir(trashDir + "/" + s_viewDirName);
+	const std::string objectDir(viewDir + "/" + dirName);
+	if (createDir && !(MakeDir(trashDir) && MakeDir(viewDir) &&
+	                   MakeDir(objectDir)))
+	{
+		return false;
+	}
+	viewPath = objectDir + "/" + name;
+
+	return true;
+}
+
+// Returns true if the last part of pathname is a .trash directory
+bool
+IsTrashPath(const std::string &pathname)
+{
+
+	const std::string::size_type namePos = pathname.rfind('/');
+	const std::string::size_type nameStart = (namePos == std::string::npos) ? 0 :
+	        namePos + 1;
+
+	return pathname.compare(nameStart, std::string::npos, s_trashDirName) == 0;
+}
+
+// Delete an entry of a .trash directory, or the whole directory, with
+// the calling thread in the idle I/O class so it only competes for the
+// disk when nothing else is using it
+bool
+ReapTrash(const std::string &trashPath, std::string &msgText)
+{
+
+	const int ioPriority = GetIoPriority();
+	const bool idle = SetIdleIoPriority();
+	const bool success = CleanupDir(trashPath, msgText);
+	if (idle)
+	{
+		// Without a priority to go back to, the default is no class
+		(void) SetIoPriority((ioPriority >= 0) ? ioPriority : 0);
+	}
+
+	return success;
+}
+
 // This is the equivalent of rm -rf of the directory in a directory
 // type cached object
 bool
@@ -385,23 +1330,20 @@ CleanupDir(const std::string &pathname, std::string &msgText)
 	return success;
 }
 
-static cacheSize_t s_dirSum;
+// Per thread so directories can be summed on the I/O workers
+static thread_local cacheSize_t s_dirSum;
 static int
 Sum(const char *fpath, const struct stat *sb, int flag, struct FTW *ftwbuf)
 {
 
-	int retVal = 0;
+	// nftw has already stat'd the entry, only entries it couldn't stat
+	// are left out
 	if (flag == FTW_F || flag == FTW_SL || flag == FTW_D || flag == FTW_DP)
 	{
-		struct stat buf;
-		retVal = ::stat(fpath, &buf);
-		if (retVal == 0)
-		{
-			s_dirSum += GetFilesystemFileSize((cacheSize_t) buf.st_size);
-		}
+		s_dirSum += GetFilesystemFileSize((cacheSize_t) sb->st_size);
 	}
 
-	return retVal;
+	return 0;
 }
 
 // This is the equivalent of du -s of the directory in a directory
@@ -420,3 +1362,104 @@ SumDir(const std::string &pathname)
 
 	return s_dirSum;
 }
+
+// The bits of the flags byte in the packed object record
+static const uint8_t s_writtenFlag = 0x01;
+static const uint8_t s_dirTypeFlag = 0x02;
+static const uint8_t s_compressedFlag = 0x04;
+
+static void
+PutRecordValue(std::string &buf, uint64_t value, int numBytes)
+{
+	for (int i = 0; i < numBytes; i++)
+	{
+		buf.push_back((char)((value >> (8 * i)) & 0xff));
+	}
+}
+
+static uint64_t
+GetRecordValue(const unsigned char *buf, int numBytes)
+{
+	uint64_t value = 0;
+	for (int i = 0; i < numBytes; i++)
+	{
+		value |= ((uint64_t) buf[i]) << (8 * i);
+	}
+
+	return value;
+}
+
+// Pack an object record into the value of its extended attribute.
+// The record is the version, the flags, the filename length, the size,
+// the cost and the lifetime followed by the filename, and then the
+// stored size if the object is compressed, all little endian.
+const std::string
+PackObjectRecord(const CObjectRecord &record)
+{
+
+	uint8_t flags = 0;
+	if (record.m_written)
+	{
+		flags |= s_writtenFlag;
+	}
+	if (record.m_dirType)
+	{
+		flags |= s_dirTypeFlag;
+	}
+	if (record.m_compressed)
+	{
+		flags |= s_compressedFlag;
+	}
+
+	std::string buf;
+	buf.reserve(s_objectRecordHeaderSize + record.m_filename.length() +
+	            s_objectRecordStoredSize);
+	PutRecordValue(buf, s_objectRecordVersion, 1);
+	PutRecordValue(buf, flags, 1);
+	PutRecordValue(buf, record.m_filename.length(), 2);
+	PutRecordValue(buf, (uint64_t)(int64_t) record.m_size, 8);
+	PutRecordValue(buf, (uint32_t) record.m_cost, 4);
+	PutRecordValue(buf, (uint32_t) record.m_lifetime, 4);
+	buf.append(record.m_filename);
+	if (record.m_compressed)
+	{
+		PutRecordValue(buf, (uint64_t)(int64_t) record.m_storedSize, 8);
+	}
+
+	return buf;
+}
+
+// Unpack the value of an object's extended attribute.  Returns false if
+// the value is truncated or was written by an unknown version.
+bool
+UnpackObjectRecord(const void *value, size_t size, CObjectRecord &record)
+{
+
+	const unsigned char *buf = (const unsigned char *) value;
+	if ((size < s_objectRecordHeaderSize) ||
+	        (buf[0] != s_objectRecordVersion))
+	{
+		return false;
+	}
+
+	size_t filenameLength = (size_t) GetRecordValue(buf + 2, 2);
+	const bool compressed = (buf[1] & s_compressedFlag) != 0;
+	if (size != s_objectRecordHeaderSize + filenameLength +
+	        (compressed ? s_objectRecordStoredSize : 0))
+	{
+		return false;
+	}
+
+	record.m_written = (buf[1] & s_writtenFlag) != 0;
+	record.m_dirType = (buf[1] & s_dirTypeFlag) != 0;
+	record.m_size = (cacheSize_t)(int64_t) GetRecordValue(buf + 4, 8);
+	record.m_cost = (paramValue_t)(int32_t) GetRecordValue(buf + 12, 4);
+	record.m_lifetime = (paramValue_t)(int32_t) GetRecordValue(buf + 16, 4);
+	record.m_filename.assign((const char *)(buf + s_objectRecordHeaderSize),
+	                         filenameLength);
+	record.m_compressed = compressed;
+	record.m_storedSize = compressed ? (cacheSize_t)(int64_t) GetRecordValue(
+	                          buf + s_objectRecordHeaderSize + filenameLength, 8) : 0;
+
+	return true;
+}
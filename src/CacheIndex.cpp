@@ -0,0 +1,848 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "CacheIndex.h"
+
+#include <fcntl.h>
+
+MojLogger CCacheIndex::s_log(_T("filecache.cacheindex"));
+
+// The snapshot is a header, the types, the objects and a CRC-32 of
+// everything before it.  The journal is a sequence of frames, each a
+// payload length, the payload and the CRC-32 of the payload, where the
+// first frame identifies the snapshot the journal follows.  All values
+// are stored little endian.
+static const uint32_t s_indexMagic = 0x58494346;    // "FCIX"
+static const uint32_t s_journalMagic = 0x4e4a4346;  // "FCJN"
+static const uint32_t s_indexVersion = 4;
+
+static const uint8_t s_typeRecord = 1;
+static const uint8_t s_deleteTypeRecord = 2;
+static const uint8_t s_objectRecord = 3;
+static const uint8_t s_removeObjectRecord = 4;
+
+static const mode_t s_indexPerms = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+
+static const std::string s_bootIdFile("/proc/sys/kernel/random/boot_id");
+
+static void
+PutU8(std::string &buf, uint8_t value)
+{
+	buf.push_back((char) value);
+}
+
+static void
+PutU32(std::string &buf, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		buf.push_back((char)((value >> (8 * i)) & 0xff));
+	}
+}
+
+static void
+PutU64(std::string &buf, uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		buf.push_back((char)((value >> (8 * i)) & 0xff));
+	}
+}
+
+static void
+PutString(std::string &buf, const std::string &value)
+{
+	PutU32(buf, (uint32_t) value.size());
+	buf.append(value);
+}
+
+// Sizes and watermarks are stored as 64 bit values so the format
+// doesn't depend on the width of cacheSize_t.
+static void
+PutType(std::string &buf, const CIndexedType &type)
+{
+	PutString(buf, type.m_typeName);
+	PutU64(buf, (uint64_t)(int64_t) type.m_params.GetLoWatermark());
+	PutU64(buf, (uint64_t)(int64_t) type.m_params.GetHiWatermark());
+	PutU64(buf, (uint64_t)(int64_t) type.m_params.GetSize());
+	PutU32(buf, (uint32_t) type.m_params.GetCost());
+	PutU32(buf, (uint32_t) type.m_params.GetLifetime());
+	PutU8(buf, type.m_dirType ? 1 : 0);
+	PutString(buf, type.m_params.GetPolicy());
+	PutU8(buf, (type.m_params.GetCompress() > 0) ? 1 : 0);
+	PutU8(buf, (type.m_params.GetMemory() > 0) ? 1 : 0);
+}
+
+static void
+PutObject(std::string &buf, const CIndexedObject &object)
+{
+	PutU64(buf, (uint64_t) object.m_id);
+	PutString(buf, object.m_typeName);
+	PutString(buf, object.m_filename);
+	PutU64(buf, (uint64_t)(int64_t) object.m_size);
+	PutU32(buf, (uint32_t) object.m_cost);
+	PutU32(buf, (uint32_t) object.m_lifetime);
+	PutU8(buf, object.m_written ? 1 : 0);
+	PutU8(buf, object.m_compressed ? 1 : 0);
+	PutU64(buf, (uint64_t)(int64_t) object.m_storedSize);
+	PutU8(buf, object.m_inMemory ? 1 : 0);
+}
+
+// Wraps a payload in a journal frame
+static std::string
+MakeFrame(const std::string &payload)
+{
+	std::string frame;
+	PutU32(frame, (uint32_t) payload.size());
+	frame.append(payload);
+	PutU32(frame, ComputeChecksum(payload.data(), payload.size()));
+
+	return frame;
+}
+
+// Reads the values written by the Put functions from a range of a
+// buffer.  Every read fails once the end of the range is reached.
+class CIndexReader
+{
+public:
+
+	CIndexReader(const std::string &buf, size_t start, size_t end)
+		: m_buf(buf)
+		, m_pos(start)
+		, m_end(end)
+	{
+	}
+
+	bool GetU8(uint8_t *value)
+	{
+		if (m_pos + 1 > m_end)
+		{
+			return false;
+		}
+		*value = (uint8_t) m_buf[m_pos++];
+		return true;
+	}
+
+	bool GetU32(uint32_t *value)
+	{
+		if (m_pos + 4 > m_end)
+		{
+			return false;
+		}
+		*value = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			*value |= (uint32_t)(uint8_t) m_buf[m_pos++] << (8 * i);
+		}
+		return true;
+	}
+
+	bool GetU64(uint64_t *value)
+	{
+		if (m_pos + 8 > m_end)
+		{
+			return false;
+		}
+		*value = 0;
+		for (int i = 0; i < 8; i++)
+		{
+			*value |= (uint64_t)(uint8_t) m_buf[m_pos++] << (8 * i);
+		}
+		return true;
+	}
+
+	bool GetString(std::string &value)
+	{
+		uint32_t length;
+		if (!GetU32(&length) || (length > m_end - m_pos))
+		{
+			return false;
+		}
+		value.assign(m_buf, m_pos, length);
+		m_pos += length;
+		return true;
+	}
+
+	bool GetType(CIndexedType &type)
+	{
+		uint64_t loWatermark, hiWatermark, size;
+		uint32_t cost, lifetime;
+		uint8_t dirType, compress, memory;
+		std::string policy;
+		if (!GetString(type.m_typeName) || !GetU64(&loWatermark) ||
+		        !GetU64(&hiWatermark) || !GetU64(&size) || !GetU32(&cost) ||
+		        !GetU32(&lifetime) || !GetU8(&dirType) || !GetString(policy) ||
+		        !GetU8(&compress) || !GetU8(&memory))
+		{
+			return false;
+		}
+		type.m_params.SetLoWatermark((cacheSize_t)(int64_t) loWatermark);
+		type.m_params.SetHiWatermark((cacheSize_t)(int64_t) hiWatermark);
+		type.m_params.SetSize((cacheSize_t)(int64_t) size);
+		type.m_params.SetCost((paramValue_t) cost);
+		type.m_params.SetLifetime((paramValue_t) lifetime);
+		type.m_dirType = (dirType != 0);
+		type.m_params.SetPolicy(policy);
+		type.m_params.SetCompress((compress != 0) ? 1 : 0);
+		type.m_params.SetMemory((memory != 0) ? 1 : 0);
+		return true;
+	}
+
+	bool GetObject(CIndexedObject &object)
+	{
+		uint64_t id, size, storedSize;
+		uint32_t cost, lifetime;
+		uint8_t written, compressed, inMemory;
+		if (!GetU64(&id) || !GetString(object.m_typeName) ||
+		        !GetString(object.m_filename) || !GetU64(&size) ||
+		        !GetU32(&cost) || !GetU32(&lifetime) || !GetU8(&written) ||
+		        !GetU8(&compressed) || !GetU64(&storedSize) || !GetU8(&inMemory))
+		{
+			return false;
+		}
+		object.m_id = (cachedObjectId_t) id;
+		object.m_size = (cacheSize_t)(int64_t) size;
+		object.m_cost = (paramValue_t) cost;
+		object.m_lifetime = (paramValue_t) lifetime;
+		object.m_written = (written != 0);
+		object.m_compressed = (compressed != 0);
+		object.m_storedSize = (cacheSize_t)(int64_t) storedSize;
+		object.m_inMemory = (inMemory != 0);
+		return true;
+	}
+
+	// Returns the range of the payload of the next journal frame after
+	// validating its checksum.
+	bool GetFrame(size_t *payloadStart, size_t *payloadEnd)
+	{
+		uint32_t length;
+		if (!GetU32(&length) || (length > m_end - m_pos) ||
+		        (m_end - m_pos - length < 4))
+		{
+			return false;
+		}
+		*payloadStart = m_pos;
+		*payloadEnd = m_pos + length;
+		m_pos += length;
+		uint32_t checksum;
+		if (!GetU32(&checksum))
+		{
+			return false;
+		}
+		return (checksum == ComputeChecksum(m_buf.data() + *payloadStart,
+		                                    length));
+	}
+
+	bool atEnd()
+	{
+		return (m_pos == m_end);
+	}
+
+private:
+
+	const std::string &m_buf;
+	size_t m_pos;
+	size_t m_end;
+};
+
+// Write all of buf to fd, retrying on short writes
+static bool
+WriteAll(int fd, const std::string &buf)
+{
+	size_t written = 0;
+	while (written < buf.size())
+	{
+		ssize_t retVal = ::write(fd, buf.data() + written, buf.size() - written);
+		if (retVal < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return false;
+		}
+		written += (size_t) retVal;
+	}
+
+	return true;
+}
+
+// Make a rename, create or unlink in dirName durable
+static void
+SyncDirectory(const std::string &dirName)
+{
+	int fd = ::open(dirName.c_str(), O_RDONLY);
+	if (fd >= 0)
+	{
+		::fsync(fd);
+		::close(fd);
+	}
+}
+
+CCacheIndex::CCacheIndex(const std::string &dirName)
+	: m_dirName(dirName)
+	, m_indexPathname(dirName + "/" + s_indexFilename)
+	, m_journalPathname(dirName + "/" + s_journalFilename)
+	, m_generation(0)
+	, m_numJournalRecords(0)
+	, m_journalFd(-1)
+{
+
+	MojLogTrace(s_log);
+}
+
+CCacheIndex::~CCacheIndex()
+{
+
+	MojLogTrace(s_log);
+
+	CloseJournal();
+}
+
+// Read the snapshot and replay the journal into types and objects.
+// Returns false if the index is missing, fails validation or can't
+// be trusted, in which case the caller has to walk the directory
+// tree instead.
+bool
+CCacheIndex::Load(indexedTypes_t &types, indexedObjects_t &objects)
+{
+
+	MojLogTrace(s_log);
+
+	types.clear();
+	objects.clear();
+	m_numJournalRecords = 0;
+
+	std::string snapshot;
+	if (!ReadFile(m_indexPathname, snapshot))
+	{
+		MojLogInfo(s_log, _T("Load: No cache index found at '%s'."),
+		           m_indexPathname.c_str());
+		return false;
+	}
+
+	if (snapshot.size() < 4)
+	{
+		MojLogError(s_log, _T("Load: Cache index '%s' is truncated."),
+		            m_indexPathname.c_str());
+		return false;
+	}
+	size_t bodySize = snapshot.size() - 4;
+	CIndexReader trailer(snapshot, bodySize, snapshot.size());
+	uint32_t checksum;
+	trailer.GetU32(&checksum);
+	if (checksum != ComputeChecksum(snapshot.data(), bodySize))
+	{
+		MojLogError(s_log, _T("Load: Cache index '%s' failed the checksum."),
+		            m_indexPathname.c_str());
+		return false;
+	}
+
+	CIndexReader reader(snapshot, 0, bodySize);
+	uint32_t magic, version, numTypes, numObjects;
+	uint64_t generation;
+	uint8_t clean;
+	std::string bootId;
+	bool valid = reader.GetU32(&magic) && (magic == s_indexMagic) &&
+	             reader.GetU32(&version) && (version == s_indexVersion) &&
+	             reader.GetU64(&generation) && reader.GetU8(&clean) &&
+	             reader.GetString(bootId) && reader.GetU32(&numTypes);
+	for (uint32_t i = 0; valid && (i < numTypes); i++)
+	{
+		CIndexedType type;
+		valid = reader.GetType(type);
+		types[type.m_typeName] = type;
+	}
+	valid = valid && reader.GetU32(&numObjects);
+	for (uint32_t i = 0; valid && (i < numObjects); i++)
+	{
+		CIndexedObject object;
+		valid = reader.GetObject(object);
+		objects[object.m_id] = object;
+	}
+	if (!valid || !reader.atEnd())
+	{
+		MojLogError(s_log, _T("Load: Cache index '%s' is not valid."),
+		            m_indexPathname.c_str());
+		return false;
+	}
+
+	// A journal for an older snapshot was left behind by a crash right
+	// after the snapshot was renamed into place and can be ignored, its
+	// changes are all in the snapshot.
+	const std::string currentBootId(GetBootId());
+	bool haveJournal = false;
+	std::string journal;
+	if (ReadFile(m_journalPathname, journal) && !journal.empty())
+	{
+		CIndexReader frames(journal, 0, journal.size());
+		size_t start, end;
+		if (!frames.GetFrame(&start, &end))
+		{
+			MojLogError(s_log, _T("Load: Journal '%s' has no valid header."),
+			            m_journalPathname.c_str());
+			return false;
+		}
+		CIndexReader header(journal, start, end);
+		uint64_t journalGeneration;
+		std::string journalBootId;
+		if (!header.GetU32(&magic) || (magic != s_journalMagic) ||
+		        !header.GetU32(&version) || (version != s_indexVersion) ||
+		        !header.GetU64(&journalGeneration) ||
+		        !header.GetString(journalBootId))
+		{
+			MojLogError(s_log, _T("Load: Journal '%s' has no valid header."),
+			            m_journalPathname.c_str());
+			return false;
+		}
+		if (journalGeneration == generation)
+		{
+			// The journal isn't synced so after a reboot it may be
+			// missing changes even though its header made it to disk.
+			if (currentBootId.empty() || (journalBootId != currentBootId))
+			{
+				MojLogWarning(s_log,
+				              _T("Load: Journal '%s' was written before the last reboot."),
+				              m_journalPathname.c_str());
+				return false;
+			}
+			if (!ReplayJournal(journal, types, objects))
+			{
+				MojLogError(s_log, _T("Load: Failed to replay journal '%s'."),
+				            m_journalPathname.c_str());
+				return false;
+			}
+			haveJournal = true;
+		}
+	}
+	if (!haveJournal && !clean &&
+	        (currentBootId.empty() || (bootId != currentBootId)))
+	{
+		MojLogWarning(s_log,
+		              _T("Load: Cache index '%s' was not written at shutdown."),
+		              m_indexPathname.c_str());
+		return false;
+	}
+
+	// Every object must belong to a known type
+	indexedObjects_t::const_iterator iter = objects.begin();
+	while (iter != objects.end())
+	{
+		if (types.find((*iter).second.m_typeName) == types.end())
+		{
+			MojLogError(s_log,
+			            _T("Load: Object '%llu' has unknown type '%s'."),
+			            (*iter).first, (*iter).second.m_typeName.c_str());
+			return false;
+		}
+		++iter;
+	}
+
+	m_generation = generation;
+	MojLogInfo(s_log,
+	           _T("Load: Loaded %zu types and %zu objects (%u journal records)."),
+	           types.size(), objects.size(), m_numJournalRecords);
+
+	return true;
+}
+
+// Replace the snapshot with the provided types and objects and start
+// a new empty journal.  A clean snapshot is one written when the
+// service is shutting down and no more changes will follow.
+bool
+CCacheIndex::WriteSnapshot(const indexedTypes_t &types,
+                           const indexedObjects_t &objects, bool clean)
+{
+
+	MojLogTrace(s_log);
+
+	CloseJournal();
+
+	uint64_t generation = m_generation + 1;
+	std::string buf;
+	PutU32(buf, s_indexMagic);
+	PutU32(buf, s_indexVersion);
+	PutU64(buf, generation);
+	PutU8(buf, clean ? 1 : 0);
+	PutString(buf, GetBootId());
+	PutU32(buf, (uint32_t) types.size());
+	indexedTypes_t::const_iterator typeIter = types.begin();
+	while (typeIter != types.end())
+	{
+		PutType(buf, (*typeIter).second);
+		++typeIter;
+	}
+	PutU32(buf, (uint32_t) objects.size());
+	indexedObjects_t::const_iterator objIter = objects.begin();
+	while (objIter != objects.end())
+	{
+		PutObject(buf, (*objIter).second);
+		++objIter;
+	}
+	PutU32(buf, ComputeChecksum(buf.data(), buf.size()));
+
+	std::string tmpFile(m_indexPathname + ".tmp");
+	int fd = ::open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, s_indexPerms);
+	if (fd < 0)
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("WriteSnapshot: Failed to open file '%s' (%s)."),
+		            tmpFile.c_str(), ::strerror(savedErrno));
+		Invalidate();
+		return false;
+	}
+	bool writeOK = WriteAll(fd, buf) && (::fsync(fd) == 0);
+	int savedErrno = errno;
+	::close(fd);
+	if (!writeOK)
+	{
+		MojLogError(s_log, _T("WriteSnapshot: Failed to write file '%s' (%s)."),
+		            tmpFile.c_str(), ::strerror(savedErrno));
+		::unlink(tmpFile.c_str());
+		Invalidate();
+		return false;
+	}
+	if (::rename(tmpFile.c_str(), m_indexPathname.c_str()) != 0)
+	{
+		savedErrno = errno;
+		MojLogError(s_log,
+		            _T("WriteSnapshot: Failed to rename file '%s' to '%s' (%s)."),
+		            tmpFile.c_str(), m_indexPathname.c_str(), ::strerror(savedErrno));
+		::unlink(tmpFile.c_str());
+		Invalidate();
+		return false;
+	}
+	m_generation = generation;
+	MojLogInfo(s_log,
+	           _T("WriteSnapshot: Wrote %zu types and %zu objects to '%s'."),
+	           types.size(), objects.size(), m_indexPathname.c_str());
+
+	// Nothing follows a clean snapshot so there is no journal to start.
+	bool retVal = true;
+	if (clean)
+	{
+		::unlink(m_journalPathname.c_str());
+		m_numJournalRecords = 0;
+		SyncDirectory(m_dirName);
+	}
+	else
+	{
+		retVal = OpenJournal();
+	}
+
+	return retVal;
+}
+
+// Start a new empty journal following the loaded snapshot.  This is
+// only valid after a Load that replayed no journal records.
+bool
+CCacheIndex::OpenJournal()
+{
+
+	MojLogTrace(s_log);
+
+	CloseJournal();
+	m_numJournalRecords = 0;
+
+	std::string header;
+	PutU32(header, s_journalMagic);
+	PutU32(header, s_indexVersion);
+	PutU64(header, m_generation);
+	PutString(header, GetBootId());
+
+	int fd = ::open(m_journalPathname.c_str(),
+	                O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, s_indexPerms);
+	if (fd < 0)
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("OpenJournal: Failed to open file '%s' (%s)."),
+		            m_journalPathname.c_str(), ::strerror(savedErrno));
+		Invalidate();
+		return false;
+	}
+
+	// The header has to be on disk before anything changes, otherwise
+	// a clean snapshot could be trusted after a power loss even though
+	// changes followed it.
+	if (!WriteAll(fd, MakeFrame(header)) || (::fsync(fd) != 0))
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("OpenJournal: Failed to write file '%s' (%s)."),
+		            m_journalPathname.c_str(), ::strerror(savedErrno));
+		::close(fd);
+		Invalidate();
+		return false;
+	}
+	SyncDirectory(m_dirName);
+	m_journalFd = fd;
+
+	return true;
+}
+
+// Append the current state of a type to the journal
+bool
+CCacheIndex::JournalType(const CIndexedType &type)
+{
+
+	MojLogTrace(s_log);
+
+	std::string record;
+	PutU8(record, s_typeRecord);
+	PutType(record, type);
+
+	return AppendRecord(record);
+}
+
+// Append the current state of an object to the journal
+bool
+CCacheIndex::JournalObject(const CIndexedObject &object)
+{
+
+	MojLogTrace(s_log);
+
+	std::string record;
+	PutU8(record, s_objectRecord);
+	PutObject(record, object);
+
+	return AppendRecord(record);
+}
+
+// Append the removal of a type to the journal
+bool
+CCacheIndex::JournalDeleteType(const std::string &typeName)
+{
+
+	MojLogTrace(s_log);
+
+	std::string record;
+	PutU8(record, s_deleteTypeRecord);
+	PutString(record, typeName);
+
+	return AppendRecord(record);
+}
+
+// Append the removal of an object to the journal
+bool
+CCacheIndex::JournalRemoveObject(const cachedObjectId_t objId)
+{
+
+	MojLogTrace(s_log);
+
+	std::string record;
+	PutU8(record, s_removeObjectRecord);
+	PutU64(record, (uint64_t) objId);
+
+	return AppendRecord(record);
+}
+
+// Remove the snapshot and the journal so the next start will walk the
+// directory tree.
+void
+CCacheIndex::Invalidate()
+{
+
+	MojLogTrace(s_log);
+
+	CloseJournal();
+	m_numJournalRecords = 0;
+	if ((::unlink(m_indexPathname.c_str()) != 0) && (errno != ENOENT))
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("Invalidate: Failed to unlink file '%s' (%s)."),
+		            m_indexPathname.c_str(), ::strerror(savedErrno));
+	}
+	::unlink(m_journalPathname.c_str());
+	SyncDirectory(m_dirName);
+	MojLogWarning(s_log, _T("Invalidate: Cache index '%s' removed."),
+	              m_indexPathname.c_str());
+}
+
+bool
+CCacheIndex::ReadFile(const std::string &pathname, std::string &contents)
+{
+
+	MojLogTrace(s_log);
+
+	std::ifstream infile(pathname.c_str(), std::ios::in | std::ios::binary);
+	if (!infile)
+	{
+		return false;
+	}
+	infile.seekg(0, std::ios::end);
+	std::streamoff length = infile.tellg();
+	infile.seekg(0, std::ios::beg);
+	if (length < 0)
+	{
+		return false;
+	}
+	contents.resize((size_t) length);
+	if (length > 0)
+	{
+		infile.read(&contents[0], length);
+	}
+
+	return infile.good();
+}
+
+bool
+CCacheIndex::ReplayJournal(const std::string &journal,
+                           indexedTypes_t &types, indexedObjects_t &objects)
+{
+
+	MojLogTrace(s_log);
+
+	CIndexReader frames(journal, 0, journal.size());
+	size_t start, end;
+
+	// Skip the header, the caller has already checked it
+	frames.GetFrame(&start, &end);
+	while (!frames.atEnd())
+	{
+		if (!frames.GetFrame(&start, &end))
+		{
+			MojLogError(s_log,
+			            _T("ReplayJournal: Bad frame after %u records."),
+			            m_numJournalRecords);
+			return false;
+		}
+		CIndexReader record(journal, start, end);
+		uint8_t kind = 0;
+		bool valid = record.GetU8(&kind);
+		if (valid && (kind == s_typeRecord))
+		{
+			CIndexedType type;
+			valid = record.GetType(type);
+			types[type.m_typeName] = type;
+		}
+		else if (valid && (kind == s_deleteTypeRecord))
+		{
+			std::string typeName;
+			valid = record.GetString(typeName);
+			types.erase(typeName);
+		}
+		else if (valid && (kind == s_objectRecord))
+		{
+			CIndexedObject object;
+			valid = record.GetObject(object);
+			objects[object.m_id] = object;
+		}
+		else if (valid && (kind == s_removeObjectRecord))
+		{
+			uint64_t objId;
+			valid = record.GetU64(&objId);
+			objects.erase((cachedObjectId_t) objId);
+		}
+		else
+		{
+			valid = false;
+		}
+		if (!valid || !record.atEnd())
+		{
+			MojLogError(s_log,
+			            _T("ReplayJournal: Bad record of kind %u after %u records."),
+			            kind, m_numJournalRecords);
+			return false;
+		}
+		m_numJournalRecords++;
+	}
+
+	return true;
+}
+
+bool
+CCacheIndex::AppendRecord(const std::string &record)
+{
+
+	MojLogTrace(s_log);
+
+	bool retVal = false;
+	if (isOpen())
+	{
+		if (WriteAll(m_journalFd, MakeFrame(record)))
+		{
+			m_numJournalRecords++;
+			retVal = true;
+		}
+		else
+		{
+			// Once a change is lost the index no longer matches the
+			// cache, so get rid of it until the next snapshot.
+			int savedErrno = errno;
+			MojLogError(s_log, _T("AppendRecord: Failed to write file '%s' (%s)."),
+			            m_journalPathname.c_str(), ::strerror(savedErrno));
+			Invalidate();
+		}
+	}
+
+	return retVal;
+}
+
+void
+CCacheIndex::CloseJournal()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_journalFd >= 0)
+	{
+		::close(m_journalFd);
+		m_journalFd = -1;
+	}
+}
+
+// Returns the kernel boot id, or an empty string if it can't be read
+const std::string
+GetBootId()
+{
+	std::string bootId;
+	std::ifstream infile(s_bootIdFile.c_str());
+	if (infile)
+	{
+		infile >> bootId;
+	}
+
+	return bootId;
+}
+
+// Compute the CRC-32 (IEEE 802.3) of size bytes of data
+uint32_t
+ComputeChecksum(const void *data, size_t size)
+{
+	static uint32_t table[256];
+	static bool tableReady = false;
+	if (!tableReady)
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t value = i;
+			for (int bit = 0; bit < 8; bit++)
+			{
+				value = (value & 1) ? (0xEDB88320 ^ (value >> 1)) : (value >> 1);
+			}
+			table[i] = value;
+		}
+		tableReady = true;
+	}
+
+	const uint8_t *bytes = static_cast<const uint8_t *>(data);
+	uint32_t crc = 0xFFFFFFFF;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+	}
+
+	return crc ^ 0xFFFFFFFF;
+}
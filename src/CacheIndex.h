@@ -0,0 +1,154 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __CACHE_INDEX_H__
+#define __CACHE_INDEX_H__
+
+#include "CacheBase.h"
+
+static const std::string s_indexFilename(".cacheIndex");
+static const std::string s_journalFilename(".cacheJournal");
+
+// How often (in seconds) the index snapshot is rewritten while the
+// journal holds changes that aren't in it.
+static const unsigned int s_indexSnapshotInterval = 300;
+
+// A cache type as it is saved in the index
+struct CIndexedType
+{
+	CIndexedType() : m_dirType(false)
+	{
+	}
+
+	std::string m_typeName;
+	CCacheParamValues m_params;
+	bool m_dirType;
+};
+
+// A cache object as it is saved in the index
+struct CIndexedObject
+{
+	CIndexedObject()
+		: m_id(0)
+		, m_size(0)
+		, m_cost(0)
+		, m_lifetime(0)
+		, m_written(false)
+		, m_compressed(false)
+		, m_storedSize(0)
+		, m_inMemory(false)
+	{
+	}
+
+	cachedObjectId_t m_id;
+	std::string m_typeName;
+	std::string m_filename;
+	cacheSize_t m_size;
+	paramValue_t m_cost;
+	paramValue_t m_lifetime;
+	bool m_written;
+	bool m_compressed;
+	cacheSize_t m_storedSize;
+
+	// A memory object's file is in the memory directory, it doesn't
+	// survive a reboot
+	bool m_inMemory;
+};
+
+typedef std::map<std::string, CIndexedType> indexedTypes_t;
+typedef std::map<cachedObjectId_t, CIndexedObject> indexedObjects_t;
+
+// The cache index lets the service start without walking the cache
+// directory tree and reading the extended attributes of every file.
+// It is made of a checksummed snapshot of all types and objects plus
+// an append-only journal of the changes made since the snapshot was
+// written.  The journal is never synced record by record, so it is
+// only trusted when it was written during the current boot (the
+// service restarted but the page cache survived) or when the snapshot
+// was written at a clean shutdown and nothing was journaled after it.
+class CCacheIndex
+{
+public:
+
+	CCacheIndex(const std::string &dirName);
+
+	~CCacheIndex();
+
+	// Read the snapshot and replay the journal into types and objects.
+	// Returns false if the index is missing, fails validation or can't
+	// be trusted, in which case the caller has to walk the directory
+	// tree instead.
+	bool Load(indexedTypes_t &types, indexedObjects_t &objects);
+
+	// Replace the snapshot with the provided types and objects and
+	// start a new empty journal.  A clean snapshot is one written when
+	// the service is shutting down and no more changes will follow.
+	bool WriteSnapshot(const indexedTypes_t &types,
+	                   const indexedObjects_t &objects, bool clean = false);
+
+	// Start a new empty journal following the loaded snapshot.  This
+	// is only valid after a Load that replayed no journal records.
+	bool OpenJournal();
+
+	// Append the current state of a type or an object to the journal
+	bool JournalType(const CIndexedType &type);
+	bool JournalObject(const CIndexedObject &object);
+
+	// Append the removal of a type or an object to the journal
+	bool JournalDeleteType(const std::string &typeName);
+	bool JournalRemoveObject(const cachedObjectId_t objId);
+
+	// Returns true while changes are being journaled
+	bool isOpen()
+	{
+		return (m_journalFd >= 0);
+	}
+
+	// The number of records in the journal since the last snapshot
+	uint32_t GetNumJournalRecords()
+	{
+		return m_numJournalRecords;
+	}
+
+	// Remove the snapshot and the journal so the next start will walk
+	// the directory tree.
+	void Invalidate();
+
+private:
+
+	bool ReadFile(const std::string &pathname, std::string &contents);
+	bool ReplayJournal(const std::string &journal, indexedTypes_t &types,
+	                   indexedObjects_t &objects);
+	bool AppendRecord(const std::string &record);
+	void CloseJournal();
+
+	std::string m_dirName;
+	std::string m_indexPathname;
+	std::string m_journalPathname;
+
+	uint64_t m_generation;
+	uint32_t m_numJournalRecords;
+	int m_journalFd;
+	static MojLogger s_log;
+};
+
+// Returns the kernel boot id, or an empty string if it can't be read
+const std::string GetBootId();
+
+// Compute the CRC-32 of size bytes of data
+uint32_t ComputeChecksum(const void *data, size_t size);
+
+#endif
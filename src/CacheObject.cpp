@@ -18,9 +18,45 @@
 #include "FileCache.h"
 #include "FileCacheSet.h"
 
+#include <limits>
+#include <memory>
+
 MojLogger CCacheObject::s_log(_T("filecache.cacheobject"));
 static MojLogger s_cleanuplog(_T("filecache.cacheobject"));
 
+// Cache objects are allocated from a slab pool rather than one by one
+// from the heap
+void *
+CCacheObject::operator new(size_t size)
+{
+	if (size == sizeof(CCacheObject))
+	{
+		return GetSlabPool<sizeof(CCacheObject)>().Allocate();
+	}
+	return ::operator new(size);
+}
+
+void
+CCacheObject::operator delete(void *ptr, size_t size)
+{
+	if (size == sizeof(CCacheObject))
+	{
+		GetSlabPool<sizeof(CCacheObject)>().Free(ptr);
+	}
+	else
+	{
+		::operator delete(ptr);
+	}
+}
+
+// The table the filenames of all cache objects are interned in
+CNameTable &
+CCacheObject::GetFilenameTable()
+{
+	static CNameTable table;
+	return table;
+}
+
 CCacheObject::CCacheObject(CFileCache *fileCache,
                            const cachedObjectId_t id,
                            const std::string &filename, cacheSize_t size,
@@ -30,13 +66,25 @@ CCacheObject::CCacheObject(CFileCache *fileCache,
                            bool dirType): m_id(id)
 	, m_fileCache(fileCache)
 	, m_size(size)
+	, m_storedSize(0)
 	, m_cost(cost)
 	, m_lifetime(lifetime)
 	, m_subscriptionCount(0)
-	, m_filename(filename)
+	, m_streamReaders(0)
+	, m_filename(GetFilenameTable().Intern(filename))
 	, m_written(written)
 	, m_expired(false)
 	, m_dirType(dirType)
+	, m_onCacheList(false)
+	, m_syncPending(false)
+	, m_removed(false)
+	, m_linked(false)
+	, m_compressed(false)
+	, m_inMemory(false)
+	, m_viewOpen(false)
+	, m_viewPending(false)
+	, m_viewInMemory(false)
+	, m_cacheListId(0)
 {
 
 	MojLogTrace(s_log);
@@ -57,58 +105,22 @@ CCacheObject::~CCacheObject()
 
 	MojLogTrace(s_log);
 
-	const std::string pathname(GetPathname());
-	if (pathname.size() > 0)
+	CDirSizeTracker *tracker = GetFileCacheSet()->GetDirSizeTracker();
+	if (tracker != NULL)
 	{
-		if (m_dirType)
-		{
-			MojLogDebug(s_log, _T("~CCacheObject: Cleaning directory '%s'."),
-			            pathname.c_str());
-			std::string msgText;
-			if (CleanupDir(pathname, msgText))
-			{
-				MojLogDebug(s_log,
-				            _T("~CCacheObject: cleaned '%s' to delete object '%llu'."),
-				            pathname.c_str(), m_id);
-			}
-			else
-			{
-				MojLogNotice(s_log, _T("~CCacheObject: Failed to clean '%s'."),
-				             pathname.c_str());
-				if (!msgText.empty())
-				{
-					MojLogError(s_log, _T("~CCacheObject: %s."), msgText.c_str());
-				}
-			}
-		}
-		else
-		{
-			int retVal = ::unlink(pathname.c_str());
-			if ((retVal != 0) && (errno != ENOENT))
-			{
-				int savedErrno = errno;
-				MojLogNotice(s_log, _T("~CCacheObject: Failed to unlink '%s' (%s)."),
-				             pathname.c_str(), ::strerror(savedErrno));
-			}
-			else
-			{
-				MojLogDebug(s_log,
-				            _T("~CCacheObject: Unlinked '%s' to delete object '%llu'."),
-				            pathname.c_str(), m_id);
-				const std::string dirpath(GetDirname(pathname));
-				retVal = ::rmdir(dirpath.c_str());
-				if ((retVal != 0) && (errno != ENOTEMPTY) && (errno != ENOENT))
-				{
-					// This should also never happen.  If it does we will just print
-					// out the error as there isn't anything we can do about it.
-					int savedErrno = errno;
-					MojLogError(s_log,
-					            _T("~CCacheObject: Failed to rmdir directory '%s' (%s)."),
-					            dirpath.c_str(), ::strerror(savedErrno));
-				}
-			}
-		}
+		tracker->Untrack(m_id);
+	}
+
+	// Nothing to do if Expire already removed it
+	if (!m_removed)
+	{
+		(void) Remove(std::string("~CCacheObject"));
 	}
+	if (m_inMemory)
+	{
+		GetFileCacheSet()->RemoveMemoryObject(this);
+	}
+	GetFilenameTable().Release(m_filename);
 }
 
 bool
@@ -137,12 +149,15 @@ CCacheObject::CreateObject(const std::string &pathname)
 	}
 	else
 	{
-		FILE *fp = ::fopen(pathname.c_str(), "w");
+		// The file of a memory object is made in the memory directory
+		// and linked to from the object's path
+		const std::string filePath(m_inMemory ? GetMemoryPathname(true) : pathname);
+		FILE *fp = ::fopen(filePath.c_str(), "w");
 		if (fp == NULL)
 		{
 			int savedErrno = errno;
 			MojLogError(s_log, _T("Initialize: Failed to create file '%s' (%s)."),
-			            pathname.c_str(), ::strerror(savedErrno));
+			            filePath.c_str(), ::strerror(savedErrno));
 			success = false;
 		}
 		else
@@ -151,11 +166,11 @@ CCacheObject::CreateObject(const std::string &pathname)
 
 			MojLogDebug(s_log,
 			            _T("Initialize: Created cache file '%s' for object '%llu'."),
-			            pathname.c_str(), m_id);
+			            filePath.c_str(), m_id);
 
 			// Now set the permissions on the file so we can write the
 			// extended attributes.
-			retVal = ::chmod(pathname.c_str(), s_fileRWPerms);
+			retVal = ::chmod(filePath.c_str(), s_fileRWPerms);
 			if (retVal != 0)
 			{
 				int savedErrno = errno;
@@ -170,204 +185,132 @@ CCacheObject::CreateObject(const std::string &pathname)
 				            _T("Initialize: Permissions set on '%s' to allow attribute setting."),
 				            pathname.c_str());
 			}
-		}
-	}
-	return success;
-}
-
-bool
-CCacheObject::SetFilenameAttribute(const std::string &pathname)
-{
-
-	MojLogTrace(s_log);
-
-	bool success = true;
-	// Add the real filename as an extended attribute
-	int retVal = FC_setxattr(pathname.c_str(), "user.f", m_filename.c_str(),
-	                         m_filename.length() + 1, XATTR_CREATE);
-	if (retVal != 0)
-	{
-		int savedErrno = errno;
-		MojLogError(s_log,
-		            _T("Initialize: Failed to set filename as attribute on '%s' (%s)."),
-		            pathname.c_str(), ::strerror(savedErrno));
-		success = false;
-	}
-	else
-	{
-		MojLogDebug(s_log,
-		            _T("Initialize: Set user.f attribute on '%s' to '%s'."),
-		            pathname.c_str(), m_filename.c_str());
-	}
-
-	return success;
-}
 
-bool
-CCacheObject::SetSizeAttribute(const std::string &pathname,
-                               const std::string &logname,
-                               const bool replace)
-{
-
-	MojLogTrace(s_log);
+			if (success && m_inMemory &&
+			        (::symlink(filePath.c_str(), pathname.c_str()) != 0))
+			{
+				int savedErrno = errno;
+				MojLogError(s_log, _T("Initialize: Failed to link '%s' to '%s' (%s)."),
+				            pathname.c_str(), filePath.c_str(), ::strerror(savedErrno));
+				(void) ::unlink(filePath.c_str());
+				success = false;
+			}
 
-	bool success = true;
-	// Add the size as an extended attribute
-	int retVal = FC_setxattr(pathname.c_str(), "user.s", &m_size,
-	                         sizeof(m_size),
-	                         replace ? XATTR_REPLACE : XATTR_CREATE);
-	if (retVal != 0)
-	{
-		int savedErrno = errno;
-		MojLogError(s_log,
-		            _T("%s: Failed to set size as attribute on '%s' (%s)."),
-		            logname.c_str(), pathname.c_str(), ::strerror(savedErrno));
-		success = false;
-	}
-	else
-	{
-		MojLogDebug(s_log,
-		            _T("%s: Set user.s attribute on '%s' to '%d'."),
-		            logname.c_str(), pathname.c_str(), m_size);
+			if (success && GetFileCacheSet()->GetReserveSpace())
+			{
+				success = ReserveSpace(pathname, std::string("Initialize"));
+			}
+		}
 	}
-
 	return success;
 }
 
+// Allocate the disk space for the declared size of a file object.  A
+// filesystem that can't reserve space just isn't reserved on, running
+// out of space fails.
 bool
-CCacheObject::SetCostAttribute(const std::string &pathname)
+CCacheObject::ReserveSpace(const std::string &pathname,
+                           const std::string &logname)
 {
 
 	MojLogTrace(s_log);
 
 	bool success = true;
-	// Add the cost as an extended attribute
-	int retVal = FC_setxattr(pathname.c_str(), "user.c", &m_cost,
-	                         sizeof(m_cost), XATTR_CREATE);
-	if (retVal != 0)
+	std::string msgText;
+	if (!ReserveFileSpace(pathname, m_size, msgText))
 	{
-		int savedErrno = errno;
-		MojLogError(s_log,
-		            _T("Initialize: Failed to set cost as attribute on '%s' (%s)."),
-		            pathname.c_str(), ::strerror(savedErrno));
-		success = false;
+		if (errno == EOPNOTSUPP)
+		{
+			MojLogWarning(s_log, _T("%s: %s"), logname.c_str(), msgText.c_str());
+		}
+		else
+		{
+			MojLogError(s_log, _T("%s: %s"), logname.c_str(), msgText.c_str());
+			success = false;
+		}
 	}
 	else
 	{
-		MojLogDebug(s_log,
-		            _T("Initialize: Set user.c attribute on '%s' to '%d'."),
-		            pathname.c_str(), m_cost);
+		MojLogDebug(s_log, _T("%s: Reserved '%lld' bytes for '%s'."),
+		            logname.c_str(), m_size, pathname.c_str());
 	}
 
 	return success;
 }
 
+// Persist all of the object's metadata in one packed extended
+// attribute.  This replaces the record unless the object is new.
 bool
-CCacheObject::SetLifetimeAttribute(const std::string &pathname)
+CCacheObject::SetAttributes(const std::string &pathname,
+                            const std::string &logname,
+                            const bool replace, const char *attrName)
 {
 
 	MojLogTrace(s_log);
 
-	bool success = true;
-	// Add the lifetime as an extended attribute
-	int retVal = FC_setxattr(pathname.c_str(), "user.l", &m_lifetime,
-	                         sizeof(m_lifetime), XATTR_CREATE);
-	if (retVal != 0)
-	{
-		int savedErrno = errno;
-		MojLogError(s_log,
-		            _T("Initialize: Failed to set lifetime as attribute on '%s' (%s)."),
-		            pathname.c_str(), ::strerror(savedErrno));
-		success = false;
-	}
-	else
+	// tmpfs may not take user attributes and a memory object doesn't
+	// outlive a reboot, the cache index is enough to restore it
+	if (m_inMemory)
 	{
-		MojLogDebug(s_log,
-		            _T("Initialize: Set user.l attribute on '%s' to '%d'."),
-		            pathname.c_str(), m_lifetime);
+		return true;
 	}
 
-	return success;
-}
-
-bool
-CCacheObject::SetWrittenAttribute(const std::string &pathname,
-                                  const std::string &logname,
-                                  const bool replace)
-{
-
-	MojLogTrace(s_log);
-
 	bool success = true;
-
-	// Add the written flag as an extended attribute.
-	int writtenVal = m_written ? 1 : 0;
-	int retVal = FC_setxattr(pathname.c_str(), "user.w", &writtenVal,
-	                         sizeof(writtenVal),
+	CObjectRecord record;
+	record.m_filename = m_filename->GetString();
+	record.m_size = m_size;
+	record.m_cost = m_cost;
+	record.m_lifetime = m_lifetime;
+	record.m_written = m_written;
+	record.m_dirType = m_dirType;
+	record.m_compressed = m_compressed;
+	record.m_storedSize = m_storedSize;
+	const std::string value(PackObjectRecord(record));
+	int retVal = FC_setxattr(pathname.c_str(), attrName, value.data(),
+	                         value.length(),
 	                         replace ? XATTR_REPLACE : XATTR_CREATE);
 	if (retVal != 0)
 	{
 		int savedErrno = errno;
 		MojLogError(s_log,
-		            _T("%s: Failed to set written flag as attribute on '%s' (%s)."),
+		            _T("%s: Failed to set attributes on '%s' (%s)."),
 		            logname.c_str(), pathname.c_str(), ::strerror(savedErrno));
 		success = false;
 	}
 	else
 	{
 		MojLogDebug(s_log,
-		            _T("%s: Set user.w attribute on '%s' to '%d'."),
-		            logname.c_str(), pathname.c_str(), writtenVal);
-	}
-
-	if (success)
-	{
-		// Now set the permissions on the file so it can't be written,
-		// they will be changed to read-write during the first subscribe.
-		retVal = ::chmod(pathname.c_str(), s_fileROPerms);
-		if (retVal != 0)
-		{
-			int savedErrno = errno;
-			MojLogError(s_log,
-			            _T("%s: Failed to change permissions on '%s' (%s)."),
-			            logname.c_str(), pathname.c_str(), ::strerror(savedErrno));
-			success = false;
-		}
-		else
-		{
-			MojLogDebug(s_log, _T("%s: Permissions reset on '%s'."),
-			            logname.c_str(), pathname.c_str());
-		}
+		            _T("%s: Set %s attribute on '%s' (size '%lld', written '%d')."),
+		            logname.c_str(), attrName, pathname.c_str(), m_size,
+		            m_written ? 1 : 0);
 	}
 
 	return success;
 }
 
+// Set the permissions on the file so it can't be written, they will be
+// changed to read-write during the first subscribe.
 bool
-CCacheObject::SetDirTypeAttribute(const std::string &pathname)
+CCacheObject::SetReadOnly(const std::string &pathname,
+                          const std::string &logname)
 {
 
 	MojLogTrace(s_log);
 
 	bool success = true;
-
-	// Add the dirType flag as an extended attribute.
-	int dirtypeVal = m_dirType ? 1 : 0;
-	int retVal = FC_setxattr(pathname.c_str(), "user.d", &dirtypeVal,
-	                         sizeof(dirtypeVal), XATTR_CREATE);
+	int retVal = ::chmod(pathname.c_str(), s_fileROPerms);
 	if (retVal != 0)
 	{
 		int savedErrno = errno;
 		MojLogError(s_log,
-		            _T("Initialize: Failed to set dirType as attribute on '%s' (%s)."),
-		            pathname.c_str(), ::strerror(savedErrno));
+		            _T("%s: Failed to change permissions on '%s' (%s)."),
+		            logname.c_str(), pathname.c_str(), ::strerror(savedErrno));
 		success = false;
 	}
 	else
 	{
-		MojLogDebug(s_log,
-		            _T("Initialize: Set user.d attribute on '%s' to '%d'."),
-		            pathname.c_str(), dirtypeVal);
+		MojLogDebug(s_log, _T("%s: Permissions reset on '%s'."),
+		            logname.c_str(), pathname.c_str());
 	}
 
 	return success;
@@ -397,27 +340,11 @@ CCacheObject::Initialize(bool isNew)
 		}
 		if (success)
 		{
-			success = SetFilenameAttribute(pathname);
-		}
-		if (success)
-		{
-			success = SetSizeAttribute(pathname, std::string("Initialize"));
-		}
-		if (success)
-		{
-			success = SetCostAttribute(pathname);
-		}
-		if (success)
-		{
-			success = SetLifetimeAttribute(pathname);
-		}
-		if (success)
-		{
-			success = SetDirTypeAttribute(pathname);
+			success = SetAttributes(pathname, std::string("Initialize"));
 		}
 		if (success)
 		{
-			success = SetWrittenAttribute(pathname, std::string("Initialize"));
+			success = SetReadOnly(pathname, std::string("Initialize"));
 		}
 	}
 
@@ -435,20 +362,63 @@ CCacheObject::GetFileCacheType()
 
 // This will increment the subscribe count and return the path to
 // the file backing this object.  If the object doesn't exist, this
-// will return an empty string.
+// will return an empty string.  If stream points to true, a reader
+// can subscribe to a file object still being written.
 std::string
-CCacheObject::Subscribe(std::string &msgText)
+CCacheObject::Subscribe(std::string &msgText, bool *stream)
 {
 
 	MojLogTrace(s_log);
 
+	const bool streaming = (stream != NULL) && *stream && !m_written;
+	if (stream != NULL)
+	{
+		*stream = false;
+	}
+
 	std::string pathname("");
 	if (!isExpired())
 	{
-		if (m_written || (m_subscriptionCount == 0))
+		if (streaming && (m_dirType || (!isWriterSubscribed() && !m_syncPending)))
+		{
+			msgText = m_dirType ? "Failed, directory objects can't be streamed" :
+			          "Failed, object is not being written";
+			MojLogError(s_log,
+			            _T("Subscribe: %s for object '%llu'."),
+			            msgText.c_str(), m_id);
+		}
+		else if (streaming)
+		{
+			// The reader gets the file the writer is filling, it's told
+			// how much there is to read as it's written
+			pathname = GetPathname();
+			if (!pathname.empty())
+			{
+				MojLogInfo(s_log,
+				           _T("Subscribe: streaming subscription taken on object '%llu'."),
+				           m_id);
+				m_subscriptionCount++;
+				m_streamReaders++;
+				*stream = true;
+			}
+		}
+		else if (m_syncPending)
+		{
+			// The flush of the writer's data is still queued, the object
+			// is only written, or open to a new writer, once it's done
+			msgText = "Failed, object is still being flushed";
+			MojLogError(s_log,
+			            _T("Subscribe: %s for object '%llu'."),
+			            msgText.c_str(), m_id);
+		}
+		else if (m_written || (m_subscriptionCount == 0))
 		{
 			pathname = GetPathname();
-			if (!m_written)
+			if (m_compressed && !pathname.empty())
+			{
+				pathname = OpenView(pathname);
+			}
+			else if (!m_written)
 			{
 				// Now set the permissions on the file so it can be written,
 				// it will be changed to read-only during the unsubscribe.
@@ -474,6 +444,14 @@ CCacheObject::Subscribe(std::string &msgText)
 				MojLogInfo(s_log,
 				           _T("Subscribe: subscription taken on object '%llu'."), m_id);
 				m_subscriptionCount++;
+
+				// The writer is followed so the object is validated as it
+				// changes and a directory's size is known without a walk
+				CDirSizeTracker *tracker = GetFileCacheSet()->GetDirSizeTracker();
+				if (!m_written && (tracker != NULL))
+				{
+					(void) tracker->Track(m_id, pathname);
+				}
 			}
 		}
 		else
@@ -496,16 +474,46 @@ CCacheObject::Subscribe(std::string &msgText)
 }
 
 void
-CCacheObject::UnSubscribe()
+CCacheObject::UnSubscribe(const bool stream)
 {
 
 	MojLogTrace(s_log);
 
 	m_subscriptionCount--;
 
+	// A streaming reader leaves the object to its writer, and the
+	// writer's tracking to the writer's unsubscribe
+	if (stream && (m_streamReaders > 0))
+	{
+		m_streamReaders--;
+		MojLogDebug(s_log,
+		            _T("UnSubscribe: streaming subscription released on object '%llu'."),
+		            m_id);
+		if (m_compressed && (m_subscriptionCount == 0))
+		{
+			RemoveView();
+		}
+		if (!m_expired)
+		{
+			UpdateAccessTime();
+		}
+		return;
+	}
+
 	bool suceeded = true;
 	const std::string pathname(GetPathname());
 
+	CDirSizeTracker *tracker = GetFileCacheSet()->GetDirSizeTracker();
+	if (tracker != NULL)
+	{
+		tracker->Untrack(m_id);
+	}
+
+	if (m_compressed && (m_subscriptionCount == 0))
+	{
+		RemoveView();
+	}
+
 	if (m_dirType)
 	{
 		// By setting suceeded = false, it will be marked as expired and
@@ -515,7 +523,7 @@ CCacheObject::UnSubscribe()
 		            pathname.c_str());
 		suceeded = false;
 	}
-	else if (!m_written)
+	else if (!m_written && !m_syncPending)
 	{
 		// Check if this is the first subscription where the file gets
 		// written
@@ -558,13 +566,19 @@ CCacheObject::UnSubscribe()
 				else if (size < m_size)
 				{
 					// If the real size is smaller, reset the specified size to
-					// the real size and persist the value
+					// the real size, it's persisted with the written flag
 					MojLogDebug(s_log,
-					            _T("UnSubscribe: Resetting object size of '%llu' from '%d' to '%d'."),
+					            _T("UnSubscribe: Resetting object size of '%llu' from '%lld' to '%lld'."),
 					            m_id, m_size, size);
-					m_size = size;
-					suceeded = SetSizeAttribute(pathname, std::string("UnSubscribe"),
-					                            true);
+					SetSize(size);
+				}
+
+				// Give back what was reserved past the end of the file
+				std::string msgText;
+				if (suceeded && GetFileCacheSet()->GetReserveSpace() &&
+				        !ReleaseFileSpace(pathname, msgText))
+				{
+					MojLogWarning(s_log, _T("UnSubscribe: %s"), msgText.c_str());
 				}
 			}
 		}
@@ -574,28 +588,31 @@ CCacheObject::UnSubscribe()
 			suceeded = false;
 		}
 
-		if (suceeded)
+		// Hand the flush to the sync queue when there is one, the
+		// object stays unwritten until SyncDone.  There is nothing to
+		// flush for a memory object.
+		CSyncQueue *syncQueue = GetFileCacheSet()->GetSyncQueue();
+		if (suceeded && (syncQueue != NULL) && !m_inMemory)
+		{
+			MojLogDebug(s_log, _T("UnSubscribe: Queued sync of '%s'."),
+			            pathname.c_str());
+			m_syncPending = true;
+			syncQueue->Add(m_fileCache->GetType(), m_id, pathname);
+		}
+		else if (suceeded)
 		{
 			std::string msgText;
-			suceeded = SyncFile(pathname, msgText);
+			suceeded = m_inMemory || SyncFile(pathname, msgText);
 			MojLogDebug(s_log, _T("UnSubscribe: SyncFile was %s."),
 			            suceeded ? "successful" : "unsuccessful");
 			if (!suceeded && !msgText.empty())
 			{
 				MojLogError(s_log, _T("UnSubscribe: %s"), msgText.c_str());
 			}
-		}
 
-		// Now persist the written flag by reseting the extended
-		// attribute, this makes it a valid file for deserialize
-		if (suceeded)
-		{
-			m_written = true;
-			suceeded = SetWrittenAttribute(pathname, std::string("UnSubscribe"),
-			                               true);
-			if (!suceeded)
+			if (suceeded)
 			{
-				m_written = false;
+				suceeded = SetWritten(pathname, std::string("UnSubscribe"));
 			}
 		}
 	}
@@ -605,11 +622,7 @@ CCacheObject::UnSubscribe()
 
 	if (!suceeded)
 	{
-		// Mark this expired and remove it from the FileCacheSet id map so
-		// it will be orphaned and cleaned up next time we reap orphans
-		MojLogDebug(s_log, _T("UnSubscribe: Object '%llu' marked as expired."), m_id);
-		GetFileCacheSet()->RemoveObjectFromIdMap(m_id);
-		m_expired = true;
+		WriteFailed();
 	}
 	else
 	{
@@ -617,137 +630,780 @@ CCacheObject::UnSubscribe()
 	}
 }
 
-// This updates the access time without needing to subscribe, it's
-// like using touch on an existing file
-time_t
-CCacheObject::Touch()
+// Finish the write of an object whose queued flush has completed
+void
+CCacheObject::SyncDone(bool synced)
 {
 
 	MojLogTrace(s_log);
 
-	return UpdateAccessTime();
+	if (!m_syncPending)
+	{
+		return;
+	}
+	m_syncPending = false;
+
+	if (!synced || !SetWritten(GetPathname(), std::string("SyncDone")))
+	{
+		WriteFailed();
+	}
 }
 
-// The FileCache::Resize will have already checked for space so this
-// just sets the new size and persists it.
-cacheSize_t
-CCacheObject::Resize(cacheSize_t newSize)
+// Now persist the written flag by reseting the extended attribute,
+// this makes it a valid file for deserialize
+bool
+CCacheObject::SetWritten(const std::string &pathname,
+                         const std::string &logname)
 {
 
 	MojLogTrace(s_log);
 
-	// Since you can only resize a file while it's being written, we can
-	// check and just return the saved size if already written
-	if (!m_written && (m_subscriptionCount == 1))
+	m_written = true;
+	bool suceeded = SetAttributes(pathname, logname, true) &&
+	                SetReadOnly(pathname, logname);
+	if (!suceeded)
 	{
-
-		const std::string pathname(GetPathname());
-		int savedSize = m_size;
-		m_size = newSize;
-		if (!SetSizeAttribute(pathname, std::string("Resize"), true))
-		{
-			m_size = savedSize;
-		}
+		m_written = false;
 	}
-	else
+	else if (!m_expired)
 	{
-		if (m_written)
-		{
-			MojLogWarning(s_log,
-			              _T("Resize: Operation not allowed on written object '%llu'."),
-			              m_id);
-		}
-		else if (m_subscriptionCount == 0)
-		{
-			MojLogWarning(s_log,
-			              _T("Resize: Operation not allowed on unsubscribed object '%llu'."),
-			              m_id);
-		}
+		NotifyStreamReaders(StreamEventWritten, m_size);
 	}
 
-	return m_size;
+	return suceeded;
 }
 
-bool
-CCacheObject::Expire()
+// The path of the view of a compressed object for a new subscription.
+// The first subscription makes the view, on the I/O pool if there is
+// one, and the others share it.  Returns an empty string if it can't be
+// made.
+std::string
+CCacheObject::OpenView(const std::string &pathname)
 {
 
 	MojLogTrace(s_log);
 
-	bool successful = true;
-	m_expired = true;
-	if (m_subscriptionCount > 0)
+	const bool making = !m_viewOpen && !m_viewPending;
+	if (making)
 	{
-		MojLogInfo(s_log,
-		           _T("Expire: Subscribed, cannot remove expired object."));
-		successful = false;
+		m_viewInMemory = !GetFileCacheSet()->GetMemoryDirName().empty();
 	}
-	else if (m_filename.size() > 0)
+	const std::string viewBase(GetViewBasename(making));
+	std::string viewPath;
+	if (viewBase.empty() || !GetViewPath(viewBase, viewPath))
 	{
-		const std::string pathname(GetPathname());
-		if (m_dirType)
+		MojLogError(s_log, _T("Subscribe: Failed to find the view of '%s'."),
+		            pathname.c_str());
+		return std::string();
+	}
+	if (!making)
+	{
+		return viewPath;
+	}
+
+	CIoWorkerPool *ioPool = GetFileCacheSet()->GetIoPool();
+	if (ioPool == NULL)
+	{
+		if (!MakeView(pathname, viewBase, m_size))
 		{
-			std::string msgText;
-			successful = CleanupDir(pathname, msgText);
-			if (successful)
-			{
-				MojLogDebug(s_log,
-				            _T("Expire: Cleaned directory '%s' to expire object '%llu'."),
-				            pathname.c_str(), m_id);
-			}
-			else
+			return std::string();
+		}
+		SetViewOpen(true);
+		return viewPath;
+	}
+
+	// The view is made on the pool in the order of the type's other
+	// work, so it can't race the removal of another view's directory
+	m_viewPending = true;
+	CFileCacheSet *fileCacheSet = GetFileCacheSet();
+	const cachedObjectId_t id = m_id;
+	const cacheSize_t size = m_size;
+	std::shared_ptr<bool> made(new bool(false));
+	ioPool->Post(m_fileCache->GetType(), [pathname, viewBase, size, made]()
+	{
+		*made = MakeView(pathname, viewBase, size);
+	}, [fileCacheSet, id, viewPath, made]()
+	{
+		fileCacheSet->FinishView(id, viewPath, *made);
+	});
+
+	return viewPath;
+}
+
+// Called once the view being made on the I/O pool is finished
+bool
+CCacheObject::FinishView(const bool made)
+{
+
+	MojLogTrace(s_log);
+
+	m_viewPending = false;
+	if (!made)
+	{
+		return false;
+	}
+	SetViewOpen(true);
+	if (m_subscriptionCount == 0)
+	{
+		RemoveView();
+		return false;
+	}
+
+	return true;
+}
+
+// The path the view of this object is named from.  That's the path of
+// the object in the memory directory if the view is kept in memory, so
+// reading a compressed object doesn't write the flash, otherwise it's
+// the object's own path.  The type's memory directory is made if
+// createDir is set.
+std::string
+CCacheObject::GetViewBasename(bool createDir)
+{
+
+	MojLogTrace(s_log);
+
+	if (!m_viewInMemory)
+	{
+		return GetPathname();
+	}
+	if (createDir)
+	{
+		const std::string typeDir(GetFileCacheSet()->GetMemoryDirName() + "/" +
+		                          m_fileCache->GetType());
+		int retVal = ::mkdir(typeDir.c_str(), s_dirPerms);
+		if ((retVal != 0) && (errno != EEXIST))
+		{
+			int savedErrno = errno;
+			MojLogWarning(s_log,
+			              _T("Subscribe: Failed to make directory '%s' (%s), view kept with the object."),
+			              typeDir.c_str(), ::strerror(savedErrno));
+			m_viewInMemory = false;
+			return GetPathname();
+		}
+	}
+
+	return GetMemoryPathname();
+}
+
+// Open or close the view, keeping the memory space up to date for a
+// view kept in memory
+void
+CCacheObject::SetViewOpen(const bool open)
+{
+
+	if (open == m_viewOpen)
+	{
+		return;
+	}
+	m_viewOpen = open;
+	if (m_viewInMemory)
+	{
+		const cacheSize_t size = GetFilesystemFileSize(m_size);
+		GetFileCacheSet()->AdjustMemorySize(open ? size : -size);
+	}
+}
+
+// Remove the open view of a compressed object, on the I/O pool if
+// there is one so it stays in order with the views being made.  A view
+// still being made is removed once it's finished.
+void
+CCacheObject::RemoveView()
+{
+
+	MojLogTrace(s_log);
+
+	if (!m_viewOpen)
+	{
+		return;
+	}
+	std::string viewPath;
+	const bool found = GetViewPath(GetViewBasename(), viewPath);
+	SetViewOpen(false);
+	if (!found)
+	{
+		return;
+	}
+
+	CIoWorkerPool *ioPool = GetFileCacheSet()->GetIoPool();
+	if (ioPool != NULL)
+	{
+		ioPool->Post(m_fileCache->GetType(), [viewPath]()
+		{
+			RemoveViewFile(viewPath);
+		});
+	}
+	else
+	{
+		RemoveViewFile(viewPath);
+	}
+}
+
+// Decompress the compressed object at pathname into its view, making
+// the directories of the view named from viewBase.  Nothing is left
+// behind if it can't be made.
+bool
+CCacheObject::MakeView(const std::string &pathname,
+                       const std::string &viewBase, const cacheSize_t size)
+{
+
+	std::string viewPath;
+	if (!GetViewPath(viewBase, viewPath, true))
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("Subscribe: Failed to make the view of '%s' (%s)."),
+		            pathname.c_str(), ::strerror(savedErrno));
+		return false;
+	}
+
+	std::string msgText;
+	cacheSize_t viewSize;
+	if (!DecompressFile(pathname, viewPath, viewSize, msgText) ||
+	        (viewSize != size) ||
+	        (::chmod(viewPath.c_str(), s_fileROPerms) != 0))
+	{
+		MojLogError(s_log, _T("Subscribe: Failed to decompress '%s' (%s)."),
+		            pathname.c_str(), msgText.empty() ? "wrong size" : msgText.c_str());
+		RemoveViewFile(viewPath);
+		return false;
+	}
+	MojLogDebug(s_log, _T("Subscribe: Decompressed '%s' to '%s'."),
+	            pathname.c_str(), viewPath.c_str());
+
+	return true;
+}
+
+// Unlink the file of a view and its directory
+void
+CCacheObject::RemoveViewFile(const std::string &viewPath)
+{
+
+	if ((::unlink(viewPath.c_str()) != 0) && (errno != ENOENT))
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("UnSubscribe: Failed to unlink view '%s' (%s)."),
+		            viewPath.c_str(), ::strerror(savedErrno));
+	}
+	RemoveEmptyDir(GetDirectoryFromPath(viewPath), std::string("UnSubscribe"));
+}
+
+// Replace the file of this written object with its compressed content.
+// The compressed file was made in the trash, it's given this object's
+// record and renamed over the file, so the object always has a
+// complete file and a crash leaves nothing behind but trash.
+bool
+CCacheObject::Compress(const std::string &compressedPath,
+                       cacheSize_t storedSize)
+{
+
+	MojLogTrace(s_log);
+
+	const std::string pathname(GetPathname());
+	m_compressed = true;
+	m_storedSize = storedSize;
+	bool suceeded = !pathname.empty() &&
+	                (::chmod(compressedPath.c_str(), s_fileRWPerms) == 0) &&
+	                SetAttributes(compressedPath, std::string("Compress"));
+	suceeded = suceeded && SetReadOnly(compressedPath, std::string("Compress"));
+	if (suceeded && (::rename(compressedPath.c_str(), pathname.c_str()) != 0))
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("Compress: Failed to rename '%s' to '%s' (%s)."),
+		            compressedPath.c_str(), pathname.c_str(), ::strerror(savedErrno));
+		suceeded = false;
+	}
+	if (!suceeded)
+	{
+		m_compressed = false;
+		m_storedSize = 0;
+		(void) ::unlink(compressedPath.c_str());
+		return false;
+	}
+	MojLogDebug(s_log, _T("Compress: Object '%llu' compressed from '%lld' to '%lld'."),
+	            m_id, m_size, storedSize);
+
+	return true;
+}
+
+// Keep the file of this object in memory
+void
+CCacheObject::SetInMemory()
+{
+
+	MojLogTrace(s_log);
+
+	m_inMemory = true;
+	GetFileCacheSet()->AddMemoryObject(this);
+}
+
+// Move this written memory object to the cache directory.  The copy
+// was made in the trash, it's given this object's record and renamed
+// over the link, so the object always has a complete file.  A reader
+// with the memory file open keeps reading it until it's closed.
+bool
+CCacheObject::Demote(const std::string &copyPath)
+{
+
+	MojLogTrace(s_log);
+
+	const std::string pathname(GetPathname());
+	const std::string memoryPath(GetMemoryPathname());
+	m_inMemory = false;
+	bool suceeded = !pathname.empty() &&
+	                SetAttributes(copyPath, std::string("Demote"));
+	suceeded = suceeded && SetReadOnly(copyPath, std::string("Demote"));
+	if (suceeded && (::rename(copyPath.c_str(), pathname.c_str()) != 0))
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("Demote: Failed to rename '%s' to '%s' (%s)."),
+		            copyPath.c_str(), pathname.c_str(), ::strerror(savedErrno));
+		suceeded = false;
+	}
+	if (!suceeded)
+	{
+		m_inMemory = true;
+		(void) ::unlink(copyPath.c_str());
+		return false;
+	}
+	GetFileCacheSet()->RemoveMemoryObject(this);
+	(void) RemoveFiles(memoryPath, false, m_id, std::string("Demote"));
+	MojLogDebug(s_log, _T("Demote: Object '%llu' moved from '%s' to '%s'."),
+	            m_id, memoryPath.c_str(), pathname.c_str());
+
+	return true;
+}
+
+// Move the record of this written object to its own link attribute.
+// The new record is set before the old one goes so the file always has
+// one.
+bool
+CCacheObject::ShareFile()
+{
+
+	MojLogTrace(s_log);
+
+	const std::string pathname(GetPathname());
+	const std::string attrName(GetLinkAttrName(m_id));
+	if (pathname.empty())
+	{
+		return false;
+	}
+	if (FC_getxattr(pathname.c_str(), attrName.c_str(), NULL, 0) >= 0)
+	{
+		return true;
+	}
+
+	bool suceeded = (::chmod(pathname.c_str(), s_fileRWPerms) == 0) &&
+	                SetAttributes(pathname, std::string("ShareFile"), false,
+	                              attrName.c_str());
+	if (suceeded && (FC_removexattr(pathname.c_str(), s_objectAttrName) != 0))
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("ShareFile: Failed to remove %s from '%s' (%s)."),
+		            s_objectAttrName, pathname.c_str(), ::strerror(savedErrno));
+		(void) FC_removexattr(pathname.c_str(), attrName.c_str());
+		suceeded = false;
+	}
+
+	return SetReadOnly(pathname, std::string("ShareFile")) && suceeded;
+}
+
+// Replace the file of this written object with a hard link to target.
+// The link is made in the trash, given this object's record and then
+// renamed over the file, so the object always has a complete file and
+// a crash leaves nothing behind but trash.
+bool
+CCacheObject::LinkTo(const std::string &target)
+{
+
+	MojLogTrace(s_log);
+
+	const std::string pathname(GetPathname());
+	std::string linkPath;
+	if (pathname.empty() || !LinkToTrash(target, pathname, linkPath))
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("LinkTo: Failed to link '%s' to '%s' (%s)."),
+		            pathname.c_str(), target.c_str(), ::strerror(savedErrno));
+		return false;
+	}
+
+	// The shared file is read-only, it's opened up just long enough to
+	// add the record
+	const std::string attrName(GetLinkAttrName(m_id));
+	bool suceeded = (::chmod(linkPath.c_str(), s_fileRWPerms) == 0) &&
+	                SetAttributes(linkPath, std::string("LinkTo"), false,
+	                              attrName.c_str());
+	suceeded = SetReadOnly(linkPath, std::string("LinkTo")) && suceeded;
+	if (suceeded && (::rename(linkPath.c_str(), pathname.c_str()) != 0))
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("LinkTo: Failed to rename '%s' to '%s' (%s)."),
+		            linkPath.c_str(), pathname.c_str(), ::strerror(savedErrno));
+		suceeded = false;
+	}
+	if (!suceeded)
+	{
+		(void) FC_removexattr(linkPath.c_str(), attrName.c_str());
+		(void) ::unlink(linkPath.c_str());
+		return false;
+	}
+	m_linked = true;
+	MojLogDebug(s_log, _T("LinkTo: Object '%llu' now shares '%s'."), m_id,
+	            target.c_str());
+
+	return true;
+}
+
+// Mark this expired and remove it from the FileCacheSet id map so it
+// will be orphaned and cleaned up next time we reap orphans
+void
+CCacheObject::WriteFailed()
+{
+
+	MojLogTrace(s_log);
+
+	MojLogDebug(s_log, _T("UnSubscribe: Object '%llu' marked as expired."), m_id);
+	GetFileCacheSet()->RemoveObjectFromIdMap(m_id);
+	if (!m_expired)
+	{
+		NotifyStreamReaders(StreamEventFailed, 0);
+	}
+	m_expired = true;
+	m_fileCache->QueueOrphan(m_id);
+}
+
+// This updates the access time without needing to subscribe, it's
+// like using touch on an existing file
+time_t
+CCacheObject::Touch()
+{
+
+	MojLogTrace(s_log);
+
+	return UpdateAccessTime();
+}
+
+// Tell the streaming readers how much of the object has been written.
+// The tracked size is used when the writer is tracked, otherwise the
+// file is looked at.
+void
+CCacheObject::ReportStreamProgress()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_written || m_expired || (m_streamReaders == 0))
+	{
+		return;
+	}
+
+	cacheSize_t size = -1;
+	CDirSizeTracker *tracker = GetFileCacheSet()->GetDirSizeTracker();
+	if (tracker != NULL)
+	{
+		size = tracker->GetSize(m_id);
+	}
+	if (size < 0)
+	{
+		struct stat buf;
+		const std::string pathname(GetPathname());
+		if (!pathname.empty() && (::stat(pathname.c_str(), &buf) == 0))
+		{
+			size = (cacheSize_t) buf.st_size;
+		}
+	}
+	if (size >= 0)
+	{
+		NotifyStreamReaders(StreamEventProgress, size);
+	}
+}
+
+// Returns true while the writer of an object being written holds its
+// subscription, the other subscriptions are streaming readers
+bool
+CCacheObject::isWriterSubscribed()
+{
+
+	return !m_written && (m_subscriptionCount > m_streamReaders);
+}
+
+// Pass an event on to the streaming readers of this object, if it has
+// any
+void
+CCacheObject::NotifyStreamReaders(const StreamEvent event,
+                                  const cacheSize_t size)
+{
+
+	if (m_streamReaders > 0)
+	{
+		GetFileCacheSet()->NotifyStreamReaders(m_id, event, size);
+	}
+}
+
+// The FileCache::Resize will have already checked for space so this
+// just sets the new size and persists it.
+cacheSize_t
+CCacheObject::Resize(cacheSize_t newSize)
+{
+
+	MojLogTrace(s_log);
+
+	// Since you can only resize a file while it's being written, we can
+	// check and just return the saved size if already written
+	if (isWriterSubscribed())
+	{
+
+		const std::string pathname(GetPathname());
+		cacheSize_t savedSize = m_size;
+		SetSize(newSize);
+
+		// Growing extends the reservation, shrinking leaves it to be
+		// given back when the file is written
+		bool success = true;
+		if (!m_dirType && (newSize > savedSize) &&
+		        GetFileCacheSet()->GetReserveSpace())
+		{
+			success = ReserveSpace(pathname, std::string("Resize"));
+		}
+		if (!success || !SetAttributes(pathname, std::string("Resize"), true))
+		{
+			SetSize(savedSize);
+		}
+	}
+	else
+	{
+		if (m_written)
+		{
+			MojLogWarning(s_log,
+			              _T("Resize: Operation not allowed on written object '%llu'."),
+			              m_id);
+		}
+		else if (m_subscriptionCount == m_streamReaders)
+		{
+			MojLogWarning(s_log,
+			              _T("Resize: Operation not allowed on unsubscribed object '%llu'."),
+			              m_id);
+		}
+	}
+
+	return m_size;
+}
+
+bool
+CCacheObject::Expire()
+{
+
+	MojLogTrace(s_log);
+
+	bool successful = true;
+	if (!m_expired && !m_written)
+	{
+		NotifyStreamReaders(StreamEventFailed, 0);
+	}
+	m_expired = true;
+	if (m_subscriptionCount > 0)
+	{
+		MojLogInfo(s_log,
+		           _T("Expire: Subscribed, cannot remove expired object."));
+		successful = false;
+	}
+	else if (m_filename->m_length > 0)
+	{
+		// If the removal fails, the timer worker method will walk the
+		// caches and look for these to try to cleanup
+		successful = Remove(std::string("Expire"));
+	}
+	else
+	{
+		MojLogDebug(s_log, _T("Expire: No filename to remove."));
+		successful = false;
+	}
+
+	return successful;
+}
+
+// Remove the file or directory of the object.  It's renamed into the
+// trash of its type, which is atomic and cheap however big the object
+// is, and deleted from there by the I/O worker pool at idle priority.
+// Without a pool it's deleted at once.  If it can't be moved it is
+// removed in place, queued on the pool if there is one and assumed to
+// work.  The directory the object was in is only ever removed on the
+// main loop, the one place objects are created, so an object made in
+// it can't have the directory taken from under it.
+bool
+CCacheObject::Remove(const std::string &logname)
+{
+
+	MojLogTrace(s_log);
+
+	const std::string pathname(GetPathname());
+	if (pathname.empty())
+	{
+		return false;
+	}
+
+	// The file of a memory object and the link to it are unlinked at
+	// once, neither takes any I/O worth deferring
+	if (m_inMemory)
+	{
+		(void) RemoveFiles(GetMemoryPathname(), false, m_id, logname);
+		m_removed = RemoveFiles(pathname, false, m_id, logname);
+		return m_removed;
+	}
+
+	// The record of a link stays on the shared file unless it's taken
+	// off first
+	struct stat buf;
+	if (!m_dirType && (m_linked || GetFileCacheSet()->GetDedupObjects()) &&
+	        (::lstat(pathname.c_str(), &buf) == 0) && (buf.st_nlink > 1))
+	{
+		(void) ::chmod(pathname.c_str(), s_fileRWPerms);
+		(void) FC_removexattr(pathname.c_str(), GetLinkAttrName(m_id).c_str());
+		(void) ::chmod(pathname.c_str(), s_fileROPerms);
+	}
+
+	bool successful = true;
+	CIoWorkerPool *ioPool = GetFileCacheSet()->GetIoPool();
+	std::string trashPath;
+	if (MoveToTrash(pathname, trashPath))
+	{
+		MojLogDebug(s_log, _T("%s: Moved '%s' to '%s'."), logname.c_str(),
+		            pathname.c_str(), trashPath.c_str());
+		RemoveEmptyDir(GetDirname(pathname), logname);
+		if (ioPool != NULL)
+		{
+			ioPool->Post(m_fileCache->GetType(), [trashPath, logname]()
 			{
-				MojLogError(s_log,
-				            _T("Expire: Failed to clean directory '%s'."),
-				            pathname.c_str());
-				if (!msgText.empty())
-				{
-					MojLogDebug(s_log, _T("Expire: %s."), msgText.c_str());
-				}
-			}
+				ReapFiles(trashPath, logname);
+			});
 		}
 		else
 		{
-			int retVal = ::unlink(pathname.c_str());
-			if (retVal != 0)
-			{
-				// This should never happen but if it does, the timer worker
-				// method will walk the caches and look for these to try to
-				// cleanup
-				int savedErrno = errno;
-				MojLogError(s_log,
-				            _T("Expire: Failed to unlink file '%s' (%s)."),
-				            pathname.c_str(), ::strerror(savedErrno));
-				successful = false;
-			}
-			else
+			ReapFiles(trashPath, logname);
+		}
+	}
+	else if (ioPool != NULL)
+	{
+		MojLogDebug(s_log, _T("%s: Queued removal of '%s'."), logname.c_str(),
+		            pathname.c_str());
+		const bool dirType = m_dirType;
+		const cachedObjectId_t id = m_id;
+		const std::string dirpath(GetDirectoryFromPath(pathname));
+		ioPool->Post(m_fileCache->GetType(), [pathname, dirType, id, logname]()
+		{
+			(void) RemoveFiles(pathname, dirType, id, logname, false);
+		}, [dirpath, logname]()
+		{
+			RemoveEmptyDir(dirpath, logname);
+		});
+	}
+	else
+	{
+		successful = RemoveFiles(pathname, m_dirType, m_id, logname);
+	}
+	m_removed = successful;
+
+	return successful;
+}
+
+// Delete an object moved to the trash
+void
+CCacheObject::ReapFiles(const std::string &trashPath,
+                        const std::string &logname)
+{
+
+	std::string msgText;
+	if (ReapTrash(trashPath, msgText))
+	{
+		MojLogDebug(s_log, _T("%s: Deleted '%s'."), logname.c_str(),
+		            trashPath.c_str());
+	}
+	else
+	{
+		// The trash is swept again at startup
+		MojLogError(s_log, _T("%s: Failed to delete '%s' (%s)."),
+		            logname.c_str(), trashPath.c_str(), msgText.c_str());
+	}
+}
+
+// Unlink the file, or clean the directory, of an object and, if
+// removeDir is set, remove its directory if that leaves it empty.
+// Without removeDir this only touches the object so it can run on an
+// I/O worker.
+bool
+CCacheObject::RemoveFiles(const std::string &pathname, const bool dirType,
+                          const cachedObjectId_t id, const std::string &logname,
+                          const bool removeDir)
+{
+
+	bool successful = true;
+	if (dirType)
+	{
+		std::string msgText;
+		successful = CleanupDir(pathname, msgText);
+		if (successful)
+		{
+			MojLogDebug(s_log,
+			            _T("%s: Cleaned directory '%s' to remove object '%llu'."),
+			            logname.c_str(), pathname.c_str(), id);
+		}
+		else
+		{
+			MojLogError(s_log, _T("%s: Failed to clean directory '%s'."),
+			            logname.c_str(), pathname.c_str());
+			if (!msgText.empty())
 			{
-				MojLogDebug(s_log,
-				            _T("Expire: unlinked file '%s' to expire object '%llu'."),
-				            pathname.c_str(), m_id);
+				MojLogDebug(s_log, _T("%s: %s."), logname.c_str(), msgText.c_str());
 			}
 		}
-		const std::string dirpath(GetDirname(pathname));
-		int retVal = ::rmdir(dirpath.c_str());
-		if ((retVal != 0) && (errno != ENOTEMPTY) && (errno != ENOENT))
+	}
+	else
+	{
+		int retVal = ::unlink(pathname.c_str());
+		if ((retVal != 0) && (errno != ENOENT))
 		{
-			// This should also never happen.  If it does we will just print
-			// out the error as there isn't anything we can do about it.
+			// This should never happen but if it does, the timer worker
+			// method will walk the caches and look for these to try to
+			// cleanup
 			int savedErrno = errno;
-			MojLogError(s_log,
-			            _T("Expire: Failed to rmdir directory '%s' (%s)."),
-			            dirpath.c_str(), ::strerror(savedErrno));
+			MojLogError(s_log, _T("%s: Failed to unlink file '%s' (%s)."),
+			            logname.c_str(), pathname.c_str(), ::strerror(savedErrno));
+			successful = false;
+		}
+		else
+		{
+			MojLogDebug(s_log, _T("%s: Unlinked file '%s' to remove object '%llu'."),
+			            logname.c_str(), pathname.c_str(), id);
 		}
 	}
-	else
+
+	if (removeDir)
 	{
-		MojLogDebug(s_log, _T("Expire: No filename to remove."));
-		successful = false;
+		RemoveEmptyDir(GetDirectoryFromPath(pathname), logname);
 	}
 
 	return successful;
 }
 
+// Remove the directory an object was in if it is now empty
+void
+CCacheObject::RemoveEmptyDir(const std::string &dirpath,
+                             const std::string &logname)
+{
+
+	int retVal = ::rmdir(dirpath.c_str());
+	if ((retVal != 0) && (errno != ENOTEMPTY) && (errno != ENOENT) &&
+	        (errno != EEXIST))
+	{
+		// This should also never happen.  If it does we will just print
+		// out the error as there isn't anything we can do about it.
+		int savedErrno = errno;
+		MojLogError(s_log, _T("%s: Failed to rmdir directory '%s' (%s)."),
+		            logname.c_str(), dirpath.c_str(), ::strerror(savedErrno));
+	}
+}
+
 // Validate a subscribed file that is writable.  For now, just ensure
 // the file size is <= the specified size, otherwise log it as an
 // error.
@@ -757,13 +1413,35 @@ CCacheObject::Validate()
 
 	MojLogTrace(s_log);
 
-	if (m_filename.size() > 0)
+	if (m_filename->m_length > 0)
 	{
 		const std::string pathname(GetPathname());
 		if (!pathname.empty())
 		{
 			cacheSize_t size = -1;
-			if (m_dirType)
+			bool queued = false;
+			CIoWorkerPool *ioPool = GetFileCacheSet()->GetIoPool();
+			CDirSizeTracker *tracker = GetFileCacheSet()->GetDirSizeTracker();
+			if (m_dirType && (tracker != NULL) && (tracker->GetSize(m_id) >= 0))
+			{
+				size = tracker->GetSize(m_id);
+			}
+			else if (m_dirType && (ioPool != NULL))
+			{
+				// Summing a large directory takes a while, so do it on a
+				// worker and check the result when it comes back
+				std::shared_ptr<cacheSize_t> sum(new cacheSize_t(-1));
+				const cacheSize_t expected = m_size;
+				ioPool->Post(m_fileCache->GetType(), [pathname, sum]()
+				{
+					*sum = SumDir(pathname);
+				}, [pathname, sum, expected]()
+				{
+					LogValidation(pathname, *sum, expected);
+				});
+				queued = true;
+			}
+			else if (m_dirType)
 			{
 				size = SumDir(pathname);
 			}
@@ -783,22 +1461,9 @@ CCacheObject::Validate()
 					size = (cacheSize_t) buf.st_size;
 				}
 			}
-			if ((size >= 0) && (size <= m_size))
-			{
-				MojLogInfo(s_log, _T("Validate: '%s' is valid."),
-				           pathname.c_str());
-			}
-			else if (size >= 0)
-			{
-				MojLogError(s_log,
-				            _T("Validate: '%s' is invalid, size = '%d', expected '%d'."),
-				            pathname.c_str(), size, m_size);
-			}
-			else
+			if (!queued)
 			{
-				MojLogError(s_log,
-				            _T("Validate: Failed to get size of '%s'."),
-				            pathname.c_str());
+				LogValidation(pathname, size, m_size);
 			}
 		}
 		else
@@ -815,6 +1480,30 @@ CCacheObject::Validate()
 	}
 }
 
+// Log whether the size found for a subscribed object is within the
+// size expected
+void
+CCacheObject::LogValidation(const std::string &pathname, cacheSize_t size,
+                            cacheSize_t expected)
+{
+
+	if ((size >= 0) && (size <= expected))
+	{
+		MojLogInfo(s_log, _T("Validate: '%s' is valid."), pathname.c_str());
+	}
+	else if (size >= 0)
+	{
+		MojLogError(s_log,
+		            _T("Validate: '%s' is invalid, size = '%lld', expected '%lld'."),
+		            pathname.c_str(), size, expected);
+	}
+	else
+	{
+		MojLogError(s_log, _T("Validate: Failed to get size of '%s'."),
+		            pathname.c_str());
+	}
+}
+
 CFileCacheSet *
 CCacheObject::GetFileCacheSet()
 {
@@ -830,10 +1519,63 @@ CCacheObject::GetPathname(bool createDir)
 
 	MojLogTrace(s_log);
 
-	const std::string typeName(GetFileCacheType());
-	const std::string dirBase(GetFileCacheSet()->GetBaseDirName());
+	const std::string &typeName(m_fileCache->GetType());
+	const std::string &dirBase(GetFileCacheSet()->GetBaseDirName());
+
+	char pathname[s_maxPathnameLength];
+	size_t length = BuildPathname(pathname, sizeof(pathname), m_id, dirBase,
+	                              typeName, m_filename->m_name, createDir);
+
+	return std::string(pathname, length);
+}
+
+// The path of the file of a memory object in the memory directory.
+// The directory of the type is made along with the object's if
+// createDir is set.
+const std::string
+CCacheObject::GetMemoryPathname(bool createDir)
+{
+
+	MojLogTrace(s_log);
+
+	const std::string &typeName(m_fileCache->GetType());
+	const std::string &dirBase(GetFileCacheSet()->GetMemoryDirName());
+	if (dirBase.empty())
+	{
+		return std::string();
+	}
+	if (createDir)
+	{
+		const std::string typeDir(dirBase + "/" + typeName);
+		int retVal = ::mkdir(typeDir.c_str(), s_dirPerms);
+		if ((retVal != 0) && (errno != EEXIST))
+		{
+			int savedErrno = errno;
+			MojLogError(s_log, _T("Initialize: Failed to make directory '%s' (%s)."),
+			            typeDir.c_str(), ::strerror(savedErrno));
+			return std::string();
+		}
+	}
+
+	char pathname[s_maxPathnameLength];
+	size_t length = BuildPathname(pathname, sizeof(pathname), m_id, dirBase,
+	                              typeName, m_filename->m_name, createDir);
 
-	return BuildPathname(m_id, dirBase, typeName, m_filename, createDir);
+	return std::string(pathname, length);
+}
+
+// Set the size of the object, keeping the space taken in memory up to
+// date for a memory object
+void
+CCacheObject::SetSize(cacheSize_t size)
+{
+
+	if (m_inMemory)
+	{
+		GetFileCacheSet()->AdjustMemorySize(GetFilesystemFileSize(size) -
+		                                    GetFilesystemFileSize(m_size));
+	}
+	m_size = size;
 }
 
 std::string
@@ -851,8 +1593,19 @@ CCacheObject::GetCacheCost()
 
 	MojLogTrace(s_log);
 
+	return GetCacheCost(::time(0));
+}
+
+// Compute the cleanup cost as of the time now.  This lets a caller
+// scoring many objects read the clock once.
+paramValue_t
+CCacheObject::GetCacheCost(time_t now)
+{
+
+	MojLogTrace(s_log);
+
 	paramValue_t cost;
-	paramValue_t age = (paramValue_t)(::time(0) - m_lastAccessTime);
+	paramValue_t age = (paramValue_t)(now - m_lastAccessTime);
 	if (age < m_lifetime)
 	{
 		MojLogDebug(s_log,
@@ -861,8 +1614,13 @@ CCacheObject::GetCacheCost()
 	}
 	else
 	{
-		cacheSize_t sizeInPages = (m_size + s_blockSize - 1) / s_blockSize;
-		cost = m_cost * sizeInPages / age;
+		// Computed in 64 bits as large objects have enough pages to
+		// overflow 32, and capped to what a cost can hold
+		const cacheSize_t blockSize = GetBlockSize();
+		cacheSize_t sizeInPages = (m_size + blockSize - 1) / blockSize;
+		cacheSize_t weightedCost = (cacheSize_t) m_cost * sizeInPages / age;
+		cost = (weightedCost < (cacheSize_t) std::numeric_limits<paramValue_t>::max())
+		       ? (paramValue_t) weightedCost : std::numeric_limits<paramValue_t>::max();
 	}
 
 	return cost;
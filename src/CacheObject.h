@@ -18,6 +18,8 @@
 #define __CACHE_OBJECT_H__
 
 #include "CacheBase.h"
+#include "NameTable.h"
+#include "SlabPool.h"
 
 inline int FC_setxattr(const char *path, const char *name, const void *value,
                        size_t size, int options)
@@ -29,9 +31,50 @@ inline int FC_setxattr(const char *path, const char *name, const void *value,
 #endif // #ifdef MOJ_MAC
 }
 
+inline int FC_removexattr(const char *path, const char *name)
+{
+#ifdef MOJ_MAC
+	return ::removexattr(path, name, 0);
+#else
+	return ::removexattr(path, name);
+#endif // #ifdef MOJ_MAC
+}
+
 class CFileCache;
 class CFileCacheSet;
 
+// The key used to order objects in the per type eviction index.  The
+// cost is the cleanup cost computed when the index was last scored,
+// ties fall back to the oldest access time so equal costs are evicted
+// in LRU order.
+struct CEvictionKey
+{
+	CEvictionKey(paramValue_t cost = 0, time_t lastAccessTime = 0,
+	             cachedObjectId_t id = 0)
+		: m_cost(cost)
+		, m_lastAccessTime(lastAccessTime)
+		, m_id(id)
+	{
+	}
+
+	bool operator<(const CEvictionKey &otherKey) const
+	{
+		if (m_cost != otherKey.m_cost)
+		{
+			return m_cost < otherKey.m_cost;
+		}
+		if (m_lastAccessTime != otherKey.m_lastAccessTime)
+		{
+			return m_lastAccessTime < otherKey.m_lastAccessTime;
+		}
+		return m_id < otherKey.m_id;
+	}
+
+	paramValue_t m_cost;
+	time_t m_lastAccessTime;
+	cachedObjectId_t m_id;
+};
+
 class CCacheObject
 {
 public:
@@ -45,6 +88,14 @@ public:
 
 	~CCacheObject();
 
+	// Cache objects are allocated from a slab pool rather than one by
+	// one from the heap
+	static void *operator new(size_t size);
+	static void operator delete(void *ptr, size_t size);
+
+	// The table the filenames of all cache objects are interned in
+	static CNameTable &GetFilenameTable();
+
 	bool Initialize(bool isNew);
 
 	cachedObjectId_t GetId()
@@ -52,6 +103,12 @@ public:
 		return m_id;
 	}
 
+	// The cache of the type this object belongs to
+	CFileCache *GetFileCache()
+	{
+		return m_fileCache;
+	}
+
 	time_t GetCreationTime()
 	{
 		return m_creationTime;
@@ -79,18 +136,50 @@ public:
 		return m_lifetime;
 	}
 	paramValue_t GetCacheCost();
+	paramValue_t GetCacheCost(time_t now);
 
 	// This will increment the subscribe count and return the path to
 	// the file backing this object.  If the object doesn't exist, this
-	// will return an empty string.
-	std::string Subscribe(std::string &msgText);
+	// will return an empty string.  A compressed object is decompressed
+	// into a view by its first subscription and the path of the view is
+	// returned.  With an I/O pool the view is made there and is pending
+	// until FinishView is called.  If stream points to true, a file
+	// object still being written can be subscribed by readers as well as
+	// its writer, and stream is left true only if the subscription is
+	// such a streaming reader.  Only streaming readers can subscribe
+	// while the writer's flush is queued.
+	std::string Subscribe(std::string &msgText, bool *stream = NULL);
 	paramValue_t GetSubscriptionCount()
 	{
 		return m_subscriptionCount;
 	}
 
-	// This will decrement the subscribe count
-	void UnSubscribe();
+	// The number of streaming readers, which subscribed while the
+	// object was being written
+	paramValue_t GetStreamReaderCount()
+	{
+		return m_streamReaders;
+	}
+
+	// Tell the streaming readers how much of the object has been
+	// written.  Does nothing once it's written or if there are none.
+	void ReportStreamProgress();
+
+	// This will decrement the subscribe count.  The first time an
+	// object is unsubscribed its data is flushed and it is marked
+	// written, or if the file cache set has a sync queue the flush is
+	// queued and SyncDone finishes the write.  A memory object is
+	// marked written without a flush.  The view of a compressed object
+	// is removed with its last subscription.  A streaming reader's
+	// subscription is only released, the write is left to the writer.
+	void UnSubscribe(const bool stream = false);
+
+	// Finish the write of an object whose queued flush has completed
+	void SyncDone(bool synced);
+	bool isSyncPending()
+	{
+		return m_syncPending;
+	}
 
 	// This updates the access time without needing to subscribe, it's
 	// like using touch on an existing file
@@ -100,7 +189,7 @@ public:
 
 	std::string GetFileName()
 	{
-		return m_filename;
+		return m_filename->GetString();
 	}
 
 	// This will set the expire flag and return whether the object is
@@ -121,43 +210,210 @@ public:
 		return m_dirType;
 	}
 
+	// Move the record of this written object to its own link
+	// attribute so other objects can link to its file, each keeping
+	// their own record.  Does nothing if it was moved already.
+	bool ShareFile();
+
+	// Replace the file of this written object with a hard link to
+	// target, a file with the same content, keeping this object's
+	// record on the shared file under its own attribute.  The object is
+	// marked linked, charged nothing, if this succeeds.
+	bool LinkTo(const std::string &target);
+
+	// A linked object shares its file with another object that is
+	// charged for the space
+	bool isLinked()
+	{
+		return m_linked;
+	}
+	void SetLinked(bool linked)
+	{
+		m_linked = linked;
+	}
+
+	// A compressed object's file holds its content compressed, the
+	// stored size is the size of the file while GetSize stays the size
+	// of the content
+	bool isCompressed()
+	{
+		return m_compressed;
+	}
+	cacheSize_t GetStoredSize()
+	{
+		return m_compressed ? m_storedSize : m_size;
+	}
+
+	// Mark an object restored from its record as compressed
+	void SetCompressed(cacheSize_t storedSize)
+	{
+		m_compressed = true;
+		m_storedSize = storedSize;
+	}
+
+	// Replace the file of this written object with compressedPath, its
+	// content compressed into storedSize bytes in the trash, giving the
+	// new file the object's record.  The object is marked compressed if
+	// this succeeds, otherwise compressedPath is removed.
+	bool Compress(const std::string &compressedPath, cacheSize_t storedSize);
+
+	// A memory object keeps its file in the memory directory of the
+	// file cache set, the object's path is a link to it.  The record of
+	// a memory object is only kept in the cache index.
+	bool isInMemory()
+	{
+		return m_inMemory;
+	}
+
+	// Keep the file of this object in memory, called before a new
+	// object is initialized or as one is restored from the cache index
+	void SetInMemory();
+
+	// Move this written memory object to the cache directory.
+	// copyPath is a synced copy of its content in the trash, it's given
+	// the object's record and renamed over the link.  The object is no
+	// longer in memory if this succeeds, otherwise copyPath is removed.
+	bool Demote(const std::string &copyPath);
+
+	// The view of a compressed object is made by its first subscription
+	// and removed with its last.  It is kept in the memory directory if
+	// there is one, and the owning CFileCache is charged for it while
+	// it's open.
+	bool isViewPending()
+	{
+		return m_viewPending;
+	}
+	cacheSize_t GetViewSize()
+	{
+		return m_viewOpen ? GetFilesystemFileSize(m_size) : 0;
+	}
+
+	// Called once the view being made on the I/O pool is finished, made
+	// says if it was.  Returns true if the view is open for the
+	// subscribers, one nobody is subscribed to any more is removed.
+	bool FinishView(const bool made);
+
+	// The space the owning CFileCache is charged for this object
+	cacheSize_t GetChargedSize()
+	{
+		return m_linked ? 0 : GetFilesystemFileSize(GetStoredSize());
+	}
+
 	// Validate a subscribed file that is writable.  For now, just ensure
 	// the file size is <= the specified size, otherwise log it as an
 	// error.
 	void Validate();
 
 	const std::string GetPathname(bool createDir = false);
+
+	// The path of the file of a memory object in the memory directory
+	const std::string GetMemoryPathname(bool createDir = false);
 	const std::string GetFileCacheType();
 
+	// The eviction policy of the owning CFileCache keeps the position
+	// of this object in its lists here so moving or removing it never
+	// requires a search.  A policy with more than one list records
+	// which one the object is on.  The object is on the cache list
+	// while the policy can evict it, the position is only meaningful
+	// then.
+	typedef std::list<cachedObjectId_t, CSlabAllocator<cachedObjectId_t> >
+	cacheList_t;
+	typedef cacheList_t::iterator cacheListPosition_t;
+	bool isOnCacheList()
+	{
+		return m_onCacheList;
+	}
+	void SetOnCacheList(bool onCacheList)
+	{
+		m_onCacheList = onCacheList;
+	}
+	cacheListPosition_t GetCacheListPosition()
+	{
+		return m_cacheListPos;
+	}
+	uint8_t GetCacheListId()
+	{
+		return m_cacheListId;
+	}
+	void SetCacheListPosition(cacheListPosition_t pos, uint8_t listId = 0)
+	{
+		m_cacheListPos = pos;
+		m_cacheListId = listId;
+	}
+
+	// The key this object was last entered under in the owning
+	// CFileCache cost index, used to find and remove the entry.
+	const CEvictionKey &GetEvictionKey()
+	{
+		return m_evictionKey;
+	}
+	void SetEvictionKey(const CEvictionKey &key)
+	{
+		m_evictionKey = key;
+	}
+
 private:
 
 	std::string GetDirname(const std::string &pathname);
 	CFileCacheSet *GetFileCacheSet();
 	bool CreateObject(const std::string &pathname);
-	bool SetFilenameAttribute(const std::string &pathname);
-	bool SetSizeAttribute(const std::string &pathname, const std::string &logname,
-	                      const bool replace = false);
-	bool SetCostAttribute(const std::string &pathname);
-	bool SetLifetimeAttribute(const std::string &pathname);
-	bool SetWrittenAttribute(const std::string &pathname,
-	                         const std::string &logname,
-	                         const bool replace = false);
-	bool SetDirTypeAttribute(const std::string &pathname);
+	void SetSize(cacheSize_t size);
+	bool isWriterSubscribed();
+	void NotifyStreamReaders(const StreamEvent event, const cacheSize_t size);
+	bool ReserveSpace(const std::string &pathname, const std::string &logname);
+	bool SetAttributes(const std::string &pathname, const std::string &logname,
+	                   const bool replace = false,
+	                   const char *attrName = s_objectAttrName);
+	bool SetReadOnly(const std::string &pathname, const std::string &logname);
+	bool SetWritten(const std::string &pathname, const std::string &logname);
+	std::string OpenView(const std::string &pathname);
+	std::string GetViewBasename(bool createDir = false);
+	void SetViewOpen(const bool open);
+	void RemoveView();
+	static bool MakeView(const std::string &pathname,
+	                     const std::string &viewBase, const cacheSize_t size);
+	static void RemoveViewFile(const std::string &viewPath);
+	void WriteFailed();
+	bool Remove(const std::string &logname);
+	static bool RemoveFiles(const std::string &pathname, const bool dirType,
+	                        const cachedObjectId_t id, const std::string &logname,
+	                        const bool removeDir = true);
+	static void ReapFiles(const std::string &trashPath,
+	                      const std::string &logname);
+	static void RemoveEmptyDir(const std::string &dirpath,
+	                           const std::string &logname);
+	static void LogValidation(const std::string &pathname, cacheSize_t size,
+	                          cacheSize_t expected);
 
 	const cachedObjectId_t m_id;
 
 	CFileCache *m_fileCache;
 
 	cacheSize_t m_size;
+	cacheSize_t m_storedSize;
 	paramValue_t m_cost;
 	paramValue_t m_lifetime;
 	paramValue_t m_subscriptionCount;
+	paramValue_t m_streamReaders;
 
-	std::string m_filename;
+	const CInternedName *m_filename;
 
 	bool m_written;
 	bool m_expired;
 	bool m_dirType;
+	bool m_onCacheList;
+	bool m_syncPending;
+	bool m_removed;
+	bool m_linked;
+	bool m_compressed;
+	bool m_inMemory;
+	bool m_viewOpen;
+	bool m_viewPending;
+	bool m_viewInMemory;
+	uint8_t m_cacheListId;
+
+	cacheListPosition_t m_cacheListPos;
+	CEvictionKey m_evictionKey;
 
 	time_t m_creationTime;
 	time_t m_lastAccessTime;
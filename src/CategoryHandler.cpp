@@ -27,6 +27,75 @@ namespace fs = boost::filesystem;
 
 MojLogger CategoryHandler::s_log(_T("filecache.categoryhandler"));
 
+// The methods that only read the cache, which invoke answers without
+// the write lock
+static const MojChar *const s_readMethods[] =
+{
+	_T("DescribeType"),
+	_T("GetCacheStatus"),
+	_T("GetCacheTypeStatus"),
+	_T("GetCacheObjectSize"),
+	_T("GetCacheObjectFilename"),
+	_T("GetCacheTypes"),
+	_T("GetVersion"),
+	_T("GetMetrics"),
+	NULL
+};
+
+static bool
+isReadMethod(const MojChar *method)
+{
+
+	const MojChar *const *name = s_readMethods;
+	while (*name != NULL)
+	{
+		if (strcmp(*name, method) == 0)
+		{
+			return true;
+		}
+		++name;
+	}
+
+	return false;
+}
+
+// How often, in seconds, the worker runs while it has work to do
+static const guint s_workerInterval = 15;
+
+// How often, in seconds, objects that have outlived a ttl type's
+// lifetime are expired
+static const guint s_expiryInterval = 60;
+
+// How often, in seconds, the cache space is adapted to the free space
+// and the pressure on the system when that is configured
+static const guint s_adaptInterval = 10;
+
+// Add the result of a batch item that failed to the results array
+static MojErr
+PushErrorResult(MojObject &results, FCErr errCode, const std::string &errorText)
+{
+	MojObject result;
+	MojErr err = result.putBool(_T("returnValue"), false);
+	MojErrCheck(err);
+	err = result.putInt(_T("errorCode"), (MojInt64) errCode);
+	MojErrCheck(err);
+	err = result.putString(_T("errorText"), errorText.c_str());
+	MojErrCheck(err);
+	err = results.push(result);
+	MojErrCheck(err);
+
+	return MojErrNone;
+}
+
+// The percentage of subscribes that found their object, 0 if there
+// were none
+static MojInt64
+GetHitPercent(unsigned long long hits, unsigned long long misses)
+{
+
+	return ((hits + misses) > 0) ? (MojInt64)(hits * 100 / (hits + misses)) : 0;
+}
+
 void CategoryHandler::InitCategoryDescription()
 {
 	const std::string commonProperties = R"(
@@ -54,6 +123,28 @@ void CategoryHandler::InitCategoryDescription()
 	    }
 	)";
 
+	const std::string evictionPolicyProperty = R"(
+	    "evictionPolicy": {
+	        "type": "string",
+	        "enum": ["cost", "lru", "2q", "ttl"],
+	        "description": "How the cache type picks the object to evict. cost, the default, evicts the least recently used object when the type is full and the object with the lowest cost, size and age weighted, when all types are. lru always evicts the least recently used object. 2q keeps objects read again after they were written ahead of newer ones so scans don't flush them. ttl expires objects once their lifetime has passed since they were inserted and evicts the closest to that first."
+	    }
+	)";
+
+	const std::string compressProperty = R"(
+	    "compress": {
+	        "type": "boolean",
+	        "description": "Specifies whether objects of the cache type are compressed once they are written. A compressed object is charged for its compressed size and is decompressed into a view when it is subscribed. Objects that don't compress are kept as they are."
+	    }
+	)";
+
+	const std::string memoryProperty = R"(
+	    "memory": {
+	        "type": "boolean",
+	        "description": "Specifies whether objects of the cache type are kept in memory when the memory tier configured for the service has room for them. A memory object is moved to flash when memory runs short or the type stops being kept in memory, and doesn't survive a reboot. The path returned by SubscribeCacheObject doesn't change."
+	    }
+	)";
+
 	const std::string defineTypeDescription = R"(
 	    {"call": {
 	        "type": "object",
@@ -62,6 +153,9 @@ void CategoryHandler::InitCategoryDescription()
 	        "additionalProperties": false,
 	        "properties": {
 	            )" + commonProperties + R"(,
+	            )" + evictionPolicyProperty + R"(,
+	            )" + compressProperty + R"(,
+	            )" + memoryProperty + R"(,
 	            "dirType": {
 	                "type": "boolean",
 	                "description": "Specifies whether the cache type should create directory entries. This is intended for use by the backup service."
@@ -88,6 +182,9 @@ void CategoryHandler::InitCategoryDescription()
 	        "required": ["typeName"],
 	        "properties": {
 	            )" + commonProperties + R"(,
+	            )" + evictionPolicyProperty + R"(,
+	            )" + compressProperty + R"(,
+	            )" + memoryProperty + R"(,
 	            "loWatermark": {
 	                "type": "integer",
 	                "minimum": 0,
@@ -120,7 +217,7 @@ void CategoryHandler::InitCategoryDescription()
 	const std::string copyCacheObjectDescription = R"(
 	    {"call": {
 	        "type": "object",
-	        "description": "The CopyCacheObject method enables copying of an object from the file cache to a non-cached location. On successful completion, newPathName will be returned as it may be different than expected due to filename collisions. If there is a name collision, the name will be made unique by adding a number to the file basename (i.e. foo.bar may become foo-(1).bar).",
+	        "description": "The CopyCacheObject method enables copying of an object from the file cache to a non-cached location. On successful completion, newPathName will be returned as it may be different than expected due to filename collisions. If there is a name collision, the name will be made unique by adding a number to the file basename (i.e. foo.bar may become foo-(1).bar). The reply's copyStrategy tells how the copy was made: hardlink for written objects on the same filesystem, reflink, copy_file_range, sendfile or gio. Objects stored compressed can't be copied.",
 	        "additionalProperties": false,
 	        "properties": {
 	            "pathName": {
@@ -134,6 +231,15 @@ void CategoryHandler::InitCategoryDescription()
 	            "fileName": {
 	                "type": "string",
 	                "description": "The fileName is the name for the target file. If not passed, the fileName will be the value passed when calling InsertCacheObject."
+	            },
+	            "priority": {
+	                "type": "string",
+	                "enum": ["high", "normal", "low"],
+	                "description": "Copies wait for one of the maxCopies configured copy slots, queued copies of a higher priority start first. Low priority copies also use idle disk I/O. The default is normal."
+	            },
+	            "subscribe": {
+	                "type": "boolean",
+	                "description": "Subscribe should be set to true to get progress replies with bytesCopied and totalBytes while the data is copied. Cancelling the subscription stops the copy and removes the partial file."
 	            }
 	        },
 	        "required": ["pathName"]
@@ -175,6 +281,38 @@ void CategoryHandler::InitCategoryDescription()
 	    }}
 	)";
 
+	const std::string insertCacheObjectsDescription = R"(
+	    {"call": {
+	        "type": "object",
+	        "description": "The InsertCacheObjects method defines a batch of new objects. The space for all the objects of a type is found with one cleanup pass and a single reply carries a result for each object, in order.",
+	        "additionalProperties": false,
+	        "required": ["objects"],
+	        "properties": {
+	            "objects": {
+	                "type": "array",
+	                "minItems": 1,
+	                "description": "The objects to insert, each described as for InsertCacheObject.",
+	                "items": {
+	                    "type": "object",
+	                    "additionalProperties": false,
+	                    "required": ["typeName", "fileName"],
+	                    "properties": {
+	                        )" + commonProperties + R"(,
+	                        "fileName": {
+	                            "type": "string",
+	                            "description": "The filename stored with the object, as for InsertCacheObject."
+	                        }
+	                    }
+	                }
+	            },
+	            "subscribe": {
+	                "type": "boolean",
+	                "description": "Subscribe should be set to true to hold a subscription to every inserted object until the call is cancelled."
+	            }
+	        }
+	    }}
+	)";
+
 	const std::string resizeCacheObjectDescription = R"(
 	    {"call": {
 	        "type": "object",
@@ -211,21 +349,72 @@ void CategoryHandler::InitCategoryDescription()
 	    }}
 	)";
 
+	const std::string prefetchProperty = R"(
+	    "prefetch": {
+	        "type": "boolean",
+	        "description": "Specifies whether the files of written objects are read into memory in the background once they are subscribed, so opening them doesn't wait on flash. Defaults to false."
+	    }
+	)";
+
 	const std::string subscribeCacheObjectDescription = R"(
 	    {"call": {
 	        "type": "object",
-	        "description": "The SubscribeCacheObject method enables you to subscribe an object in the cache and hold a subscription to the object for the duration of your usage. An object will not be expired from the cache while it is subscribed.",
+	        "description": "The SubscribeCacheObject method enables you to subscribe an object in the cache and hold a subscription to the object for the duration of your usage. An object will not be expired from the cache while it is subscribed. A streaming subscription to a file object that is still being written is answered with streaming set, then with a reply for each event: progress with the bytesWritten so far, written once the writer has finished, or failed if the write failed and the object was expired. A compressed object is decompressed into a view first, the reply is sent once the view is ready and carries the viewPath to read the content from.",
 	        "additionalProperties": true,
 	        "properties": {
 	            "pathName": {
 	                "type": "string",
 	                "description": "The path for the object to be subscribed."
-	            }
+	            },
+	            "stream": {
+	                "type": "boolean",
+	                "description": "Specifies whether the object can be read while it is still being written. Defaults to false, when only its writer can subscribe to it until it is written."
+	            },
+	            )" + prefetchProperty + R"(
 	        },
 	        "required": ["pathName"]
 	    }}
 	)";
 
+	const std::string subscribeCacheObjectsDescription = R"(
+	    {"call": {
+	        "type": "object",
+	        "description": "The SubscribeCacheObjects method subscribes a batch of objects in the cache. A single reply carries a result for each object, in order, and the subscriptions are held until the call is cancelled. Objects stored compressed are refused and must be subscribed with SubscribeCacheObject, which returns the path of their view.",
+	        "additionalProperties": true,
+	        "properties": {
+	            "pathNames": {
+	                "type": "array",
+	                "minItems": 1,
+	                "items": {
+	                    "type": "string"
+	                },
+	                "description": "The paths of the objects to be subscribed."
+	            },
+	            )" + prefetchProperty + R"(
+	        },
+	        "required": ["pathNames"]
+	    }}
+	)";
+
+	const std::string prefetchCacheObjectsDescription = R"(
+	    {"call": {
+	        "type": "object",
+	        "description": "The PrefetchCacheObjects method starts reading the files of a batch of written objects into memory in the background, so they don't have to be read from flash when they are opened. A single reply carries a result for each object, in order. Directory objects and objects not yet written can't be prefetched.",
+	        "additionalProperties": false,
+	        "properties": {
+	            "pathNames": {
+	                "type": "array",
+	                "minItems": 1,
+	                "items": {
+	                    "type": "string"
+	                },
+	                "description": "The paths of the objects to be prefetched."
+	            }
+	        },
+	        "required": ["pathNames"]
+	    }}
+	)";
+
 	const std::string touchCacheObjectDescription = R"(
 	    {"call": {
 	        "type": "object",
@@ -244,7 +433,7 @@ void CategoryHandler::InitCategoryDescription()
 	const std::string getCacheStatusDescription = R"(
 	    {"call": {
 	        "type": "object",
-	        "description": "The GetCacheStatus method will give you the status of the cache as a whole.",
+	        "description": "The GetCacheStatus method will give you the status of the cache as a whole. The cacheSpace is the space the cache can take now, which follows the free space of the filesystem and the memory and I/O pressure when the service is configured to adapt it.",
 	        "additionalProperties": false
 	    }}
 	)";
@@ -310,6 +499,14 @@ void CategoryHandler::InitCategoryDescription()
 	    }}
 	)";
 
+	const std::string getMetricsDescription = R"(
+	    {"call": {
+	        "type": "object",
+	        "description": "The GetMetrics method returns counters for each cache type including the space saved by compressing objects and by sharing identical objects, the objects moved out of memory, the objects prefetched, the hit percentage of each type and eviction policy, latency histograms for each method and how long the startup walk took.",
+	        "additionalProperties": false
+	    }}
+	)";
+
 
 	const std::string methodDescriptionString = std::string("{ \"methods\": {")
 	        + "  \"DefineType\":" + defineTypeDescription
@@ -318,9 +515,12 @@ void CategoryHandler::InitCategoryDescription()
 	        + ", \"CopyCacheObject\":" + copyCacheObjectDescription
 	        + ", \"DescribeType\":" + describeTypeDescription
 	        + ", \"InsertCacheObject\":" + insertCacheObjectDescription
+	        + ", \"InsertCacheObjects\":" + insertCacheObjectsDescription
 	        + ", \"ResizeCacheObject\":" + resizeCacheObjectDescription
 	        + ", \"ExpireCacheObject\":" + expireCacheObjectDescription
 	        + ", \"SubscribeCacheObject\":" + subscribeCacheObjectDescription
+	        + ", \"SubscribeCacheObjects\":" + subscribeCacheObjectsDescription
+	        + ", \"PrefetchCacheObjects\":" + prefetchCacheObjectsDescription
 	        + ", \"TouchCacheObject\":" + touchCacheObjectDescription
 	        + ", \"GetCacheStatus\":" + getCacheStatusDescription
 	        + ", \"GetCacheTypeStatus\":" + getCacheTypeStatusDescription
@@ -328,6 +528,7 @@ void CategoryHandler::InitCategoryDescription()
 	        + ", \"GetCacheObjectFilename\":" + getCacheObjectFilenameDescription
 	        + ", \"GetCacheTypes\":" + getCacheTypesDescription
 	        + ", \"GetVersion\":" + getVersionDescription
+	        + ", \"GetMetrics\":" + getMetricsDescription
 	+ "}}";
 
 	auto log_error = [](jerror *err, const char *errorSummary) {
@@ -353,27 +554,48 @@ const CategoryHandler::Method CategoryHandler::s_Methods[] =
 	Method(_T("ChangeType"), (Callback) &CategoryHandler::ChangeType, LUNA_METHOD_FLAG_VALIDATE_IN),
 	Method(_T("DeleteType"), (Callback) &CategoryHandler::DeleteType, LUNA_METHOD_FLAG_VALIDATE_IN),
 	Method(_T("CopyCacheObject"), (Callback) &CategoryHandler::CopyCacheObject, LUNA_METHOD_FLAG_VALIDATE_IN),
-	Method(_T("DescribeType"), (Callback) &CategoryHandler::DescribeType, LUNA_METHOD_FLAG_VALIDATE_IN),
+	Method(_T("DescribeType"), (Callback) &CategoryHandler::PostDescribeType, LUNA_METHOD_FLAG_VALIDATE_IN),
 	Method(_T("InsertCacheObject"), (Callback) &CategoryHandler::InsertCacheObject, LUNA_METHOD_FLAG_VALIDATE_IN),
+	Method(_T("InsertCacheObjects"), (Callback) &CategoryHandler::InsertCacheObjects, LUNA_METHOD_FLAG_VALIDATE_IN),
 	Method(_T("ResizeCacheObject"), (Callback) &CategoryHandler::ResizeCacheObject, LUNA_METHOD_FLAG_VALIDATE_IN),
 	Method(_T("ExpireCacheObject"), (Callback) &CategoryHandler::ExpireCacheObject, LUNA_METHOD_FLAG_VALIDATE_IN),
 	Method(_T("SubscribeCacheObject"), (Callback) &CategoryHandler::SubscribeCacheObject, LUNA_METHOD_FLAG_VALIDATE_IN),
+	Method(_T("SubscribeCacheObjects"), (Callback) &CategoryHandler::SubscribeCacheObjects, LUNA_METHOD_FLAG_VALIDATE_IN),
+	Method(_T("PrefetchCacheObjects"), (Callback) &CategoryHandler::PrefetchCacheObjects, LUNA_METHOD_FLAG_VALIDATE_IN),
 	Method(_T("TouchCacheObject"), (Callback) &CategoryHandler::TouchCacheObject, LUNA_METHOD_FLAG_VALIDATE_IN),
-	Method(_T("GetCacheStatus"), (Callback) &CategoryHandler::GetCacheStatus, LUNA_METHOD_FLAG_VALIDATE_IN),
-	Method(_T("GetCacheTypeStatus"), (Callback) &CategoryHandler::GetCacheTypeStatus, LUNA_METHOD_FLAG_VALIDATE_IN),
-	Method(_T("GetCacheObjectSize"), (Callback) &CategoryHandler::GetCacheObjectSize, LUNA_METHOD_FLAG_VALIDATE_IN),
-	Method(_T("GetCacheObjectFilename"), (Callback) &CategoryHandler::GetCacheObjectFilename, LUNA_METHOD_FLAG_VALIDATE_IN),
-	Method(_T("GetCacheTypes"), (Callback) &CategoryHandler::GetCacheTypes, LUNA_METHOD_FLAG_VALIDATE_IN),
+	Method(_T("GetCacheStatus"), (Callback) &CategoryHandler::PostGetCacheStatus, LUNA_METHOD_FLAG_VALIDATE_IN),
+	Method(_T("GetCacheTypeStatus"), (Callback) &CategoryHandler::PostGetCacheTypeStatus, LUNA_METHOD_FLAG_VALIDATE_IN),
+	Method(_T("GetCacheObjectSize"), (Callback) &CategoryHandler::PostGetCacheObjectSize, LUNA_METHOD_FLAG_VALIDATE_IN),
+	Method(_T("GetCacheObjectFilename"), (Callback) &CategoryHandler::PostGetCacheObjectFilename, LUNA_METHOD_FLAG_VALIDATE_IN),
+	Method(_T("GetCacheTypes"), (Callback) &CategoryHandler::PostGetCacheTypes, LUNA_METHOD_FLAG_VALIDATE_IN),
 	Method(_T("GetVersion"), (Callback) &CategoryHandler::GetVersion, LUNA_METHOD_FLAG_VALIDATE_IN),
+	Method(_T("GetMetrics"), (Callback) &CategoryHandler::PostGetMetrics, LUNA_METHOD_FLAG_VALIDATE_IN),
 	Method(NULL, NULL, 0)
 };
 
 CategoryHandler::CategoryHandler(CFileCacheSet *cacheSet)
 	: m_fileCacheSet(cacheSet)
+	, m_copyScheduler((size_t) cacheSet->GetMaxCopies())
+	, m_workerTimer(0)
+	, m_requestLatency(NULL)
+	, m_requestStart(0)
 	, categoryDescription(nullptr)
 {
 	MojLogTrace(s_log);
 
+	const Method *method = s_Methods;
+	while (method->m_name != NULL)
+	{
+		(void) m_latencies[method->m_name];
+		++method;
+	}
+
+	if (!cacheSet->GetTraceFile().empty())
+	{
+		(void) m_trace.Open(cacheSet->GetTraceFile(),
+		                    cacheSet->TotalCacheSpace());
+	}
+
 	InitCategoryDescription();
 
 	SetupWorkerTimer();
@@ -383,6 +605,13 @@ CategoryHandler::~CategoryHandler()
 {
 	MojLogTrace(s_log);
 
+	m_fileCacheSet->SetOrphanCallback(std::function<void ()>());
+	m_fileCacheSet->SetStreamCallback(streamCallback_t());
+	m_fileCacheSet->SetViewCallback(viewCallback_t());
+	if (m_workerTimer != 0)
+	{
+		g_source_remove(m_workerTimer);
+	}
 	j_release(&categoryDescription);
 }
 
@@ -404,6 +633,39 @@ CategoryHandler::RegisterMethods()
 	return MojErrNone;
 }
 
+// Time each request into the latency histogram of its method.  A
+// request answered on the reader pool is timed once its reply has been
+// sent.  Requests which can change the cache hold the write lock, so
+// the readers only wait while a change is in progress.
+MojErr
+CategoryHandler::invoke(const MojChar *method, MojServiceMessage *msg,
+                        MojObject &payload)
+{
+
+	std::map<std::string, CLatencyHistogram>::iterator iter =
+	    m_latencies.find(method);
+	m_requestLatency = (iter != m_latencies.end()) ? &(*iter).second : NULL;
+	m_requestStart = GetMonotonicMicros();
+
+	const bool writer = !isReadMethod(method);
+	if (writer)
+	{
+		m_fileCacheSet->LockForWrite();
+	}
+	MojErr err = MojService::CategoryHandler::invoke(method, msg, payload);
+	if (writer)
+	{
+		m_fileCacheSet->UnlockForWrite();
+	}
+	if (m_requestLatency != NULL)
+	{
+		m_requestLatency->Record(GetMonotonicMicros() - m_requestStart);
+		m_requestLatency = NULL;
+	}
+
+	return err;
+}
+
 MojErr
 CategoryHandler::DefineType(MojServiceMessage *msg, MojObject &payload)
 {
@@ -415,6 +677,9 @@ CategoryHandler::DefineType(MojServiceMessage *msg, MojObject &payload)
 	MojInt64 size = 0;
 	MojInt64 cost = 0;
 	MojInt64 lifetime = 0;
+	MojString evictionPolicy;
+	bool compress = false;
+	bool memory = false;
 	bool dirType = false;
 
 	payload.getRequired(_T("typeName"), typeName);
@@ -423,6 +688,9 @@ CategoryHandler::DefineType(MojServiceMessage *msg, MojObject &payload)
 	payload.get(_T("size"), size);
 	payload.get(_T("cost"), cost);
 	payload.get(_T("lifetime"), lifetime);
+	payload.get(_T("evictionPolicy"), evictionPolicy);
+	payload.get(_T("compress"), compress);
+	payload.get(_T("memory"), memory);
 	payload.get(_T("dirType"), dirType);
 
 	MojLogDebug(s_log, _T("DefineType: new type '%s' to be defined."), typeName.data());
@@ -452,6 +720,10 @@ CategoryHandler::DefineType(MojServiceMessage *msg, MojObject &payload)
 	                         (cacheSize_t) hiWatermark,
 	                         (cacheSize_t) size, (paramValue_t) cost,
 	                         (paramValue_t) lifetime);
+	params.SetPolicy(evictionPolicy.empty() ? s_defaultPolicy :
+	                 std::string(evictionPolicy.data()));
+	params.SetCompress(compress ? 1 : 0);
+	params.SetMemory(memory ? 1 : 0);
 
 	if (m_fileCacheSet->TypeExists(std::string(typeName.data())))
 	{
@@ -495,6 +767,7 @@ CategoryHandler::DefineType(MojServiceMessage *msg, MojObject &payload)
 	}
 	else
 	{
+		m_trace.DefineType(typeName.data(), params, dirType);
 		if (m_fileCacheSet->DefineType(msgText, std::string(typeName.data()),
 		                               &params, dirType))
 		{
@@ -523,6 +796,9 @@ CategoryHandler::ChangeType(MojServiceMessage *msg, MojObject &payload)
 	MojInt64 size = 0;
 	MojInt64 cost = 0;
 	MojInt64 lifetime = 0;
+	MojString evictionPolicy;
+	bool compress = false;
+	bool memory = false;
 	MojErr err = MojErrNone;
 
 	payload.getRequired(_T("typeName"), typeName);
@@ -531,6 +807,9 @@ CategoryHandler::ChangeType(MojServiceMessage *msg, MojObject &payload)
 	payload.get(_T("size"), size);
 	payload.get(_T("cost"), cost);
 	payload.get(_T("lifetime"), lifetime);
+	payload.get(_T("evictionPolicy"), evictionPolicy);
+	const bool hasCompress = payload.get(_T("compress"), compress);
+	const bool hasMemory = payload.get(_T("memory"), memory);
 
 	MojLogDebug(s_log, _T("ChangeType: existing type '%s' to be changed."), typeName.data());
 
@@ -559,7 +838,17 @@ CategoryHandler::ChangeType(MojServiceMessage *msg, MojObject &payload)
 	                         (cacheSize_t) hiWatermark,
 	                         (cacheSize_t) size, (paramValue_t) cost,
 	                         (paramValue_t) lifetime);
+	params.SetPolicy(evictionPolicy.data());
+	if (hasCompress)
+	{
+		params.SetCompress(compress ? 1 : 0);
+	}
+	if (hasMemory)
+	{
+		params.SetMemory(memory ? 1 : 0);
+	}
 
+	m_trace.ChangeType(typeName.data(), params);
 	if (m_fileCacheSet->ChangeType(msgText, std::string(typeName.data()),
 	                               &params))
 	{
@@ -589,6 +878,7 @@ CategoryHandler::DeleteType(MojServiceMessage *msg, MojObject &payload)
 	MojLogDebug(s_log, _T("DeleteType: existing type '%s' to be deleted."), typeName.data());
 
 	std::string msgText;
+	m_trace.DeleteType(typeName.data());
 	freedSpace = m_fileCacheSet->DeleteType(msgText, std::string(typeName.data()));
 
 	if (freedSpace >= 0)
@@ -610,8 +900,8 @@ CategoryHandler::DeleteType(MojServiceMessage *msg, MojObject &payload)
 }
 
 MojErr
-CategoryHandler::DescribeType(MojServiceMessage *msg,
-                              MojObject &payload)
+CategoryHandler::DescribeType(MojObject &payload,
+                              ReadReply &readReply)
 {
 
 	MojLogTrace(s_log);
@@ -629,10 +919,10 @@ CategoryHandler::DescribeType(MojServiceMessage *msg,
 		    m_fileCacheSet->DescribeType(std::string(typeName.data()));
 
 		MojLogDebug(s_log,
-		            _T("DescribeType: params: loWatermark = '%d', hiWatermark = '%d',"),
+		            _T("DescribeType: params: loWatermark = '%lld', hiWatermark = '%lld',"),
 		            params.GetLoWatermark(), params.GetHiWatermark());
 		MojLogDebug(s_log,
-		            _T("DescribeType: params: size = '%d', cost = '%d', lifetime = '%d'."),
+		            _T("DescribeType: params: size = '%lld', cost = '%d', lifetime = '%d'."),
 		            params.GetSize(), params.GetCost(), params.GetLifetime());
 
 		MojObject reply;
@@ -646,14 +936,20 @@ CategoryHandler::DescribeType(MojServiceMessage *msg,
 		MojErrCheck(err);
 		err = reply.putInt(_T("lifetime"), (MojInt64) params.GetLifetime());
 		MojErrCheck(err);
-		err = msg->replySuccess(reply);
+		err = reply.putString(_T("evictionPolicy"), params.GetPolicy().c_str());
+		MojErrCheck(err);
+		err = reply.putBool(_T("compress"), params.GetCompress() > 0);
+		MojErrCheck(err);
+		err = reply.putBool(_T("memory"), params.GetMemory() > 0);
+		MojErrCheck(err);
+		err = readReply.Success(reply);
 	}
 	else
 	{
 		std::string msgText("DescribeType: Type '");
 		msgText += typeName.data();
 		msgText += "' does not exists.";
-		err = msg->replyError((MojErr) FCExistsError, msgText.c_str());
+		err = readReply.Error((MojErr) FCExistsError, msgText);
 	}
 
 	MojErrCheck(err);
@@ -727,12 +1023,15 @@ CategoryHandler::InsertCacheObject(MojServiceMessage *msg,
 	                                      (paramValue_t) lifetime);
 
 	MojLogDebug(s_log, _T("InsertCacheObject: new object id = %llu."), objId);
+	m_trace.Insert(typeName.data(), (cacheSize_t) size, (paramValue_t) cost,
+	               (paramValue_t) lifetime, objId);
 	if (objId > 0)
 	{
 		MojString pathName;
 		MojObject reply;
 		if (subscribed)
 		{
+			m_trace.Subscribe(objId);
 			const std::string fpath(m_fileCacheSet->SubscribeCacheObject(msgText, objId));
 			if (!fpath.empty())
 			{
@@ -777,6 +1076,156 @@ CategoryHandler::InsertCacheObject(MojServiceMessage *msg,
 	return MojErrNone;
 }
 
+MojErr
+CategoryHandler::InsertCacheObjects(MojServiceMessage *msg,
+                                    MojObject &payload)
+{
+	MojLogTrace(s_log);
+
+	MojObject objects;
+	bool subscribed = false;
+	MojErr err = MojErrNone;
+
+	payload.getRequired(_T("objects"), objects);
+	payload.get(_T("subscribe"), subscribed);
+
+	// Objects with invalid params are left out of the batch, their
+	// errors are kept in place so the results stay in order.
+	insertRequests_t requests;
+	std::vector<std::string> paramErrors;
+	MojObject::ConstArrayIterator iter = objects.arrayBegin();
+	while (iter != objects.arrayEnd())
+	{
+		MojString typeName, fileName;
+		MojInt64 size = 0;
+		MojInt64 cost = 0;
+		MojInt64 lifetime = 0;
+		(*iter).getRequired(_T("typeName"), typeName);
+		(*iter).getRequired(_T("fileName"), fileName);
+
+		std::string msgText;
+		if (!m_fileCacheSet->TypeExists(std::string(typeName.data())))
+		{
+			msgText = "InsertCacheObjects: No type '" + std::string(typeName.data()) + "' defined.";
+		}
+
+		CCacheParamValues params =
+			m_fileCacheSet->DescribeType(std::string(typeName.data()));
+
+		if (!(*iter).get(_T("size"), size))
+			size = params.GetSize();
+
+		if (!(*iter).get(_T("cost"), cost))
+			cost = params.GetCost();
+
+		if (!(*iter).get(_T("lifetime"), lifetime))
+			lifetime = params.GetLifetime();
+
+		if ((size <= GetFilesystemFileSize(1)) &&
+				 m_fileCacheSet->isTypeDirType(typeName.data()))
+		{
+			msgText = "InsertCacheObjects: Invalid params: size must be greater than 1 block when dirType = true.";
+		}
+
+		if (!msgText.empty())
+		{
+			MojLogError(s_log, _T("%s"), msgText.c_str());
+		}
+		else
+		{
+			CInsertRequest request;
+			request.m_typeName = typeName.data();
+			request.m_filename = fileName.data();
+			request.m_size = (cacheSize_t) size;
+			request.m_cost = (paramValue_t) cost;
+			request.m_lifetime = (paramValue_t) lifetime;
+			requests.push_back(request);
+		}
+		paramErrors.push_back(msgText);
+		++iter;
+	}
+
+	MojLogDebug(s_log, _T("InsertCacheObjects: inserting '%zd' of '%zd' objects."),
+	            requests.size(), paramErrors.size());
+
+	m_fileCacheSet->InsertCacheObjects(requests);
+
+	MojObject results(MojObject::TypeArray);
+	bool anySubscribed = false;
+	insertRequests_t::iterator reqIter = requests.begin();
+	for (size_t i = 0; i < paramErrors.size(); i++)
+	{
+		if (!paramErrors[i].empty())
+		{
+			err = PushErrorResult(results, FCInvalidParams, paramErrors[i]);
+			MojErrCheck(err);
+			continue;
+		}
+
+		CInsertRequest &request = *reqIter++;
+		m_trace.Insert(request.m_typeName, request.m_size, request.m_cost,
+		               request.m_lifetime, request.m_objId);
+		if (request.m_objId == 0)
+		{
+			err = PushErrorResult(results, FCExistsError, request.m_msgText);
+			MojErrCheck(err);
+			continue;
+		}
+
+		MojString pathName;
+		MojObject result;
+		err = result.putBool(_T("returnValue"), true);
+		MojErrCheck(err);
+		const std::string dirBase(m_fileCacheSet->GetBaseDirName());
+		err = pathName.assign(BuildPathname(request.m_objId, dirBase,
+		                                    request.m_typeName,
+		                                    request.m_filename).c_str());
+		MojErrCheck(err);
+		if (subscribed)
+		{
+			std::string msgText;
+			m_trace.Subscribe(request.m_objId);
+			const std::string fpath(m_fileCacheSet->SubscribeCacheObject(msgText,
+			                        request.m_objId));
+			if (!fpath.empty())
+			{
+				MojRefCountedPtr<Subscription> cancelHandler(new Subscription(*this,
+						msg,
+						pathName));
+				MojAllocCheck(cancelHandler.get());
+				m_subscribers.push_back(cancelHandler.get());
+				MojLogDebug(s_log, _T("InsertCacheObjects: subscribed new object '%s'."),
+				            fpath.c_str());
+				err = result.putBool(_T("subscribed"), true);
+				MojErrCheck(err);
+				anySubscribed = true;
+			}
+			else if (!msgText.empty())
+			{
+				msgText = "SubscribeCacheObject: " + msgText;
+				MojLogError(s_log, _T("%s"), msgText.c_str());
+			}
+		}
+		err = result.putString(_T("pathName"), pathName);
+		MojErrCheck(err);
+		err = results.push(result);
+		MojErrCheck(err);
+	}
+
+	MojObject reply;
+	err = reply.put(_T("results"), results);
+	MojErrCheck(err);
+	if (anySubscribed)
+	{
+		err = reply.putBool(_T("subscribed"), true);
+		MojErrCheck(err);
+	}
+	err = msg->replySuccess(reply);
+	MojErrCheck(err);
+
+	return MojErrNone;
+}
+
 MojErr
 CategoryHandler::ResizeCacheObject(MojServiceMessage *msg,
                                    MojObject &payload)
@@ -802,12 +1251,12 @@ CategoryHandler::ResizeCacheObject(MojServiceMessage *msg,
 	FCErr errCode = FCErrorNone;
 	if (objId > 0)
 	{
-		if (GetTypeNameFromPath(m_fileCacheSet->GetBaseDirName(),
-		                        pathName.data()) ==
-		    m_fileCacheSet->GetTypeForObjectId(objId))
+		if (PathHasTypeName(m_fileCacheSet->GetBaseDirName(), pathName.data(),
+		                    m_fileCacheSet->GetTypeForObjectId(objId)))
 		{
+			m_trace.Resize(objId, (cacheSize_t) newSize);
 			size = m_fileCacheSet->Resize(objId, (cacheSize_t) newSize);
-			MojLogDebug(s_log, _T("ResizeCacheObject: final size is '%d'."), size);
+			MojLogDebug(s_log, _T("ResizeCacheObject: final size is '%lld'."), size);
 
 			if (size == (cacheSize_t) newSize)
 			{
@@ -866,10 +1315,10 @@ CategoryHandler::ExpireCacheObject(MojServiceMessage *msg,
 	const cachedObjectId_t objId = GetObjectIdFromPath(pathName.data());
 	if (objId > 0)
 	{
-		if (GetTypeNameFromPath(m_fileCacheSet->GetBaseDirName(),
-		                        pathName.data()) ==
-		        m_fileCacheSet->GetTypeForObjectId(objId))
+		if (PathHasTypeName(m_fileCacheSet->GetBaseDirName(), pathName.data(),
+		                    m_fileCacheSet->GetTypeForObjectId(objId)))
 		{
+			m_trace.Expire(objId);
 			if (m_fileCacheSet->ExpireCacheObject(objId))
 			{
 				MojLogWarning(s_log,
@@ -936,7 +1385,11 @@ CategoryHandler::SubscribeCacheObject(MojServiceMessage *msg,
 	do
 	{
 		MojString pathName;
+		bool stream = false;
+		bool prefetch = false;
 		payload.getRequired(_T("pathName"), pathName);
+		payload.get(_T("stream"), stream);
+		payload.get(_T("prefetch"), prefetch);
 
 		MojLogDebug(s_log, _T("SubscribeCacheObject: subscribing to file '%s'."),
 		            pathName.data());
@@ -948,11 +1401,12 @@ CategoryHandler::SubscribeCacheObject(MojServiceMessage *msg,
 			errorText = "Invalid object id derived from pathname.";
 			break;
 		}
+		m_trace.Subscribe(objId);
 
-		const std::string type = GetTypeNameFromPath(m_fileCacheSet->GetBaseDirName(),
-		                         pathName.data());
-		if (type != m_fileCacheSet->GetTypeForObjectId(objId))
+		if (!PathHasTypeName(m_fileCacheSet->GetBaseDirName(), pathName.data(),
+		                     m_fileCacheSet->GetTypeForObjectId(objId)))
 		{
+			m_fileCacheSet->CountSubscribeMiss(pathName.data());
 			err = (MojErr)FCExistsError;
 			errorText = std::string("'pathName': ") + pathName.data() +
 			            " no longer found in cache.";
@@ -960,7 +1414,8 @@ CategoryHandler::SubscribeCacheObject(MojServiceMessage *msg,
 		}
 
 		MojObject reply;
-		const std::string fpath(m_fileCacheSet->SubscribeCacheObject(errorText, objId));
+		const std::string fpath(m_fileCacheSet->SubscribeCacheObject(errorText, objId,
+		                        &stream));
 		if (fpath.empty() || !errorText.empty())
 		{
 			err = (MojErr)FCExistsError;
@@ -970,15 +1425,42 @@ CategoryHandler::SubscribeCacheObject(MojServiceMessage *msg,
 		}
 
 		MojRefCountedPtr<Subscription> cancelHandler(new Subscription(*this, msg,
-		        pathName));
+		        pathName, stream));
 		MojAllocCheck(cancelHandler.get());
 		m_subscribers.push_back(cancelHandler.get());
 		MojLogDebug(s_log, _T("SubscribeCacheObject: subscribed object '%s'."),
 		            fpath.c_str());
 
+		// The view of a compressed object is made on the I/O pool, the
+		// reply waits for it
+		if (m_fileCacheSet->isViewPending(objId))
+		{
+			cancelHandler->WaitForView();
+			break;
+		}
+
 		reply.putBool(_T("subscribed"), true);
+		if (stream)
+		{
+			reply.putBool(_T("streaming"), true);
+		}
+		else if (fpath.compare(pathName.data()) != 0)
+		{
+			reply.putString(_T("viewPath"), fpath.c_str());
+		}
 		err = msg->replySuccess(reply);
 
+		// A streaming reader is told straight away how much it can read
+		if (stream)
+		{
+			m_fileCacheSet->CheckSubscribedObject(
+			    m_fileCacheSet->GetTypeForObjectId(objId), objId);
+		}
+		else if (prefetch)
+		{
+			PrefetchSubscribedObject(objId);
+		}
+
 	}
 	while (false);
 
@@ -993,43 +1475,305 @@ CategoryHandler::SubscribeCacheObject(MojServiceMessage *msg,
 }
 
 MojErr
-CategoryHandler::CancelSubscription(Subscription *sub,
-                                    MojServiceMessage *msg,
-                                    MojString &pathName)
+CategoryHandler::SubscribeCacheObjects(MojServiceMessage *msg,
+                                       MojObject &payload)
 {
 
 	MojLogTrace(s_log);
 
-	const cachedObjectId_t objId = GetObjectIdFromPath(pathName.data());
-	if (objId > 0)
+	MojObject pathNames;
+	MojErr err = MojErrNone;
+	bool prefetch = false;
+
+	payload.getRequired(_T("pathNames"), pathNames);
+	payload.get(_T("prefetch"), prefetch);
+
+	MojObject results(MojObject::TypeArray);
+	bool anySubscribed = false;
+	MojObject::ConstArrayIterator iter = pathNames.arrayBegin();
+	while (iter != pathNames.arrayEnd())
 	{
-		const std::string typeName(GetTypeNameFromPath(m_fileCacheSet->GetBaseDirName(),
-		                           pathName.data()));
-		if (!typeName.empty())
+		MojString pathName;
+		err = (*iter).stringValue(pathName);
+		MojErrCheck(err);
+		++iter;
+
+		MojLogDebug(s_log, _T("SubscribeCacheObjects: subscribing to file '%s'."),
+		            pathName.data());
+
+		std::string errorText;
+		const cachedObjectId_t objId = GetObjectIdFromPath(pathName.data());
+		if (objId > 0)
+		{
+			m_trace.Subscribe(objId);
+		}
+		if (objId == 0)
+		{
+			errorText = "Invalid object id derived from pathname.";
+		}
+		else if (!PathHasTypeName(m_fileCacheSet->GetBaseDirName(),
+		                          pathName.data(),
+		                          m_fileCacheSet->GetTypeForObjectId(objId)))
+		{
+			m_fileCacheSet->CountSubscribeMiss(pathName.data());
+			errorText = std::string("'pathName': ") + pathName.data() +
+			            " no longer found in cache.";
+		}
+		else if (m_fileCacheSet->isCompressedObject(objId))
 		{
-			m_fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+			// A compressed object is read through a view made on the
+			// I/O pool, which only SubscribeCacheObject waits for
+			errorText = "Compressed objects must be subscribed with SubscribeCacheObject.";
 		}
 		else
 		{
-			MojLogError(s_log,
-			            _T("CancelSubscription: pathName no longer found in cache."));
+			const std::string fpath(m_fileCacheSet->SubscribeCacheObject(errorText,
+			                        objId));
+			if (fpath.empty() && errorText.empty())
+			{
+				errorText = "Could not find object to match derived id.";
+			}
 		}
-	}
-	for (SubscriptionVec::iterator it = m_subscribers.begin();
-	        it != m_subscribers.end(); ++it)
-	{
-		if (it->get() == sub)
+
+		if (!errorText.empty())
 		{
-			m_subscribers.erase(it);
-			MojLogInfo(s_log,
-			           _T("CancelSubscription: Removed subscription on pathName '%s'."),
-			           pathName.data());
-			break;
+			MojLogError(s_log, _T("%s"), errorText.c_str());
+			err = PushErrorResult(results, FCExistsError, errorText);
+			MojErrCheck(err);
+			continue;
 		}
-	}
 
-	return MojErrNone;
-}
+		MojRefCountedPtr<Subscription> cancelHandler(new Subscription(*this, msg,
+		        pathName));
+		MojAllocCheck(cancelHandler.get());
+		m_subscribers.push_back(cancelHandler.get());
+		MojLogDebug(s_log, _T("SubscribeCacheObjects: subscribed object '%s'."),
+		            pathName.data());
+		anySubscribed = true;
+		if (prefetch)
+		{
+			PrefetchSubscribedObject(objId);
+		}
+
+		MojObject result;
+		err = result.putBool(_T("returnValue"), true);
+		MojErrCheck(err);
+		err = result.putString(_T("pathName"), pathName);
+		MojErrCheck(err);
+		err = result.putBool(_T("subscribed"), true);
+		MojErrCheck(err);
+		err = results.push(result);
+		MojErrCheck(err);
+	}
+
+	MojObject reply;
+	err = reply.put(_T("results"), results);
+	MojErrCheck(err);
+	if (anySubscribed)
+	{
+		err = reply.putBool(_T("subscribed"), true);
+		MojErrCheck(err);
+	}
+	err = msg->replySuccess(reply);
+	MojErrCheck(err);
+
+	return MojErrNone;
+}
+
+MojErr
+CategoryHandler::PrefetchCacheObjects(MojServiceMessage *msg,
+                                      MojObject &payload)
+{
+
+	MojLogTrace(s_log);
+
+	MojObject pathNames;
+	MojErr err = MojErrNone;
+
+	payload.getRequired(_T("pathNames"), pathNames);
+
+	MojObject results(MojObject::TypeArray);
+	MojObject::ConstArrayIterator iter = pathNames.arrayBegin();
+	while (iter != pathNames.arrayEnd())
+	{
+		MojString pathName;
+		err = (*iter).stringValue(pathName);
+		MojErrCheck(err);
+		++iter;
+
+		MojLogDebug(s_log, _T("PrefetchCacheObjects: prefetching file '%s'."),
+		            pathName.data());
+
+		std::string errorText;
+		const cachedObjectId_t objId = GetObjectIdFromPath(pathName.data());
+		if (objId == 0)
+		{
+			errorText = "Invalid object id derived from pathname.";
+		}
+		else if (!PathHasTypeName(m_fileCacheSet->GetBaseDirName(),
+		                          pathName.data(),
+		                          m_fileCacheSet->GetTypeForObjectId(objId)))
+		{
+			errorText = std::string("'pathName': ") + pathName.data() +
+			            " no longer found in cache.";
+		}
+		else
+		{
+			(void) m_fileCacheSet->PrefetchCacheObject(errorText, objId);
+		}
+
+		if (!errorText.empty())
+		{
+			MojLogError(s_log, _T("%s"), errorText.c_str());
+			err = PushErrorResult(results, FCExistsError, errorText);
+			MojErrCheck(err);
+			continue;
+		}
+
+		MojObject result;
+		err = result.putBool(_T("returnValue"), true);
+		MojErrCheck(err);
+		err = result.putString(_T("pathName"), pathName);
+		MojErrCheck(err);
+		err = results.push(result);
+		MojErrCheck(err);
+	}
+
+	MojObject reply;
+	err = reply.put(_T("results"), results);
+	MojErrCheck(err);
+	err = msg->replySuccess(reply);
+	MojErrCheck(err);
+
+	return MojErrNone;
+}
+
+// Read the file of a subscribed object ahead of the client opening it.
+// An object that can't be prefetched, such as one still being written,
+// is only read when it is opened.
+void
+CategoryHandler::PrefetchSubscribedObject(const cachedObjectId_t objId)
+{
+
+	MojLogTrace(s_log);
+
+	std::string msgText;
+	if (!m_fileCacheSet->PrefetchCacheObject(msgText, objId))
+	{
+		MojLogDebug(s_log,
+		            _T("PrefetchSubscribedObject: Object '%llu' not prefetched (%s)."),
+		            objId, msgText.c_str());
+	}
+}
+
+MojErr
+CategoryHandler::CancelSubscription(Subscription *sub,
+                                    MojServiceMessage *msg,
+                                    MojString &pathName)
+{
+
+	MojLogTrace(s_log);
+
+	CWriteLockGuard guard(m_fileCacheSet);
+	const cachedObjectId_t objId = GetObjectIdFromPath(pathName.data());
+	if (objId > 0)
+	{
+		const std::string typeName(GetTypeNameFromPath(m_fileCacheSet->GetBaseDirName(),
+		                           pathName.data()));
+		if (!typeName.empty())
+		{
+			m_trace.UnSubscribe(typeName, objId);
+			m_fileCacheSet->UnSubscribeCacheObject(typeName, objId,
+			                                       sub->isStreaming());
+		}
+		else
+		{
+			MojLogError(s_log,
+			            _T("CancelSubscription: pathName no longer found in cache."));
+		}
+	}
+	for (SubscriptionVec::iterator it = m_subscribers.begin();
+	        it != m_subscribers.end(); ++it)
+	{
+		if (it->get() == sub)
+		{
+			m_subscribers.erase(it);
+			MojLogInfo(s_log,
+			           _T("CancelSubscription: Removed subscription on pathName '%s'."),
+			           pathName.data());
+			break;
+		}
+	}
+
+	return MojErrNone;
+}
+
+// Answer the subscribers waiting for the view of an object.  If it
+// couldn't be made they are told so and their subscriptions dropped.
+void
+CategoryHandler::FinishView(const cachedObjectId_t objId,
+                            const std::string &viewPath)
+{
+
+	MojLogTrace(s_log);
+
+	SubscriptionVec failed;
+	for (SubscriptionVec::const_iterator it = m_subscribers.begin();
+	        it != m_subscribers.end(); ++it)
+	{
+		if (!(*it)->isWaitingForView() ||
+		        (GetObjectIdFromPath((*it)->GetPathName().data()) != objId))
+		{
+			continue;
+		}
+		if (viewPath.empty())
+		{
+			failed.push_back(*it);
+		}
+		else if ((*it)->ReplyView(viewPath) != MojErrNone)
+		{
+			MojLogWarning(s_log,
+			              _T("FinishView: Failed to answer a subscriber of object '%llu'."),
+			              objId);
+		}
+	}
+
+	for (SubscriptionVec::iterator it = failed.begin(); it != failed.end(); ++it)
+	{
+		MojString pathName((*it)->GetPathName());
+		MojLogError(s_log, _T("FinishView: No view of '%s' for its subscriber."),
+		            pathName.data());
+		(void) (*it)->ReplyView(std::string());
+		(void) CancelSubscription(it->get(), NULL, pathName);
+	}
+}
+
+// Pass an event for the streaming readers of an object on to their
+// subscriptions
+void
+CategoryHandler::NotifyStreamReaders(const cachedObjectId_t objId,
+                                     const StreamEvent event,
+                                     const cacheSize_t size)
+{
+
+	MojLogTrace(s_log);
+
+	for (SubscriptionVec::const_iterator it = m_subscribers.begin();
+	        it != m_subscribers.end(); ++it)
+	{
+		if ((*it)->isStreaming() &&
+		        (GetObjectIdFromPath((*it)->GetPathName().data()) == objId))
+		{
+			MojErr err = (*it)->Notify(event, size);
+			if (err != MojErrNone)
+			{
+				MojLogWarning(s_log,
+				              _T("NotifyStreamReaders: Failed to notify reader of object '%llu'."),
+				              objId);
+			}
+		}
+	}
+}
 
 MojErr
 CategoryHandler::TouchCacheObject(MojServiceMessage *msg,
@@ -1050,10 +1794,10 @@ CategoryHandler::TouchCacheObject(MojServiceMessage *msg,
 	const cachedObjectId_t objId = GetObjectIdFromPath(pathName.data());
 	if (objId > 0)
 	{
-		if (GetTypeNameFromPath(m_fileCacheSet->GetBaseDirName(),
-		                        pathName.data()) ==
-		        m_fileCacheSet->GetTypeForObjectId(objId))
+		if (PathHasTypeName(m_fileCacheSet->GetBaseDirName(), pathName.data(),
+		                    m_fileCacheSet->GetTypeForObjectId(objId)))
 		{
+			m_trace.Touch(objId);
 			if (m_fileCacheSet->Touch(objId))
 			{
 				err = msg->replySuccess();
@@ -1107,6 +1851,15 @@ CategoryHandler::CopyCacheObject(MojServiceMessage *msg,
 		destination = s_defaultDownloadDir;
 	}
 
+	bool subscribed = false;
+	payload.get(_T("subscribe"), subscribed);
+	CopyPriority priority = CopyPriorityNormal;
+	payload.get(_T("priority"), param, found);
+	if (found)
+	{
+		priority = GetCopyPriority(param.data());
+	}
+
 	payload.get(_T("fileName"), param, found);
 
 	MojLogDebug(s_log, _T("CopyCacheObject: attempting to copy file '%s'."),
@@ -1117,9 +1870,8 @@ CategoryHandler::CopyCacheObject(MojServiceMessage *msg,
 	const cachedObjectId_t objId = GetObjectIdFromPath(pathName.data());
 	if (objId > 0)
 	{
-		if (GetTypeNameFromPath(m_fileCacheSet->GetBaseDirName(),
-		                        pathName.data()) ==
-		        m_fileCacheSet->GetTypeForObjectId(objId))
+		if (PathHasTypeName(m_fileCacheSet->GetBaseDirName(), pathName.data(),
+		                    m_fileCacheSet->GetTypeForObjectId(objId)))
 		{
 			if (m_fileCacheSet->CachedObjectSize(objId) < 0)
 			{
@@ -1127,6 +1879,13 @@ CategoryHandler::CopyCacheObject(MojServiceMessage *msg,
 				errCode = (MojErr) FCExistsError;
 				MojLogError(s_log, _T("%s"), msgText.c_str());
 			}
+			else if (m_fileCacheSet->isCompressedObject(objId))
+			{
+				// The file holds the deflated data, not the content
+				msgText = "CopyCacheObject: Compressed objects can't be copied.";
+				errCode = (MojErr) FCArgumentError;
+				MojLogError(s_log, _T("%s"), msgText.c_str());
+			}
 			else
 			{
 				if (found && !param.empty())
@@ -1225,7 +1984,7 @@ CategoryHandler::CopyCacheObject(MojServiceMessage *msg,
 	}
 	else
 	{
-		err = CopyFile(msg, pathName.data(), destFileName);
+		err = CopyFile(msg, pathName.data(), destFileName, priority, subscribed);
 	}
 	MojErrCheck(err);
 
@@ -1233,8 +1992,8 @@ CategoryHandler::CopyCacheObject(MojServiceMessage *msg,
 }
 
 MojErr
-CategoryHandler::GetCacheStatus(MojServiceMessage *msg,
-                                MojObject &payload)
+CategoryHandler::GetCacheStatus(MojObject &payload,
+                                ReadReply &readReply)
 {
 
 	MojLogTrace(s_log);
@@ -1255,19 +2014,22 @@ CategoryHandler::GetCacheStatus(MojServiceMessage *msg,
 	MojErrCheck(err);
 	err = reply.putInt(_T("availSpace"), (MojInt64) space);
 	MojErrCheck(err);
+	err = reply.putInt(_T("cacheSpace"),
+	                   (MojInt64) m_fileCacheSet->EffectiveCacheSpace());
+	MojErrCheck(err);
 	MojLogDebug(s_log,
-	            _T("GetCacheStatus: numTypes = '%d', size = '%d', numObjs = '%d', availSpace = '%d'."),
+	            _T("GetCacheStatus: numTypes = '%lld', size = '%lld', numObjs = '%d', availSpace = '%lld'."),
 	            numTypes, size, numObjs, space);
 
-	err = msg->replySuccess(reply);
+	err = readReply.Success(reply);
 	MojErrCheck(err);
 
 	return MojErrNone;
 }
 
 MojErr
-CategoryHandler::GetCacheTypeStatus(MojServiceMessage *msg,
-                                    MojObject &payload)
+CategoryHandler::GetCacheTypeStatus(MojObject &payload,
+                                    ReadReply &readReply)
 {
 
 	MojLogTrace(s_log);
@@ -1292,9 +2054,9 @@ CategoryHandler::GetCacheTypeStatus(MojServiceMessage *msg,
 		MojErrCheck(err);
 		err = reply.putInt(_T("numObjs"), (MojInt64) numObjs);
 		MojErrCheck(err);
-		MojLogDebug(s_log, _T("GetCacheTypeStatus: size = '%d', numObjs = '%d'."),
+		MojLogDebug(s_log, _T("GetCacheTypeStatus: size = '%lld', numObjs = '%d'."),
 		            size, numObjs);
-		err = msg->replySuccess(reply);
+		err = readReply.Success(reply);
 	}
 	else
 	{
@@ -1302,7 +2064,7 @@ CategoryHandler::GetCacheTypeStatus(MojServiceMessage *msg,
 		msgText += typeName.data();
 		msgText += "' doesn't exist";
 		MojLogInfo(s_log, _T("%s"), msgText.c_str());
-		err = msg->replyError((MojErr) FCExistsError, msgText.c_str());
+		err = readReply.Error((MojErr) FCExistsError, msgText);
 	}
 
 	MojErrCheck(err);
@@ -1311,8 +2073,8 @@ CategoryHandler::GetCacheTypeStatus(MojServiceMessage *msg,
 }
 
 MojErr
-CategoryHandler::GetCacheObjectSize(MojServiceMessage *msg,
-                                    MojObject &payload)
+CategoryHandler::GetCacheObjectSize(MojObject &payload,
+                                    ReadReply &readReply)
 {
 
 	MojLogTrace(s_log);
@@ -1331,8 +2093,8 @@ CategoryHandler::GetCacheObjectSize(MojServiceMessage *msg,
 	{
 		err = reply.putInt(_T("size"), (MojInt64) objSize);
 		MojErrCheck(err);
-		MojLogDebug(s_log, _T("GetCacheObjectSize: found size '%d'."), objSize);
-		err = msg->replySuccess(reply);
+		MojLogDebug(s_log, _T("GetCacheObjectSize: found size '%lld'."), objSize);
+		err = readReply.Success(reply);
 	}
 	else
 	{
@@ -1340,7 +2102,7 @@ CategoryHandler::GetCacheObjectSize(MojServiceMessage *msg,
 		msgText += pathName.data();
 		msgText += "' doesn't exist";
 		MojLogInfo(s_log, _T("%s"), msgText.c_str());
-		err = msg->replyError((MojErr) FCExistsError, msgText.c_str());
+		err = readReply.Error((MojErr) FCExistsError, msgText);
 	}
 	MojErrCheck(err);
 
@@ -1348,8 +2110,8 @@ CategoryHandler::GetCacheObjectSize(MojServiceMessage *msg,
 }
 
 MojErr
-CategoryHandler::GetCacheObjectFilename(MojServiceMessage *msg,
-                                        MojObject &payload)
+CategoryHandler::GetCacheObjectFilename(MojObject &payload,
+                                        ReadReply &readReply)
 {
 
 	MojLogTrace(s_log);
@@ -1370,7 +2132,7 @@ CategoryHandler::GetCacheObjectFilename(MojServiceMessage *msg,
 		MojErrCheck(err);
 		MojLogDebug(s_log, _T("GetCacheObjectFilename: found filename '%s'."),
 		            filename.c_str());
-		err = msg->replySuccess(reply);
+		err = readReply.Success(reply);
 	}
 	else
 	{
@@ -1378,7 +2140,7 @@ CategoryHandler::GetCacheObjectFilename(MojServiceMessage *msg,
 		msgText += pathName.data();
 		msgText += "' doesn't exist";
 		MojLogInfo(s_log, _T("%s"), msgText.c_str());
-		err = msg->replyError((MojErr) FCExistsError, msgText.c_str());
+		err = readReply.Error((MojErr) FCExistsError, msgText);
 	}
 	MojErrCheck(err);
 
@@ -1386,8 +2148,8 @@ CategoryHandler::GetCacheObjectFilename(MojServiceMessage *msg,
 }
 
 MojErr
-CategoryHandler::GetCacheTypes(MojServiceMessage *msg,
-                               MojObject &payload)
+CategoryHandler::GetCacheTypes(MojObject &payload,
+                               ReadReply &readReply)
 {
 
 	MojLogTrace(s_log);
@@ -1412,7 +2174,7 @@ CategoryHandler::GetCacheTypes(MojServiceMessage *msg,
 		MojLogDebug(s_log, _T("GetCacheTypes: found '%zd' types."),
 		            cacheTypes.size());
 	}
-	err = msg->replySuccess(reply);
+	err = readReply.Success(reply);
 	MojErrCheck(err);
 
 	return MojErrNone;
@@ -1436,70 +2198,559 @@ CategoryHandler::GetVersion(MojServiceMessage *msg,
 
 }
 
+// Report the counters of each type, the latency histogram of each
+// method and how long the startup walk took.  Bucket i of a histogram
+// counts the requests that took under 2^i microseconds and weren't
+// counted in an earlier bucket, the last one counts the rest.
 MojErr
-CategoryHandler::WorkerHandler()
+CategoryHandler::GetMetrics(MojObject &payload,
+                            ReadReply &readReply)
 {
 
 	MojLogTrace(s_log);
 
-	MojLogDebug(s_log, _T("WorkerHandler: Attempting to cleanup any orphans."));
-	m_fileCacheSet->CleanupOrphans();
+	MojObject reply;
+	MojErr err = reply.putInt(_T("walkDuration"),
+	                          (MojInt64) m_fileCacheSet->GetWalkDuration());
+	MojErrCheck(err);
 
-	// For each subscribed object, if it's still being written, do a
-	// validity check
-	for (SubscriptionVec::const_iterator it = m_subscribers.begin();
-	        it != m_subscribers.end(); ++it)
+	// The hits and misses of each type are also summed by eviction
+	// policy so the policies can be compared
+	MojObject typeArray;
+	std::map<std::string, std::pair<unsigned long long, unsigned long long> > policyHits;
+	const std::vector<std::string> cacheTypes = m_fileCacheSet->GetTypes();
+	std::vector<std::string>::const_iterator typeIter = cacheTypes.begin();
+	while (typeIter != cacheTypes.end())
 	{
-		MojLogDebug(s_log, _T("WorkerHandler: Validating subscribed object '%s'."),
-		            (*it)->GetPathName().data());
-		const cachedObjectId_t objId =
-		    GetObjectIdFromPath((*it)->GetPathName().data());
-		const std::string typeName(GetTypeNameFromPath(m_fileCacheSet->GetBaseDirName(),
-		                           (*it)->GetPathName().data()));
-		m_fileCacheSet->CheckSubscribedObject(typeName, objId);
+		const CCacheMetrics *metrics = m_fileCacheSet->GetTypeMetrics(*typeIter);
+		if (metrics != NULL)
+		{
+			const std::string policy(m_fileCacheSet->DescribeType(*typeIter).GetPolicy());
+			const unsigned long long hits = metrics->m_subscribeHits.Get();
+			const unsigned long long misses = metrics->m_subscribeMisses.Get();
+			policyHits[policy].first += hits;
+			policyHits[policy].second += misses;
+
+			MojObject type;
+			err = type.putString(_T("typeName"), (*typeIter).c_str());
+			MojErrCheck(err);
+			err = type.putString(_T("evictionPolicy"), policy.c_str());
+			MojErrCheck(err);
+			err = type.putInt(_T("subscribeHits"), (MojInt64) hits);
+			MojErrCheck(err);
+			err = type.putInt(_T("subscribeMisses"), (MojInt64) misses);
+			MojErrCheck(err);
+			err = type.putInt(_T("hitPercent"), GetHitPercent(hits, misses));
+			MojErrCheck(err);
+			err = type.putInt(_T("insertRejections"),
+			                  (MojInt64) metrics->m_insertRejections.Get());
+			MojErrCheck(err);
+			err = type.putInt(_T("localEvictions"),
+			                  (MojInt64) metrics->m_localEvictions.Get());
+			MojErrCheck(err);
+			err = type.putInt(_T("globalEvictions"),
+			                  (MojInt64) metrics->m_globalEvictions.Get());
+			MojErrCheck(err);
+			err = type.putInt(_T("bytesFreed"),
+			                  (MojInt64) metrics->m_bytesFreed.Get());
+			MojErrCheck(err);
+			err = type.putInt(_T("dedupLinks"),
+			                  (MojInt64) metrics->m_dedupLinks.Get());
+			MojErrCheck(err);
+			err = type.putInt(_T("bytesDeduped"),
+			                  (MojInt64) metrics->m_bytesDeduped.Get());
+			MojErrCheck(err);
+			err = type.putInt(_T("compressedObjects"),
+			                  (MojInt64) metrics->m_compressedObjects.Get());
+			MojErrCheck(err);
+			err = type.putInt(_T("bytesCompressed"),
+			                  (MojInt64) metrics->m_bytesCompressed.Get());
+			MojErrCheck(err);
+			err = type.putInt(_T("memoryDemotions"),
+			                  (MojInt64) metrics->m_memoryDemotions.Get());
+			MojErrCheck(err);
+			err = type.putInt(_T("prefetches"),
+			                  (MojInt64) metrics->m_prefetches.Get());
+			MojErrCheck(err);
+			err = typeArray.push(type);
+			MojErrCheck(err);
+		}
+		++typeIter;
+	}
+	err = reply.put(_T("types"), typeArray);
+	MojErrCheck(err);
+
+	MojObject policyArray;
+	std::map<std::string, std::pair<unsigned long long, unsigned long long> >::const_iterator
+	policyIter = policyHits.begin();
+	while (policyIter != policyHits.end())
+	{
+		MojObject policy;
+		err = policy.putString(_T("evictionPolicy"), (*policyIter).first.c_str());
+		MojErrCheck(err);
+		err = policy.putInt(_T("subscribeHits"), (MojInt64)(*policyIter).second.first);
+		MojErrCheck(err);
+		err = policy.putInt(_T("subscribeMisses"),
+		                    (MojInt64)(*policyIter).second.second);
+		MojErrCheck(err);
+		err = policy.putInt(_T("hitPercent"),
+		                    GetHitPercent((*policyIter).second.first,
+		                                  (*policyIter).second.second));
+		MojErrCheck(err);
+		err = policyArray.push(policy);
+		MojErrCheck(err);
+		++policyIter;
+	}
+	err = reply.put(_T("policies"), policyArray);
+	MojErrCheck(err);
+
+	MojObject methodArray;
+	std::map<std::string, CLatencyHistogram>::const_iterator iter;
+	iter = m_latencies.begin();
+	while (iter != m_latencies.end())
+	{
+		const CLatencyHistogram &latency = (*iter).second;
+		MojObject method;
+		err = method.putString(_T("method"), (*iter).first.c_str());
+		MojErrCheck(err);
+		err = method.putInt(_T("count"), (MojInt64) latency.GetCount());
+		MojErrCheck(err);
+		err = method.putInt(_T("totalMicros"), (MojInt64) latency.GetTotal());
+		MojErrCheck(err);
+		MojObject buckets;
+		for (size_t i = 0; i < s_numLatencyBuckets; i++)
+		{
+			err = buckets.pushInt((MojInt64) latency.GetBucket(i));
+			MojErrCheck(err);
+		}
+		err = method.put(_T("buckets"), buckets);
+		MojErrCheck(err);
+		err = methodArray.push(method);
+		MojErrCheck(err);
+		++iter;
 	}
+	err = reply.put(_T("methods"), methodArray);
+	MojErrCheck(err);
+
+	err = readReply.Success(reply);
+	MojErrCheck(err);
 
 	return MojErrNone;
 }
 
+// Keep the answer to send from the main loop
 MojErr
-CategoryHandler::CleanerHandler()
+CategoryHandler::ReadReply::Success(const MojObject &payload)
 {
 
-	MojLogTrace(s_log);
-
-	MojLogDebug(s_log, _T("CleanerHandler: Attempting to cleanup dirTypes."));
-	m_fileCacheSet->CleanupDirTypes();
+	m_payload = payload;
+	m_errCode = MojErrNone;
+	m_filled = true;
 
 	return MojErrNone;
 }
 
 MojErr
-CategoryHandler::SetupWorkerTimer()
+CategoryHandler::ReadReply::Error(const MojErr errCode,
+                                  const std::string &errorText)
 {
 
-	MojLogTrace(s_log);
-
-	g_timeout_add_seconds(15, &TimerCallback, this);
-	g_timeout_add_seconds(120, &CleanerCallback, this);
+	m_errCode = errCode;
+	m_errorText = errorText;
+	m_filled = true;
 
 	return MojErrNone;
 }
 
-gboolean
-CategoryHandler::TimerCallback(void *data)
+// Send the kept answer, a reader which failed without one is answered
+// with a generic error
+MojErr
+CategoryHandler::ReadReply::Send(MojServiceMessage *msg)
 {
 
-	MojLogTrace(s_log);
-
-	CategoryHandler *self = static_cast<CategoryHandler *>(data);
-	self->WorkerHandler();
+	MojErr err = MojErrNone;
+	if (!m_filled)
+	{
+		err = msg->replyError(MojErrInternal, _T("Request failed"));
+	}
+	else if (m_errCode != MojErrNone)
+	{
+		err = msg->replyError(m_errCode, m_errorText.c_str());
+	}
+	else
+	{
+		err = msg->replySuccess(m_payload);
+	}
+	MojErrCheck(err);
 
-	return true;
+	return MojErrNone;
 }
 
-gboolean
-CategoryHandler::CleanerCallback(void *data)
+// Answer a read-only request on the reader pool.  The payload is copied
+// and the message held until the completion runs back on the main
+// loop, which sends the answer the reader built.  The reader runs with
+// the cache set locked for reading, so it only waits while the main
+// loop is changing the cache.  Lookups can load directories while a
+// lazy walk is in progress, so until the walk finishes the request is
+// answered inline with the write lock held.
+MojErr
+CategoryHandler::RunReader(MojServiceMessage *msg, MojObject &payload,
+                           Reader reader)
+{
+
+	MojLogTrace(s_log);
+
+	CIoWorkerPool *readPool = m_fileCacheSet->GetReadPool();
+	if ((readPool == NULL) || !m_fileCacheSet->isWalkComplete())
+	{
+		CWriteLockGuard guard(m_fileCacheSet);
+		ReadReply readReply;
+		MojErr err = (this->*reader)(payload, readReply);
+		MojErrCheck(err);
+		err = readReply.Send(msg);
+		MojErrCheck(err);
+
+		return MojErrNone;
+	}
+
+	MojRefCountedPtr<MojServiceMessage> msgRef(msg);
+	MojObject request(payload);
+	std::shared_ptr<ReadReply> readReply(new ReadReply());
+	std::shared_ptr<MojErr> readErr(new MojErr(MojErrNone));
+	CLatencyHistogram *latency = m_requestLatency;
+	const long long start = m_requestStart;
+	m_requestLatency = NULL;
+	readPool->Post(std::string(), [this, request, reader, readReply,
+	                               readErr]() mutable
+	{
+		CReadLockGuard guard(m_fileCacheSet->GetLock());
+		*readErr = (this->*reader)(request, *readReply);
+	},
+	[msgRef, readReply, readErr, latency, start]()
+	{
+		if (*readErr != MojErrNone)
+		{
+			MojLogError(s_log, _T("RunReader: Request failed with error '%d'."),
+			            (int) *readErr);
+			(void) msgRef->replyError(*readErr, _T("Request failed"));
+		}
+		else
+		{
+			(void) readReply->Send(msgRef.get());
+		}
+		if (latency != NULL)
+		{
+			latency->Record(GetMonotonicMicros() - start);
+		}
+	});
+
+	return MojErrNone;
+}
+
+MojErr
+CategoryHandler::PostDescribeType(MojServiceMessage *msg,
+                                  MojObject &payload)
+{
+
+	return RunReader(msg, payload, &CategoryHandler::DescribeType);
+}
+
+MojErr
+CategoryHandler::PostGetCacheStatus(MojServiceMessage *msg,
+                                    MojObject &payload)
+{
+
+	return RunReader(msg, payload, &CategoryHandler::GetCacheStatus);
+}
+
+MojErr
+CategoryHandler::PostGetCacheTypeStatus(MojServiceMessage *msg,
+                                        MojObject &payload)
+{
+
+	return RunReader(msg, payload, &CategoryHandler::GetCacheTypeStatus);
+}
+
+MojErr
+CategoryHandler::PostGetCacheObjectSize(MojServiceMessage *msg,
+                                        MojObject &payload)
+{
+
+	return RunReader(msg, payload, &CategoryHandler::GetCacheObjectSize);
+}
+
+MojErr
+CategoryHandler::PostGetCacheObjectFilename(MojServiceMessage *msg,
+        MojObject &payload)
+{
+
+	return RunReader(msg, payload, &CategoryHandler::GetCacheObjectFilename);
+}
+
+MojErr
+CategoryHandler::PostGetCacheTypes(MojServiceMessage *msg,
+                                   MojObject &payload)
+{
+
+	return RunReader(msg, payload, &CategoryHandler::GetCacheTypes);
+}
+
+MojErr
+CategoryHandler::PostGetMetrics(MojServiceMessage *msg,
+                                MojObject &payload)
+{
+
+	return RunReader(msg, payload, &CategoryHandler::GetMetrics);
+}
+
+MojErr
+CategoryHandler::WorkerHandler()
+{
+
+	MojLogTrace(s_log);
+
+	CWriteLockGuard guard(m_fileCacheSet);
+	MojLogDebug(s_log, _T("WorkerHandler: Attempting to cleanup any orphans."));
+	m_fileCacheSet->CleanupOrphans();
+
+	// Objects being written are validated as they change when their
+	// writes are tracked.  Otherwise, for each subscribed object, if
+	// it's still being written, do a validity check.
+	if (m_fileCacheSet->GetDirSizeTracker() != NULL)
+	{
+		return MojErrNone;
+	}
+	for (SubscriptionVec::const_iterator it = m_subscribers.begin();
+	        it != m_subscribers.end(); ++it)
+	{
+		const MojString pathName((*it)->GetPathName());
+		MojLogDebug(s_log, _T("WorkerHandler: Validating subscribed object '%s'."),
+		            pathName.data());
+		const cachedObjectId_t objId = GetObjectIdFromPath(pathName.data());
+		const char *typeName = "";
+		size_t length = 0;
+		FindTypeNameInPath(m_fileCacheSet->GetBaseDirName(), pathName.data(),
+		                   &typeName, &length);
+		m_fileCacheSet->CheckSubscribedObject(std::string(typeName, length), objId);
+	}
+
+	return MojErrNone;
+}
+
+MojErr
+CategoryHandler::CleanerHandler()
+{
+
+	MojLogTrace(s_log);
+
+	CWriteLockGuard guard(m_fileCacheSet);
+	MojLogDebug(s_log, _T("CleanerHandler: Attempting to cleanup dirTypes."));
+	m_fileCacheSet->CleanupDirTypes();
+
+	return MojErrNone;
+}
+
+MojErr
+CategoryHandler::IndexHandler()
+{
+
+	MojLogTrace(s_log);
+
+	CWriteLockGuard guard(m_fileCacheSet);
+	if (m_fileCacheSet->CacheIndexNeedsSnapshot())
+	{
+		MojLogDebug(s_log, _T("IndexHandler: Writing cache index snapshot."));
+		m_fileCacheSet->WriteCacheIndex();
+	}
+
+	return MojErrNone;
+}
+
+MojErr
+CategoryHandler::ExpiryHandler()
+{
+
+	MojLogTrace(s_log);
+
+	CWriteLockGuard guard(m_fileCacheSet);
+	paramValue_t numExpired = m_fileCacheSet->ExpireStaleObjects();
+	if (numExpired > 0)
+	{
+		MojLogDebug(s_log, _T("ExpiryHandler: Expired '%d' stale objects."),
+		            numExpired);
+	}
+
+	// Memory pressure from outside the cache is only noticed here
+	paramValue_t numDemoted = m_fileCacheSet->DemoteMemoryObjects();
+	if (numDemoted > 0)
+	{
+		MojLogDebug(s_log, _T("ExpiryHandler: Moving '%d' objects out of memory."),
+		            numDemoted);
+	}
+
+	return MojErrNone;
+}
+
+MojErr
+CategoryHandler::AdaptHandler()
+{
+
+	MojLogTrace(s_log);
+
+	CWriteLockGuard guard(m_fileCacheSet);
+	cacheSize_t cleanedSize = m_fileCacheSet->AdaptCacheSpace();
+	if (cleanedSize > 0)
+	{
+		MojLogDebug(s_log, _T("AdaptHandler: Cleaned up '%lld' bytes ahead of inserts."),
+		            cleanedSize);
+	}
+
+	return MojErrNone;
+}
+
+MojErr
+CategoryHandler::SetupWorkerTimer()
+{
+
+	MojLogTrace(s_log);
+
+	g_timeout_add_seconds(120, &CleanerCallback, this);
+	g_timeout_add_seconds(s_indexSnapshotInterval, &IndexCallback, this);
+	g_timeout_add_seconds(s_expiryInterval, &ExpiryCallback, this);
+	if (m_fileCacheSet->isAdaptiveSpace())
+	{
+		g_timeout_add_seconds(s_adaptInterval, &AdaptCallback, this);
+	}
+
+	// Written objects are flushed off the main loop and finished here
+	// as each batch completes
+	int syncFd = m_fileCacheSet->StartSyncQueue();
+	if (syncFd >= 0)
+	{
+		GIOChannel *channel = g_io_channel_unix_new(syncFd);
+		g_io_add_watch(channel, G_IO_IN, &SyncCallback, this);
+		g_io_channel_unref(channel);
+	}
+	else
+	{
+		MojLogWarning(s_log, _T("SetupWorkerTimer: No sync queue event, syncing on unsubscribe."));
+		m_fileCacheSet->StopSyncQueue();
+	}
+
+	// Removing objects and summing directories is done on I/O workers
+	// and completed here
+	int ioFd = m_fileCacheSet->StartIoPool();
+	if (ioFd >= 0)
+	{
+		GIOChannel *channel = g_io_channel_unix_new(ioFd);
+		g_io_add_watch(channel, G_IO_IN, &IoCallback, this);
+		g_io_channel_unref(channel);
+	}
+	else
+	{
+		MojLogWarning(s_log, _T("SetupWorkerTimer: No I/O pool event, doing I/O inline."));
+		m_fileCacheSet->StopIoPool();
+	}
+	m_fileCacheSet->SweepTrash();
+
+	// The objects used last are read ahead of the clients starting up
+	// again, after a lazy walk this waits for the walk to finish
+	m_fileCacheSet->PrefetchAtStartup();
+
+	// Read-only requests are answered on reader threads, which only wait
+	// while the main loop is changing the cache
+	int readFd = m_fileCacheSet->StartReadPool();
+	if (readFd >= 0)
+	{
+		GIOChannel *channel = g_io_channel_unix_new(readFd);
+		g_io_add_watch(channel, G_IO_IN, &ReadCallback, this);
+		g_io_channel_unref(channel);
+	}
+	else
+	{
+		MojLogInfo(s_log, _T("SetupWorkerTimer: No reader pool, answering requests inline."));
+		m_fileCacheSet->StopReadPool();
+	}
+
+	// Subscribed directory type objects have their size kept up to date
+	// from inotify events handled here
+	int dirSizeFd = m_fileCacheSet->StartDirSizeTracker();
+	if (dirSizeFd >= 0)
+	{
+		GIOChannel *channel = g_io_channel_unix_new(dirSizeFd);
+		g_io_add_watch(channel, G_IO_IN, &DirSizeCallback, this);
+		g_io_channel_unref(channel);
+	}
+	else
+	{
+		MojLogWarning(s_log, _T("SetupWorkerTimer: No inotify, polling subscribed objects."));
+		m_fileCacheSet->StopDirSizeTracker();
+	}
+
+	// The worker only runs while there are orphans to clean up, or all
+	// the time if subscribed objects have to be polled
+	m_fileCacheSet->SetOrphanCallback([this]()
+	{
+		ScheduleWorker();
+	});
+	ScheduleWorker();
+
+	// The streaming readers of objects being written are told how
+	// each write goes
+	m_fileCacheSet->SetStreamCallback([this](const cachedObjectId_t objId,
+	                                  const StreamEvent event, const cacheSize_t size)
+	{
+		NotifyStreamReaders(objId, event, size);
+	});
+
+	// Subscribers of compressed objects are answered once the views made
+	// on the I/O pool are ready
+	m_fileCacheSet->SetViewCallback([this](const cachedObjectId_t objId,
+	                                const std::string &viewPath)
+	{
+		FinishView(objId, viewPath);
+	});
+
+	return MojErrNone;
+}
+
+// Start the worker timer unless it is already running
+void
+CategoryHandler::ScheduleWorker()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_workerTimer == 0)
+	{
+		m_workerTimer = g_timeout_add_seconds(s_workerInterval, &TimerCallback,
+		                                      this);
+	}
+}
+
+gboolean
+CategoryHandler::TimerCallback(void *data)
+{
+
+	MojLogTrace(s_log);
+
+	CategoryHandler *self = static_cast<CategoryHandler *>(data);
+	self->WorkerHandler();
+
+	// Keep running while orphans are left to retry or subscribed
+	// objects have to be polled
+	if (self->m_fileCacheSet->HasOrphans() ||
+	        (self->m_fileCacheSet->GetDirSizeTracker() == NULL))
+	{
+		return true;
+	}
+	self->m_workerTimer = 0;
+
+	return false;
+}
+
+gboolean
+CategoryHandler::CleanerCallback(void *data)
 {
 
 	MojLogTrace(s_log);
@@ -1511,12 +2762,151 @@ CategoryHandler::CleanerCallback(void *data)
 	return false;
 }
 
+gboolean
+CategoryHandler::IndexCallback(void *data)
+{
+
+	MojLogTrace(s_log);
+
+	CategoryHandler *self = static_cast<CategoryHandler *>(data);
+	self->IndexHandler();
+
+	return true;
+}
+
+gboolean
+CategoryHandler::ExpiryCallback(void *data)
+{
+
+	MojLogTrace(s_log);
+
+	CategoryHandler *self = static_cast<CategoryHandler *>(data);
+	self->ExpiryHandler();
+
+	return true;
+}
+
+gboolean
+CategoryHandler::AdaptCallback(void *data)
+{
+
+	MojLogTrace(s_log);
+
+	CategoryHandler *self = static_cast<CategoryHandler *>(data);
+	self->AdaptHandler();
+
+	return true;
+}
+
+MojErr
+CategoryHandler::SyncHandler()
+{
+
+	MojLogTrace(s_log);
+
+	CWriteLockGuard guard(m_fileCacheSet);
+	m_fileCacheSet->FinishSyncs();
+
+	return MojErrNone;
+}
+
+gboolean
+CategoryHandler::SyncCallback(GIOChannel *channel, GIOCondition condition,
+                              void *data)
+{
+
+	MojLogTrace(s_log);
+
+	CategoryHandler *self = static_cast<CategoryHandler *>(data);
+	self->SyncHandler();
+
+	return true;
+}
+
+MojErr
+CategoryHandler::IoHandler()
+{
+
+	MojLogTrace(s_log);
+
+	CWriteLockGuard guard(m_fileCacheSet);
+	m_fileCacheSet->RunIoCompletions();
+
+	return MojErrNone;
+}
+
+gboolean
+CategoryHandler::IoCallback(GIOChannel *channel, GIOCondition condition,
+                            void *data)
+{
+
+	MojLogTrace(s_log);
+
+	CategoryHandler *self = static_cast<CategoryHandler *>(data);
+	self->IoHandler();
+
+	return true;
+}
+
+MojErr
+CategoryHandler::DirSizeHandler()
+{
+
+	MojLogTrace(s_log);
+
+	CWriteLockGuard guard(m_fileCacheSet);
+	m_fileCacheSet->ProcessDirSizeEvents();
+
+	return MojErrNone;
+}
+
+gboolean
+CategoryHandler::DirSizeCallback(GIOChannel *channel, GIOCondition condition,
+                                 void *data)
+{
+
+	MojLogTrace(s_log);
+
+	CategoryHandler *self = static_cast<CategoryHandler *>(data);
+	self->DirSizeHandler();
+
+	return true;
+}
+
+MojErr
+CategoryHandler::ReadHandler()
+{
+
+	MojLogTrace(s_log);
+
+	m_fileCacheSet->RunReadCompletions();
+
+	return MojErrNone;
+}
+
+gboolean
+CategoryHandler::ReadCallback(GIOChannel *channel, GIOCondition condition,
+                              void *data)
+{
+
+	MojLogTrace(s_log);
+
+	CategoryHandler *self = static_cast<CategoryHandler *>(data);
+	self->ReadHandler();
+
+	return true;
+}
+
 CategoryHandler::Subscription::Subscription(CategoryHandler &handler,
         MojServiceMessage *msg,
-        MojString &pathName)
+        MojString &pathName,
+        bool stream)
 	: m_handler(handler),
 	  m_msg(msg),
 	  m_pathName(pathName),
+	  m_stream(stream),
+	  m_waitingForView(false),
+	  m_streamedSize(-1),
 	  m_cancelSlot(this, &Subscription::HandleCancel)
 {
 
@@ -1540,18 +2930,87 @@ CategoryHandler::Subscription::HandleCancel(MojServiceMessage *msg)
 	return m_handler.CancelSubscription(this, msg, m_pathName);
 }
 
+// Answer a subscriber waiting for the view of a compressed object with
+// its path, or with an error if the view couldn't be made
+MojErr
+CategoryHandler::Subscription::ReplyView(const std::string &viewPath)
+{
+
+	MojLogTrace(s_log);
+
+	m_waitingForView = false;
+	if (viewPath.empty())
+	{
+		MojErr err = m_msg->replyError((MojErr) FCExistsError,
+		                               _T("Failed to decompress the object."));
+		MojErrCheck(err);
+		return MojErrNone;
+	}
+
+	MojObject reply;
+	MojErr err = reply.putBool(_T("subscribed"), true);
+	MojErrCheck(err);
+	err = reply.putString(_T("viewPath"), viewPath.c_str());
+	MojErrCheck(err);
+	err = m_msg->replySuccess(reply);
+	MojErrCheck(err);
+
+	return MojErrNone;
+}
+
+// Reply to a streaming reader with an event of the object it reads.
+// Progress is only sent when more has been written.
+MojErr
+CategoryHandler::Subscription::Notify(const StreamEvent event,
+                                      const cacheSize_t size)
+{
+
+	MojLogTrace(s_log);
+
+	if ((event == StreamEventProgress) && (size == m_streamedSize))
+	{
+		return MojErrNone;
+	}
+
+	MojObject reply;
+	MojErr err = reply.putBool(_T("subscribed"), true);
+	MojErrCheck(err);
+	if (event == StreamEventFailed)
+	{
+		err = reply.putString(_T("event"), _T("failed"));
+		MojErrCheck(err);
+	}
+	else
+	{
+		m_streamedSize = size;
+		err = reply.putString(_T("event"), (event == StreamEventWritten) ?
+		                      _T("written") : _T("progress"));
+		MojErrCheck(err);
+		err = reply.putInt(_T("bytesWritten"), (MojInt64) size);
+		MojErrCheck(err);
+	}
+	err = m_msg->replySuccess(reply);
+	MojErrCheck(err);
+
+	return MojErrNone;
+}
+
 MojErr
 CategoryHandler::CopyFile(MojServiceMessage *msg,
                           const std::string &source,
-                          const std::string &destination)
+                          const std::string &destination,
+                          CopyPriority priority, bool subscribed)
 {
 
 	MojLogTrace(s_log);
 
 	MojErr err = MojErrNone;
 
-	CAsyncCopier *c = new CAsyncCopier(source, destination, msg);
-	c->StartCopy();
+	CAsyncCopier *c = new CAsyncCopier(source, destination, msg,
+	                                   &m_copyScheduler, priority, subscribed);
+	m_copyScheduler.Add(c);
+	MojLogDebug(s_log, _T("CopyFile: %zu copies running, %zu queued."),
+	            m_copyScheduler.GetNumRunning(), m_copyScheduler.GetNumQueued());
 
 	return err;
 }
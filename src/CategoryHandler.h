@@ -19,6 +19,9 @@
 
 #include "CacheBase.h"
 #include "FileCacheSet.h"
+#include "CopyScheduler.h"
+#include "Metrics.h"
+#include "TraceLog.h"
 #include "core/MojService.h"
 #include "luna/MojLunaMessage.h"
 #include "glib.h"
@@ -38,62 +41,165 @@ public:
 	{
 		return m_subscribers.size();
 	}
+
+	// Times each request into the latency histogram of its method and
+	// holds the cache set's write lock around the ones changing it
+	virtual MojErr invoke(const MojChar *method, MojServiceMessage *msg,
+	                      MojObject &payload);
 private:
 	class Subscription : public MojSignalHandler
 	{
 	public:
 		Subscription(CategoryHandler &handler, MojServiceMessage *msg,
-		             MojString &pathName);
+		             MojString &pathName, bool stream = false);
 		~Subscription();
 		MojString GetPathName()
 		{
 			return m_pathName;
 		}
 
+		// A streaming reader subscribed while the object was being
+		// written and is sent its events
+		bool isStreaming() const
+		{
+			return m_stream;
+		}
+		MojErr Notify(const StreamEvent event, const cacheSize_t size);
+
+		// A subscriber of a compressed object is answered once the view
+		// of the object has been made
+		bool isWaitingForView() const
+		{
+			return m_waitingForView;
+		}
+		void WaitForView()
+		{
+			m_waitingForView = true;
+		}
+		MojErr ReplyView(const std::string &viewPath);
+
 	private:
 		MojErr HandleCancel(MojServiceMessage *msg);
 
 		CategoryHandler &m_handler;
 		MojRefCountedPtr<MojServiceMessage> m_msg;
 		MojString m_pathName;
+		bool m_stream;
+		bool m_waitingForView;
+		cacheSize_t m_streamedSize;
 		MojServiceMessage::CancelSignal::Slot<Subscription> m_cancelSlot;
 	};
 
+	// The answer a read-only request builds on a reader thread, sent
+	// from the main loop once the reader is done
+	class ReadReply
+	{
+	public:
+		ReadReply()
+			: m_errCode(MojErrNone)
+			, m_filled(false)
+		{
+		}
+		MojErr Success(const MojObject &payload);
+		MojErr Error(const MojErr errCode, const std::string &errorText);
+		MojErr Send(MojServiceMessage *msg);
+
+	private:
+		MojObject m_payload;
+		MojErr m_errCode;
+		std::string m_errorText;
+		bool m_filled;
+	};
+
 	MojErr DefineType(MojServiceMessage *msg, MojObject &payload);
 	MojErr ChangeType(MojServiceMessage *msg, MojObject &payload);
 	MojErr DeleteType(MojServiceMessage *msg, MojObject &payload);
-	MojErr DescribeType(MojServiceMessage *msg, MojObject &payload);
+	MojErr DescribeType(MojObject &payload, ReadReply &readReply);
 	MojErr InsertCacheObject(MojServiceMessage *msg, MojObject &payload);
+	MojErr InsertCacheObjects(MojServiceMessage *msg, MojObject &payload);
 	MojErr ResizeCacheObject(MojServiceMessage *msg, MojObject &payload);
 	MojErr ExpireCacheObject(MojServiceMessage *msg, MojObject &payload);
 	MojErr SubscribeCacheObject(MojServiceMessage *msg, MojObject &payload);
+	MojErr SubscribeCacheObjects(MojServiceMessage *msg, MojObject &payload);
+	MojErr PrefetchCacheObjects(MojServiceMessage *msg, MojObject &payload);
 	MojErr TouchCacheObject(MojServiceMessage *msg, MojObject &payload);
 	MojErr CopyCacheObject(MojServiceMessage *msg, MojObject &payload);
-	MojErr GetCacheStatus(MojServiceMessage *msg, MojObject &payload);
-	MojErr GetCacheTypeStatus(MojServiceMessage *msg, MojObject &payload);
-	MojErr GetCacheObjectSize(MojServiceMessage *msg, MojObject &payload);
-	MojErr GetCacheObjectFilename(MojServiceMessage *msg, MojObject &payload);
-	MojErr GetCacheTypes(MojServiceMessage *msg, MojObject &payload);
+	MojErr GetCacheStatus(MojObject &payload, ReadReply &readReply);
+	MojErr GetCacheTypeStatus(MojObject &payload, ReadReply &readReply);
+	MojErr GetCacheObjectSize(MojObject &payload, ReadReply &readReply);
+	MojErr GetCacheObjectFilename(MojObject &payload, ReadReply &readReply);
+	MojErr GetCacheTypes(MojObject &payload, ReadReply &readReply);
 	MojErr GetVersion(MojServiceMessage *msg, MojObject &payload);
+	MojErr GetMetrics(MojObject &payload, ReadReply &readReply);
+
+	// The read-only methods are registered through these, which answer
+	// them on the reader pool when there is one
+	typedef MojErr (CategoryHandler::*Reader)(MojObject &payload,
+	        ReadReply &readReply);
+	MojErr RunReader(MojServiceMessage *msg, MojObject &payload, Reader reader);
+	MojErr PostDescribeType(MojServiceMessage *msg, MojObject &payload);
+	MojErr PostGetCacheStatus(MojServiceMessage *msg, MojObject &payload);
+	MojErr PostGetCacheTypeStatus(MojServiceMessage *msg, MojObject &payload);
+	MojErr PostGetCacheObjectSize(MojServiceMessage *msg, MojObject &payload);
+	MojErr PostGetCacheObjectFilename(MojServiceMessage *msg, MojObject &payload);
+	MojErr PostGetCacheTypes(MojServiceMessage *msg, MojObject &payload);
+	MojErr PostGetMetrics(MojServiceMessage *msg, MojObject &payload);
 
 	MojErr CancelSubscription(Subscription *sub, MojServiceMessage *msg,
 	                          MojString &pathName);
+	void NotifyStreamReaders(const cachedObjectId_t objId,
+	                         const StreamEvent event, const cacheSize_t size);
+	void FinishView(const cachedObjectId_t objId, const std::string &viewPath);
+	void PrefetchSubscribedObject(const cachedObjectId_t objId);
 
 	typedef MojRefCountedPtr<Subscription> SubscriptionPtr;
 	typedef std::vector<SubscriptionPtr> SubscriptionVec;
 
 	MojErr SetupWorkerTimer();
+	void ScheduleWorker();
 	MojErr WorkerHandler();
 	static gboolean TimerCallback(void *data);
 	MojErr CleanerHandler();
 	static gboolean CleanerCallback(void *data);
+	MojErr IndexHandler();
+	static gboolean IndexCallback(void *data);
+	MojErr ExpiryHandler();
+	static gboolean ExpiryCallback(void *data);
+	MojErr AdaptHandler();
+	static gboolean AdaptCallback(void *data);
+	MojErr SyncHandler();
+	static gboolean SyncCallback(GIOChannel *channel, GIOCondition condition,
+	                             void *data);
+	MojErr IoHandler();
+	static gboolean IoCallback(GIOChannel *channel, GIOCondition condition,
+	                           void *data);
+	MojErr DirSizeHandler();
+	static gboolean DirSizeCallback(GIOChannel *channel, GIOCondition condition,
+	                                void *data);
+	MojErr ReadHandler();
+	static gboolean ReadCallback(GIOChannel *channel, GIOCondition condition,
+	                             void *data);
 	MojErr CopyFile(MojServiceMessage *msg, const std::string &source,
-	                const std::string &destination);
+	                const std::string &destination, CopyPriority priority,
+	                bool subscribed);
 	std::string CallerID(MojServiceMessage *msg);
 
 	CFileCacheSet *m_fileCacheSet;
+	CCopyScheduler m_copyScheduler;
+	guint m_workerTimer;
 
 	SubscriptionVec m_subscribers;
+
+	// A latency histogram for each method, filled in when the handler
+	// is created so the reader threads can look them up unlocked, and
+	// the request invoke is timing
+	std::map<std::string, CLatencyHistogram> m_latencies;
+	CLatencyHistogram *m_requestLatency;
+	long long m_requestStart;
+
+	// The trace of the client operations, if tracing is turned on
+	CTraceLog m_trace;
+
 	static const Method s_Methods[];
 	static MojLogger s_log;
 
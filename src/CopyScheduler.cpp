@@ -0,0 +1,150 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "CopyScheduler.h"
+#include "AsyncFileCopier.h"
+
+#include <algorithm>
+
+// Returns the priority named in a CopyCacheObject request, or
+// CopyPriorityNormal for an unknown name
+CopyPriority
+GetCopyPriority(const std::string &name)
+{
+	if (name == "high")
+	{
+		return CopyPriorityHigh;
+	}
+	if (name == "low")
+	{
+		return CopyPriorityLow;
+	}
+
+	return CopyPriorityNormal;
+}
+
+CCopyScheduler::CCopyScheduler(size_t maxCopies)
+	: m_maxCopies((maxCopies > 0) ? maxCopies : 1)
+	, m_starting(false)
+{
+}
+
+// Copies still queued at shutdown are dropped without a reply.  The
+// ones running are cancelled and detached so they don't tell the
+// scheduler when they finish, they still delete themselves then.
+CCopyScheduler::~CCopyScheduler()
+{
+	std::set<CAsyncCopier *>::iterator runningIter = m_running.begin();
+	while (runningIter != m_running.end())
+	{
+		(*runningIter)->DetachScheduler();
+		(*runningIter)->Cancel();
+		++runningIter;
+	}
+	m_running.clear();
+
+	for (int i = 0; i < s_numCopyPriorities; i++)
+	{
+		std::deque<CAsyncCopier *>::iterator iter = m_queues[i].begin();
+		while (iter != m_queues[i].end())
+		{
+			delete *iter;
+			++iter;
+		}
+	}
+}
+
+// Queue a copy, starting it straight away if fewer than the maximum
+// are running.
+void
+CCopyScheduler::Add(CAsyncCopier *copier)
+{
+	m_queues[copier->GetPriority()].push_back(copier);
+	StartCopies();
+}
+
+// Called by a copier once it has finished, just before it deletes
+// itself.
+void
+CCopyScheduler::CopyFinished(CAsyncCopier *copier)
+{
+	m_running.erase(copier);
+	StartCopies();
+}
+
+// Drop a copy whose caller cancelled it.  A queued copy is deleted, a
+// running one is asked to stop and finishes as usual.
+void
+CCopyScheduler::Cancel(CAsyncCopier *copier)
+{
+	if (m_running.find(copier) != m_running.end())
+	{
+		copier->Cancel();
+		return;
+	}
+
+	std::deque<CAsyncCopier *> &queue = m_queues[copier->GetPriority()];
+	std::deque<CAsyncCopier *>::iterator iter = std::find(queue.begin(),
+	        queue.end(), copier);
+	if (iter != queue.end())
+	{
+		queue.erase(iter);
+		delete copier;
+	}
+}
+
+size_t
+CCopyScheduler::GetNumQueued() const
+{
+	size_t numQueued = 0;
+	for (int i = 0; i < s_numCopyPriorities; i++)
+	{
+		numQueued += m_queues[i].size();
+	}
+
+	return numQueued;
+}
+
+// Start queued copies, highest priority first, until the maximum are
+// running.  Links and reflinks finish inside StartCopy, so the copies
+// they free up are filled by this loop rather than by recursing.
+void
+CCopyScheduler::StartCopies()
+{
+	if (m_starting)
+	{
+		return;
+	}
+
+	m_starting = true;
+	int priority = 0;
+	while ((m_running.size() < m_maxCopies) &&
+	        (priority < s_numCopyPriorities))
+	{
+		if (m_queues[priority].empty())
+		{
+			priority++;
+		}
+		else
+		{
+			CAsyncCopier *copier = m_queues[priority].front();
+			m_queues[priority].pop_front();
+			m_running.insert(copier);
+			copier->StartCopy();
+		}
+	}
+	m_starting = false;
+}
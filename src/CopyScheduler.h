@@ -0,0 +1,87 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __COPY_SCHEDULER_H__
+#define __COPY_SCHEDULER_H__
+
+#include <boost/noncopyable.hpp>
+#include <deque>
+#include <set>
+#include <string>
+
+class CAsyncCopier;
+
+// The priority classes of copies.  Every queued copy of a class is
+// started before any copy of a lower class.
+enum CopyPriority
+{
+	CopyPriorityHigh,
+	CopyPriorityNormal,
+	CopyPriorityLow
+};
+
+static const int s_numCopyPriorities = CopyPriorityLow + 1;
+
+// Returns the priority named in a CopyCacheObject request, or
+// CopyPriorityNormal for an unknown name
+CopyPriority GetCopyPriority(const std::string &name);
+
+// Runs the CopyCacheObject copies, at most maxCopies at once, and
+// queues the rest by priority so a burst of exports can't take all of
+// the storage bandwidth from the objects in use.  The scheduler owns
+// the copiers given to it until they finish and must only be used
+// from the main loop.
+class CCopyScheduler : public boost::noncopyable
+{
+public:
+
+	CCopyScheduler(size_t maxCopies);
+
+	~CCopyScheduler();
+
+	// Queue a copy, starting it straight away if fewer than the
+	// maximum are running.
+	void Add(CAsyncCopier *copier);
+
+	// Called by a copier once it has finished, just before it deletes
+	// itself.
+	void CopyFinished(CAsyncCopier *copier);
+
+	// Drop a copy whose caller cancelled it.  A queued copy is deleted,
+	// a running one is asked to stop and finishes as usual.
+	void Cancel(CAsyncCopier *copier);
+
+	size_t GetNumRunning() const
+	{
+		return m_running.size();
+	}
+
+	size_t GetNumQueued() const;
+
+private:
+
+	void StartCopies();
+
+	size_t m_maxCopies;
+	std::deque<CAsyncCopier *> m_queues[s_numCopyPriorities];
+	std::set<CAsyncCopier *> m_running;
+
+	// Set while StartCopies is starting copies, some of which may
+	// finish before StartCopy returns.
+	bool m_starting;
+};
+
+#endif
@@ -0,0 +1,170 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "DedupTable.h"
+
+#include <algorithm>
+
+// Add an object with content that isn't shared as the owner of a new
+// group
+bool
+CDedupTable::Add(const uint64_t hash, const cachedObjectId_t objId)
+{
+
+	if ((objId == 0) || (m_owners.find(objId) != m_owners.end()))
+	{
+		return false;
+	}
+
+	CGroup &group = m_groups[objId];
+	group.m_hash = hash;
+	m_hashes.insert(std::make_pair(hash, objId));
+	m_owners[objId] = objId;
+
+	return true;
+}
+
+// Add an object whose file is now a link to the file of owner
+bool
+CDedupTable::Link(const cachedObjectId_t owner, const cachedObjectId_t objId)
+{
+
+	std::map<cachedObjectId_t, CGroup>::iterator iter = m_groups.find(owner);
+	if ((objId == 0) || (iter == m_groups.end()) ||
+	        (m_owners.find(objId) != m_owners.end()))
+	{
+		return false;
+	}
+
+	(*iter).second.m_links.push_back(objId);
+	m_owners[objId] = owner;
+
+	return true;
+}
+
+// Remove an object.  If it owned a group with links, the oldest link
+// becomes the owner and its id is returned.
+cachedObjectId_t
+CDedupTable::Remove(const cachedObjectId_t objId)
+{
+
+	std::map<cachedObjectId_t, cachedObjectId_t>::iterator ownerIter;
+	ownerIter = m_owners.find(objId);
+	if (ownerIter == m_owners.end())
+	{
+		return 0;
+	}
+	const cachedObjectId_t owner = (*ownerIter).second;
+	m_owners.erase(ownerIter);
+
+	std::map<cachedObjectId_t, CGroup>::iterator groupIter = m_groups.find(owner);
+	CGroup &group = (*groupIter).second;
+	if (owner != objId)
+	{
+		std::vector<cachedObjectId_t>::iterator linkIter;
+		linkIter = std::find(group.m_links.begin(), group.m_links.end(), objId);
+		group.m_links.erase(linkIter);
+		return 0;
+	}
+
+	// The owner's entry in the hashes goes whether or not the group does
+	const uint64_t hash = group.m_hash;
+	std::multimap<uint64_t, cachedObjectId_t>::iterator hashIter;
+	hashIter = m_hashes.lower_bound(hash);
+	while ((hashIter != m_hashes.end()) && ((*hashIter).first == hash))
+	{
+		if ((*hashIter).second == owner)
+		{
+			m_hashes.erase(hashIter);
+			break;
+		}
+		++hashIter;
+	}
+
+	cachedObjectId_t newOwner = 0;
+	if (!group.m_links.empty())
+	{
+		newOwner = group.m_links.front();
+		CGroup &newGroup = m_groups[newOwner];
+		newGroup.m_hash = hash;
+		newGroup.m_links.assign(group.m_links.begin() + 1, group.m_links.end());
+		m_hashes.insert(std::make_pair(hash, newOwner));
+
+		std::vector<cachedObjectId_t>::const_iterator linkIter;
+		linkIter = newGroup.m_links.begin();
+		while (linkIter != newGroup.m_links.end())
+		{
+			m_owners[*linkIter] = newOwner;
+			++linkIter;
+		}
+		m_owners[newOwner] = newOwner;
+	}
+	m_groups.erase(owner);
+
+	return newOwner;
+}
+
+// Get the owners of the groups whose content has this hash
+void
+CDedupTable::Find(const uint64_t hash,
+                  std::vector<cachedObjectId_t> &owners) const
+{
+
+	std::multimap<uint64_t, cachedObjectId_t>::const_iterator iter;
+	iter = m_hashes.lower_bound(hash);
+	while ((iter != m_hashes.end()) && ((*iter).first == hash))
+	{
+		owners.push_back((*iter).second);
+		++iter;
+	}
+}
+
+// The owner of the group of an object, or 0 if it isn't in the table
+cachedObjectId_t
+CDedupTable::GetOwner(const cachedObjectId_t objId) const
+{
+
+	std::map<cachedObjectId_t, cachedObjectId_t>::const_iterator iter;
+	iter = m_owners.find(objId);
+
+	return (iter != m_owners.end()) ? (*iter).second : 0;
+}
+
+// The number of objects sharing the file of an object, including
+// itself, or 0 if it isn't in the table
+size_t
+CDedupTable::GetRefCount(const cachedObjectId_t objId) const
+{
+
+	const cachedObjectId_t owner = GetOwner(objId);
+	if (owner == 0)
+	{
+		return 0;
+	}
+	std::map<cachedObjectId_t, CGroup>::const_iterator iter = m_groups.find(owner);
+
+	return (*iter).second.m_links.size() + 1;
+}
+
+// Forget every object
+void
+CDedupTable::Clear()
+{
+
+	m_hashes.clear();
+	m_groups.clear();
+	m_owners.clear();
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __DEDUP_TABLE_H__
+#define __DEDUP_TABLE_H__
+
+#include "CacheBase.h"
+
+#include <map>
+
+// Tracks the written objects by the hash of their content and which of
+// them share one backing file.  The objects sharing a file form a
+// group, its owner is the object charged for the space and the others
+// are links charged nothing.  When the owner goes, the space is charged
+// to the oldest link, which becomes the owner.  Different content with
+// the same hash makes separate groups, so a hash can lead to several
+// owners.  The table only holds ids, the caller does the charging and
+// the linking.
+class CDedupTable
+{
+public:
+
+	// Add an object with content that isn't shared as the owner of a
+	// new group.  Returns false if the object is already in the table.
+	bool Add(const uint64_t hash, const cachedObjectId_t objId);
+
+	// Add an object whose file is now a link to the file of owner.
+	// Returns false if owner doesn't own a group or objId is already in
+	// the table.
+	bool Link(const cachedObjectId_t owner, const cachedObjectId_t objId);
+
+	// Remove an object.  If it owned a group with links, the oldest
+	// link becomes the owner and its id is returned, otherwise 0.
+	cachedObjectId_t Remove(const cachedObjectId_t objId);
+
+	// Get the owners of the groups whose content has this hash
+	void Find(const uint64_t hash, std::vector<cachedObjectId_t> &owners) const;
+
+	// The owner of the group of an object, or 0 if it isn't in the
+	// table
+	cachedObjectId_t GetOwner(const cachedObjectId_t objId) const;
+
+	// The number of objects sharing the file of an object, including
+	// itself, or 0 if it isn't in the table
+	size_t GetRefCount(const cachedObjectId_t objId) const;
+
+	// The number of objects in the table
+	size_t GetNumObjects() const
+	{
+		return m_owners.size();
+	}
+
+	// Forget every object
+	void Clear();
+
+private:
+
+	// The objects sharing one file, links oldest first
+	struct CGroup
+	{
+		uint64_t m_hash;
+		std::vector<cachedObjectId_t> m_links;
+	};
+
+	// The owner of each group by hash, and the group of each owner
+	std::multimap<uint64_t, cachedObjectId_t> m_hashes;
+	std::map<cachedObjectId_t, CGroup> m_groups;
+
+	// The owner of the group of every object in the table
+	std::map<cachedObjectId_t, cachedObjectId_t> m_owners;
+};
+
+#endif
@@ -0,0 +1,360 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "DirScanner.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+
+MojLogger CDirScanner::s_log(_T("filecache.dirscanner"));
+
+static ssize_t
+ReadXattr(const std::string &pathname, const char *name, void *value,
+          size_t size)
+{
+#ifdef MOJ_MAC
+	return ::getxattr(pathname.c_str(), name, value, size, 0, 0);
+#else
+	return ::getxattr(pathname.c_str(), name, value, size);
+#endif // #ifdef MOJ_MAC
+}
+
+// Read an extended attribute into a scanned attribute
+static void
+ReadAttribute(const std::string &pathname, const char *name,
+              CScannedAttribute &attr)
+{
+	char value[s_maxFilenameLength];
+	attr.m_size = ReadXattr(pathname, name, value, sizeof(value));
+	if (attr.m_size >= 0)
+	{
+		attr.m_errno = 0;
+		attr.m_value.assign(value, (size_t) attr.m_size);
+	}
+	else
+	{
+		attr.m_errno = errno;
+	}
+}
+
+// Copy size bytes of a value the way getxattr does
+static ssize_t
+CopyAttribute(const void *attr, size_t attrSize, void *value, size_t size)
+{
+	if (attrSize > size)
+	{
+		errno = ERANGE;
+		return -1;
+	}
+	::memcpy(value, attr, attrSize);
+
+	return (ssize_t) attrSize;
+}
+
+// Read the packed record of the entry or, for an object written by an
+// older version, each of its attributes.  A file shared by objects with
+// the same content has a record for each of them named by its id.
+void
+CScannedEntry::ReadAttributes()
+{
+
+	char value[s_maxObjectRecordSize];
+	ssize_t size = ReadXattr(m_pathname, s_objectAttrName, value, sizeof(value));
+	if ((size < 0) && (errno == ENODATA) && S_ISREG(m_stat.st_mode))
+	{
+		const cachedObjectId_t objId = GetObjectIdFromPath(m_pathname.c_str());
+		size = ReadXattr(m_pathname, GetLinkAttrName(objId).c_str(), value,
+		                 sizeof(value));
+	}
+	if (size >= 0)
+	{
+		// A damaged record leaves every attribute missing
+		m_packed = UnpackObjectRecord(value, (size_t) size, m_record);
+		if (!m_packed)
+		{
+			for (int i = 0; i < s_numScannedAttrs; i++)
+			{
+				m_attrs[i].m_errno = EINVAL;
+			}
+		}
+	}
+	else
+	{
+		for (int i = 0; i < s_numScannedAttrs; i++)
+		{
+			ReadAttribute(m_pathname, s_scannedAttrNames[i], m_attrs[i]);
+		}
+	}
+}
+
+// Copy the attribute into value with the same results as getxattr would
+// have for the separate attributes
+ssize_t
+CScannedEntry::GetAttribute(const char *name, void *value, size_t size) const
+{
+	if (m_packed)
+	{
+		if (::strcmp(name, "user.w") == 0)
+		{
+			int written = m_record.m_written ? 1 : 0;
+			return CopyAttribute(&written, sizeof(written), value, size);
+		}
+		if (::strcmp(name, "user.s") == 0)
+		{
+			return CopyAttribute(&m_record.m_size, sizeof(m_record.m_size),
+			                     value, size);
+		}
+		if (::strcmp(name, "user.f") == 0)
+		{
+			// The separate attribute included the terminating null
+			return CopyAttribute(m_record.m_filename.c_str(),
+			                     m_record.m_filename.length() + 1, value, size);
+		}
+		if (::strcmp(name, "user.c") == 0)
+		{
+			return CopyAttribute(&m_record.m_cost, sizeof(m_record.m_cost),
+			                     value, size);
+		}
+		if (::strcmp(name, "user.l") == 0)
+		{
+			return CopyAttribute(&m_record.m_lifetime,
+			                     sizeof(m_record.m_lifetime), value, size);
+		}
+	}
+
+	for (int i = 0; i < s_numScannedAttrs; i++)
+	{
+		if (::strcmp(name, s_scannedAttrNames[i]) == 0)
+		{
+			const CScannedAttribute &attr = m_attrs[i];
+			if (attr.m_size < 0)
+			{
+				errno = attr.m_errno;
+				return -1;
+			}
+			return CopyAttribute(attr.m_value.data(), attr.m_value.size(),
+			                     value, size);
+		}
+	}
+
+	errno = ENODATA;
+	return -1;
+}
+
+CDirScanner::CDirScanner(size_t numWorkers) : m_numWorkers(numWorkers)
+	, m_stopping(false)
+{
+
+	MojLogTrace(s_log);
+}
+
+// Stops the workers
+CDirScanner::~CDirScanner()
+{
+
+	MojLogTrace(s_log);
+
+	Stop();
+}
+
+// Start reading the directories in order
+void
+CDirScanner::Start(const std::set<std::string> &dirNames)
+{
+
+	MojLogTrace(s_log);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::set<std::string>::const_iterator iter = dirNames.begin();
+		while (iter != dirNames.end())
+		{
+			if (m_states.find(*iter) == m_states.end())
+			{
+				m_states[*iter] = QUEUED;
+				m_queue.push_back(*iter);
+			}
+			++iter;
+		}
+	}
+
+	while (m_workers.size() < m_numWorkers)
+	{
+		m_workers.push_back(std::thread(&CDirScanner::Worker, this));
+	}
+	MojLogInfo(s_log, _T("Start: Scanning %d directories with %d workers."),
+	           (int) dirNames.size(), (int) m_workers.size());
+}
+
+// Get the entries of a directory, waiting for the worker reading it or
+// reading it on this thread if no worker has started it yet.  Returns
+// false if the directory wasn't started or couldn't be read.
+bool
+CDirScanner::GetEntries(const std::string &dirName, scannedEntries_t &entries)
+{
+
+	MojLogTrace(s_log);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	std::map<std::string, ScanState>::iterator iter = m_states.find(dirName);
+	if (iter == m_states.end())
+	{
+		return false;
+	}
+
+	if ((*iter).second == QUEUED)
+	{
+		// The workers skip directories that are no longer queued
+		(*iter).second = SCANNING;
+		lock.unlock();
+		bool scanned = ScanDir(dirName, entries);
+		lock.lock();
+		m_states.erase(dirName);
+		m_cond.notify_all();
+		return scanned;
+	}
+
+	while ((*iter).second == SCANNING)
+	{
+		m_cond.wait(lock);
+	}
+
+	bool retVal = false;
+	if ((*iter).second == SCANNED)
+	{
+		entries.swap(m_results[dirName]);
+		m_results.erase(dirName);
+		retVal = true;
+	}
+	m_states.erase(iter);
+
+	// Let a worker waiting for room read ahead again
+	m_cond.notify_all();
+
+	return retVal;
+}
+
+// Read the entries of a directory and their attributes.  d_type is
+// used to tell directories apart so only the other entries are stat'd.
+bool
+CDirScanner::ScanDir(const std::string &dirName, scannedEntries_t &entries)
+{
+
+	DIR *dir = ::opendir(dirName.c_str());
+	if (dir == NULL)
+	{
+		return false;
+	}
+
+	int dirFd = ::dirfd(dir);
+	struct dirent *dirEntry;
+	while ((dirEntry = ::readdir(dir)) != NULL)
+	{
+		if ((::strcmp(dirEntry->d_name, ".") == 0) ||
+		        (::strcmp(dirEntry->d_name, "..") == 0))
+		{
+			continue;
+		}
+
+		entries.push_back(CScannedEntry());
+		CScannedEntry &entry = entries.back();
+		entry.m_pathname = dirName + "/" + dirEntry->d_name;
+		if (dirEntry->d_type == DT_DIR)
+		{
+			entry.m_stat.st_mode = S_IFDIR;
+		}
+		else if (::fstatat(dirFd, dirEntry->d_name, &entry.m_stat, 0) != 0)
+		{
+			entry.m_statErrno = errno;
+			continue;
+		}
+
+		entry.ReadAttributes();
+	}
+	::closedir(dir);
+
+	return true;
+}
+
+// Take queued directories in order and read them.  A worker stops
+// reading ahead while the main thread hasn't taken enough of the
+// results.
+void
+CDirScanner::Worker()
+{
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_stopping)
+	{
+		if (m_queue.empty())
+		{
+			break;
+		}
+		if (m_results.size() >= s_scanAheadPerWorker * m_numWorkers)
+		{
+			m_cond.wait(lock);
+			continue;
+		}
+
+		const std::string dirName(m_queue.front());
+		m_queue.pop_front();
+		std::map<std::string, ScanState>::iterator iter = m_states.find(dirName);
+		if ((iter == m_states.end()) || ((*iter).second != QUEUED))
+		{
+			continue;
+		}
+		(*iter).second = SCANNING;
+
+		lock.unlock();
+		scannedEntries_t entries;
+		bool scanned = ScanDir(dirName, entries);
+		lock.lock();
+
+		// The state may have been erased by Stop
+		iter = m_states.find(dirName);
+		if (iter != m_states.end())
+		{
+			(*iter).second = scanned ? SCANNED : FAILED;
+			if (scanned)
+			{
+				m_results[dirName].swap(entries);
+			}
+		}
+		m_cond.notify_all();
+	}
+}
+
+// Tell the workers to finish the directory they are reading and wait
+// for them.
+void
+CDirScanner::Stop()
+{
+
+	MojLogTrace(s_log);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+		m_queue.clear();
+		m_cond.notify_all();
+	}
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+}
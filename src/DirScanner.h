@@ -0,0 +1,131 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __DIR_SCANNER_H__
+#define __DIR_SCANNER_H__
+
+#include "CacheBase.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// The extended attributes ProcessFiles reads from each cache object
+// written by a version that didn't pack them into one record
+static const int s_numScannedAttrs = 5;
+static const char *const s_scannedAttrNames[s_numScannedAttrs] =
+{
+	"user.w", "user.s", "user.f", "user.c", "user.l"
+};
+
+// The number of scanned directories the workers may hold ahead of the
+// main thread for each worker.
+static const size_t s_scanAheadPerWorker = 4;
+
+// An extended attribute as it was read by the scanner
+struct CScannedAttribute
+{
+	CScannedAttribute() : m_size(-1), m_errno(ENODATA)
+	{
+	}
+
+	ssize_t m_size;
+	int m_errno;
+	std::string m_value;
+};
+
+// A directory entry and its attributes as they were read by the scanner
+struct CScannedEntry
+{
+	CScannedEntry() : m_statErrno(0)
+		, m_packed(false)
+	{
+		::memset(&m_stat, 0, sizeof(m_stat));
+	}
+
+	// Read the packed record of the entry or, for an object written by
+	// an older version, each of its attributes.
+	void ReadAttributes();
+
+	// Copy the attribute into value with the same results as getxattr
+	// would have for the separate attributes
+	ssize_t GetAttribute(const char *name, void *value, size_t size) const;
+
+	std::string m_pathname;
+	struct stat m_stat;
+	int m_statErrno;
+
+	// Set if the attributes were read from the packed record
+	bool m_packed;
+	CObjectRecord m_record;
+	CScannedAttribute m_attrs[s_numScannedAttrs];
+};
+
+typedef std::vector<CScannedEntry> scannedEntries_t;
+
+// The directory scanner reads the entries of the object directories
+// and their extended attributes on a pool of worker threads so the
+// reads are queued to the storage device in parallel.  It only reads,
+// the results are handed to the main thread which decides what to
+// keep, remove and insert into the cache.
+class CDirScanner
+{
+public:
+
+	CDirScanner(size_t numWorkers);
+
+	// Stops the workers
+	~CDirScanner();
+
+	// Start reading the directories in order
+	void Start(const std::set<std::string> &dirNames);
+
+	// Get the entries of a directory, waiting for the worker reading it
+	// or reading it on this thread if no worker has started it yet.
+	// Returns false if the directory wasn't started or couldn't be read.
+	bool GetEntries(const std::string &dirName, scannedEntries_t &entries);
+
+	// Read the entries of a directory and their attributes.  d_type is
+	// used to tell directories apart so only the other entries are
+	// stat'd.
+	static bool ScanDir(const std::string &dirName, scannedEntries_t &entries);
+
+private:
+
+	enum ScanState
+	{
+	    QUEUED = 0,
+	    SCANNING,
+	    SCANNED,
+	    FAILED
+	};
+
+	void Worker();
+	void Stop();
+
+	size_t m_numWorkers;
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::deque<std::string> m_queue;
+	std::map<std::string, ScanState> m_states;
+	std::map<std::string, scannedEntries_t> m_results;
+	bool m_stopping;
+	static MojLogger s_log;
+};
+
+#endif
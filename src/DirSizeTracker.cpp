@@ -0,0 +1,359 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "DirSizeTracker.h"
+
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+MojLogger CDirSizeTracker::s_log(_T("filecache.dirsizetracker"));
+
+// The events that can change the size of a tree
+static const uint32_t s_watchMask = IN_CREATE | IN_DELETE | IN_MODIFY |
+                                    IN_CLOSE_WRITE | IN_MOVED_FROM |
+                                    IN_MOVED_TO | IN_ONLYDIR;
+
+// The events that can change the size of a file object
+static const uint32_t s_fileWatchMask = IN_MODIFY | IN_CLOSE_WRITE;
+
+CDirSizeTracker::CDirSizeTracker()
+	: m_inotifyFd(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+
+	MojLogTrace(s_log);
+
+	if (m_inotifyFd < 0)
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("CDirSizeTracker: Failed to create inotify fd (%s)."),
+		            ::strerror(savedErrno));
+	}
+}
+
+// Removes the watches
+CDirSizeTracker::~CDirSizeTracker()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_inotifyFd >= 0)
+	{
+		// Closing the fd removes all of its watches
+		::close(m_inotifyFd);
+	}
+}
+
+// Start tracking the tree of an object, walking it once.  Returns false
+// if the tree can't be watched and the object isn't tracked.
+bool
+CDirSizeTracker::Track(const cachedObjectId_t objId,
+                       const std::string &pathname)
+{
+
+	MojLogTrace(s_log);
+
+	if (m_inotifyFd < 0)
+	{
+		return false;
+	}
+
+	Untrack(objId);
+	CTrackedObject &object = m_objects[objId];
+	object.m_pathname = pathname;
+
+	// A file is watched itself, a tree must at least have its top
+	// directory watched
+	bool retVal = false;
+	struct stat buf;
+	if ((::lstat(pathname.c_str(), &buf) == 0) && S_ISREG(buf.st_mode))
+	{
+		int wd = ::inotify_add_watch(m_inotifyFd, pathname.c_str(),
+		                             s_fileWatchMask);
+		if (wd >= 0)
+		{
+			CWatch &watch = m_watches[wd];
+			watch.m_objId = objId;
+			watch.m_dirname = pathname;
+			object.m_watches.insert(wd);
+			UpdateEntry(object, pathname);
+			retVal = true;
+		}
+	}
+	else
+	{
+		retVal = AddTree(objId, object, pathname) && !object.m_watches.empty();
+	}
+	if (retVal)
+	{
+		MojLogDebug(s_log, _T("Track: Tracking '%s', size = '%lld'."),
+		            pathname.c_str(), object.m_size);
+	}
+	else
+	{
+		MojLogWarning(s_log, _T("Track: Unable to track '%s'."), pathname.c_str());
+		Untrack(objId);
+	}
+
+	return retVal;
+}
+
+// Stop tracking an object
+void
+CDirSizeTracker::Untrack(const cachedObjectId_t objId)
+{
+
+	MojLogTrace(s_log);
+
+	std::map<cachedObjectId_t, CTrackedObject>::iterator iter;
+	iter = m_objects.find(objId);
+	if (iter != m_objects.end())
+	{
+		std::set<int>::const_iterator watchIter = (*iter).second.m_watches.begin();
+		while (watchIter != (*iter).second.m_watches.end())
+		{
+			(void) ::inotify_rm_watch(m_inotifyFd, *watchIter);
+			m_watches.erase(*watchIter);
+			++watchIter;
+		}
+		m_objects.erase(iter);
+	}
+}
+
+// The size of a tracked object, or -1 if it isn't tracked
+cacheSize_t
+CDirSizeTracker::GetSize(const cachedObjectId_t objId) const
+{
+
+	std::map<cachedObjectId_t, CTrackedObject>::const_iterator iter;
+	iter = m_objects.find(objId);
+
+	return (iter != m_objects.end()) ? (*iter).second.m_size : -1;
+}
+
+// Read the queued events and update the tracked sizes.  Every entry an
+// event names is stat'd again rather than trusting the event, so
+// events that arrive late or merged still leave the right size.  The
+// ids of the objects that changed are added to changed.
+void
+CDirSizeTracker::ProcessEvents(std::set<cachedObjectId_t> &changed)
+{
+
+	MojLogTrace(s_log);
+
+	if (m_inotifyFd < 0)
+	{
+		return;
+	}
+
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t length;
+	while ((length = ::read(m_inotifyFd, buf, sizeof(buf))) > 0)
+	{
+		ssize_t offset = 0;
+		while (offset < length)
+		{
+			const struct inotify_event *event =
+			    reinterpret_cast<const struct inotify_event *>(buf + offset);
+			offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				MojLogWarning(s_log, _T("ProcessEvents: Events lost, rescanning."));
+				Rescan();
+				std::map<cachedObjectId_t, CTrackedObject>::const_iterator iter;
+				iter = m_objects.begin();
+				while (iter != m_objects.end())
+				{
+					changed.insert((*iter).first);
+					++iter;
+				}
+				continue;
+			}
+
+			std::map<int, CWatch>::iterator watchIter = m_watches.find(event->wd);
+			if (watchIter == m_watches.end())
+			{
+				continue;
+			}
+			const cachedObjectId_t objId = (*watchIter).second.m_objId;
+			CTrackedObject &object = m_objects[objId];
+			if (event->mask & IN_IGNORED)
+			{
+				object.m_watches.erase(event->wd);
+				m_watches.erase(watchIter);
+				continue;
+			}
+
+			changed.insert(objId);
+			const std::string dirname((*watchIter).second.m_dirname);
+			std::string pathname(dirname);
+			if (event->len > 0)
+			{
+				pathname += "/";
+				pathname += event->name;
+			}
+			if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+			{
+				RemoveEntries(object, pathname);
+			}
+			else if ((event->mask & (IN_CREATE | IN_MOVED_TO)) &&
+			         (event->mask & IN_ISDIR))
+			{
+				if (!AddTree(objId, object, pathname))
+				{
+					MojLogWarning(s_log,
+					              _T("ProcessEvents: Unable to watch '%s', no longer tracking '%llu'."),
+					              pathname.c_str(), objId);
+					Untrack(objId);
+					continue;
+				}
+			}
+			else
+			{
+				UpdateEntry(object, pathname);
+			}
+
+			// A directory grows as entries are added to it
+			if (pathname != dirname)
+			{
+				UpdateEntry(object, dirname);
+			}
+		}
+	}
+}
+
+// Count an entry and, if it is a directory, everything below it,
+// watching each directory
+bool
+CDirSizeTracker::AddTree(const cachedObjectId_t objId, CTrackedObject &object,
+                         const std::string &pathname)
+{
+
+	struct stat buf;
+	if (::lstat(pathname.c_str(), &buf) != 0)
+	{
+		// It was removed again before we got to it
+		RemoveEntries(object, pathname);
+		return true;
+	}
+	if (!S_ISDIR(buf.st_mode))
+	{
+		UpdateEntry(object, pathname);
+		return true;
+	}
+
+	// Watch before reading so nothing created in between is missed
+	int wd = ::inotify_add_watch(m_inotifyFd, pathname.c_str(), s_watchMask);
+	if (wd < 0)
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("AddTree: Failed to watch '%s' (%s)."),
+		            pathname.c_str(), ::strerror(savedErrno));
+		return false;
+	}
+	CWatch &watch = m_watches[wd];
+	watch.m_objId = objId;
+	watch.m_dirname = pathname;
+	object.m_watches.insert(wd);
+	UpdateEntry(object, pathname);
+
+	bool retVal = true;
+	DIR *dir = ::opendir(pathname.c_str());
+	if (dir != NULL)
+	{
+		struct dirent *dirEntry;
+		while (retVal && ((dirEntry = ::readdir(dir)) != NULL))
+		{
+			if ((::strcmp(dirEntry->d_name, ".") != 0) &&
+			        (::strcmp(dirEntry->d_name, "..") != 0))
+			{
+				retVal = AddTree(objId, object, pathname + "/" + dirEntry->d_name);
+			}
+		}
+		::closedir(dir);
+	}
+
+	return retVal;
+}
+
+// Set the size counted for an entry from a fresh lstat, or remove it if
+// it is gone
+void
+CDirSizeTracker::UpdateEntry(CTrackedObject &object,
+                             const std::string &pathname)
+{
+
+	struct stat buf;
+	if (::lstat(pathname.c_str(), &buf) != 0)
+	{
+		RemoveEntries(object, pathname);
+		return;
+	}
+
+	const cacheSize_t size = GetFilesystemFileSize((cacheSize_t) buf.st_size);
+	cacheSize_t &entrySize = object.m_entries[pathname];
+	object.m_size += size - entrySize;
+	entrySize = size;
+}
+
+// Remove an entry and everything counted below it
+void
+CDirSizeTracker::RemoveEntries(CTrackedObject &object,
+                               const std::string &pathname)
+{
+
+	std::map<std::string, cacheSize_t>::iterator iter;
+	iter = object.m_entries.find(pathname);
+	if (iter != object.m_entries.end())
+	{
+		object.m_size -= (*iter).second;
+		object.m_entries.erase(iter);
+	}
+
+	// The entries below it sort together right after pathname + "/"
+	const std::string prefix(pathname + "/");
+	iter = object.m_entries.lower_bound(prefix);
+	while ((iter != object.m_entries.end()) &&
+	        ((*iter).first.compare(0, prefix.length(), prefix) == 0))
+	{
+		object.m_size -= (*iter).second;
+		object.m_entries.erase(iter++);
+	}
+}
+
+// Count every tracked tree again after events were lost
+void
+CDirSizeTracker::Rescan()
+{
+
+	std::vector<std::pair<cachedObjectId_t, std::string> > tracked;
+	std::map<cachedObjectId_t, CTrackedObject>::const_iterator iter;
+	iter = m_objects.begin();
+	while (iter != m_objects.end())
+	{
+		tracked.push_back(std::make_pair((*iter).first, (*iter).second.m_pathname));
+		++iter;
+	}
+
+	std::vector<std::pair<cachedObjectId_t, std::string> >::const_iterator
+	trackedIter = tracked.begin();
+	while (trackedIter != tracked.end())
+	{
+		(void) Track((*trackedIter).first, (*trackedIter).second);
+		++trackedIter;
+	}
+}
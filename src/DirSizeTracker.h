@@ -0,0 +1,102 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __DIR_SIZE_TRACKER_H__
+#define __DIR_SIZE_TRACKER_H__
+
+#include "CacheBase.h"
+
+#include <map>
+#include <set>
+
+// Keeps the size of objects being written up to date from inotify
+// events on their trees, so checking the size of one while it is being
+// written costs a lookup rather than a walk of the tree.  The tree of
+// a file object is just the file.  The size is counted the same way
+// SumDir counts it.  Everything runs on the main thread, ProcessEvents
+// is called whenever the inotify fd polls readable and reports the
+// objects whose size changed so only those are validated.
+class CDirSizeTracker
+{
+public:
+
+	CDirSizeTracker();
+
+	// Removes the watches
+	~CDirSizeTracker();
+
+	// Start tracking the tree of an object, walking it once.  Returns
+	// false if the tree can't be watched, for example when the inotify
+	// watch limit is reached, and the object isn't tracked.
+	bool Track(const cachedObjectId_t objId, const std::string &pathname);
+
+	// Stop tracking an object
+	void Untrack(const cachedObjectId_t objId);
+
+	// The size of a tracked object, or -1 if it isn't tracked
+	cacheSize_t GetSize(const cachedObjectId_t objId) const;
+
+	// Read the queued events and update the tracked sizes.  The ids of
+	// the objects that changed are added to changed.
+	void ProcessEvents(std::set<cachedObjectId_t> &changed);
+
+	// The number of objects being tracked
+	size_t GetNumTracked() const
+	{
+		return m_objects.size();
+	}
+
+	// The inotify fd, which polls readable while events are queued
+	int GetFd() const
+	{
+		return m_inotifyFd;
+	}
+
+private:
+
+	// The entries of a tracked tree and the size counted for each one
+	struct CTrackedObject
+	{
+		CTrackedObject() : m_size(0)
+		{
+		}
+
+		std::string m_pathname;
+		cacheSize_t m_size;
+		std::map<std::string, cacheSize_t> m_entries;
+		std::set<int> m_watches;
+	};
+
+	// A watched directory of a tracked tree
+	struct CWatch
+	{
+		cachedObjectId_t m_objId;
+		std::string m_dirname;
+	};
+
+	bool AddTree(const cachedObjectId_t objId, CTrackedObject &object,
+	             const std::string &pathname);
+	void UpdateEntry(CTrackedObject &object, const std::string &pathname);
+	void RemoveEntries(CTrackedObject &object, const std::string &pathname);
+	void Rescan();
+
+	int m_inotifyFd;
+	std::map<cachedObjectId_t, CTrackedObject> m_objects;
+	std::map<int, CWatch> m_watches;
+	static MojLogger s_log;
+};
+
+#endif
@@ -0,0 +1,366 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "EvictionPolicy.h"
+
+MojLogger CEvictionPolicy::s_log(_T("filecache.evictionpolicy"));
+
+// The 2Q lists an object can be on
+static const uint8_t s_newListId = 0;
+static const uint8_t s_hotListId = 1;
+
+// The new list is evicted first while it holds more than one in this
+// many of the objects
+static const size_t s_newListShare = 4;
+
+// Create the policy of a given name looking objects up in
+// cachedObjects.  Returns NULL if there is no such policy.
+CEvictionPolicy *
+CEvictionPolicy::Create(const std::string &name,
+                        CObjectIdTable &cachedObjects)
+{
+
+	MojLogTrace(s_log);
+
+	CEvictionPolicy *policy = NULL;
+	if (name == s_costPolicy)
+	{
+		policy = new CCostPolicy(cachedObjects);
+	}
+	else if (name == s_lruPolicy)
+	{
+		policy = new CLruPolicy(cachedObjects);
+	}
+	else if (name == s_2qPolicy)
+	{
+		policy = new C2QPolicy(cachedObjects);
+	}
+	else if (name == s_ttlPolicy)
+	{
+		policy = new CTtlPolicy(cachedObjects);
+	}
+	else
+	{
+		MojLogError(s_log, _T("Create: No eviction policy named '%s'."),
+		            name.c_str());
+	}
+
+	return policy;
+}
+
+// Returns true if name is the name of a policy
+bool
+CEvictionPolicy::isPolicy(const std::string &name)
+{
+
+	return ((name == s_costPolicy) || (name == s_lruPolicy) ||
+	        (name == s_2qPolicy) || (name == s_ttlPolicy));
+}
+
+// The victim at its cleanup cost as of the time now
+cachedObjectId_t
+CEvictionPolicy::GetCandidate(time_t now, paramValue_t *cost)
+{
+
+	MojLogTrace(s_log);
+
+	cachedObjectId_t objId = GetVictim(now);
+	if ((objId != 0) && (cost != NULL))
+	{
+		CCacheObject *cachedObject = m_cachedObjects.Find(objId);
+		*cost = (cachedObject != NULL) ? cachedObject->GetCacheCost(now) : 0;
+	}
+
+	return objId;
+}
+
+// New objects go on the front of the list
+void
+CLruPolicy::Insert(CCacheObject *cachedObject)
+{
+
+	m_cacheList.push_front(cachedObject->GetId());
+	cachedObject->SetCacheListPosition(m_cacheList.begin());
+}
+
+void
+CLruPolicy::Remove(CCacheObject *cachedObject)
+{
+
+	m_cacheList.erase(cachedObject->GetCacheListPosition());
+}
+
+// Move the object to the front of the list.  The object remembers its
+// own list position so this is a constant time splice rather than a
+// search of the list.
+void
+CLruPolicy::Update(CCacheObject *cachedObject, bool hit)
+{
+
+	m_cacheList.splice(m_cacheList.begin(), m_cacheList,
+	                   cachedObject->GetCacheListPosition());
+}
+
+// The object at the back of the list
+cachedObjectId_t
+CLruPolicy::GetVictim(time_t now)
+{
+
+	return m_cacheList.empty() ? 0 : m_cacheList.back();
+}
+
+void
+CCostPolicy::Insert(CCacheObject *cachedObject)
+{
+
+	CLruPolicy::Insert(cachedObject);
+	IndexObject(cachedObject);
+}
+
+void
+CCostPolicy::Remove(CCacheObject *cachedObject)
+{
+
+	CLruPolicy::Remove(cachedObject);
+	UnindexObject(cachedObject);
+}
+
+void
+CCostPolicy::Update(CCacheObject *cachedObject, bool hit)
+{
+
+	CLruPolicy::Update(cachedObject, hit);
+	UnindexObject(cachedObject);
+	IndexObject(cachedObject);
+}
+
+// Get the object with the lowest cleanup cost as of the time now.  The
+// index is only rescored once its costs are older than
+// s_evictionIndexInterval so repeated calls during a cleanup pass are
+// cheap.
+cachedObjectId_t
+CCostPolicy::GetCandidate(time_t now, paramValue_t *cost)
+{
+
+	MojLogTrace(s_log);
+
+	cachedObjectId_t objId = 0;
+	if (!m_evictionIndex.empty())
+	{
+		if ((now - m_evictionIndexTime) >= s_evictionIndexInterval)
+		{
+			RescoreEvictionIndex(now);
+		}
+		const CEvictionKey &key = *m_evictionIndex.begin();
+		objId = key.m_id;
+		if (cost != NULL)
+		{
+			*cost = key.m_cost;
+		}
+	}
+
+	return objId;
+}
+
+// Add an object to the index using its cost as of the time the index
+// was last scored.  An object accessed since then will score as within
+// its lifetime, which is the correct result.
+void
+CCostPolicy::IndexObject(CCacheObject *cachedObject)
+{
+
+	CEvictionKey key(cachedObject->GetCacheCost(m_evictionIndexTime),
+	                 cachedObject->GetLastAccessTime(), cachedObject->GetId());
+	m_evictionIndex.insert(key);
+	cachedObject->SetEvictionKey(key);
+}
+
+// Remove an object from the index
+void
+CCostPolicy::UnindexObject(CCacheObject *cachedObject)
+{
+
+	m_evictionIndex.erase(cachedObject->GetEvictionKey());
+}
+
+// Recompute the cost of every object on the cache list as of the time
+// now.
+void
+CCostPolicy::RescoreEvictionIndex(time_t now)
+{
+
+	MojLogTrace(s_log);
+
+	m_evictionIndex.clear();
+	m_evictionIndexTime = now;
+	CCacheObject::cacheList_t::const_iterator iter = m_cacheList.begin();
+	while (iter != m_cacheList.end())
+	{
+		CCacheObject *cachedObject = m_cachedObjects.Find(*iter);
+		if (cachedObject != NULL)
+		{
+			IndexObject(cachedObject);
+		}
+		++iter;
+	}
+	MojLogDebug(s_log, _T("RescoreEvictionIndex: Rescored '%zd' objects."),
+	            m_evictionIndex.size());
+}
+
+// New objects go on the front of the new list
+void
+C2QPolicy::Insert(CCacheObject *cachedObject)
+{
+
+	m_newList.push_front(cachedObject->GetId());
+	cachedObject->SetCacheListPosition(m_newList.begin(), s_newListId);
+}
+
+void
+C2QPolicy::Remove(CCacheObject *cachedObject)
+{
+
+	if (cachedObject->GetCacheListId() == s_hotListId)
+	{
+		m_hotList.erase(cachedObject->GetCacheListPosition());
+	}
+	else
+	{
+		m_newList.erase(cachedObject->GetCacheListPosition());
+	}
+}
+
+// A hot object moves to the front of the hot list, a new one only
+// when it is hit.  Other updates leave a new object where it is so the
+// new list stays in the order the objects were inserted.
+void
+C2QPolicy::Update(CCacheObject *cachedObject, bool hit)
+{
+
+	if (cachedObject->GetCacheListId() == s_hotListId)
+	{
+		m_hotList.splice(m_hotList.begin(), m_hotList,
+		                 cachedObject->GetCacheListPosition());
+	}
+	else if (hit)
+	{
+		m_hotList.splice(m_hotList.begin(), m_newList,
+		                 cachedObject->GetCacheListPosition());
+		cachedObject->SetCacheListPosition(m_hotList.begin(), s_hotListId);
+	}
+}
+
+// The oldest new object while the new list is over its share, or
+// there are no hot objects, otherwise the least recently used hot one
+cachedObjectId_t
+C2QPolicy::GetVictim(time_t now)
+{
+
+	cachedObjectId_t objId = 0;
+	const size_t numObjects = m_newList.size() + m_hotList.size();
+	if (!m_newList.empty() &&
+	        (m_hotList.empty() || (m_newList.size() * s_newListShare > numObjects)))
+	{
+		objId = m_newList.back();
+	}
+	else if (!m_hotList.empty())
+	{
+		objId = m_hotList.back();
+	}
+
+	return objId;
+}
+
+// The time an object's lifetime runs out
+CTtlPolicy::deadline_t
+CTtlPolicy::GetDeadline(CCacheObject *cachedObject)
+{
+
+	return deadline_t(cachedObject->GetCreationTime() +
+	                  (time_t) cachedObject->GetLifetime(),
+	                  cachedObject->GetId());
+}
+
+void
+CTtlPolicy::Insert(CCacheObject *cachedObject)
+{
+
+	m_deadlines.insert(GetDeadline(cachedObject));
+}
+
+void
+CTtlPolicy::Remove(CCacheObject *cachedObject)
+{
+
+	m_deadlines.erase(GetDeadline(cachedObject));
+}
+
+// Using an object doesn't extend its lifetime
+void
+CTtlPolicy::Update(CCacheObject *cachedObject, bool hit)
+{
+}
+
+// The object whose lifetime runs out first
+cachedObjectId_t
+CTtlPolicy::GetVictim(time_t now)
+{
+
+	return m_deadlines.empty() ? 0 : (*m_deadlines.begin()).second;
+}
+
+// An object whose lifetime has run out costs nothing to lose
+cachedObjectId_t
+CTtlPolicy::GetCandidate(time_t now, paramValue_t *cost)
+{
+
+	MojLogTrace(s_log);
+
+	cachedObjectId_t objId = 0;
+	if (!m_deadlines.empty())
+	{
+		const deadline_t &deadline = *m_deadlines.begin();
+		objId = deadline.second;
+		if (cost != NULL)
+		{
+			CCacheObject *cachedObject = m_cachedObjects.Find(objId);
+			*cost = ((deadline.first <= now) || (cachedObject == NULL)) ? 0 :
+			        cachedObject->GetCacheCost(now);
+		}
+	}
+
+	return objId;
+}
+
+// Add the unsubscribed objects whose lifetime has run out
+void
+CTtlPolicy::GetExpired(time_t now, std::vector<cachedObjectId_t> &expired)
+{
+
+	MojLogTrace(s_log);
+
+	std::set<deadline_t, std::less<deadline_t>, CSlabAllocator<deadline_t> >::const_iterator
+	iter = m_deadlines.begin();
+	while ((iter != m_deadlines.end()) && ((*iter).first <= now))
+	{
+		CCacheObject *cachedObject = m_cachedObjects.Find((*iter).second);
+		if ((cachedObject != NULL) && (cachedObject->GetSubscriptionCount() == 0))
+		{
+			expired.push_back((*iter).second);
+		}
+		++iter;
+	}
+}
@@ -0,0 +1,229 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __EVICTION_POLICY_H__
+#define __EVICTION_POLICY_H__
+
+#include "CacheObject.h"
+#include "ObjectIdTable.h"
+
+// The names the eviction policies are selected by
+static const std::string s_costPolicy("cost");
+static const std::string s_lruPolicy("lru");
+static const std::string s_2qPolicy("2q");
+static const std::string s_ttlPolicy("ttl");
+
+// The policy of a type that doesn't ask for one
+static const std::string s_defaultPolicy(s_costPolicy);
+
+// How long (in seconds) the costs in the cost index are trusted
+// before the index is rescored.
+static const time_t s_evictionIndexInterval = 10;
+
+// Decides which object a type evicts next.  Every object of the type
+// is entered in its policy when it is inserted and taken out when it
+// is expired, the policy is told whenever one is used.  The victim is
+// what a type over its hiWatermark evicts, the candidate is what the
+// set-wide cleanup takes from the type when the set runs out of space.
+// The candidates of the types are compared by their cost so the
+// cleanup takes from the type whose candidate is cheapest to lose.
+class CEvictionPolicy
+{
+public:
+
+	CEvictionPolicy(CObjectIdTable &cachedObjects)
+		: m_cachedObjects(cachedObjects)
+	{
+	}
+
+	virtual ~CEvictionPolicy()
+	{
+	}
+
+	// Create the policy of a given name looking objects up in
+	// cachedObjects.  Returns NULL if there is no such policy.
+	static CEvictionPolicy *Create(const std::string &name,
+	                               CObjectIdTable &cachedObjects);
+
+	// Returns true if name is the name of a policy
+	static bool isPolicy(const std::string &name);
+
+	virtual const std::string &GetName() const = 0;
+
+	// Enter an object so it can be evicted
+	virtual void Insert(CCacheObject *cachedObject) = 0;
+
+	// Take an object out, it is no longer evicted
+	virtual void Remove(CCacheObject *cachedObject) = 0;
+
+	// An object was used.  A hit is a subscribe or touch of an object
+	// that has been written, the other updates are the first write and
+	// resizes.
+	virtual void Update(CCacheObject *cachedObject, bool hit) = 0;
+
+	// The object to evict next, 0 if there is none
+	virtual cachedObjectId_t GetVictim(time_t now) = 0;
+
+	// The object the set-wide cleanup should take from the type as of
+	// the time now and its cost, 0 if there is none.  Unless a policy
+	// knows better this is the victim at its cleanup cost.
+	virtual cachedObjectId_t GetCandidate(time_t now, paramValue_t *cost);
+
+	// Add to expired the objects that have outlived their lifetime and
+	// are expired without waiting for the type to run out of space
+	virtual void GetExpired(time_t now, std::vector<cachedObjectId_t> &expired)
+	{
+	}
+
+protected:
+
+	CObjectIdTable &m_cachedObjects;
+	static MojLogger s_log;
+};
+
+// Evicts the least recently used object
+class CLruPolicy : public CEvictionPolicy
+{
+public:
+
+	CLruPolicy(CObjectIdTable &cachedObjects)
+		: CEvictionPolicy(cachedObjects)
+	{
+	}
+
+	const std::string &GetName() const
+	{
+		return s_lruPolicy;
+	}
+
+	void Insert(CCacheObject *cachedObject);
+	void Remove(CCacheObject *cachedObject);
+	void Update(CCacheObject *cachedObject, bool hit);
+	cachedObjectId_t GetVictim(time_t now);
+
+protected:
+
+	CCacheObject::cacheList_t m_cacheList;
+};
+
+// The policy types have always used.  A type over its hiWatermark
+// evicts its least recently used object, the set-wide cleanup takes
+// the object with the lowest cost, which is the cost of the object
+// times its size in pages divided by the time since it was used, and
+// which is never lower than the maximum inside the object's lifetime.
+class CCostPolicy : public CLruPolicy
+{
+public:
+
+	CCostPolicy(CObjectIdTable &cachedObjects)
+		: CLruPolicy(cachedObjects)
+		, m_evictionIndexTime(0)
+	{
+	}
+
+	const std::string &GetName() const
+	{
+		return s_costPolicy;
+	}
+
+	void Insert(CCacheObject *cachedObject);
+	void Remove(CCacheObject *cachedObject);
+	void Update(CCacheObject *cachedObject, bool hit);
+	cachedObjectId_t GetCandidate(time_t now, paramValue_t *cost);
+
+private:
+
+	void IndexObject(CCacheObject *cachedObject);
+	void UnindexObject(CCacheObject *cachedObject);
+	void RescoreEvictionIndex(time_t now);
+
+	// Every object on the cache list ordered by the cleanup cost it
+	// had at m_evictionIndexTime.
+	std::set<CEvictionKey, std::less<CEvictionKey>, CSlabAllocator<CEvictionKey> >
+	m_evictionIndex;
+	time_t m_evictionIndexTime;
+};
+
+// A scan resistant policy after 2Q.  New objects wait on a FIFO list,
+// only an object hit while it is there moves to the LRU list of hot
+// objects.  The new list is evicted first while it holds more than its
+// share of the objects, so a scan of objects used once, like a scroll
+// through a gallery, only pushes out other new objects and leaves the
+// hot ones.  The list of objects recently evicted from the new list
+// the original keeps isn't kept as an object inserted again is given
+// a new id.
+class C2QPolicy : public CEvictionPolicy
+{
+public:
+
+	C2QPolicy(CObjectIdTable &cachedObjects)
+		: CEvictionPolicy(cachedObjects)
+	{
+	}
+
+	const std::string &GetName() const
+	{
+		return s_2qPolicy;
+	}
+
+	void Insert(CCacheObject *cachedObject);
+	void Remove(CCacheObject *cachedObject);
+	void Update(CCacheObject *cachedObject, bool hit);
+	cachedObjectId_t GetVictim(time_t now);
+
+private:
+
+	CCacheObject::cacheList_t m_newList;
+	CCacheObject::cacheList_t m_hotList;
+};
+
+// Strict time to live.  An object is expired once its lifetime has
+// passed since it was inserted, or loaded after a restart, however
+// often it is used.  An object that is subscribed stays until it is
+// unsubscribed.  When the type runs out of space before then the
+// object closest to the end of its lifetime is evicted.
+class CTtlPolicy : public CEvictionPolicy
+{
+public:
+
+	CTtlPolicy(CObjectIdTable &cachedObjects)
+		: CEvictionPolicy(cachedObjects)
+	{
+	}
+
+	const std::string &GetName() const
+	{
+		return s_ttlPolicy;
+	}
+
+	void Insert(CCacheObject *cachedObject);
+	void Remove(CCacheObject *cachedObject);
+	void Update(CCacheObject *cachedObject, bool hit);
+	cachedObjectId_t GetVictim(time_t now);
+	cachedObjectId_t GetCandidate(time_t now, paramValue_t *cost);
+	void GetExpired(time_t now, std::vector<cachedObjectId_t> &expired);
+
+private:
+
+	typedef std::pair<time_t, cachedObjectId_t> deadline_t;
+
+	deadline_t GetDeadline(CCacheObject *cachedObject);
+
+	std::set<deadline_t, std::less<deadline_t>, CSlabAllocator<deadline_t> >
+	m_deadlines;
+};
+
+#endif
@@ -17,6 +17,9 @@
 #include "FileCache.h"
 #include "FileCacheSet.h"
 
+#include <algorithm>
+#include <functional>
+
 MojLogger CFileCache::s_log(_T("filecache.filecache"));
 
 // This constructor is used to create a new type or deserialize an
@@ -32,8 +35,13 @@ CFileCache::CFileCache(CFileCacheSet *cacheSet,
 	, m_defaultLifetime(1)
 	, m_defaultCost(0)
 	, m_dirType(false)
+	, m_compress(false)
+	, m_memory(false)
+	, m_policy(NULL)
 {
 	MojLogTrace(s_log);
+
+	m_policy = CEvictionPolicy::Create(s_defaultPolicy, m_cachedObjects);
 }
 
 CFileCache::~CFileCache()
@@ -47,6 +55,86 @@ CFileCache::~CFileCache()
 	// typename, the id and the filename
 	std::string pathname(GetFileCacheSet()->GetBaseDirName());
 	pathname += "/" + m_cacheType;
+
+	// The directory is removed after the objects of the type queued
+	// ahead of it
+	CIoWorkerPool *ioPool = GetFileCacheSet()->GetIoPool();
+	if (ioPool != NULL)
+	{
+		ioPool->Post(m_cacheType, [pathname, cleanable]()
+		{
+			RemoveTypeDir(pathname, cleanable);
+		});
+	}
+	else
+	{
+		RemoveTypeDir(pathname, cleanable);
+	}
+
+	// The memory objects of the type were unlinked as they were
+	// removed and the views with their last subscriptions, only the
+	// type's memory directory and the directories of its views can be
+	// left once the removals of the views queued ahead have run
+	const std::string &memoryDirName(GetFileCacheSet()->GetMemoryDirName());
+	if (!memoryDirName.empty())
+	{
+		const std::string typeDir(memoryDirName + "/" + m_cacheType);
+		if (ioPool != NULL)
+		{
+			ioPool->Post(m_cacheType, [typeDir]()
+			{
+				RemoveMemoryTypeDir(typeDir);
+			});
+		}
+		else
+		{
+			RemoveMemoryTypeDir(typeDir);
+		}
+	}
+
+	if (!cleanable)
+	{
+		MojLogWarning(s_log, _T("~CFileCache: '%s' has orphans."),
+		              m_cacheType.c_str());
+	}
+
+	// Take what is left of the type out of the set totals
+	GetFileCacheSet()->UpdateTotals(-m_cacheSize, -m_loWatermark);
+	delete m_policy;
+}
+
+// Change the space used by the type, keeping the set totals in step
+void
+CFileCache::AdjustCacheSize(const cacheSize_t delta)
+{
+
+	m_cacheSize += delta;
+	GetFileCacheSet()->UpdateTotals(delta, 0);
+}
+
+// Set the low watermark of the type, keeping the set totals in step
+void
+CFileCache::SetLoWatermark(const cacheSize_t loWatermark)
+{
+
+	GetFileCacheSet()->UpdateTotals(0, loWatermark - m_loWatermark);
+	m_loWatermark = loWatermark;
+}
+
+// Remove the config file and, if nothing was left behind in it, the
+// directory of a deleted type
+void
+CFileCache::RemoveTypeDir(const std::string &pathname, bool cleanable)
+{
+
+	// The objects of the type were reaped before this runs, anything
+	// left in the trash failed to be deleted once already
+	std::string msgText;
+	if (!ReapTrash(pathname + "/" + s_trashDirName, msgText))
+	{
+		MojLogError(s_log, _T("~CFileCache: %s"), msgText.c_str());
+	}
+
 	std::string configFile(pathname + "/Type.defaults");
 	if (::unlink(configFile.c_str()) != 0)
 	{
@@ -65,11 +153,18 @@ CFileCache::~CFileCache()
 			            pathname.c_str());
 		}
 	}
-	else
-	{
-		MojLogWarning(s_log, _T("~CFileCache: '%s' has orphans."),
-		              m_cacheType.c_str());
-	}
+}
+
+// Remove the memory directory of a type and the directories left by
+// its views
+void
+CFileCache::RemoveMemoryTypeDir(const std::string &typeDir)
+{
+
+	const std::string trashDir(typeDir + "/" + s_trashDirName);
+	(void) ::rmdir((trashDir + "/" + s_viewDirName).c_str());
+	(void) ::rmdir(trashDir.c_str());
+	(void) ::rmdir(typeDir.c_str());
 }
 
 // Configure the cache configuration items.  Returns false if it
@@ -88,6 +183,13 @@ CFileCache::Configure(CCacheParamValues *params, bool dirType)
 		            m_cacheType.c_str());
 		retVal = ReadConfig();
 	}
+	else if (!params->GetPolicy().empty() &&
+	         !CEvictionPolicy::isPolicy(params->GetPolicy()))
+	{
+		MojLogError(s_log,
+		            _T("Configure: FileCache '%s': Invalid eviction policy '%s'."),
+		            m_cacheType.c_str(), params->GetPolicy().c_str());
+	}
 	else
 	{
 		cacheSize_t availSpace = GetFileCacheSet()->TotalCacheSpace() -
@@ -96,41 +198,41 @@ CFileCache::Configure(CCacheParamValues *params, bool dirType)
 		{
 			if (params->GetLoWatermark() > 0)
 			{
-				m_loWatermark = GetFilesystemFileSize(params->GetLoWatermark());
+				SetLoWatermark(GetFilesystemFileSize(params->GetLoWatermark()));
 				MojLogDebug(s_log,
-				            _T("Configure: Configured '%s' low watermark to %d."),
+				            _T("Configure: Configured '%s' low watermark to %lld."),
 				            m_cacheType.c_str(), m_loWatermark);
 			}
 			else if (params->GetLoWatermark() < 0)
 			{
 				MojLogError(s_log,
-				            _T("Configure: FileCache '%s': Ignoring invalid value '%d' for low watermark."),
+				            _T("Configure: FileCache '%s': Ignoring invalid value '%lld' for low watermark."),
 				            m_cacheType.c_str(), params->GetLoWatermark());
 			}
 			if (params->GetHiWatermark() > 0)
 			{
 				m_hiWatermark = GetFilesystemFileSize(params->GetHiWatermark());
 				MojLogDebug(s_log,
-				            _T("Configure: Configured '%s' high watermark to %d."),
+				            _T("Configure: Configured '%s' high watermark to %lld."),
 				            m_cacheType.c_str(), m_hiWatermark);
 			}
 			else if (params->GetHiWatermark() < 0)
 			{
 				MojLogError(s_log,
-				            _T("Configure: FileCache '%s': Ignoring invalid value '%d' for high watermark."),
+				            _T("Configure: FileCache '%s': Ignoring invalid value '%lld' for high watermark."),
 				            m_cacheType.c_str(), params->GetHiWatermark());
 			}
 			if (params->GetSize() > 0)
 			{
 				m_defaultSize = params->GetSize();
 				MojLogDebug(s_log,
-				            _T("Configure: Configured '%s' size to %d."),
+				            _T("Configure: Configured '%s' size to %lld."),
 				            m_cacheType.c_str(), m_defaultSize);
 			}
 			else if (params->GetSize() < 0)
 			{
 				MojLogError(s_log,
-				            _T("Configure: FileCache '%s': Ignoring invalid value '%d' for default size."),
+				            _T("Configure: FileCache '%s': Ignoring invalid value '%lld' for default size."),
 				            m_cacheType.c_str(), params->GetSize());
 			}
 			if (params->GetLifetime() > 1)
@@ -147,6 +249,26 @@ CFileCache::Configure(CCacheParamValues *params, bool dirType)
 				            _T("Configure: Configured '%s' cost to %d."),
 				            m_cacheType.c_str(), m_defaultCost);
 			}
+			if (!params->GetPolicy().empty() && SetPolicy(params->GetPolicy()))
+			{
+				MojLogDebug(s_log,
+				            _T("Configure: Configured '%s' eviction policy to %s."),
+				            m_cacheType.c_str(), m_policy->GetName().c_str());
+			}
+			if (params->GetCompress() >= 0)
+			{
+				m_compress = (params->GetCompress() != 0);
+				MojLogDebug(s_log,
+				            _T("Configure: Configured '%s' compress to %d."),
+				            m_cacheType.c_str(), m_compress ? 1 : 0);
+			}
+			if (params->GetMemory() >= 0)
+			{
+				m_memory = (params->GetMemory() != 0);
+				MojLogDebug(s_log,
+				            _T("Configure: Configured '%s' memory to %d."),
+				            m_cacheType.c_str(), m_memory ? 1 : 0);
+			}
 			m_dirType = dirType;
 			retVal = WriteConfig();
 		}
@@ -161,6 +283,31 @@ CFileCache::Configure(CCacheParamValues *params, bool dirType)
 	return retVal;
 }
 
+// Restore a configuration saved in the cache index.  Like reading the
+// Type.defaults file, the values are trusted as they were validated
+// when the type was configured and nothing is written.
+void
+CFileCache::Restore(const CCacheParamValues &params, bool dirType)
+{
+
+	MojLogTrace(s_log);
+
+	SetLoWatermark(params.GetLoWatermark());
+	m_hiWatermark = params.GetHiWatermark();
+	m_defaultSize = params.GetSize();
+	m_defaultCost = params.GetCost();
+	m_defaultLifetime = params.GetLifetime();
+	if (!params.GetPolicy().empty())
+	{
+		(void) SetPolicy(params.GetPolicy());
+	}
+	m_compress = (params.GetCompress() > 0);
+	m_memory = (params.GetMemory() > 0);
+	m_dirType = dirType;
+	MojLogDebug(s_log, _T("Restore: Restored '%s' from the cache index."),
+	            m_cacheType.c_str());
+}
+
 // Returns all the configuration values in the parameter object and
 // returns the current space used in the cache.
 cacheSize_t
@@ -174,6 +321,9 @@ CFileCache::Describe(CCacheParamValues &params)
 	params.SetSize(m_defaultSize);
 	params.SetLifetime(m_defaultLifetime);
 	params.SetCost(m_defaultCost);
+	params.SetPolicy(m_policy->GetName());
+	params.SetCompress(m_compress ? 1 : 0);
+	params.SetMemory(m_memory ? 1 : 0);
 
 	return m_cacheSize;
 }
@@ -188,17 +338,17 @@ CFileCache::Insert(CCacheObject *newObj)
 	MojLogTrace(s_log);
 
 	cachedObjectId_t objId = newObj->GetId();
-	m_cachedObjects.insert(std::map < cachedObjectId_t,
-	                       CCacheObject * >::value_type(objId, newObj));
-	m_cacheList.push_front(objId);
+	m_cachedObjects.Insert(objId, newObj);
+	m_policy->Insert(newObj);
+	newObj->SetOnCacheList(true);
 	m_numObjects++;
-	m_cacheSize += GetFilesystemFileSize(newObj->GetSize());
+	AdjustCacheSize(newObj->GetChargedSize());
+	GetFileCacheSet()->JournalCacheObject(newObj);
 	MojLogInfo(s_log,
-	           _T("Insert: Id '%llu'. Cache size '%d', object count '%d'."),
+	           _T("Insert: Id '%llu'. Cache size '%lld', object count '%d'."),
 	           objId, m_cacheSize, m_numObjects);
-	MojLogDebug(s_log,
-	            _T("Insert: m_cachedObject.size() = '%zd', m_cacheList.size() = '%zd'."),
-	            m_cachedObjects.size(), m_cacheList.size());
+	MojLogDebug(s_log, _T("Insert: m_cachedObject.size() = '%zd'."),
+	            m_cachedObjects.size());
 
 	return (paramValue_t) m_cachedObjects.size();
 }
@@ -228,7 +378,7 @@ CFileCache::Resize(const cachedObjectId_t objId, cacheSize_t newSize)
 		if (!CheckForSize(neededSpace))
 		{
 			MojLogInfo(s_log,
-			           _T("Resize: Attempting to cleanup cache for '%d' bytes."),
+			           _T("Resize: Attempting to cleanup cache for '%lld' bytes."),
 			           neededSpace);
 			Cleanup(neededSpace);
 		}
@@ -237,10 +387,11 @@ CFileCache::Resize(const cachedObjectId_t objId, cacheSize_t newSize)
 			finalSize = cachedObject->Resize(newSize);
 			if (finalSize != origSize)
 			{
-				m_cacheSize += (GetFilesystemFileSize(finalSize) -
+				AdjustCacheSize(GetFilesystemFileSize(finalSize) -
 				                GetFilesystemFileSize(origSize));
-				UpdateObject(objId);
-				MojLogInfo(s_log, _T("Resize: Object '%llu' resized to '%d'."),
+				UpdateObject(cachedObject);
+				GetFileCacheSet()->JournalCacheObject(cachedObject);
+				MojLogInfo(s_log, _T("Resize: Object '%llu' resized to '%lld'."),
 				           objId, finalSize);
 			}
 			else
@@ -248,6 +399,7 @@ CFileCache::Resize(const cachedObjectId_t objId, cacheSize_t newSize)
 				MojLogInfo(s_log, _T("Resize: Object '%llu' not resized."),
 				           objId);
 			}
+			cachedObject->ReportStreamProgress();
 		}
 		else
 		{
@@ -266,7 +418,7 @@ CFileCache::Resize(const cachedObjectId_t objId, cacheSize_t newSize)
 
 // Expire an object in the cache.  This will cause the object to be
 // deleted.  CFileCacheSet should remove the cachedObjectId_t from it's
-// m_idMap.  This will return false if the requested item is
+// m_idTable.  This will return false if the requested item is
 // currently pinned in the cache by a subscription and the object
 // will be deleted once the subscription expires.
 bool
@@ -280,25 +432,16 @@ CFileCache::Expire(const cachedObjectId_t objId)
 	if (cachedObject != NULL)
 	{
 
-		cacheSize_t objSize = cachedObject->GetSize();
+		cacheSize_t chargedSize = cachedObject->GetChargedSize();
 
 		// Remove it from the cache list if it is still there
-		if (!cachedObject->isExpired())
+		if (cachedObject->isOnCacheList())
 		{
-			std::list<cachedObjectId_t>::iterator iter;
-			iter = m_cacheList.begin();
-			while (iter != m_cacheList.end())
-			{
-				if (*iter == objId)
-				{
-					m_cacheList.erase(iter);
-					MojLogDebug(s_log,
-					            _T("Expire: Object '%llu' removed from active cache list."),
-					            objId);
-					break;
-				}
-				++iter;
-			}
+			m_policy->Remove(cachedObject);
+			cachedObject->SetOnCacheList(false);
+			MojLogDebug(s_log,
+			            _T("Expire: Object '%llu' removed from active cache list."),
+			            objId);
 		}
 		// Now try to actually remove the object, this will return false
 		// if the object is still subscribed or if the unlink fails.  If
@@ -312,10 +455,13 @@ CFileCache::Expire(const cachedObjectId_t objId)
 			// object up on unsubscribe calls after an object was expired.
 			// This way we only remove the lookup reference once the expire
 			// call is successful.
-			m_cachedObjects.erase(objId);
+			m_cachedObjects.Erase(objId);
+			GetFileCacheSet()->RemoveObjectFromIdMap(objId);
 			m_numObjects--;
-			m_cacheSize -= GetFilesystemFileSize(objSize);
+			AdjustCacheSize(-chargedSize);
 			delete cachedObject;
+			GetFileCacheSet()->ReleaseContent(objId);
+			GetFileCacheSet()->JournalCacheObjectRemoved(objId);
 			MojLogWarning(s_log, _T("Expire: Object '%llu' removed from the cache."),
 			              objId);
 		}
@@ -323,6 +469,7 @@ CFileCache::Expire(const cachedObjectId_t objId)
 		{
 			MojLogInfo(s_log, _T("Expire: Object '%llu' expired but still in use."),
 			           objId);
+			QueueOrphan(objId);
 		}
 	}
 	else
@@ -336,9 +483,11 @@ CFileCache::Expire(const cachedObjectId_t objId)
 // Subscribing to an object is the means to pin an object in the
 // cache.  This means that for the duration of the subscription, the
 // object is guaranteed not to be deleted from the cache.  This is also
-// how you obtain the pathname to the cached object.
+// how you obtain the pathname to the cached object.  If stream points
+// to true, a reader can subscribe to an object still being written.
 const std::string
-CFileCache::Subscribe(std::string &msgText, const cachedObjectId_t objId)
+CFileCache::Subscribe(std::string &msgText, const cachedObjectId_t objId,
+                      bool *stream)
 {
 
 	MojLogTrace(s_log);
@@ -347,10 +496,16 @@ CFileCache::Subscribe(std::string &msgText, const cachedObjectId_t objId)
 	CCacheObject *cachedObject = GetCacheObjectForId(objId);
 	if (cachedObject != NULL)
 	{
-		retVal = cachedObject->Subscribe(msgText);
+		// The first subscription writes the object, only reading it
+		// again is a hit for the eviction policy
+		bool wasWritten = cachedObject->isWritten();
+		const cacheSize_t viewSize = cachedObject->GetViewSize();
+		retVal = cachedObject->Subscribe(msgText, stream);
+		AdjustCacheSize(cachedObject->GetViewSize() - viewSize);
 		if (!retVal.empty() && msgText.empty())
 		{
-			UpdateObject(objId);
+			m_metrics.m_subscribeHits.Add();
+			UpdateObject(cachedObject, wasWritten);
 			MojLogInfo(s_log,
 			           _T("Subscribe: Subscribed to object '%llu' at path '%s'."),
 			           objId, retVal.c_str());
@@ -367,9 +522,10 @@ CFileCache::Subscribe(std::string &msgText, const cachedObjectId_t objId)
 
 // Unsubscribing an object removes the pin of the object in the
 // cache.  This means that there is no longer any guarantee of available
-// of the object in the cache.
+// of the object in the cache.  stream says the subscription was a
+// streaming reader's.
 void
-CFileCache::UnSubscribe(const cachedObjectId_t objId)
+CFileCache::UnSubscribe(const cachedObjectId_t objId, const bool stream)
 {
 
 	MojLogTrace(s_log);
@@ -378,19 +534,37 @@ CFileCache::UnSubscribe(const cachedObjectId_t objId)
 	if (cachedObject != NULL)
 	{
 		cacheSize_t origSize = cachedObject->GetSize();
-		cachedObject->UnSubscribe();
+		bool wasWritten = cachedObject->isWritten();
+		const cacheSize_t viewSize = cachedObject->GetViewSize();
+		cachedObject->UnSubscribe(stream);
+		AdjustCacheSize(cachedObject->GetViewSize() - viewSize);
 		MojLogInfo(s_log,
 		           _T("UnSubscribe: UnSubscribed from object '%llu'."), objId);
 		cacheSize_t finalSize = cachedObject->GetSize();
 		if (finalSize != origSize)
 		{
-			m_cacheSize += (GetFilesystemFileSize(finalSize) -
+			AdjustCacheSize(GetFilesystemFileSize(finalSize) -
 			                GetFilesystemFileSize(origSize));
 			MojLogInfo(s_log,
-			           _T("UnSubscribe: Adjusting cache for new file size of '%d' bytes."),
+			           _T("UnSubscribe: Adjusting cache for new file size of '%lld' bytes."),
 			           finalSize);
 		}
-		UpdateObject(objId);
+		UpdateObject(cachedObject);
+		if ((finalSize != origSize) || (cachedObject->isWritten() != wasWritten))
+		{
+			GetFileCacheSet()->JournalCacheObject(cachedObject);
+		}
+		if (cachedObject->isWritten() && !wasWritten)
+		{
+			GetFileCacheSet()->CompressCacheObject(cachedObject);
+		}
+
+		// An object expired while it was subscribed can go now
+		if (cachedObject->isExpired() &&
+		        (cachedObject->GetSubscriptionCount() == 0))
+		{
+			QueueOrphan(objId);
+		}
 	}
 	else
 	{
@@ -399,6 +573,163 @@ CFileCache::UnSubscribe(const cachedObjectId_t objId)
 	}
 }
 
+// Finish the write of an unsubscribed object once its queued flush has
+// completed
+void
+CFileCache::SyncDone(const cachedObjectId_t objId, bool synced)
+{
+
+	MojLogTrace(s_log);
+
+	CCacheObject *cachedObject = GetCacheObjectForId(objId);
+	if (cachedObject != NULL)
+	{
+		bool wasWritten = cachedObject->isWritten();
+		cachedObject->SyncDone(synced);
+		MojLogInfo(s_log, _T("SyncDone: Object '%llu' is %s."), objId,
+		           cachedObject->isWritten() ? "written" : "expired");
+		if (cachedObject->isWritten() != wasWritten)
+		{
+			GetFileCacheSet()->JournalCacheObject(cachedObject);
+			GetFileCacheSet()->CompressCacheObject(cachedObject);
+		}
+	}
+	else
+	{
+		MojLogInfo(s_log, _T("SyncDone: Object '%llu' is no longer cached."),
+		           objId);
+	}
+}
+
+// Replace the file of a written object with a link to target, a file
+// with the same content, and stop charging the type for its space
+bool
+CFileCache::LinkObject(const cachedObjectId_t objId, const std::string &target)
+{
+
+	MojLogTrace(s_log);
+
+	CCacheObject *cachedObject = GetCacheObjectForId(objId);
+	if ((cachedObject == NULL) || cachedObject->isLinked())
+	{
+		return false;
+	}
+	const cacheSize_t size = cachedObject->GetChargedSize();
+	if (!cachedObject->LinkTo(target))
+	{
+		return false;
+	}
+	AdjustCacheSize(-size);
+	m_metrics.m_dedupLinks.Add();
+	m_metrics.m_bytesDeduped.Add((unsigned long long) size);
+	MojLogInfo(s_log, _T("LinkObject: Object '%llu' shares '%s', saved '%lld'."),
+	           objId, target.c_str(), size);
+
+	return true;
+}
+
+// Charge the type for the space of a linked object again, it's the
+// owner of the shared file now
+void
+CFileCache::ChargeObject(const cachedObjectId_t objId)
+{
+
+	MojLogTrace(s_log);
+
+	CCacheObject *cachedObject = GetCacheObjectForId(objId);
+	if ((cachedObject != NULL) && cachedObject->isLinked())
+	{
+		cachedObject->SetLinked(false);
+		AdjustCacheSize(cachedObject->GetChargedSize());
+		MojLogDebug(s_log, _T("ChargeObject: Object '%llu' now owns its file."),
+		            objId);
+	}
+}
+
+// Replace the file of a written object with its compressed content and
+// charge the type for the compressed size
+bool
+CFileCache::CompressObject(const cachedObjectId_t objId,
+                           const std::string &compressedPath,
+                           cacheSize_t storedSize)
+{
+
+	MojLogTrace(s_log);
+
+	CCacheObject *cachedObject = GetCacheObjectForId(objId);
+	if ((cachedObject == NULL) || cachedObject->isCompressed() ||
+	        cachedObject->isLinked())
+	{
+		(void) ::unlink(compressedPath.c_str());
+		return false;
+	}
+	const cacheSize_t origSize = cachedObject->GetChargedSize();
+	if (!cachedObject->Compress(compressedPath, storedSize))
+	{
+		return false;
+	}
+	const cacheSize_t saved = origSize - cachedObject->GetChargedSize();
+	AdjustCacheSize(-saved);
+	m_metrics.m_compressedObjects.Add();
+	m_metrics.m_bytesCompressed.Add((unsigned long long) saved);
+	GetFileCacheSet()->JournalCacheObject(cachedObject);
+	MojLogInfo(s_log, _T("CompressObject: Object '%llu' compressed, saved '%lld'."),
+	           objId, saved);
+
+	return true;
+}
+
+// Move a written memory object to the cache directory, replacing its
+// link with copyPath, a synced copy of its content.  Once out of memory
+// it can be compressed and shared like any other object.
+bool
+CFileCache::DemoteObject(const cachedObjectId_t objId,
+                         const std::string &copyPath)
+{
+
+	MojLogTrace(s_log);
+
+	CCacheObject *cachedObject = GetCacheObjectForId(objId);
+	if ((cachedObject == NULL) || !cachedObject->isInMemory())
+	{
+		(void) ::unlink(copyPath.c_str());
+		return false;
+	}
+	if (!cachedObject->Demote(copyPath))
+	{
+		return false;
+	}
+	m_metrics.m_memoryDemotions.Add();
+	GetFileCacheSet()->JournalCacheObject(cachedObject);
+	MojLogInfo(s_log, _T("DemoteObject: Object '%llu' moved out of memory."),
+	           objId);
+	GetFileCacheSet()->CompressCacheObject(cachedObject);
+
+	return true;
+}
+
+// Finish the view of a compressed object made on the I/O pool and
+// charge the type for it
+bool
+CFileCache::FinishView(const cachedObjectId_t objId, const bool made)
+{
+
+	MojLogTrace(s_log);
+
+	CCacheObject *cachedObject = GetCacheObjectForId(objId);
+	if (cachedObject == NULL)
+	{
+		return false;
+	}
+	const cacheSize_t viewSize = cachedObject->GetViewSize();
+	const bool open = cachedObject->FinishView(made);
+	AdjustCacheSize(cachedObject->GetViewSize() - viewSize);
+	MojLogDebug(s_log, _T("FinishView: View of object '%llu' %s."), objId,
+	            open ? "opened" : "not opened");
+
+	return open;
+}
+
 // This updates the access time without needing to subscribe, it's
 // like using touch on an existing file
 bool
@@ -412,7 +743,7 @@ CFileCache::Touch(const cachedObjectId_t objId)
 	if (cachedObject != NULL)
 	{
 		cachedObject->Touch();
-		UpdateObject(objId);
+		UpdateObject(cachedObject, cachedObject->isWritten());
 		MojLogInfo(s_log, _T("Touch: Updated access time for object '%llu'."),
 		           objId);
 		retVal = true;
@@ -426,7 +757,7 @@ CFileCache::Touch(const cachedObjectId_t objId)
 }
 
 // Get a vector containing pairs of all the objects in the cache and
-// their object IDs.
+// their object IDs, ordered by id.
 std::vector<std::pair<cachedObjectId_t, CCacheObject *>>
         CFileCache::GetCachedObjects()
 {
@@ -435,14 +766,16 @@ std::vector<std::pair<cachedObjectId_t, CCacheObject *>>
 
 	std::vector < std::pair < cachedObjectId_t,
 	    CCacheObject * > > objs(m_cachedObjects.size());
-	std::map<cachedObjectId_t, CCacheObject *>::iterator iter;
-	iter = m_cachedObjects.begin();
+	CObjectIdTable::const_iterator iter = m_cachedObjects.begin();
 	int i = 0;
 	while (iter != m_cachedObjects.end())
 	{
 		objs[i++] = std::make_pair((*iter).first, (*iter).second);
 		++iter;
 	}
+
+	// The id table isn't ordered, callers get the objects in id order
+	std::sort(objs.begin(), objs.end());
 	MojLogDebug(s_log, _T("GetCachedObjects: Found '%zd' objects."),
 	            m_cachedObjects.size());
 	MojLogDebug(s_log, _T("GetCachedObjects: Returned '%zd' objects."),
@@ -451,6 +784,38 @@ std::vector<std::pair<cachedObjectId_t, CCacheObject *>>
 	return objs;
 }
 
+// Add the ids of the numObjects most recently used written objects to
+// objIds, most recent first
+void
+CFileCache::GetRecentObjects(const size_t numObjects,
+                             std::vector<cachedObjectId_t> &objIds)
+{
+
+	MojLogTrace(s_log);
+
+	std::vector<std::pair<time_t, cachedObjectId_t> > recent;
+	CObjectIdTable::const_iterator iter = m_cachedObjects.begin();
+	while (iter != m_cachedObjects.end())
+	{
+		CCacheObject *cacheObject = (*iter).second;
+		if (cacheObject->isWritten() && !cacheObject->isExpired())
+		{
+			recent.push_back(std::make_pair(cacheObject->GetLastAccessTime(),
+			                                (*iter).first));
+		}
+		++iter;
+	}
+
+	const size_t count = std::min(numObjects, recent.size());
+	std::partial_sort(recent.begin(), recent.begin() + (long) count,
+	                  recent.end(),
+	                  std::greater<std::pair<time_t, cachedObjectId_t> >());
+	for (size_t i = 0; i < count; i++)
+	{
+		objIds.push_back(recent[i].second);
+	}
+}
+
 // Check if there is space in the cache for a new object of size
 bool
 CFileCache::CheckForSize(cacheSize_t size)
@@ -459,7 +824,8 @@ CFileCache::CheckForSize(cacheSize_t size)
 	MojLogTrace(s_log);
 
 	bool retVal = false;
-	cacheSize_t availSpace = GetFileCacheSet()->TotalCacheSpace() -
+	const cacheSize_t hiWatermark = GetEffectiveHiWatermark();
+	cacheSize_t availSpace = GetFileCacheSet()->EffectiveCacheSpace() -
 	                         GetFileCacheSet()->SumOfCacheSizes();
 
 	// This is part of the fix for NOV-128944.
@@ -469,9 +835,9 @@ CFileCache::CheckForSize(cacheSize_t size)
 	}
 
 	MojLogDebug(s_log,
-	            _T("CheckForSize: Free cache space '%d', free space '%d'."),
-	            (m_hiWatermark - m_cacheSize), availSpace);
-	if (((m_cacheSize + size) < m_hiWatermark) && (size <= availSpace))
+	            _T("CheckForSize: Free cache space '%lld', free space '%lld'."),
+	            (hiWatermark - m_cacheSize), availSpace);
+	if (((m_cacheSize + size) < hiWatermark) && (size <= availSpace))
 	{
 		retVal = true;
 	}
@@ -479,7 +845,18 @@ CFileCache::CheckForSize(cacheSize_t size)
 	return retVal;
 }
 
-// Cleanup an expirable object in the cache list. Return -1 if no more items in list.
+// The hiWatermark scaled with the space the cache set can take now,
+// never below the loWatermark
+cacheSize_t
+CFileCache::GetEffectiveHiWatermark()
+{
+
+	return std::max(m_loWatermark,
+	                GetFileCacheSet()->ScaleHiWatermark(m_hiWatermark));
+}
+
+// Cleanup the object the eviction policy picks. Return -1 if it has
+// no more objects.
 cacheSize_t
 CFileCache::CleanupCache(cachedObjectId_t *cleanedId)
 {
@@ -489,10 +866,16 @@ CFileCache::CleanupCache(cachedObjectId_t *cleanedId)
 	bool expired = false;
 	cachedObjectId_t objId = 0;
 	cacheSize_t size = -1;
-	while (!m_cacheList.empty() && !expired)
+	const time_t now = ::time(0);
+	while (!expired && ((objId = m_policy->GetVictim(now)) != 0))
 	{
-		objId = m_cacheList.back();
-		m_cacheList.pop_back();
+		CCacheObject *cachedObject = GetCacheObjectForId(objId);
+		if (cachedObject == NULL)
+		{
+			break;
+		}
+		m_policy->Remove(cachedObject);
+		cachedObject->SetOnCacheList(false);
 		size = GetObjectSize(objId); // size will always be >= 0
 		expired = GetFileCacheSet()->ExpireCacheObject(objId);
 	}
@@ -502,8 +885,10 @@ CFileCache::CleanupCache(cachedObjectId_t *cleanedId)
 		{
 			*cleanedId = objId;
 		}
+		m_metrics.m_localEvictions.Add();
+		m_metrics.m_bytesFreed.Add((unsigned long long) GetFilesystemFileSize(size));
 		MojLogInfo(s_log,
-		           _T("CleanupCache: Expired object '%llu', freed space '%d'."),
+		           _T("CleanupCache: Expired object '%llu', freed space '%lld'."),
 		           objId, size);
 
 		return size;
@@ -521,13 +906,14 @@ CFileCache::Cleanup(cacheSize_t size)
 
 	MojLogTrace(s_log);
 
-	if (size < m_hiWatermark)
+	const cacheSize_t hiWatermark = GetEffectiveHiWatermark();
+	if (size < hiWatermark)
 	{
-		while (((m_cacheSize + size) >= m_hiWatermark) &&
+		while (((m_cacheSize + size) >= hiWatermark) &&
 		        (CleanupCache(NULL) >= 0))
 		{
 		}
-		cacheSize_t availSpace = GetFileCacheSet()->TotalCacheSpace() -
+		cacheSize_t availSpace = GetFileCacheSet()->EffectiveCacheSpace() -
 		                         GetFileCacheSet()->SumOfCacheSizes();
 
 		// This is part of the fix for NOV-128944.
@@ -575,37 +961,102 @@ CFileCache::GetCleanupCandidate()
 	MojLogTrace(s_log);
 
 	cachedObjectId_t objId = 0;
-	if ((m_cacheSize > m_loWatermark) && !m_cacheList.empty())
+	if (m_cacheSize > m_loWatermark)
+	{
+		objId = m_policy->GetVictim(::time(0));
+	}
+
+	return objId;
+}
+
+// Get the object the eviction policy gives up when the set runs out of
+// space as of the time now.
+cachedObjectId_t
+CFileCache::GetCheapestCandidate(time_t now, paramValue_t *cost)
+{
+
+	MojLogTrace(s_log);
+
+	cachedObjectId_t objId = 0;
+	if (m_cacheSize > m_loWatermark)
 	{
-		objId = m_cacheList.back();
+		objId = m_policy->GetCandidate(now, cost);
 	}
 
 	return objId;
 }
 
-// Cleanup orphaned objects
+// Expire the objects the eviction policy says have outlived their
+// lifetime as of the time now.  They are counted as evicted by the
+// type.  Returns the number expired.
+paramValue_t
+CFileCache::ExpireStale(time_t now)
+{
+
+	MojLogTrace(s_log);
+
+	std::vector<cachedObjectId_t> stale;
+	m_policy->GetExpired(now, stale);
+	paramValue_t numExpired = 0;
+	std::vector<cachedObjectId_t>::const_iterator iter = stale.begin();
+	while (iter != stale.end())
+	{
+		cacheSize_t size = GetObjectSize(*iter);
+		if (GetFileCacheSet()->ExpireCacheObject(*iter))
+		{
+			m_metrics.m_localEvictions.Add();
+			m_metrics.m_bytesFreed.Add((unsigned long long) GetFilesystemFileSize(size));
+			numExpired++;
+		}
+		++iter;
+	}
+	if (numExpired > 0)
+	{
+		MojLogInfo(s_log, _T("ExpireStale: Expired '%d' objects in '%s'."),
+		           numExpired, m_cacheType.c_str());
+	}
+
+	return numExpired;
+}
+
+// Cleanup the orphaned objects that have been queued.  An object that
+// is still subscribed is queued again when it is unsubscribed, one
+// whose removal fails stays queued to be retried on the next call.
 void
 CFileCache::CleanupOrphanedObjects()
 {
 
 	MojLogTrace(s_log);
 
-	std::map<cachedObjectId_t, CCacheObject *>::const_iterator iter;
-	std::vector<cachedObjectId_t> cleanups;
-	iter = m_cachedObjects.begin();
-	while (iter != m_cachedObjects.end())
+	std::set<cachedObjectId_t> cleanups;
+	cleanups.swap(m_orphans);
+	std::set<cachedObjectId_t>::const_iterator iter = cleanups.begin();
+	while (iter != cleanups.end())
 	{
-		if ((*iter).second->isExpired())
+		CCacheObject *cachedObject = GetCacheObjectForId(*iter);
+		if ((cachedObject != NULL) && cachedObject->isExpired() &&
+		        (cachedObject->GetSubscriptionCount() == 0))
 		{
-			cleanups.push_back((*iter).first);
+			// Expire queues it again if it fails
+			Expire(*iter);
 		}
 		++iter;
 	}
-	while (!cleanups.empty())
+}
+
+// Queue an object that has been marked expired but couldn't be removed
+// yet to be cleaned up as an orphan
+void
+CFileCache::QueueOrphan(const cachedObjectId_t objId)
+{
+
+	MojLogTrace(s_log);
+
+	if (m_orphans.insert(objId).second)
 	{
-		cachedObjectId_t objId = cleanups.back();
-		Expire(objId);
-		cleanups.pop_back();
+		MojLogDebug(s_log, _T("QueueOrphan: Object '%llu' queued for cleanup."),
+		            objId);
+		GetFileCacheSet()->OrphanQueued();
 	}
 }
 
@@ -685,8 +1136,7 @@ CFileCache::isCleanable()
 	bool retVal = true;
 	if (!m_cachedObjects.empty())
 	{
-		std::map<cachedObjectId_t, CCacheObject *>::const_iterator iter;
-		iter = m_cachedObjects.begin();
+		CObjectIdTable::const_iterator iter = m_cachedObjects.begin();
 		while (iter != m_cachedObjects.end())
 		{
 			if ((*iter).second->GetSubscriptionCount() > 0)
@@ -711,21 +1161,15 @@ CFileCache::GetCacheObjectForId(const cachedObjectId_t objId)
 	            _T("GetCacheObjectForId: Searching '%zd' objects for object '%llu'."),
 	            m_cachedObjects.size(), objId);
 
-	CCacheObject *retVal = NULL;
-	std::map<cachedObjectId_t, CCacheObject *>::iterator iter;
-	iter = m_cachedObjects.find(objId);
-	if (iter != m_cachedObjects.end())
-	{
-		retVal = (*iter).second;
-	}
+	CCacheObject *retVal = m_cachedObjects.Find(objId);
 #ifdef DEBUG
-	else
+	if (retVal == NULL)
 	{
 		MojLogDebug(s_log,
 		            _T("GetCacheObjectForId: Failed to find object for id '%llu'."),
 		            objId);
 		int i = 0;
-		iter = m_cachedObjects.begin();
+		CObjectIdTable::const_iterator iter = m_cachedObjects.begin();
 		while (iter != m_cachedObjects.end())
 		{
 			MojLogDebug(s_log,
@@ -739,29 +1183,67 @@ CFileCache::GetCacheObjectForId(const cachedObjectId_t objId)
 	return retVal;
 }
 
-// Update the cache list so the specified object is at the front of
-// the list
+// Tell the eviction policy the object was used.  A hit is a read of an
+// object that has been written.
 void
-CFileCache::UpdateObject(const cachedObjectId_t objId)
+CFileCache::UpdateObject(CCacheObject *cachedObject, bool hit)
+{
+
+	MojLogTrace(s_log);
+
+	if (cachedObject->isOnCacheList())
+	{
+		m_policy->Update(cachedObject, hit);
+	}
+}
+
+// Switch to the eviction policy of a given name.  The objects enter
+// the new policy least recently used first so it starts out ordered
+// by when they were used.  Returns false, keeping the current policy,
+// if there is no such policy.
+bool
+CFileCache::SetPolicy(const std::string &name)
 {
 
 	MojLogTrace(s_log);
 
-	std::list<cachedObjectId_t>::iterator iter;
-	iter = m_cacheList.begin();
-	while (iter != m_cacheList.end())
+	if ((m_policy != NULL) && (m_policy->GetName() == name))
+	{
+		return true;
+	}
+	CEvictionPolicy *policy = CEvictionPolicy::Create(name, m_cachedObjects);
+	if (policy == NULL)
+	{
+		return false;
+	}
+
+	std::vector<CEvictionKey> keys;
+	CObjectIdTable::const_iterator iter = m_cachedObjects.begin();
+	while (iter != m_cachedObjects.end())
 	{
-		if (*iter == objId)
+		if ((*iter).second->isOnCacheList())
 		{
-			m_cacheList.erase(iter);
-			m_cacheList.push_front(objId);
-			break;
+			keys.push_back(CEvictionKey(0, (*iter).second->GetLastAccessTime(),
+			                            (*iter).first));
 		}
 		++iter;
 	}
+	std::sort(keys.begin(), keys.end());
+
+	delete m_policy;
+	m_policy = policy;
+	std::vector<CEvictionKey>::const_iterator keyIter = keys.begin();
+	while (keyIter != keys.end())
+	{
+		m_policy->Insert(m_cachedObjects.Find((*keyIter).m_id));
+		++keyIter;
+	}
+
+	return true;
 }
 
-// Validate a subscribed object.
+// Validate a subscribed object and tell its streaming readers how much
+// has been written.
 void
 CFileCache::CheckSubscribedObject(const cachedObjectId_t objId)
 {
@@ -777,6 +1259,7 @@ CFileCache::CheckSubscribedObject(const cachedObjectId_t objId)
 		if (!cachedObject->isWritten())
 		{
 			cachedObject->Validate();
+			cachedObject->ReportStreamProgress();
 		}
 	}
 	else
@@ -794,9 +1277,8 @@ CFileCache::CleanupDirType()
 
 	MojLogTrace(s_log);
 
-	std::map<cachedObjectId_t, CCacheObject *>::const_iterator iter;
 	std::vector<cachedObjectId_t> cleanups;
-	iter = m_cachedObjects.begin();
+	CObjectIdTable::const_iterator iter = m_cachedObjects.begin();
 	while (iter != m_cachedObjects.end())
 	{
 		if ((*iter).second->GetSubscriptionCount() == 0)
@@ -815,7 +1297,7 @@ CFileCache::CleanupDirType()
 		cachedObjectId_t objId = cleanups.back();
 		MojLogDebug(s_log, _T("CleanupDirType: Cleaning object '%llu'."), objId);
 		bool expired = false;
-		if (m_cachedObjects[objId]->isExpired())
+		if (m_cachedObjects.Find(objId)->isExpired())
 		{
 			expired = Expire(objId);
 		}
@@ -872,6 +1354,9 @@ CFileCache::WriteConfig()
 			outfile << s_defaultCost << " " << m_defaultCost << std::endl;
 			outfile << s_defaultLifetime << " " << m_defaultLifetime << std::endl;
 			outfile << s_dirType << " " << (m_dirType ? 1 : 0) << std::endl;
+			outfile << s_evictionPolicy << " " << m_policy->GetName() << std::endl;
+			outfile << s_compress << " " << (m_compress ? 1 : 0) << std::endl;
+			outfile << s_memory << " " << (m_memory ? 1 : 0) << std::endl;
 			outfile.close();
 			bool writeOK = outfile.good();
 			if (writeOK)
@@ -941,15 +1426,22 @@ CFileCache::ReadConfig()
 		           _T("ReadConfig: Reading configuration from file '%s'."),
 		           pathname.c_str());
 		std::string label;
-		paramValue_t value;
+		cacheSize_t value;
 		std::set<std::string> labels;
 
 		while ((infile >> label).good())
 		{
+			if (label == s_evictionPolicy)
+			{
+				std::string policy;
+				infile >> policy;
+				(void) SetPolicy(policy);
+				continue;
+			}
 			infile >> value;
 			if (label == s_loWatermark)
 			{
-				m_loWatermark = value;
+				SetLoWatermark(value);
 				labels.insert(s_loWatermark);
 			}
 			else if (label == s_hiWatermark)
@@ -964,12 +1456,12 @@ CFileCache::ReadConfig()
 			}
 			else if (label == s_defaultCost)
 			{
-				m_defaultCost = value;
+				m_defaultCost = (paramValue_t) value;
 				labels.insert(s_defaultCost);
 			}
 			else if (label == s_defaultLifetime)
 			{
-				m_defaultLifetime = value;
+				m_defaultLifetime = (paramValue_t) value;
 				labels.insert(s_defaultLifetime);
 			}
 			else if (label == s_dirType)
@@ -984,6 +1476,14 @@ CFileCache::ReadConfig()
 				}
 				labels.insert(s_dirType);
 			}
+			else if (label == s_compress)
+			{
+				m_compress = (value != 0);
+			}
+			else if (label == s_memory)
+			{
+				m_memory = (value != 0);
+			}
 		}
 		infile.close();
 
@@ -19,6 +19,9 @@
 
 #include "CacheBase.h"
 #include "CacheObject.h"
+#include "EvictionPolicy.h"
+#include "ObjectIdTable.h"
+#include "Metrics.h"
 
 class CFileCacheSet;
 
@@ -30,6 +33,17 @@ static const std::string s_defaultCost("defaultCost");
 static const std::string s_dirType("dirType");
 static const uint32_t s_numLabels = 6;
 
+// The eviction policy isn't counted in s_numLabels, a Type.defaults
+// written before there were policies gets the default one
+static const std::string s_evictionPolicy("evictionPolicy");
+
+// Neither is whether written objects are compressed, which is off in a
+// Type.defaults written before there was compression
+static const std::string s_compress("compress");
+
+// Or whether the objects of the type are kept in memory
+static const std::string s_memory("memory");
+
 class CFileCache
 {
 public:
@@ -44,6 +58,11 @@ public:
 	// and continues to use the last configuration if one is available.
 	bool Configure(CCacheParamValues *params = NULL, bool dirType = false);
 
+	// Restore a configuration saved in the cache index.  Like reading
+	// the Type.defaults file, the values are trusted as they were
+	// validated when the type was configured and nothing is written.
+	void Restore(const CCacheParamValues &params, bool dirType);
+
 	// Returns all the configuration values in the parameter object and returns
 	// the current space used in the cache.
 	cacheSize_t Describe(CCacheParamValues &params);
@@ -68,7 +87,7 @@ public:
 
 	// Expire an object in the cache.  This will cause the object to be
 	// deleted.  CFileCacheSet should remove the cachedObjectId_t from it's
-	// m_idMap.  This will return false if the requested item is
+	// m_idTable.  This will return false if the requested item is
 	// currently pinned in the cache by a subscription and the object
 	// will be deleted once the subscription expires.
 	bool Expire(const cachedObjectId_t objId);
@@ -76,34 +95,102 @@ public:
 	// Subscribing to an object is the means to pin an object in the
 	// cache.  This means that for the duration of the subscription, the
 	// object is guaranteed not to be deleted from the cache.  This is also
-	// how you obtain the pathname to the cached object.
-	const std::string Subscribe(std::string &msgText, const cachedObjectId_t objId);
+	// how you obtain the pathname to the cached object.  If stream
+	// points to true, a reader can subscribe to an object still being
+	// written and stream is left true only if it did.
+	const std::string Subscribe(std::string &msgText, const cachedObjectId_t objId,
+	                            bool *stream = NULL);
 
 	// Unsubscribing an object removes the pin of the object in the
 	// cache.  This means that there is no longer any guarantee of available
-	// of the object in the cache.
-	void UnSubscribe(const cachedObjectId_t objId);
+	// of the object in the cache.  stream says the subscription was a
+	// streaming reader's.
+	void UnSubscribe(const cachedObjectId_t objId, const bool stream = false);
+
+	// Finish the write of an unsubscribed object once its queued flush
+	// has completed
+	void SyncDone(const cachedObjectId_t objId, bool synced);
+
+	// Replace the file of a written object with a hard link to target,
+	// a file with the same content, and stop charging the type for its
+	// space.  Returns false, leaving the object as it was, if it can't
+	// be linked.
+	bool LinkObject(const cachedObjectId_t objId, const std::string &target);
+
+	// Charge the type for the space of a linked object again, called
+	// when the object charged for the shared file is removed
+	void ChargeObject(const cachedObjectId_t objId);
+
+	// Replace the file of a written object with compressedPath, its
+	// content compressed into storedSize bytes, and charge the type for
+	// the compressed size.  Returns false, removing compressedPath and
+	// leaving the object as it was, if it can't be replaced.
+	bool CompressObject(const cachedObjectId_t objId,
+	                    const std::string &compressedPath,
+	                    cacheSize_t storedSize);
+
+	// Move a written memory object to the cache directory, replacing
+	// its link with copyPath, a synced copy of its content.  Returns
+	// false, removing copyPath and leaving the object in memory, if it
+	// can't be moved.
+	bool DemoteObject(const cachedObjectId_t objId, const std::string &copyPath);
+
+	// Finish the view of a compressed object made on the I/O pool, made
+	// says if it was, and charge the type for it while it's open.
+	// Returns true if the view is open for the subscribers.
+	bool FinishView(const cachedObjectId_t objId, const bool made);
 
 	// This updates the access time without needing to subscribe, it's
 	// like using touch on an existing file
 	bool Touch(const cachedObjectId_t objId);
 
 	// Get a vector containing pairs of all the objects in the cache and
-	// their object IDs.
+	// their object IDs, ordered by id.
 	std::vector<std::pair<cachedObjectId_t, CCacheObject *>> GetCachedObjects();
 
+	// Add the ids of the numObjects most recently used written objects
+	// to objIds, most recent first.  The access times are saved with
+	// the cache so the order holds across restarts.
+	void GetRecentObjects(const size_t numObjects,
+	                      std::vector<cachedObjectId_t> &objIds);
+
 	// Check if there is space in the cache for a new object of size
 	bool CheckForSize(cacheSize_t size);
 
 	// Cleanup this cache
 	void Cleanup(cacheSize_t size);
 
-	// Cleanup orphaned objects
+	// The hiWatermark space is checked and cleaned up against, scaled
+	// with the space the cache set can take now
+	cacheSize_t GetEffectiveHiWatermark();
+
+	// Cleanup the orphaned objects that have been queued.  An object
+	// whose removal fails stays queued to be retried on the next call.
 	void CleanupOrphanedObjects();
 
+	// Queue an object that has been marked expired but couldn't be
+	// removed yet to be cleaned up as an orphan
+	void QueueOrphan(const cachedObjectId_t objId);
+
+	// The number of orphaned objects waiting to be cleaned up
+	size_t GetNumOrphans() const
+	{
+		return m_orphans.size();
+	}
+
 	// Get the best object from this cache for cleanup
 	cachedObjectId_t GetCleanupCandidate();
 
+	// Get the object the eviction policy gives up when the set runs
+	// out of space as of the time now, returning its cost in cost.
+	// Like GetCleanupCandidate this returns 0 if the cache is at or
+	// below its loWatermark.
+	cachedObjectId_t GetCheapestCandidate(time_t now, paramValue_t *cost);
+
+	// Expire the objects the eviction policy says have outlived their
+	// lifetime as of the time now.  Returns the number expired.
+	paramValue_t ExpireStale(time_t now);
+
 	// Return information about the current state of the cache.  The
 	// total space used by the cache as well as the number of cached
 	// objects are returned in the parameters.  The typename of the
@@ -114,11 +201,17 @@ public:
 	// This returns the space used by a cached object.
 	cacheSize_t GetObjectSize(const cachedObjectId_t objId);
 
+	// Returns true if the object is in this cache, even if expired
+	bool isCachedObject(const cachedObjectId_t objId)
+	{
+		return (m_cachedObjects.Find(objId) != NULL);
+	}
+
 	// This returns the filename of a cached object
 	const std::string GetObjectFilename(const cachedObjectId_t objId);
 
 	// This returns the file cache type string
-	const std::string GetType()
+	const std::string &GetType()
 	{
 		return m_cacheType;
 	}
@@ -138,20 +231,52 @@ public:
 		return m_cacheSize;
 	}
 
+	// Return the low watermark of the cache
+	cacheSize_t GetLoWatermark() const
+	{
+		return m_loWatermark;
+	}
+
 	// Return the number of objects in the cache
 	paramValue_t GetNumObjects()
 	{
 		return m_numObjects;
 	}
 
-	// Cleans up the least recently used unsubscribed object
+	// The name of the eviction policy
+	const std::string &GetPolicyName() const
+	{
+		return m_policy->GetName();
+	}
+
+	// Whether the objects of the type are compressed once written
+	bool isCompressed() const
+	{
+		return m_compress;
+	}
+
+	// Whether the objects of the type are kept in memory when the file
+	// cache set has room for them
+	bool isMemory() const
+	{
+		return m_memory;
+	}
+
+	// The counters reported by GetMetrics
+	CCacheMetrics &GetMetrics()
+	{
+		return m_metrics;
+	}
+
+	// Cleans up the object the eviction policy picks
 	cacheSize_t CleanupCache(cachedObjectId_t *cleanedId);
 
 	// Returns whether true if none of the cached objects are
 	// subscribed, the cache can be cleanly delete
 	bool isCleanable();
 
-	// Validate a subscribed object.
+	// Validate a subscribed object and tell its streaming readers how
+	// much has been written.
 	void CheckSubscribedObject(const cachedObjectId_t objId);
 
 	// Return if this type is a dirType
@@ -166,24 +291,36 @@ public:
 private:
 
 	CCacheObject *GetCacheObjectForId(const cachedObjectId_t id);
-	void UpdateObject(const cachedObjectId_t objId);
+	void UpdateObject(CCacheObject *cachedObject, bool hit = false);
+	bool SetPolicy(const std::string &name);
+	void AdjustCacheSize(const cacheSize_t delta);
+	void SetLoWatermark(const cacheSize_t loWatermark);
 	bool WriteConfig();
 	bool ReadConfig();
+	static void RemoveTypeDir(const std::string &pathname, bool cleanable);
+	static void RemoveMemoryTypeDir(const std::string &typeDir);
 
 	CFileCacheSet *m_fileCacheSet;
 	std::string m_cacheType;
 
 	paramValue_t m_numObjects;
 	cacheSize_t m_cacheSize;
-	paramValue_t m_loWatermark;
-	paramValue_t m_hiWatermark;
+	cacheSize_t m_loWatermark;
+	cacheSize_t m_hiWatermark;
 	cacheSize_t m_defaultSize;
 	paramValue_t m_defaultLifetime;
 	paramValue_t m_defaultCost;
 	bool m_dirType;
+	bool m_compress;
+	bool m_memory;
+
+	CObjectIdTable m_cachedObjects;
 
-	std::map<cachedObjectId_t, CCacheObject *> m_cachedObjects;
-	std::list<cachedObjectId_t> m_cacheList;
+	// The objects marked expired that are waiting to be removed, so
+	// cleaning up orphans doesn't look at every object
+	std::set<cachedObjectId_t> m_orphans;
+	CEvictionPolicy *m_policy;
+	CCacheMetrics m_metrics;
 	static MojLogger s_log;
 };
 
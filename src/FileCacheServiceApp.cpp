@@ -45,6 +45,17 @@ void handle_idle_timeout_cb(void *userData)
 	}
 }
 
+gboolean reconcile_idle_cb(gpointer userData)
+{
+	// Walk one directory at a time so requests are answered between them
+	CFileCacheSet* fileCacheSet = static_cast<CFileCacheSet*>(userData);
+	if(fileCacheSet && fileCacheSet->ContinueWalkDirTree())
+	{
+		return TRUE;
+	}
+	return FALSE;
+}
+
 void create_default_cachedir()
 {
 	//Creating default directory if not exists
@@ -76,19 +87,24 @@ ServiceApp::ServiceApp() : m_service()
 	//  MojLogEngine::instance()->reset(MojLogger::LevelTrace);
 
 	// When creating the service app, walk the directory tree and build
-	// the cache data structures for objects already cached.
+	// the cache data structures for objects already cached.  A lazy
+	// walk is finished from the main loop once the service is open.
 	m_fileCacheSet = new CFileCacheSet;
-	m_fileCacheSet->WalkDirTree();
+	m_fileCacheSet->WalkDirTree(m_fileCacheSet->isLazyStartup());
 
 	// This is part of the fix for NOV-128944.
-	m_fileCacheSet->CleanupAtStartup();
+	if (m_fileCacheSet->isWalkComplete())
+	{
+		m_fileCacheSet->CleanupAtStartup();
+	}
 }
 
 void ServiceApp::powerdown()
 {
 	MojErr err = MojErrNone;
 
-	if(!(m_fileCacheSet->GetCacheSize() || m_handler.get()->GetSubscriberCount()))
+	if(m_fileCacheSet->isWalkComplete() &&
+	   !(m_fileCacheSet->GetCacheSize() || m_handler.get()->GetSubscriberCount()))
 	{
 		Base::shutdown();
 	}
@@ -103,6 +119,15 @@ MojErr ServiceApp::close()
 	MojErrAccumulate(err, errClose);
 	if(m_fileCacheSet)
 	{
+		// Both the idle powerdown and a terminating signal end up here,
+		// save a clean index so the next start doesn't walk the tree.
+		// Objects waiting to be flushed are finished first so they are
+		// saved as written, then the queued removals.  The queued
+		// requests are answered first so nothing changes under them.
+		m_fileCacheSet->StopReadPool();
+		m_fileCacheSet->StopSyncQueue();
+		m_fileCacheSet->StopIoPool();
+		m_fileCacheSet->WriteCacheIndex(true);
 		free(m_fileCacheSet);
 	}
 	return err;
@@ -132,6 +157,11 @@ MojErr ServiceApp::open()
 	                            m_handler.get());
 	MojErrCheck(err);
 
+	if (!m_fileCacheSet->isWalkComplete())
+	{
+		g_idle_add(reconcile_idle_cb, m_fileCacheSet);
+	}
+
 	LSError error;
 	LSErrorInit(&error);
 
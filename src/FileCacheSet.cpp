@@ -16,7 +16,11 @@
 
 #include "FileCacheSet.h"
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <queue>
 #include <time.h>
 #include <sys/time.h>
 
@@ -26,6 +30,39 @@ namespace fs = boost::filesystem;
 MojLogger CFileCacheSet::s_log(_T("filecache.filecacheset"));
 
 CFileCacheSet::CFileCacheSet(bool init) : m_totalCacheSpace(0)
+	, m_minCacheSpace(0)
+	, m_maxCacheSpace(0)
+	, m_reservedFreeSpace(s_defaultReservedFreeSpace)
+	, m_effectiveCacheSpace(0)
+	, m_sumOfCacheSizes(0)
+	, m_sumOfLoWatermarks(0)
+	, m_cacheIndex(NULL)
+	, m_walkInProgress(false)
+	, m_walkFailed(false)
+	, m_lazyStartup(false)
+	, m_scanThreads(1)
+	, m_maxCopies(s_defaultMaxCopies)
+	, m_syncDelay(s_defaultSyncDelay)
+	, m_syncQueue(NULL)
+	, m_ioThreads(s_defaultIoThreads)
+	, m_ioPool(NULL)
+	, m_readThreads(s_defaultReadThreads)
+	, m_readPool(NULL)
+	, m_writeDepth(0)
+	, m_writeLocked(false)
+	, m_reserveSpace(false)
+	, m_dedupObjects(false)
+	, m_prefetchAtStartup(0)
+	, m_prefetchedAtStartup(false)
+	, m_memoryLoWatermark(0)
+	, m_memoryHiWatermark(0)
+	, m_memoryObjectSize(0)
+	, m_memorySize(0)
+	, m_dirSizeTracker(NULL)
+	, m_dirScanner(NULL)
+	, m_walkStartTime(0)
+	, m_walkStartMicros(0)
+	, m_walkDuration(-1)
 {
 
 	MojLogTrace(s_log);
@@ -46,6 +83,32 @@ CFileCacheSet::CFileCacheSet(bool init) : m_totalCacheSpace(0)
 			            m_baseDirName.c_str(), ::strerror(savedErrno));
 			exit(-1);
 		}
+
+		// Account space in the blocks the cache filesystem allocates
+		cacheSize_t blockSize = GetFilesystemBlockSize(m_baseDirName);
+		if (blockSize > 0)
+		{
+			MojLogInfo(s_log, _T("CFileCacheSet: Filesystem block size is '%lld'."),
+			           blockSize);
+			SetBlockSize(blockSize);
+		}
+		else
+		{
+			MojLogWarning(s_log,
+			              _T("CFileCacheSet: Unable to read block size of '%s', using '%lld'."),
+			              m_baseDirName.c_str(), GetBlockSize());
+		}
+
+		if (!m_memoryDirName.empty())
+		{
+			MakeMemoryDir(false);
+		}
+
+		// The cache starts at its configured size until it is adapted
+		if ((m_minCacheSpace > 0) || (m_maxCacheSpace > 0))
+		{
+			SetAdaptiveSpace(m_minCacheSpace, m_maxCacheSpace, m_reservedFreeSpace);
+		}
 	}
 
 	// This provides a pseudo-random seed.and either reads the last
@@ -88,6 +151,13 @@ CFileCacheSet::DefineType(std::string &msgText, const std::string &typeName,
 	CFileCache *fileCache = GetFileCacheForType(typeName);
 	if (fileCache == NULL)
 	{
+		// A type of the same name that was just deleted may still be
+		// having its directory removed
+		if (m_ioPool != NULL)
+		{
+			m_ioPool->Wait(typeName);
+		}
+
 		CFileCache *newType = new CFileCache(this, typeName);
 		if (newType != NULL)
 		{
@@ -96,6 +166,8 @@ CFileCacheSet::DefineType(std::string &msgText, const std::string &typeName,
 				m_cacheSet.insert(std::map < const std::string,
 				                  CFileCache * >::value_type(typeName, newType));
 				retVal = true;
+				JournalCacheType(typeName);
+				KeepGuaranteedSpace();
 				msgText += "Created type '" + typeName + "'.";
 				MojLogInfo(s_log, _T("%s"), msgText.c_str());
 			}
@@ -138,6 +210,14 @@ CFileCacheSet::ChangeType(std::string &msgText, const std::string &typeName,
 	if (fileCache != NULL)
 	{
 		retVal = fileCache->Configure(params);
+		if (retVal)
+		{
+			JournalCacheType(typeName);
+			KeepGuaranteedSpace();
+
+			// Objects of a type no longer kept in memory are moved out
+			(void) DemoteMemoryObjects();
+		}
 		msgText += "Configured type '" + typeName + "'.";
 		MojLogInfo(s_log, _T("%s"), msgText.c_str());
 	}
@@ -162,6 +242,14 @@ CFileCacheSet::DeleteType(std::string &msgText,
 
 	msgText = "DeleteType: ";
 	cacheSize_t retVal = -1;
+
+	// All of the objects of the type need to be known before it can be
+	// deleted.
+	if (m_walkInProgress)
+	{
+		WalkPendingDirsForType(typeName);
+	}
+
 	CFileCache *fileCache = GetFileCacheForType(typeName);
 	if (fileCache != NULL)
 	{
@@ -189,6 +277,10 @@ CFileCacheSet::DeleteType(std::string &msgText,
 
 			m_cacheSet.erase(typeName);
 			delete fileCache;
+			if ((m_cacheIndex != NULL) && m_cacheIndex->isOpen())
+			{
+				m_cacheIndex->JournalDeleteType(typeName);
+			}
 			msgText += "Deleted type '" + typeName + "'.";
 			MojLogInfo(s_log, _T("%s"), msgText.c_str());
 		}
@@ -249,91 +341,64 @@ CFileCacheSet::DescribeType(const std::string &typeName)
 	return params;
 }
 
-// Select the object from the best choice from each cache to remove
-CFileCache *
-CFileCacheSet::SelectCandidateToExpire(std::map < CFileCache *,
-                                       const cachedObjectId_t > & m_cleanupMap)
-{
-
-	MojLogTrace(s_log);
-
-	std::map<CFileCache *, const cachedObjectId_t>::const_iterator iter;
-	iter = m_cleanupMap.begin();
-	CFileCache *retVal = NULL;
-	paramValue_t lowCost = s_maxCost;
-	while (iter != m_cleanupMap.end())
-	{
-		paramValue_t cost = ((*iter).first)->GetCacheCost((*iter).second);
-		if (cost <= lowCost)
-		{
-			retVal = (*iter).first;
-			lowCost = cost;
-		}
-		++iter;
-	}
-	return retVal;
-}
-
 // Cleanup all registered types, this is done when the cache set hits
-// the total available space
+// the total available space.  Each type offers its cheapest object and
+// the candidates are kept in a heap keyed by cost so every object
+// freed costs O(log T) for T types.  The time is read once so all
+// candidates are scored against the same clock.
 cacheSize_t
 CFileCacheSet::CleanupAllTypes(cacheSize_t neededSize)
 {
 
 	MojLogTrace(s_log);
 
-	std::map<CFileCache *, const cachedObjectId_t> m_cleanupMap;
-	std::map<const std::string, CFileCache *>::const_iterator iter;
-	iter = m_cacheSet.begin();
+	typedef std::pair<paramValue_t, CFileCache *> candidate_t;
+	std::priority_queue<candidate_t, std::vector<candidate_t>,
+	    std::greater<candidate_t> > candidates;
+	const time_t now = ::time(0);
 
 	// This is part of the fix for bug NOV-128944.
 	neededSize = GetFilesystemFileSize(neededSize);
 
 	// Get the candidates for each cache type
-	CFileCache *fileCache;
+	std::map<const std::string, CFileCache *>::const_iterator iter;
+	iter = m_cacheSet.begin();
 	while (iter != m_cacheSet.end())
 	{
-		fileCache = (*iter).second;
-		if (fileCache != NULL)
+		CFileCache *fileCache = (*iter).second;
+		paramValue_t cost;
+		if ((fileCache != NULL) &&
+		        (fileCache->GetCheapestCandidate(now, &cost) != 0))
 		{
-			const cachedObjectId_t candidate = fileCache->GetCleanupCandidate();
-			if (candidate != 0)
-			{
-				m_cleanupMap.insert(std::map < CFileCache *,
-				                    const cachedObjectId_t >::value_type(fileCache,
-				                            candidate));
-			}
+			candidates.push(candidate_t(cost, fileCache));
 		}
 		++iter;
 	}
+
 	// Now continue clearing candidates until we've cleared requested space
 	cacheSize_t cleanedSize = 0;
-	while (cleanedSize < neededSize)
+	while ((cleanedSize < neededSize) && !candidates.empty())
 	{
-		// Select which object to expire
-		fileCache = SelectCandidateToExpire(m_cleanupMap);
-		// If this comes back NULL, there is nothing else we can clean.
-		if (fileCache == NULL)
+		CFileCache *fileCache = candidates.top().second;
+		candidates.pop();
+		paramValue_t cost;
+		cachedObjectId_t objId = fileCache->GetCheapestCandidate(now, &cost);
+		if (objId == 0)
 		{
-			break;
+			continue;
 		}
-		cachedObjectId_t objId = m_cleanupMap[fileCache];
 		// This is part of the fix for bug NOV-128944.
 		cacheSize_t size = GetFilesystemFileSize(CachedObjectSize(objId));
-		m_cleanupMap.erase(fileCache);
 		if (ExpireCacheObject(objId))
 		{
 			cleanedSize += size;
+			fileCache->GetMetrics().m_globalEvictions.Add();
+			fileCache->GetMetrics().m_bytesFreed.Add((unsigned long long) size);
 		}
-		if (cleanedSize < neededSize)
+		if ((cleanedSize < neededSize) &&
+		        (fileCache->GetCheapestCandidate(now, &cost) != 0))
 		{
-			cachedObjectId_t candidate = fileCache->GetCleanupCandidate();
-			if (candidate != 0)
-			{
-				m_cleanupMap.insert(std::map < CFileCache *,
-				                    const cachedObjectId_t >::value_type(fileCache,
-				                            candidate));
-			}
+			candidates.push(candidate_t(cost, fileCache));
 		}
 	}
 
@@ -412,6 +477,7 @@ CFileCacheSet::InsertCacheObject(std::string &msgText,
 			sizeString << size;
 			msgText += "Could not find '" + sizeString.str() +
 			           "' bytes for object insert.";
+			fileCache->GetMetrics().m_insertRejections.Add();
 			MojLogError(s_log, _T("%s"), msgText.c_str());
 		}
 	}
@@ -436,7 +502,8 @@ CFileCacheSet::InsertCacheObject(std::string &msgText,
                                  const cachedObjectId_t objectId,
                                  cacheSize_t size, paramValue_t cost,
                                  paramValue_t lifetime, bool written,
-                                 bool isNew)
+                                 bool isNew, bool compressed,
+                                 cacheSize_t storedSize, bool inMemory)
 {
 
 	MojLogTrace(s_log);
@@ -448,13 +515,36 @@ CFileCacheSet::InsertCacheObject(std::string &msgText,
 		CCacheObject *newObj = new CCacheObject(fileCache, objectId, filename,
 		                                        size, cost, lifetime, written,
 		                                        fileCache->isDirType());
+		if ((newObj != NULL) && compressed)
+		{
+			newObj->SetCompressed(storedSize);
+		}
+
+		// A new object that belongs in memory goes there if it fits,
+		// otherwise it goes in the cache directory and room is made for
+		// the next one
+		if ((newObj != NULL) && isNew && BelongsInMemory(fileCache, size))
+		{
+			const cacheSize_t fsSize = GetFilesystemFileSize(size);
+			if (m_memorySize + fsSize <= m_memoryHiWatermark)
+			{
+				inMemory = true;
+			}
+			else
+			{
+				(void) DemoteMemoryObjects(fsSize);
+			}
+		}
+		if ((newObj != NULL) && inMemory)
+		{
+			newObj->SetInMemory();
+		}
 		if (newObj != NULL)
 		{
 			if (newObj->Initialize(isNew))
 			{
 				fileCache->Insert(newObj);
-				m_idMap.insert(std::map < const cachedObjectId_t,
-				               const std::string >::value_type(objectId, typeName));
+				m_idTable.Insert(objectId, newObj);
 				retVal = objectId;
 			}
 			else
@@ -479,6 +569,77 @@ CFileCacheSet::InsertCacheObject(std::string &msgText,
 	return retVal;
 }
 
+// Insert a batch of objects.  The space for all the objects of a
+// type is found with one cleanup pass before any of them are
+// inserted, the objects are then inserted in order.  The result for
+// each object is returned in its request.
+void
+CFileCacheSet::InsertCacheObjects(insertRequests_t &requests)
+{
+
+	MojLogTrace(s_log);
+
+	// Fill in the defaults and total the space needed in each type
+	std::map<std::string, cacheSize_t> neededSpace;
+	insertRequests_t::iterator iter = requests.begin();
+	while (iter != requests.end())
+	{
+		CInsertRequest &request = *iter;
+		CFileCache *fileCache = GetFileCacheForType(request.m_typeName);
+		if (fileCache != NULL)
+		{
+			CCacheParamValues params;
+			fileCache->Describe(params);
+			if (request.m_size == 0)
+			{
+				request.m_size = params.GetSize();
+			}
+			if (request.m_cost == 0)
+			{
+				request.m_cost = params.GetCost();
+			}
+			if (request.m_lifetime == 0)
+			{
+				request.m_lifetime = params.GetLifetime();
+			}
+			neededSpace[request.m_typeName] +=
+			    GetFilesystemFileSize(request.m_size);
+		}
+		++iter;
+	}
+
+	// A batch too large for its type still gets the objects that fit,
+	// each insert below cleans up for its own object if it has to.
+	std::map<std::string, cacheSize_t>::const_iterator spaceIter =
+	    neededSpace.begin();
+	while (spaceIter != neededSpace.end())
+	{
+		CFileCache *fileCache = GetFileCacheForType((*spaceIter).first);
+		if (!fileCache->CheckForSize((*spaceIter).second))
+		{
+			MojLogInfo(s_log,
+			           _T("InsertCacheObjects: Calling Cleanup to make '%lld' bytes for type '%s'."),
+			           (*spaceIter).second, (*spaceIter).first.c_str());
+			fileCache->Cleanup((*spaceIter).second);
+		}
+		++spaceIter;
+	}
+
+	iter = requests.begin();
+	while (iter != requests.end())
+	{
+		CInsertRequest &request = *iter;
+		request.m_objId = InsertCacheObject(request.m_msgText,
+		                                    request.m_typeName,
+		                                    request.m_filename,
+		                                    request.m_size, request.m_cost,
+		                                    request.m_lifetime);
+		++iter;
+	}
+	MojLogInfo(s_log, _T("InsertCacheObjects: Processed '%d' objects."),
+	           (int) requests.size());
+}
+
 // Request to change the size of an object.  This is only valid
 // while the initial writable subscription is in effect.  If there
 // isn't sufficient space, the resize will return the original size
@@ -491,20 +652,11 @@ CFileCacheSet::Resize(const cachedObjectId_t objId, cacheSize_t newSize)
 	MojLogTrace(s_log);
 
 	cacheSize_t retVal = CachedObjectSize(objId);
-	const std::string typeName(GetTypeForObjectId(objId));
-	if (!typeName.empty())
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+	if (cacheObject != NULL)
 	{
-		CFileCache *fileCache = GetFileCacheForType(typeName);
-		if (fileCache != NULL)
-		{
-			retVal = fileCache->Resize(objId, newSize);
-		}
-		else
-		{
-			MojLogWarning(s_log,
-			              _T("Resize: No cache of type '%s' found for id '%llu'."),
-			              typeName.c_str(), objId);
-		}
+		CFileCache *fileCache = cacheObject->GetFileCache();
+		retVal = fileCache->Resize(objId, newSize);
 	}
 	else
 	{
@@ -526,26 +678,17 @@ CFileCacheSet::ExpireCacheObject(const cachedObjectId_t objId)
 	MojLogTrace(s_log);
 
 	bool retVal = true;
-	const std::string typeName(GetTypeForObjectId(objId));
-	if (!typeName.empty())
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+	if (cacheObject != NULL)
 	{
-		CFileCache *fileCache = GetFileCacheForType(typeName);
-		if (fileCache != NULL)
-		{
-			RemoveObjectFromIdMap(objId);
-			retVal = fileCache->Expire(objId);
-			if (!retVal)
-			{
-				MojLogInfo(s_log,
-				           _T("ExpireCacheObject: expire deferred, object '%llu' in use"),
-				           objId);
-			}
-		}
-		else
+		CFileCache *fileCache = cacheObject->GetFileCache();
+		RemoveObjectFromIdMap(objId);
+		retVal = fileCache->Expire(objId);
+		if (!retVal)
 		{
-			MojLogWarning(s_log,
-			              _T("ExpireCacheObject: No cache of type '%s' found for id '%llu'."),
-			              typeName.c_str(), objId);
+			MojLogInfo(s_log,
+			           _T("ExpireCacheObject: expire deferred, object '%llu' in use"),
+			           objId);
 		}
 	}
 	else
@@ -561,33 +704,26 @@ CFileCacheSet::ExpireCacheObject(const cachedObjectId_t objId)
 // Pin an object in the cache by allowing a client to subscribe to
 // the object.  This will guarantee the object will not be removed
 // from the cache while the subscription is active.  Returns the
-// file path associated with the objectId.
+// file path associated with the objectId.  If stream points to true,
+// a reader can subscribe to a file object still being written.
 const std::string
 CFileCacheSet::SubscribeCacheObject(std::string &msgText,
-                                    const cachedObjectId_t objId)
+                                    const cachedObjectId_t objId,
+                                    bool *stream)
 {
 
 	MojLogTrace(s_log);
 
 	std::string retVal("");
-	const std::string typeName(GetTypeForObjectId(objId));
-	if (!typeName.empty())
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+	if (cacheObject != NULL)
 	{
-		CFileCache *fileCache = GetFileCacheForType(typeName);
-		if (fileCache != NULL)
-		{
-			retVal = fileCache->Subscribe(msgText, objId);
-			if (msgText.empty())
-			{
-				MojLogInfo(s_log,
-				           _T("SubscribeCacheObject: Object '%llu' subscribed."), objId);
-			}
-		}
-		else
+		CFileCache *fileCache = cacheObject->GetFileCache();
+		retVal = fileCache->Subscribe(msgText, objId, stream);
+		if (msgText.empty())
 		{
-			MojLogWarning(s_log,
-			              _T("SubscribeCacheObject: No cache of type '%s' found for id '%llu'."),
-			              typeName.c_str(), objId);
+			MojLogInfo(s_log,
+			           _T("SubscribeCacheObject: Object '%llu' subscribed."), objId);
 		}
 	}
 	else
@@ -600,11 +736,58 @@ CFileCacheSet::SubscribeCacheObject(std::string &msgText,
 	return retVal;
 }
 
+// Returns true if the object's file holds its data deflated
+bool
+CFileCacheSet::isCompressedObject(const cachedObjectId_t objId)
+{
+
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+
+	return (cacheObject != NULL) && cacheObject->isCompressed();
+}
+
+// Returns true if the view of a compressed object is being made
+bool
+CFileCacheSet::isViewPending(const cachedObjectId_t objId)
+{
+
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+
+	return (cacheObject != NULL) && cacheObject->isViewPending();
+}
+
+// Open the view made on the I/O pool for the subscribers waiting for
+// it.  The view of an object removed in the meantime is unlinked.
+void
+CFileCacheSet::FinishView(const cachedObjectId_t objId,
+                          const std::string &viewPath, const bool made)
+{
+
+	MojLogTrace(s_log);
+
+	bool open = false;
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+	if (cacheObject != NULL)
+	{
+		open = cacheObject->GetFileCache()->FinishView(objId, made);
+	}
+	else if (made)
+	{
+		(void) ::unlink(viewPath.c_str());
+	}
+	if (m_viewCallback)
+	{
+		m_viewCallback(objId, open ? viewPath : std::string());
+	}
+}
+
 // Remove the client subscription of an object.  This will remove
-// the guarantee that the object will be kept in the cache.
+// the guarantee that the object will be kept in the cache.  stream says
+// the subscription was a streaming reader's.
 void
 CFileCacheSet::UnSubscribeCacheObject(const std::string &typeName,
-                                      const cachedObjectId_t objId)
+                                      const cachedObjectId_t objId,
+                                      const bool stream)
 {
 
 	MojLogTrace(s_log);
@@ -614,7 +797,7 @@ CFileCacheSet::UnSubscribeCacheObject(const std::string &typeName,
 		CFileCache *fileCache = GetFileCacheForType(typeName);
 		if (fileCache != NULL)
 		{
-			fileCache->UnSubscribe(objId);
+			fileCache->UnSubscribe(objId, stream);
 			MojLogInfo(s_log,
 			           _T("UnSubscribeCacheObject: Object '%llu' unsubscribed."),
 			           objId);
@@ -643,21 +826,12 @@ CFileCacheSet::Touch(const cachedObjectId_t objId)
 	MojLogTrace(s_log);
 
 	bool retVal = false;
-	const std::string typeName(GetTypeForObjectId(objId));
-	if (!typeName.empty())
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+	if (cacheObject != NULL)
 	{
-		CFileCache *fileCache = GetFileCacheForType(typeName);
-		if (fileCache != NULL)
-		{
-			retVal = fileCache->Touch(objId);
-			MojLogInfo(s_log, _T("Touch: Object '%llu' touched."), objId);
-		}
-		else
-		{
-			MojLogWarning(s_log,
-			              _T("Touch: No cache of type '%s' found for id '%llu'."),
-			              typeName.c_str(), objId);
-		}
+		CFileCache *fileCache = cacheObject->GetFileCache();
+		retVal = fileCache->Touch(objId);
+		MojLogInfo(s_log, _T("Touch: Object '%llu' touched."), objId);
 	}
 	else
 	{
@@ -668,6 +842,121 @@ CFileCacheSet::Touch(const cachedObjectId_t objId)
 	return retVal;
 }
 
+// Ask the kernel to read the file of a written object ahead of a client
+// opening it.  The prefetch isn't ordered with the other work of the
+// type, a file removed before it runs just fails to open.
+bool
+CFileCacheSet::PrefetchCacheObject(std::string &msgText,
+                                   const cachedObjectId_t objId)
+{
+
+	MojLogTrace(s_log);
+
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+	if ((cacheObject == NULL) || cacheObject->isExpired())
+	{
+		msgText = "Failed, object not found in cache";
+		return false;
+	}
+	CFileCache *fileCache = cacheObject->GetFileCache();
+	if (fileCache->isDirType())
+	{
+		msgText = "Failed, directory objects can't be prefetched";
+		return false;
+	}
+	if (!cacheObject->isWritten())
+	{
+		msgText = "Failed, object is not written";
+		return false;
+	}
+	if (cacheObject->isInMemory())
+	{
+		return true;
+	}
+
+	const std::string pathname(cacheObject->GetPathname());
+	ioWork_t work = [pathname]()
+	{
+		std::string msgText;
+		if (!PrefetchFile(pathname, msgText))
+		{
+			MojLogWarning(s_log, _T("PrefetchCacheObject: %s"), msgText.c_str());
+		}
+	};
+	fileCache->GetMetrics().m_prefetches.Add();
+	MojLogDebug(s_log, _T("PrefetchCacheObject: Prefetching object '%llu'."),
+	            objId);
+	if (m_ioPool != NULL)
+	{
+		m_ioPool->Post(std::string(), work);
+	}
+	else
+	{
+		work();
+	}
+
+	return true;
+}
+
+// Prefetch the numObjects most recently used objects of each type
+int
+CFileCacheSet::PrefetchRecentObjects(const int numObjects)
+{
+
+	MojLogTrace(s_log);
+
+	int numPrefetched = 0;
+	if (numObjects <= 0)
+	{
+		return numPrefetched;
+	}
+
+	std::map<const std::string, CFileCache *>::const_iterator iter;
+	iter = m_cacheSet.begin();
+	while (iter != m_cacheSet.end())
+	{
+		CFileCache *fileCache = (*iter).second;
+		++iter;
+		if (fileCache->isDirType())
+		{
+			continue;
+		}
+
+		std::vector<cachedObjectId_t> objIds;
+		fileCache->GetRecentObjects((size_t) numObjects, objIds);
+		std::vector<cachedObjectId_t>::const_iterator idIter = objIds.begin();
+		while (idIter != objIds.end())
+		{
+			std::string msgText;
+			if (PrefetchCacheObject(msgText, *idIter))
+			{
+				numPrefetched++;
+			}
+			++idIter;
+		}
+	}
+	MojLogInfo(s_log, _T("PrefetchRecentObjects: Prefetched '%d' objects."),
+	           numPrefetched);
+
+	return numPrefetched;
+}
+
+// Prefetch the recent objects FileCache.conf asks to have warmed at
+// startup, once the walk is complete
+void
+CFileCacheSet::PrefetchAtStartup()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_prefetchedAtStartup || !isWalkComplete())
+	{
+		return;
+	}
+	m_prefetchedAtStartup = true;
+	(void) PrefetchRecentObjects(m_prefetchAtStartup);
+}
+
 // Get the current status of the cache as a whole.  The current
 // amount of space used in all the caches will be returned in size.
 // The current number of active cached objects will be returned in
@@ -701,7 +990,7 @@ CFileCacheSet::GetCacheStatus(cacheSize_t *size,
 	}
 
 	MojLogInfo(s_log,
-	           _T("GetCacheStatus: numtypes = '%zd', size = '%d', numobjs = '%d', space = '%d'"),
+	           _T("GetCacheStatus: numtypes = '%zd', size = '%lld', numobjs = '%d', space = '%lld'"),
 	           m_cacheSet.size(), cacheSize, numObjects,
 	           (SumOfLoWatermarks() - cacheSize));
 
@@ -755,7 +1044,7 @@ CFileCacheSet::GetCacheTypeStatus(const std::string &typeName,
 			*numCacheObjects = numObjects;
 		}
 
-		MojLogInfo(s_log, _T("GetCacheTypeStatus: size = '%d', numobjs = '%d'"),
+		MojLogInfo(s_log, _T("GetCacheTypeStatus: size = '%lld', numobjs = '%d'"),
 		           cacheSize, numObjects);
 		retVal = true;
 	}
@@ -778,23 +1067,14 @@ CFileCacheSet::CachedObjectSize(const cachedObjectId_t objId)
 	MojLogTrace(s_log);
 
 	cacheSize_t retVal = -1;
-	const std::string typeName(GetTypeForObjectId(objId));
-	if (!typeName.empty())
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+	if (cacheObject != NULL)
 	{
-		CFileCache *fileCache = GetFileCacheForType(typeName);
-		if (fileCache != NULL)
-		{
-			retVal = fileCache->GetObjectSize(objId);
-			MojLogInfo(s_log,
-			           _T("CachedObjectSize: Object '%llu' is size '%d'."),
-			           objId, retVal);
-		}
-		else
-		{
-			MojLogWarning(s_log,
-			              _T("CachedObjectSize: No cache of type '%s' found for id '%llu'."),
-			              typeName.c_str(), objId);
-		}
+		CFileCache *fileCache = cacheObject->GetFileCache();
+		retVal = fileCache->GetObjectSize(objId);
+		MojLogInfo(s_log,
+		           _T("CachedObjectSize: Object '%llu' is size '%lld'."),
+		           objId, retVal);
 	}
 	else
 	{
@@ -814,23 +1094,14 @@ CFileCacheSet::CachedObjectFilename(const cachedObjectId_t objId)
 	MojLogTrace(s_log);
 
 	std::string retVal;
-	const std::string typeName(GetTypeForObjectId(objId));
-	if (!typeName.empty())
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+	if (cacheObject != NULL)
 	{
-		CFileCache *fileCache = GetFileCacheForType(typeName);
-		if (fileCache != NULL)
-		{
-			retVal = fileCache->GetObjectFilename(objId);
-			MojLogInfo(s_log,
-			           _T("CachedObjectFilename: Object '%llu' has name '%s'."),
-			           objId, retVal.c_str());
-		}
-		else
-		{
-			MojLogWarning(s_log,
-			              _T("CachedObjectFilename: No cache of type '%s' found for id '%llu'."),
-			              typeName.c_str(), objId);
-		}
+		CFileCache *fileCache = cacheObject->GetFileCache();
+		retVal = fileCache->GetObjectFilename(objId);
+		MojLogInfo(s_log,
+		           _T("CachedObjectFilename: Object '%llu' has name '%s'."),
+		           objId, retVal.c_str());
 	}
 	else
 	{
@@ -864,7 +1135,7 @@ CFileCacheSet::ReadConfig(const std::string &configFile)
 			if (label == s_totalCacheSpace)
 			{
 				infile >> m_totalCacheSpace;
-				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%d'."),
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%lld'."),
 				           s_totalCacheSpace.c_str(), m_totalCacheSpace);
 			}
 			else if (label == s_baseDirName)
@@ -873,14 +1144,116 @@ CFileCacheSet::ReadConfig(const std::string &configFile)
 				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%s'."),
 				           s_baseDirName.c_str(), m_baseDirName.c_str());
 			}
-		}
-		infile.close();
-	}
-	else
-	{
-		MojLogInfo(s_log,
-		           _T("ReadConfig: Failed to open config file '%s'."),
-		           configFile.c_str());
+			else if (label == s_lazyStartup)
+			{
+				infile >> m_lazyStartup;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%d'."),
+				           s_lazyStartup.c_str(), m_lazyStartup);
+			}
+			else if (label == s_scanThreads)
+			{
+				infile >> m_scanThreads;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%d'."),
+				           s_scanThreads.c_str(), m_scanThreads);
+			}
+			else if (label == s_maxCopies)
+			{
+				infile >> m_maxCopies;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%d'."),
+				           s_maxCopies.c_str(), m_maxCopies);
+			}
+			else if (label == s_syncDelay)
+			{
+				infile >> m_syncDelay;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%d'."),
+				           s_syncDelay.c_str(), m_syncDelay);
+			}
+			else if (label == s_ioThreads)
+			{
+				infile >> m_ioThreads;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%d'."),
+				           s_ioThreads.c_str(), m_ioThreads);
+			}
+			else if (label == s_readThreads)
+			{
+				infile >> m_readThreads;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%d'."),
+				           s_readThreads.c_str(), m_readThreads);
+			}
+			else if (label == s_traceFile)
+			{
+				infile >> m_traceFile;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%s'."),
+				           s_traceFile.c_str(), m_traceFile.c_str());
+			}
+			else if (label == s_reserveSpace)
+			{
+				infile >> m_reserveSpace;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%d'."),
+				           s_reserveSpace.c_str(), m_reserveSpace);
+			}
+			else if (label == s_dedupObjects)
+			{
+				infile >> m_dedupObjects;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%d'."),
+				           s_dedupObjects.c_str(), m_dedupObjects);
+			}
+			else if (label == s_memoryDirName)
+			{
+				infile >> m_memoryDirName;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%s'."),
+				           s_memoryDirName.c_str(), m_memoryDirName.c_str());
+			}
+			else if (label == s_memoryLoWatermark)
+			{
+				infile >> m_memoryLoWatermark;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%lld'."),
+				           s_memoryLoWatermark.c_str(), m_memoryLoWatermark);
+			}
+			else if (label == s_memoryHiWatermark)
+			{
+				infile >> m_memoryHiWatermark;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%lld'."),
+				           s_memoryHiWatermark.c_str(), m_memoryHiWatermark);
+			}
+			else if (label == s_memoryObjectSize)
+			{
+				infile >> m_memoryObjectSize;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%lld'."),
+				           s_memoryObjectSize.c_str(), m_memoryObjectSize);
+			}
+			else if (label == s_minCacheSpace)
+			{
+				infile >> m_minCacheSpace;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%lld'."),
+				           s_minCacheSpace.c_str(), m_minCacheSpace);
+			}
+			else if (label == s_maxCacheSpace)
+			{
+				infile >> m_maxCacheSpace;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%lld'."),
+				           s_maxCacheSpace.c_str(), m_maxCacheSpace);
+			}
+			else if (label == s_reservedFreeSpace)
+			{
+				infile >> m_reservedFreeSpace;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%lld'."),
+				           s_reservedFreeSpace.c_str(), m_reservedFreeSpace);
+			}
+			else if (label == s_prefetchAtStartup)
+			{
+				infile >> m_prefetchAtStartup;
+				MojLogInfo(s_log, _T("ReadConfig: '%s' = '%d'."),
+				           s_prefetchAtStartup.c_str(), m_prefetchAtStartup);
+			}
+		}
+		infile.close();
+	}
+	else
+	{
+		MojLogInfo(s_log,
+		           _T("ReadConfig: Failed to open config file '%s'."),
+		           configFile.c_str());
 	}
 }
 
@@ -981,51 +1354,44 @@ CFileCacheSet::WriteSequenceNumber()
 	}
 }
 
-// Get the sum of the loWatermark values for each configured cache
-cacheSize_t
-CFileCacheSet::SumOfLoWatermarks()
+// Debug check that the running sums of the cache sizes and
+// loWatermarks match the sums computed again from every type
+bool
+CFileCacheSet::CheckTotals()
 {
 
 	MojLogTrace(s_log);
 
+	cacheSize_t sumOfSizes = 0;
 	cacheSize_t lwm = 0;
 	std::map<const std::string, CFileCache *>::const_iterator iter;
 	iter = m_cacheSet.begin();
 	while (iter != m_cacheSet.end())
 	{
-		CFileCache *fileCache = (*iter).second;
-		CCacheParamValues params;
-		fileCache->Describe(params);
-		lwm += params.GetLoWatermark();
-
+		sumOfSizes += (*iter).second->GetCacheSize();
+		lwm += (*iter).second->GetLoWatermark();
 		++iter;
 	}
 
-	return lwm;
-}
-
-// Compute the sum of current sizes for each of the configured caches
-cacheSize_t
-CFileCacheSet::SumOfCacheSizes()
-{
-
-	MojLogTrace(s_log);
-
-	cacheSize_t sumOfSizes = 0;
-	std::map<const std::string, CFileCache *>::const_iterator iter;
-	iter = m_cacheSet.begin();
-	while (iter != m_cacheSet.end())
+	bool retVal = true;
+	if (sumOfSizes != m_sumOfCacheSizes)
 	{
-		CFileCache *fileCache = (*iter).second;
-		CCacheParamValues params;
-		sumOfSizes += fileCache->Describe(params);
-		++iter;
+		MojLogError(s_log,
+		            _T("CheckTotals: Sum of cache sizes is '%lld', computed '%lld'."),
+		            m_sumOfCacheSizes, sumOfSizes);
+		retVal = false;
+	}
+	if (lwm != m_sumOfLoWatermarks)
+	{
+		MojLogError(s_log,
+		            _T("CheckTotals: Sum of loWatermarks is '%lld', computed '%lld'."),
+		            m_sumOfLoWatermarks, lwm);
+		retVal = false;
 	}
 
-	return sumOfSizes;
+	return retVal;
 }
 
-
 // Get the type that corresponds to an objectId
 const std::string
 CFileCacheSet::GetTypeForObjectId(const cachedObjectId_t objId)
@@ -1034,16 +1400,57 @@ CFileCacheSet::GetTypeForObjectId(const cachedObjectId_t objId)
 	MojLogTrace(s_log);
 
 	std::string retVal("");
-	std::map<const cachedObjectId_t, const std::string>::iterator iter;
-	iter = m_idMap.find(objId);
-	if (iter != m_idMap.end())
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+	if (cacheObject != NULL)
 	{
-		retVal = (*iter).second;
+		retVal = cacheObject->GetFileCache()->GetType();
 	}
 
 	return retVal;
 }
 
+// Get the cache object for an objectId, loading the directory it is
+// in first if the startup walk hasn't reached it yet.  Orphans are not
+// found.
+CCacheObject *
+CFileCacheSet::GetCacheObjectForId(const cachedObjectId_t objId)
+{
+
+	CCacheObject *cacheObject = m_idTable.Find(objId);
+	if ((cacheObject == NULL) && m_walkInProgress)
+	{
+		WalkPendingDirsForObjectId(objId);
+		cacheObject = m_idTable.Find(objId);
+	}
+
+	return cacheObject;
+}
+
+// The counters kept for a type, or NULL if there is no such type
+CCacheMetrics *
+CFileCacheSet::GetTypeMetrics(const std::string &typeName)
+{
+
+	CFileCache *fileCache = GetFileCacheForType(typeName);
+
+	return (fileCache != NULL) ? &fileCache->GetMetrics() : NULL;
+}
+
+// Count a subscribe to an object no longer in the cache against the
+// type named in its pathname.  A pathname naming no type that exists
+// isn't counted.
+void
+CFileCacheSet::CountSubscribeMiss(const std::string &pathName)
+{
+
+	CCacheMetrics *metrics =
+	    GetTypeMetrics(GetTypeNameFromPath(GetBaseDirName(), pathName));
+	if (metrics != NULL)
+	{
+		metrics->m_subscribeMisses.Add();
+	}
+}
+
 // Check if a type exists
 bool
 CFileCacheSet::TypeExists(const std::string &typeName)
@@ -1094,7 +1501,7 @@ int CFileCacheSet::GetCacheSize()
 	return m_cacheSet.size();
 }
 
-// Locate and try to cleanup any orphans
+// Cleanup the orphans each type has queued
 void
 CFileCacheSet::CleanupOrphans()
 {
@@ -1105,9 +1512,54 @@ CFileCacheSet::CleanupOrphans()
 	iter = m_cacheSet.begin();
 	while (iter != m_cacheSet.end())
 	{
-		(*iter).second->CleanupOrphanedObjects();
+		if ((*iter).second->GetNumOrphans() > 0)
+		{
+			(*iter).second->CleanupOrphanedObjects();
+		}
+		++iter;
+	}
+}
+
+// Expire the objects whose type's eviction policy says they have
+// outlived their lifetime.  Returns the number expired.
+paramValue_t
+CFileCacheSet::ExpireStaleObjects()
+{
+
+	MojLogTrace(s_log);
+
+	const time_t now = ::time(0);
+	paramValue_t numExpired = 0;
+	std::map<const std::string, CFileCache *>::const_iterator iter;
+	iter = m_cacheSet.begin();
+	while (iter != m_cacheSet.end())
+	{
+		numExpired += (*iter).second->ExpireStale(now);
+		++iter;
+	}
+
+	return numExpired;
+}
+
+// Returns true if some type has orphans waiting to be cleaned up
+bool
+CFileCacheSet::HasOrphans()
+{
+
+	MojLogTrace(s_log);
+
+	std::map<const std::string, CFileCache *>::const_iterator iter;
+	iter = m_cacheSet.begin();
+	while (iter != m_cacheSet.end())
+	{
+		if ((*iter).second->GetNumOrphans() > 0)
+		{
+			return true;
+		}
 		++iter;
 	}
+
+	return false;
 }
 
 // Generate a unique object id that isn't duplicated in the set of
@@ -1319,13 +1771,38 @@ CFileCacheSet::CheckForSpecialFile(const std::string &pathname,
 			stat = COMPLETE;
 		}
 	}
+	if (stat == CONTINUE)
+	{
+		// The cache index files are also kept in the base directory
+		const std::string indexFile(GetBaseDirName() + "/" + s_indexFilename);
+		const std::string journalFile(GetBaseDirName() + "/" + s_journalFilename);
+		if ((pathname == indexFile) || (pathname == indexFile + ".tmp") ||
+		        (pathname == journalFile))
+		{
+			stat = COMPLETE;
+		}
+	}
 
 	return stat;
 }
 
+// Read an extended attribute, using the value read ahead by the
+// directory scanner if there is one.
+static ssize_t
+ReadAttribute(const std::string &pathname, const CScannedEntry *entry,
+              const char *name, void *value, size_t size)
+{
+	if (entry != NULL)
+	{
+		return entry->GetAttribute(name, value, size);
+	}
+
+	return FC_getxattr(pathname.c_str(), name, value, size);
+}
+
 CFileCacheSet::ProcessStatus
 CFileCacheSet::GetWritten(const std::string &pathname, int *written,
-                          bool dirType)
+                          bool dirType, const CScannedEntry *entry)
 {
 
 	MojLogTrace(s_log);
@@ -1333,8 +1810,8 @@ CFileCacheSet::GetWritten(const std::string &pathname, int *written,
 	ProcessStatus stat = CONTINUE;
 	// Let's start by checking if this file was completely written as
 	// we will remove it if not.
-	ssize_t attrSize = FC_getxattr(pathname.c_str(), "user.w", written,
-	                               sizeof(*written));
+	ssize_t attrSize = ReadAttribute(pathname, entry, "user.w", written,
+	                                 sizeof(*written));
 	if ((attrSize == -1) || (!(*written)))
 	{
 		if (attrSize == -1)
@@ -1410,7 +1887,8 @@ CFileCacheSet::GetWritten(const std::string &pathname, int *written,
 
 CFileCacheSet::ProcessStatus
 CFileCacheSet::GetSize(const std::string &pathname, const struct stat *sb,
-                       cacheSize_t *size, bool dirType)
+                       cacheSize_t *size, bool dirType,
+                       const CScannedEntry *entry)
 {
 
 	MojLogTrace(s_log);
@@ -1420,7 +1898,9 @@ CFileCacheSet::GetSize(const std::string &pathname, const struct stat *sb,
 	// Now get the size and validate it is correct or else remove the
 	// file as it was tampered with after the attributes were written
 	// and the cache statistics won't add up.
-	ssize_t attrSize = FC_getxattr(pathname.c_str(), "user.s", size, sizeof(*size));
+	// Versions with 32 bit sizes wrote a 4 byte attribute
+	ssize_t attrSize = ReadAttribute(pathname, entry, "user.s", size,
+	                                 sizeof(*size));
 	if (attrSize == -1)
 	{
 		int savedErrno = errno;
@@ -1429,8 +1909,20 @@ CFileCacheSet::GetSize(const std::string &pathname, const struct stat *sb,
 		            pathname.c_str(), ::strerror(savedErrno));
 		stat = ERROR;
 	}
-	// Now check that the size on disk is equal to the specified size
-	if (!dirType && ((cacheSize_t) sb->st_size != *size))
+	else if (attrSize == (ssize_t) sizeof(int32_t))
+	{
+		int32_t legacySize;
+		::memcpy(&legacySize, size, sizeof(legacySize));
+		*size = legacySize;
+	}
+	// Now check that the size on disk is equal to the specified size,
+	// or the stored size of a compressed object
+	cacheSize_t fileSize = *size;
+	if ((entry != NULL) && entry->m_packed && entry->m_record.m_compressed)
+	{
+		fileSize = entry->m_record.m_storedSize;
+	}
+	if (!dirType && ((cacheSize_t) sb->st_size != fileSize))
 	{
 		int retVal = ::unlink(pathname.c_str());
 		if (retVal != 0)
@@ -1461,7 +1953,8 @@ CFileCacheSet::GetSize(const std::string &pathname, const struct stat *sb,
 }
 
 CFileCacheSet::ProcessStatus
-CFileCacheSet::GetFilename(const std::string &pathname, char *fileName)
+CFileCacheSet::GetFilename(const std::string &pathname, char *fileName,
+                           const CScannedEntry *entry)
 {
 
 	MojLogTrace(s_log);
@@ -1469,8 +1962,8 @@ CFileCacheSet::GetFilename(const std::string &pathname, char *fileName)
 	ProcessStatus stat = CONTINUE;
 
 	// Get the real filename from the extended attribute
-	ssize_t attrSize = FC_getxattr(pathname.c_str(), "user.f", fileName,
-	                               s_maxFilenameLength);
+	ssize_t attrSize = ReadAttribute(pathname, entry, "user.f", fileName,
+	                                 s_maxFilenameLength);
 	if (attrSize == -1)
 	{
 		int savedErrno = errno;
@@ -1484,7 +1977,8 @@ CFileCacheSet::GetFilename(const std::string &pathname, char *fileName)
 }
 
 CFileCacheSet::ProcessStatus
-CFileCacheSet::GetCost(const std::string &pathname, paramValue_t *cost)
+CFileCacheSet::GetCost(const std::string &pathname, paramValue_t *cost,
+                       const CScannedEntry *entry)
 {
 
 	MojLogTrace(s_log);
@@ -1492,7 +1986,8 @@ CFileCacheSet::GetCost(const std::string &pathname, paramValue_t *cost)
 	ProcessStatus stat = CONTINUE;
 
 	// Get the code from the extended attribute
-	ssize_t attrSize = FC_getxattr(pathname.c_str(), "user.c", cost, sizeof(*cost));
+	ssize_t attrSize = ReadAttribute(pathname, entry, "user.c", cost,
+	                                 sizeof(*cost));
 	if (attrSize == -1)
 	{
 		int savedErrno = errno;
@@ -1506,7 +2001,8 @@ CFileCacheSet::GetCost(const std::string &pathname, paramValue_t *cost)
 }
 
 CFileCacheSet::ProcessStatus
-CFileCacheSet::GetLifetime(const std::string &pathname, paramValue_t *lifetime)
+CFileCacheSet::GetLifetime(const std::string &pathname, paramValue_t *lifetime,
+                           const CScannedEntry *entry)
 {
 
 	MojLogTrace(s_log);
@@ -1514,8 +2010,8 @@ CFileCacheSet::GetLifetime(const std::string &pathname, paramValue_t *lifetime)
 	ProcessStatus stat = CONTINUE;
 
 	// Get the lifetime from the extended attribute
-	ssize_t attrSize = FC_getxattr(pathname.c_str(), "user.l", lifetime,
-	                               sizeof(*lifetime));
+	ssize_t attrSize = ReadAttribute(pathname, entry, "user.l", lifetime,
+	                                 sizeof(*lifetime));
 	if (attrSize == -1)
 	{
 		int savedErrno = errno;
@@ -1529,7 +2025,8 @@ CFileCacheSet::GetLifetime(const std::string &pathname, paramValue_t *lifetime)
 }
 
 int
-CFileCacheSet::ProcessFiles(const std::string &filepath)
+CFileCacheSet::ProcessFiles(const std::string &filepath,
+                            const CScannedEntry *entry)
 {
 
 	MojLogTrace(s_log);
@@ -1547,8 +2044,18 @@ CFileCacheSet::ProcessFiles(const std::string &filepath)
 
 	struct stat buf;
 
-	int fd = 0;
-	if((fd = open(filepath.c_str(), O_RDONLY)) == -1)
+	int fd = -1;
+	if (entry != NULL)
+	{
+		buf = entry->m_stat;
+		if (entry->m_statErrno != 0)
+		{
+			MojLogError(s_log, _T("ProcessFiles: Failed to stat file '%s' (%s)."),
+			            filepath.c_str(), ::strerror(entry->m_statErrno));
+			flowStat = ERROR;
+		}
+	}
+	else if((fd = open(filepath.c_str(), O_RDONLY)) == -1)
 	{
 		int savedErrno = errno;
 		MojLogError(s_log, _T("ProcessFiles: Failed to open file '%s' (%s)."),
@@ -1565,6 +2072,18 @@ CFileCacheSet::ProcessFiles(const std::string &filepath)
         if(fd >= 0)
 	  close(fd);
 
+	// The link of a memory object is left dangling once its memory file
+	// is gone, the object went with it
+	struct stat linkBuf;
+	if ((flowStat == ERROR) && (::lstat(filepath.c_str(), &linkBuf) == 0) &&
+	        S_ISLNK(linkBuf.st_mode))
+	{
+		MojLogWarning(s_log, _T("ProcessFiles: Removing memory object link '%s'."),
+		              filepath.c_str());
+		(void) ::unlink(filepath.c_str());
+		flowStat = COMPLETE;
+	}
+
 	if ((flowStat == CONTINUE) && S_ISDIR(buf.st_mode) &&
 	        isTopLevelDirectory(filepath))
 	{
@@ -1667,33 +2186,53 @@ CFileCacheSet::ProcessFiles(const std::string &filepath)
 		}
 	}
 
+	// A lazy startup walk can reach objects that were created or
+	// loaded on demand since the service started.
+	if ((flowStat == CONTINUE) && m_walkInProgress)
+	{
+		CFileCache *fileCache = GetFileCacheForType(typeName);
+		if ((fileCache != NULL) && fileCache->isCachedObject(objectId))
+		{
+			flowStat = COMPLETE;
+		}
+	}
+
+	// Read all of the attributes at once unless the scanner already did
+	CScannedEntry localEntry;
+	if ((flowStat == CONTINUE) && (entry == NULL))
+	{
+		localEntry.m_pathname = filepath;
+		localEntry.ReadAttributes();
+		entry = &localEntry;
+	}
+
 	int written = 0;
 	if (flowStat == CONTINUE)
 	{
-		flowStat = GetWritten(filepath, &written, dirType);
+		flowStat = GetWritten(filepath, &written, dirType, entry);
 	}
 
 	cacheSize_t size = 0;
 	if (flowStat == CONTINUE)
 	{
-		flowStat = GetSize(filepath, &buf, &size, dirType);
+		flowStat = GetSize(filepath, &buf, &size, dirType, entry);
 	}
 
 	if (flowStat == CONTINUE)
 	{
-		flowStat = GetFilename(filepath, fileName);
+		flowStat = GetFilename(filepath, fileName, entry);
 	}
 
 	paramValue_t cost = 1;
 	if (flowStat == CONTINUE)
 	{
-		flowStat = GetCost(filepath, &cost);
+		flowStat = GetCost(filepath, &cost, entry);
 	}
 
 	paramValue_t lifetime = 1;
 	if (flowStat == CONTINUE)
 	{
-		flowStat = GetLifetime(filepath, &lifetime);
+		flowStat = GetLifetime(filepath, &lifetime, entry);
 	}
 
 	if (flowStat == CONTINUE)
@@ -1701,9 +2240,23 @@ CFileCacheSet::ProcessFiles(const std::string &filepath)
 		MojLogDebug(s_log,
 		            _T("ProcessFiles: Path %s yielded objectId %llu and filename %s."),
 		            filepath.c_str(), objectId, fileName);
-		InsertCacheObject(msgText, typeName, std::string(fileName),
-		                  objectId, size, cost, lifetime,
-		                  written ? true : false, false);
+		cachedObjectId_t insertedId =
+		    InsertCacheObject(msgText, typeName, std::string(fileName),
+		                      objectId, size, cost, lifetime,
+		                      written ? true : false, false,
+		                      entry->m_packed && entry->m_record.m_compressed,
+		                      entry->m_record.m_storedSize);
+		if ((insertedId != 0) && !entry->m_packed)
+		{
+			CObjectRecord record;
+			record.m_filename = fileName;
+			record.m_size = size;
+			record.m_cost = cost;
+			record.m_lifetime = lifetime;
+			record.m_written = written ? true : false;
+			record.m_dirType = dirType;
+			MigrateAttributes(filepath, record, buf.st_mode);
+		}
 	}
 
 	int retVal = 0;
@@ -1717,6 +2270,58 @@ CFileCacheSet::ProcessFiles(const std::string &filepath)
 	return retVal;
 }
 
+// Replace the separate attributes of an object written by an older
+// version with the packed record.  The object has to be made writable
+// for the attributes to be changed.
+void
+CFileCacheSet::MigrateAttributes(const std::string &pathname,
+                                 const CObjectRecord &record, mode_t mode)
+{
+
+	MojLogTrace(s_log);
+
+	mode_t savedMode = record.m_dirType ? (mode & 07777) : s_fileROPerms;
+	int retVal = ::chmod(pathname.c_str(),
+	                     record.m_dirType ? s_dirObjPerms : s_fileRWPerms);
+	if (retVal != 0)
+	{
+		int savedErrno = errno;
+		MojLogError(s_log,
+		            _T("MigrateAttributes: Failed to set permissions on '%s' (%s)."),
+		            pathname.c_str(), ::strerror(savedErrno));
+		return;
+	}
+
+	const std::string value(PackObjectRecord(record));
+	retVal = FC_setxattr(pathname.c_str(), s_objectAttrName, value.data(),
+	                     value.length(), XATTR_CREATE);
+	if (retVal != 0)
+	{
+		int savedErrno = errno;
+		MojLogError(s_log,
+		            _T("MigrateAttributes: Failed to set attributes on '%s' (%s)."),
+		            pathname.c_str(), ::strerror(savedErrno));
+	}
+	else
+	{
+		for (int i = 0; i < s_numLegacyAttrs; i++)
+		{
+			FC_removexattr(pathname.c_str(), s_legacyAttrNames[i]);
+		}
+		MojLogDebug(s_log, _T("MigrateAttributes: Packed the attributes of '%s'."),
+		            pathname.c_str());
+	}
+
+	retVal = ::chmod(pathname.c_str(), savedMode);
+	if (retVal != 0)
+	{
+		int savedErrno = errno;
+		MojLogError(s_log,
+		            _T("MigrateAttributes: Failed to reset permissions on '%s' (%s)."),
+		            pathname.c_str(), ::strerror(savedErrno));
+	}
+}
+
 bool
 CFileCacheSet::FileTreeWalk(const std::string &dirName)
 {
@@ -1731,7 +2336,9 @@ CFileCacheSet::FileTreeWalk(const std::string &dirName)
 	{
 		try
 		{
-			if (ProcessFiles(dirIter1->path().string()) != 0)
+			// Objects in the trash are already removed from the cache
+			if (!IsTrashPath(dirIter1->path().string()) &&
+			        (ProcessFiles(dirIter1->path().string()) != 0))
 			{
 				retVal = false;
 			}
@@ -1757,7 +2364,8 @@ CFileCacheSet::FileTreeWalk(const std::string &dirName)
 				fs::file_status iterStatus = fs::status(dirIter2->path());
 				if (fs::status_known(iterStatus) &&
 				        fs::exists(iterStatus) &&
-				        fs::is_directory(iterStatus))
+				        fs::is_directory(iterStatus) &&
+				        !IsTrashPath(dirIter2->path().string()))
 				{
 					retVal = FileTreeWalk(dirIter2->path().string());
 				}
@@ -1774,72 +2382,1558 @@ CFileCacheSet::FileTreeWalk(const std::string &dirName)
 	return retVal;
 }
 
-// Walk the file cache directory tree to build the cache data
-// structures.
-int
-CFileCacheSet::WalkDirTree()
+// Process the entries of the file cache directory and of each type
+// directory, which defines the types, and queue the object directories
+// below them to be walked later.
+bool
+CFileCacheSet::WalkTypeDirs(const std::string &dirName)
 {
 
 	MojLogTrace(s_log);
 
-	int retVal = true;
-#ifdef DEBUG
-	long long startTime;
-	long long stopTime;
-
-#ifdef MOJ_MAC
-	startTime = ::clock() * 1000 / CLOCKS_PER_SEC;
-#else
-	struct timespec tm;
-	::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tm);
-	startTime = tm.tv_sec * 1000LL + tm.tv_nsec / 1000000;
-#endif // #ifdef MOJ_MAC
-#endif // #ifdef DEBUG
-
-	std::string dirName(GetCacheDirectory());
-	// walk the directory dirName and call ProcessFiles on each
-	// entry.
-	try
+	bool retVal = true;
+	fs::path pathname(dirName);
+	fs::directory_iterator endIter;
+	fs::directory_iterator dirIter1(pathname);
+	while ((dirIter1 != endIter) && (retVal == true))
 	{
-		if (!FileTreeWalk(dirName))
+		if (ProcessFiles(dirIter1->path().string()) != 0)
 		{
-			MojLogError(s_log, _T("WalkDirTree: Failed to complete file tree walk."));
 			retVal = false;
 		}
+		++dirIter1;
 	}
-	catch (const fs::filesystem_error &ex)
+	fs::directory_iterator dirIter2(pathname);
+	while ((dirIter2 != endIter) && (retVal == true))
 	{
-		MojLogError(s_log, _T("FileTreeWalk: %s (%s)"),
-		            ex.what(), ex.code().message().c_str());
-		MojLogError(s_log, _T("WalkDirTree: Failed to complete file tree walk."));
-		retVal = false;
+		if (fs::is_directory(dirIter2->status()))
+		{
+			// Objects in the trash are already removed from the cache and
+			// the trash is swept separately
+			fs::directory_iterator dirIter3(dirIter2->path());
+			while ((dirIter3 != endIter) && (retVal == true))
+			{
+				if (!IsTrashPath(dirIter3->path().string()) &&
+				        (ProcessFiles(dirIter3->path().string()) != 0))
+				{
+					retVal = false;
+				}
+				++dirIter3;
+			}
+
+			// Empty object directories were removed above
+			fs::directory_iterator dirIter4(dirIter2->path());
+			while ((dirIter4 != endIter) && (retVal == true))
+			{
+				if (fs::is_directory(dirIter4->status()) &&
+				        !IsTrashPath(dirIter4->path().string()))
+				{
+					m_pendingDirs.insert(dirIter4->path().string());
+				}
+				++dirIter4;
+			}
+		}
+		++dirIter2;
 	}
 
-#ifdef DEBUG
-#ifdef MOJ_MAC
-	stopTime = ::clock() * 1000 / CLOCKS_PER_SEC;
-#else
-	::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tm);
-	stopTime = tm.tv_sec * 1000LL + tm.tv_nsec / 1000000;
-#endif // #ifdef MOJ_MAC
+	return retVal;
+}
 
-	MojLogDebug(s_log, _T("Walking object directory/files took %lld ms."),
-	            stopTime - startTime);
-#endif // #ifdef DEBUG
+// Process the entries of an object directory read by the directory
+// scanner the same way FileTreeWalk processes the entries it reads.
+bool
+CFileCacheSet::ProcessScannedDir(const scannedEntries_t &entries)
+{
+
+	MojLogTrace(s_log);
+
+	bool retVal = true;
+	for (size_t i = 0; (i < entries.size()) && (retVal == true); i++)
+	{
+		if (ProcessFiles(entries[i].m_pathname, &entries[i]) != 0)
+		{
+			retVal = false;
+		}
+	}
+
+	// Directories that are still there after being processed are walked
+	for (size_t i = 0; (i < entries.size()) && (retVal == true); i++)
+	{
+		if (S_ISDIR(entries[i].m_stat.st_mode) &&
+		        fs::is_directory(fs::path(entries[i].m_pathname)))
+		{
+			retVal = FileTreeWalk(entries[i].m_pathname);
+		}
+	}
+
+	return retVal;
+}
+
+// Stop the directory scanner once the walk doesn't need it
+void
+CFileCacheSet::StopDirScanner()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_dirScanner != NULL)
+	{
+		delete m_dirScanner;
+		m_dirScanner = NULL;
+	}
+}
+
+// Walk an object directory queued by WalkTypeDirs
+void
+CFileCacheSet::WalkPendingDir(const std::string &dirName)
+{
+
+	MojLogTrace(s_log);
+
+	// Take it off the queue first so a lookup made while walking it
+	// doesn't walk it again.
+	if (m_pendingDirs.erase(dirName) > 0)
+	{
+		try
+		{
+			scannedEntries_t entries;
+			if ((m_dirScanner != NULL) &&
+			        m_dirScanner->GetEntries(dirName, entries))
+			{
+				if (!ProcessScannedDir(entries))
+				{
+					MojLogError(s_log,
+					            _T("WalkPendingDir: Failed to complete walk of '%s'."),
+					            dirName.c_str());
+					m_walkFailed = true;
+				}
+			}
+			else if (fs::exists(fs::path(dirName)) && !FileTreeWalk(dirName))
+			{
+				MojLogError(s_log,
+				            _T("WalkPendingDir: Failed to complete walk of '%s'."),
+				            dirName.c_str());
+				m_walkFailed = true;
+			}
+		}
+		catch (const fs::filesystem_error &ex)
+		{
+			MojLogError(s_log, _T("FileTreeWalk: %s (%s)"),
+			            ex.what(), ex.code().message().c_str());
+			m_walkFailed = true;
+		}
+	}
+}
+
+// Walk the queued directories that could hold the object
+void
+CFileCacheSet::WalkPendingDirsForObjectId(const cachedObjectId_t objId)
+{
+
+	MojLogTrace(s_log);
+
+	// The type isn't known so look in the object directory for the id
+	// in every type.
+	std::vector<std::string> dirNames;
+	std::map<const std::string, CFileCache *>::const_iterator iter;
+	iter = m_cacheSet.begin();
+	while (iter != m_cacheSet.end())
+	{
+		const std::string dirName(GetDirectoryFromPath(
+		                              BuildPathname(objId, GetBaseDirName(), (*iter).first, "x")));
+		if (m_pendingDirs.find(dirName) != m_pendingDirs.end())
+		{
+			dirNames.push_back(dirName);
+		}
+		++iter;
+	}
+
+	for (size_t i = 0; i < dirNames.size(); i++)
+	{
+		WalkPendingDir(dirNames[i]);
+	}
+}
+
+// Walk all the queued directories of a type
+void
+CFileCacheSet::WalkPendingDirsForType(const std::string &typeName)
+{
+
+	MojLogTrace(s_log);
+
+	const std::string typeDir(GetBaseDirName() + "/" + typeName + "/");
+	std::vector<std::string> dirNames;
+	std::set<std::string>::const_iterator iter;
+	iter = m_pendingDirs.lower_bound(typeDir);
+	while ((iter != m_pendingDirs.end()) &&
+	        ((*iter).compare(0, typeDir.length(), typeDir) == 0))
+	{
+		dirNames.push_back(*iter);
+		++iter;
+	}
+
+	for (size_t i = 0; i < dirNames.size(); i++)
+	{
+		WalkPendingDir(dirNames[i]);
+	}
+}
+
+// Walk one object directory queued by a lazy WalkDirTree.  Once all
+// are done this does the startup cleanup and returns false.
+bool
+CFileCacheSet::ContinueWalkDirTree()
+{
+
+	MojLogTrace(s_log);
+
+	if (!m_pendingDirs.empty())
+	{
+		const std::string dirName(*m_pendingDirs.begin());
+		WalkPendingDir(dirName);
+	}
+	if (m_walkInProgress && m_pendingDirs.empty())
+	{
+		FinishWalkDirTree();
+	}
+
+	return m_walkInProgress;
+}
+
+// Complete a lazy walk the same way WalkDirTree completes a full one
+void
+CFileCacheSet::FinishWalkDirTree()
+{
+
+	MojLogTrace(s_log);
+
+	m_walkInProgress = false;
+	StopDirScanner();
+
+	// Objects were inserted while the sizes of the objects not walked
+	// yet were unknown so the cache may have gone over its space.
+	CleanupAtStartup();
+	PrefetchAtStartup();
+
+	if (m_walkFailed)
+	{
+		m_cacheIndex->Invalidate();
+	}
+	else
+	{
+		WriteCacheIndex();
+	}
+
+	m_walkDuration = GetMonotonicMicros() - m_walkStartMicros;
+	MojLogInfo(s_log, _T("FinishWalkDirTree: Walk completed in %ld seconds."),
+	           (long) (::time(0) - m_walkStartTime));
+}
+
+// Walk the file cache directory tree to build the cache data
+// structures.
+int
+CFileCacheSet::WalkDirTree(bool lazy)
+{
+
+	MojLogTrace(s_log);
+
+	int retVal = true;
+	m_walkStartMicros = GetMonotonicMicros();
+#ifdef DEBUG
+	long long startTime;
+	long long stopTime;
+
+#ifdef MOJ_MAC
+	startTime = ::clock() * 1000 / CLOCKS_PER_SEC;
+#else
+	struct timespec tm;
+	::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tm);
+	startTime = tm.tv_sec * 1000LL + tm.tv_nsec / 1000000;
+#endif // #ifdef MOJ_MAC
+#endif // #ifdef DEBUG
+
+	if (m_cacheIndex == NULL)
+	{
+		m_cacheIndex = new CCacheIndex(GetBaseDirName());
+	}
+	bool indexChanged = false;
+	bool indexLoaded = LoadCacheIndex(&indexChanged);
+
+	// Without the index nothing says which memory files belong to which
+	// objects, they are dropped and the walk removes the links to them
+	if (!indexLoaded && isMemoryTier())
+	{
+		MakeMemoryDir(true);
+	}
+
+	std::string dirName(GetCacheDirectory());
+	// walk the directory dirName and call ProcessFiles on each
+	// entry.
+	try
+	{
+		if (!indexLoaded && (lazy || (m_scanThreads > 1)))
+		{
+			m_walkStartTime = ::time(0);
+			if (WalkTypeDirs(dirName))
+			{
+				m_walkInProgress = !m_pendingDirs.empty();
+				if (m_walkInProgress && (m_scanThreads > 1))
+				{
+					m_dirScanner = new CDirScanner((size_t) m_scanThreads);
+					m_dirScanner->Start(m_pendingDirs);
+				}
+
+				// Without lazy startup all the object directories are
+				// walked before the service starts.
+				if (!lazy)
+				{
+					while (!m_pendingDirs.empty())
+					{
+						const std::string pendingDir(*m_pendingDirs.begin());
+						WalkPendingDir(pendingDir);
+					}
+					m_walkInProgress = false;
+					StopDirScanner();
+					if (m_walkFailed)
+					{
+						MojLogError(s_log, _T("WalkDirTree: Failed to complete file tree walk."));
+						retVal = false;
+					}
+				}
+			}
+			else
+			{
+				MojLogError(s_log, _T("WalkDirTree: Failed to complete file tree walk."));
+				m_pendingDirs.clear();
+				retVal = false;
+			}
+		}
+		else if (!indexLoaded && !FileTreeWalk(dirName))
+		{
+			MojLogError(s_log, _T("WalkDirTree: Failed to complete file tree walk."));
+			retVal = false;
+		}
+	}
+	catch (const fs::filesystem_error &ex)
+	{
+		MojLogError(s_log, _T("FileTreeWalk: %s (%s)"),
+		            ex.what(), ex.code().message().c_str());
+		MojLogError(s_log, _T("WalkDirTree: Failed to complete file tree walk."));
+		m_pendingDirs.clear();
+		m_walkInProgress = false;
+		StopDirScanner();
+		retVal = false;
+	}
+
+	// Start journaling changes.  A new snapshot is only needed if the
+	// index was rebuilt or differs from the one on disk.  An incomplete
+	// walk must not be saved as the missing objects would never be
+	// found again.
+	if (!retVal)
+	{
+		m_cacheIndex->Invalidate();
+	}
+	else if (m_walkInProgress)
+	{
+		// FinishWalkDirTree writes the snapshot
+		MojLogInfo(s_log, _T("WalkDirTree: %d object directories left to walk."),
+		           (int) m_pendingDirs.size());
+	}
+	else if (indexLoaded && !indexChanged)
+	{
+		m_cacheIndex->OpenJournal();
+	}
+	else
+	{
+		WriteCacheIndex();
+	}
+
+	// A lazy walk is timed when it finishes from the main loop
+	if (!m_walkInProgress)
+	{
+		m_walkDuration = GetMonotonicMicros() - m_walkStartMicros;
+	}
+
+#ifdef DEBUG
+#ifdef MOJ_MAC
+	stopTime = ::clock() * 1000 / CLOCKS_PER_SEC;
+#else
+	::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tm);
+	stopTime = tm.tv_sec * 1000LL + tm.tv_nsec / 1000000;
+#endif // #ifdef MOJ_MAC
+
+	MojLogDebug(s_log, _T("%s took %lld ms."),
+	            indexLoaded ? "Loading the cache index" :
+	            m_walkInProgress ? "Walking type directories" :
+	            "Walking object directory/files", stopTime - startTime);
+#endif // #ifdef DEBUG
+
+	return retVal;
+}
+
+// Fill in the cache index record for a type
+static void
+GetIndexedType(CFileCache *fileCache, CIndexedType &type)
+{
+	type.m_typeName = fileCache->GetType();
+	fileCache->Describe(type.m_params);
+	type.m_dirType = fileCache->isDirType();
+}
+
+// Fill in the cache index record for an object
+static void
+GetIndexedObject(CCacheObject *cacheObject, CIndexedObject &object)
+{
+	object.m_id = cacheObject->GetId();
+	object.m_typeName = cacheObject->GetFileCacheType();
+	object.m_filename = cacheObject->GetFileName();
+	object.m_size = cacheObject->GetSize();
+	object.m_cost = cacheObject->GetCost();
+	object.m_lifetime = cacheObject->GetLifetime();
+	object.m_written = cacheObject->isWritten();
+	object.m_compressed = cacheObject->isCompressed();
+	object.m_storedSize = cacheObject->GetStoredSize();
+	object.m_inMemory = cacheObject->isInMemory();
+}
+
+// Write a snapshot of the cache index so the next start doesn't need
+// to walk the directory tree.  A clean snapshot is written when the
+// service shuts down.
+bool
+CFileCacheSet::WriteCacheIndex(bool clean)
+{
+
+	MojLogTrace(s_log);
+
+	// Saving a partial walk would lose the objects not walked yet
+	bool retVal = false;
+	if ((m_cacheIndex != NULL) && !m_walkInProgress)
+	{
+		indexedTypes_t types;
+		indexedObjects_t objects;
+		std::map<const std::string, CFileCache *>::const_iterator iter;
+		iter = m_cacheSet.begin();
+		while (iter != m_cacheSet.end())
+		{
+			CFileCache *fileCache = (*iter).second;
+			GetIndexedType(fileCache, types[(*iter).first]);
+
+			std::vector<std::pair<cachedObjectId_t, CCacheObject *>> curObjs;
+			curObjs = fileCache->GetCachedObjects();
+			for (size_t i = 0; i < curObjs.size(); i++)
+			{
+				GetIndexedObject(curObjs[i].second, objects[curObjs[i].first]);
+			}
+			++iter;
+		}
+		retVal = m_cacheIndex->WriteSnapshot(types, objects, clean);
+	}
 
 	return retVal;
 }
 
+// Returns true if the cache index journal holds changes that are not
+// in the snapshot yet.
+bool
+CFileCacheSet::CacheIndexNeedsSnapshot()
+{
+
+	MojLogTrace(s_log);
+
+	return ((m_cacheIndex != NULL) && m_cacheIndex->isOpen() &&
+	        (m_cacheIndex->GetNumJournalRecords() > 0));
+}
+
+// Record the current state of an object in the cache index journal
+void
+CFileCacheSet::JournalCacheObject(CCacheObject *cacheObject)
+{
+
+	MojLogTrace(s_log);
+
+	if ((m_cacheIndex != NULL) && m_cacheIndex->isOpen())
+	{
+		CIndexedObject object;
+		GetIndexedObject(cacheObject, object);
+		m_cacheIndex->JournalObject(object);
+	}
+}
+
+// Record the removal of an object in the cache index journal
+void
+CFileCacheSet::JournalCacheObjectRemoved(const cachedObjectId_t objId)
+{
+
+	MojLogTrace(s_log);
+
+	if ((m_cacheIndex != NULL) && m_cacheIndex->isOpen())
+	{
+		m_cacheIndex->JournalRemoveObject(objId);
+	}
+}
+
+// Compress an object that has just been written if its type is
+// configured to compress, then look for an object with the same
+// content.  The content is compressed into the trash on the I/O pool,
+// keyed by the type so it stays ordered with the removals of the
+// type's objects.  Content that doesn't save a block is left as it is.
+void
+CFileCacheSet::CompressCacheObject(CCacheObject *cacheObject)
+{
+
+	MojLogTrace(s_log);
+
+	// A memory object is kept as it is, its content is only compressed
+	// or shared once it has been moved to the cache directory
+	if (cacheObject->isInMemory())
+	{
+		if (!BelongsInMemory(cacheObject->GetFileCache(), cacheObject->GetSize()))
+		{
+			(void) DemoteMemoryObjects();
+		}
+		return;
+	}
+
+	if (!cacheObject->GetFileCache()->isCompressed() ||
+	        cacheObject->isDirType() || !cacheObject->isWritten() ||
+	        cacheObject->isCompressed() || (cacheObject->GetSize() == 0))
+	{
+		DedupCacheObject(cacheObject);
+		return;
+	}
+
+	const cachedObjectId_t objId = cacheObject->GetId();
+	const cacheSize_t size = cacheObject->GetSize();
+	const std::string pathname(cacheObject->GetPathname());
+	std::shared_ptr<std::string> compressedPath(new std::string);
+	std::shared_ptr<cacheSize_t> storedSize(new cacheSize_t(-1));
+	ioWork_t work = [pathname, size, compressedPath, storedSize]()
+	{
+		std::string msgText;
+		if (!MakeTrashPath(pathname, ".z", *compressedPath))
+		{
+			int savedErrno = errno;
+			MojLogWarning(s_log,
+			              _T("CompressCacheObject: Failed to make trash for '%s' (%s)."),
+			              pathname.c_str(), ::strerror(savedErrno));
+		}
+		else if (!CompressFile(pathname, *compressedPath, *storedSize, msgText))
+		{
+			MojLogWarning(s_log, _T("CompressCacheObject: %s"), msgText.c_str());
+			*storedSize = -1;
+		}
+		else if (GetFilesystemFileSize(*storedSize) >= GetFilesystemFileSize(size))
+		{
+			MojLogDebug(s_log,
+			            _T("CompressCacheObject: '%s' doesn't compress, left as it is."),
+			            pathname.c_str());
+			(void) ::unlink(compressedPath->c_str());
+			*storedSize = -1;
+		}
+	};
+	ioWork_t done = [this, objId, compressedPath, storedSize]()
+	{
+		CompressContent(objId, *compressedPath, *storedSize);
+	};
+	if (m_ioPool != NULL)
+	{
+		m_ioPool->Post(cacheObject->GetFileCache()->GetType(), work, done);
+	}
+	else
+	{
+		work();
+		done();
+	}
+}
+
+// Replace the file of a written object with the compressed content
+// made on the I/O pool, if there is any, and go on to look for an
+// object with the same content.  A subscriber may have the path of the
+// file open already, so a subscribed object stays uncompressed.
+void
+CFileCacheSet::CompressContent(const cachedObjectId_t objId,
+                               const std::string &compressedPath,
+                               const cacheSize_t storedSize)
+{
+
+	MojLogTrace(s_log);
+
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+	const bool cached = (cacheObject != NULL) && !cacheObject->isExpired();
+	if (storedSize >= 0)
+	{
+		if (cached && (cacheObject->GetSubscriptionCount() == 0))
+		{
+			(void) cacheObject->GetFileCache()->CompressObject(objId, compressedPath,
+			        storedSize);
+		}
+		else
+		{
+			(void) ::unlink(compressedPath.c_str());
+		}
+	}
+	if (cached)
+	{
+		DedupCacheObject(cacheObject);
+	}
+}
+
+// Returns true if a file object of size belongs in memory, because its
+// type is kept in memory or because it is small enough
+bool
+CFileCacheSet::BelongsInMemory(CFileCache *fileCache, const cacheSize_t size)
+{
+
+	return isMemoryTier() && !fileCache->isDirType() &&
+	       (fileCache->isMemory() ||
+	        ((m_memoryObjectSize > 0) && (size <= m_memoryObjectSize)));
+}
+
+// Called by an object as it is kept in memory
+void
+CFileCacheSet::AddMemoryObject(CCacheObject *cacheObject)
+{
+
+	m_memoryObjects[cacheObject->GetId()] = cacheObject;
+	m_memorySize += GetFilesystemFileSize(cacheObject->GetSize());
+}
+
+// Called by a memory object as it is moved out of memory or removed
+void
+CFileCacheSet::RemoveMemoryObject(CCacheObject *cacheObject)
+{
+
+	if (m_memoryObjects.erase(cacheObject->GetId()) > 0)
+	{
+		m_memorySize -= GetFilesystemFileSize(cacheObject->GetSize());
+	}
+}
+
+// Move memory objects to the cache directory.  Only written objects
+// are moved, their content can't change.  The objects already being
+// moved count as gone.
+paramValue_t
+CFileCacheSet::DemoteMemoryObjects(const cacheSize_t neededSpace)
+{
+
+	MojLogTrace(s_log);
+
+	if (m_memoryObjects.empty())
+	{
+		return 0;
+	}
+
+	cacheSize_t remaining = m_memorySize;
+	std::vector<CCacheObject *> demotions;
+	std::vector<std::pair<time_t, cachedObjectId_t> > candidates;
+	std::map<cachedObjectId_t, CCacheObject *>::const_iterator iter;
+	iter = m_memoryObjects.begin();
+	while (iter != m_memoryObjects.end())
+	{
+		CCacheObject *cacheObject = (*iter).second;
+		const cacheSize_t size = GetFilesystemFileSize(cacheObject->GetSize());
+		if (m_pendingDemotions.find((*iter).first) != m_pendingDemotions.end())
+		{
+			remaining -= size;
+		}
+		else if (cacheObject->isWritten() && !cacheObject->isExpired())
+		{
+			if (!BelongsInMemory(cacheObject->GetFileCache(),
+			                     cacheObject->GetSize()))
+			{
+				demotions.push_back(cacheObject);
+				remaining -= size;
+			}
+			else
+			{
+				candidates.push_back(std::make_pair(cacheObject->GetLastAccessTime(),
+				                                    (*iter).first));
+			}
+		}
+		++iter;
+	}
+
+	// Other users of the memory filesystem can fill it before the memory
+	// objects reach their hiWatermark
+	const cacheSize_t freeSpace = GetFilesystemFreeSpace(m_memoryDirName);
+	const bool pressure = (freeSpace >= 0) &&
+	                      (freeSpace < m_memoryHiWatermark - remaining);
+	if (pressure || (remaining + neededSpace > m_memoryHiWatermark))
+	{
+		std::sort(candidates.begin(), candidates.end());
+		std::vector<std::pair<time_t, cachedObjectId_t> >::const_iterator
+		candidate = candidates.begin();
+		while ((candidate != candidates.end()) &&
+		        (remaining + neededSpace > m_memoryLoWatermark))
+		{
+			CCacheObject *cacheObject = m_memoryObjects[(*candidate).second];
+			demotions.push_back(cacheObject);
+			remaining -= GetFilesystemFileSize(cacheObject->GetSize());
+			++candidate;
+		}
+	}
+
+	std::vector<CCacheObject *>::const_iterator demotion = demotions.begin();
+	while (demotion != demotions.end())
+	{
+		StartDemotion(*demotion);
+		++demotion;
+	}
+	if (!demotions.empty())
+	{
+		MojLogInfo(s_log,
+		           _T("DemoteMemoryObjects: Moving '%d' objects out of memory, '%lld' bytes stay."),
+		           (int) demotions.size(), remaining);
+	}
+
+	return (paramValue_t) demotions.size();
+}
+
+// Copy the content of a memory object into the trash of the cache
+// directory, on the I/O pool keyed by the type so it stays ordered with
+// the removals of the type's objects, and move the object once the copy
+// is synced
+void
+CFileCacheSet::StartDemotion(CCacheObject *cacheObject)
+{
+
+	MojLogTrace(s_log);
+
+	const cachedObjectId_t objId = cacheObject->GetId();
+	const cacheSize_t size = cacheObject->GetSize();
+	const std::string pathname(cacheObject->GetPathname());
+	const std::string memoryPath(cacheObject->GetMemoryPathname());
+	m_pendingDemotions.insert(objId);
+	std::shared_ptr<std::string> copyPath(new std::string);
+	ioWork_t work = [pathname, memoryPath, size, copyPath]()
+	{
+		std::string msgText;
+		cacheSize_t copied = -1;
+		if (!MakeTrashPath(pathname, ".m", *copyPath))
+		{
+			int savedErrno = errno;
+			MojLogWarning(s_log,
+			              _T("DemoteMemoryObjects: Failed to make trash for '%s' (%s)."),
+			              pathname.c_str(), ::strerror(savedErrno));
+			copyPath->clear();
+		}
+		else if (!CopyFile(memoryPath, *copyPath, copied, msgText))
+		{
+			MojLogWarning(s_log, _T("DemoteMemoryObjects: %s"), msgText.c_str());
+			copyPath->clear();
+		}
+		else if (copied != size)
+		{
+			MojLogError(s_log,
+			            _T("DemoteMemoryObjects: Copied '%lld' bytes of '%s', expected '%lld'."),
+			            copied, memoryPath.c_str(), size);
+			(void) ::unlink(copyPath->c_str());
+			copyPath->clear();
+		}
+	};
+	ioWork_t done = [this, objId, copyPath]()
+	{
+		DemoteContent(objId, *copyPath);
+	};
+	if (m_ioPool != NULL)
+	{
+		m_ioPool->Post(cacheObject->GetFileCache()->GetType(), work, done);
+	}
+	else
+	{
+		work();
+		done();
+	}
+}
+
+// Move a memory object to the cache directory with the copy of its
+// content made on the I/O pool, if there is one and the object is
+// still cached.  An object that failed to copy stays in memory and can
+// be tried again.
+void
+CFileCacheSet::DemoteContent(const cachedObjectId_t objId,
+                             const std::string &copyPath)
+{
+
+	MojLogTrace(s_log);
+
+	m_pendingDemotions.erase(objId);
+	if (copyPath.empty())
+	{
+		return;
+	}
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+	if ((cacheObject != NULL) && !cacheObject->isExpired())
+	{
+		(void) cacheObject->GetFileCache()->DemoteObject(objId, copyPath);
+	}
+	else
+	{
+		(void) ::unlink(copyPath.c_str());
+	}
+}
+
+// Make the memory directory, cleaning out whatever is in it first if
+// clean is set.  The memory tier is turned off if it can't be made.
+void
+CFileCacheSet::MakeMemoryDir(bool clean)
+{
+
+	MojLogTrace(s_log);
+
+	std::string msgText;
+	if (clean && !CleanupDir(m_memoryDirName, msgText))
+	{
+		MojLogError(s_log, _T("MakeMemoryDir: %s"), msgText.c_str());
+	}
+	int retVal = ::mkdir(m_memoryDirName.c_str(), s_dirPerms);
+	if ((retVal != 0) && (errno != EEXIST))
+	{
+		int savedErrno = errno;
+		MojLogError(s_log,
+		            _T("MakeMemoryDir: Failed to create memory directory '%s' (%s), not keeping objects in memory."),
+		            m_memoryDirName.c_str(), ::strerror(savedErrno));
+		m_memoryDirName.clear();
+	}
+}
+
+// Look for an object with the same content as one that has just been
+// written.  The hash runs on the I/O pool, keyed by the type so it
+// stays ordered with the removals of the type's objects, and the
+// candidates it finds are compared there too.  Only the bookkeeping and
+// the link itself happen on the main thread, after checking the
+// objects are still there.
+void
+CFileCacheSet::DedupCacheObject(CCacheObject *cacheObject)
+{
+
+	MojLogTrace(s_log);
+
+	if (!m_dedupObjects || cacheObject->isDirType() ||
+	        !cacheObject->isWritten() || (cacheObject->GetSize() == 0))
+	{
+		return;
+	}
+
+	const cachedObjectId_t objId = cacheObject->GetId();
+	const std::string pathname(cacheObject->GetPathname());
+	std::shared_ptr<uint64_t> hash(new uint64_t(0));
+	std::shared_ptr<bool> hashed(new bool(false));
+	ioWork_t work = [pathname, hash, hashed]()
+	{
+		std::string msgText;
+		*hashed = HashFile(pathname, *hash, msgText);
+		if (!*hashed)
+		{
+			MojLogWarning(s_log, _T("DedupCacheObject: %s"), msgText.c_str());
+		}
+	};
+	ioWork_t done = [this, objId, hash, hashed]()
+	{
+		if (*hashed)
+		{
+			MatchContent(objId, *hash);
+		}
+	};
+	if (m_ioPool != NULL)
+	{
+		m_ioPool->Post(cacheObject->GetFileCache()->GetType(), work, done);
+	}
+	else
+	{
+		work();
+		done();
+	}
+}
+
+// Returns true if an object is still cached, written, of size and
+// compressed or not the same way, so its file can be shared.  The file
+// of a memory object isn't, it's about to move.
+bool
+CFileCacheSet::isDedupCandidate(const cachedObjectId_t objId,
+                                const cacheSize_t size, const bool compressed)
+{
+
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+
+	return (cacheObject != NULL) && cacheObject->isWritten() &&
+	       !cacheObject->isExpired() && !cacheObject->isDirType() &&
+	       !cacheObject->isInMemory() &&
+	       (cacheObject->GetSize() == size) &&
+	       (cacheObject->isCompressed() == compressed);
+}
+
+// Find the objects already cached with the hash of a written object
+// and compare their content with it.  An object with content nothing
+// else has starts a new group.
+void
+CFileCacheSet::MatchContent(const cachedObjectId_t objId, const uint64_t hash)
+{
+
+	MojLogTrace(s_log);
+
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+	if ((cacheObject == NULL) || cacheObject->isExpired() ||
+	        (m_dedupTable.GetOwner(objId) != 0))
+	{
+		return;
+	}
+
+	std::vector<cachedObjectId_t> owners;
+	m_dedupTable.Find(hash, owners);
+	std::vector<std::pair<cachedObjectId_t, std::string> > candidates;
+	std::vector<cachedObjectId_t>::const_iterator iter = owners.begin();
+	while (iter != owners.end())
+	{
+		if (isDedupCandidate(*iter, cacheObject->GetSize(),
+		                     cacheObject->isCompressed()))
+		{
+			candidates.push_back(std::make_pair(*iter,
+			                                    GetCacheObjectForId(*iter)->GetPathname()));
+		}
+		++iter;
+	}
+	if (candidates.empty())
+	{
+		LinkContent(objId, hash, 0);
+		return;
+	}
+
+	const std::string pathname(cacheObject->GetPathname());
+	std::shared_ptr<cachedObjectId_t> match(new cachedObjectId_t(0));
+	ioWork_t work = [pathname, candidates, match]()
+	{
+		std::vector<std::pair<cachedObjectId_t, std::string> >::const_iterator
+		candidateIter = candidates.begin();
+		while ((*match == 0) && (candidateIter != candidates.end()))
+		{
+			if (CompareFiles(pathname, (*candidateIter).second))
+			{
+				*match = (*candidateIter).first;
+			}
+			++candidateIter;
+		}
+	};
+	ioWork_t done = [this, objId, hash, match]()
+	{
+		LinkContent(objId, hash, *match);
+	};
+	if (m_ioPool != NULL)
+	{
+		m_ioPool->Post(cacheObject->GetFileCache()->GetType(), work, done);
+	}
+	else
+	{
+		work();
+		done();
+	}
+}
+
+// Link a written object to the file of owner, an object found to have
+// the same content, or add it to the table as the owner of its own
+// content if owner is 0 or the link can't be made
+void
+CFileCacheSet::LinkContent(const cachedObjectId_t objId, const uint64_t hash,
+                           const cachedObjectId_t owner)
+{
+
+	MojLogTrace(s_log);
+
+	CCacheObject *cacheObject = GetCacheObjectForId(objId);
+	if ((cacheObject == NULL) || cacheObject->isExpired() ||
+	        (m_dedupTable.GetOwner(objId) != 0))
+	{
+		return;
+	}
+
+	if ((owner != 0) &&
+	        isDedupCandidate(owner, cacheObject->GetSize(),
+	                         cacheObject->isCompressed()) &&
+	        (m_dedupTable.GetOwner(owner) == owner))
+	{
+		CCacheObject *ownerObject = GetCacheObjectForId(owner);
+		const std::string target(ownerObject->GetPathname());
+		if (ownerObject->ShareFile() &&
+		        cacheObject->GetFileCache()->LinkObject(objId, target))
+		{
+			m_dedupTable.Link(owner, objId);
+			return;
+		}
+	}
+	m_dedupTable.Add(hash, objId);
+}
+
+// Forget the content of a removed object.  The object charged for the
+// shared file next is the oldest link still cached, links already on
+// their way out are dropped from the table and stay uncharged.
+void
+CFileCacheSet::ReleaseContent(const cachedObjectId_t objId)
+{
+
+	MojLogTrace(s_log);
+
+	cachedObjectId_t newOwner = m_dedupTable.Remove(objId);
+	while (newOwner != 0)
+	{
+		CCacheObject *cacheObject = GetCacheObjectForId(newOwner);
+		if (cacheObject != NULL)
+		{
+			cacheObject->GetFileCache()->ChargeObject(newOwner);
+			break;
+		}
+		newOwner = m_dedupTable.Remove(newOwner);
+	}
+}
+
+// Record the current configuration of a type in the cache index
+// journal
+void
+CFileCacheSet::JournalCacheType(const std::string &typeName)
+{
+
+	MojLogTrace(s_log);
+
+	CFileCache *fileCache = GetFileCacheForType(typeName);
+	if ((fileCache != NULL) && (m_cacheIndex != NULL) &&
+	        m_cacheIndex->isOpen())
+	{
+		CIndexedType type;
+		GetIndexedType(fileCache, type);
+		m_cacheIndex->JournalType(type);
+	}
+}
+
+// Rebuild the cache data structures from the cache index.  Returns
+// false if the index can't be used.  Objects that were never
+// completely written are removed just like the directory walk does,
+// in which case changed is set as the index no longer matches.
+bool
+CFileCacheSet::LoadCacheIndex(bool *changed)
+{
+
+	MojLogTrace(s_log);
+
+	indexedTypes_t types;
+	indexedObjects_t objects;
+	if (!m_cacheIndex->Load(types, objects))
+	{
+		return false;
+	}
+	*changed = (m_cacheIndex->GetNumJournalRecords() > 0);
+
+	indexedTypes_t::const_iterator typeIter = types.begin();
+	while (typeIter != types.end())
+	{
+		const CIndexedType &type = (*typeIter).second;
+		if (GetFileCacheForType(type.m_typeName) == NULL)
+		{
+			CFileCache *fileCache = new CFileCache(this, type.m_typeName);
+			fileCache->Restore(type.m_params, type.m_dirType);
+			m_cacheSet.insert(std::map < const std::string,
+			                  CFileCache * >::value_type(type.m_typeName, fileCache));
+		}
+		++typeIter;
+	}
+
+	indexedObjects_t::const_iterator objIter = objects.begin();
+	while (objIter != objects.end())
+	{
+		const CIndexedObject &object = (*objIter).second;
+
+		// A memory object is gone if its memory file is, after a reboot
+		// or if the memory tier is no longer configured
+		std::string memoryPath;
+		bool lost = false;
+		if (object.m_inMemory)
+		{
+			struct stat buf;
+			memoryPath = BuildPathname(object.m_id, m_memoryDirName,
+			                           object.m_typeName, object.m_filename);
+			lost = !isMemoryTier() || (::stat(memoryPath.c_str(), &buf) != 0);
+		}
+		if (!lost && (object.m_written || isTypeDirType(object.m_typeName)))
+		{
+			std::string msgText;
+			InsertCacheObject(msgText, object.m_typeName, object.m_filename,
+			                  object.m_id, object.m_size, object.m_cost,
+			                  object.m_lifetime, object.m_written, false,
+			                  object.m_compressed, object.m_storedSize,
+			                  object.m_inMemory);
+		}
+		else
+		{
+			const std::string pathname(BuildPathname(object.m_id, GetBaseDirName(),
+			                           object.m_typeName, object.m_filename));
+			MojLogError(s_log,
+			            _T("LoadCacheIndex: Cleaning up %s cache object on '%s'."),
+			            lost ? "lost memory" : "un-written", pathname.c_str());
+			if (object.m_inMemory && isMemoryTier())
+			{
+				(void) ::unlink(memoryPath.c_str());
+			}
+			if ((::unlink(pathname.c_str()) != 0) && (errno != ENOENT))
+			{
+				int savedErrno = errno;
+				MojLogError(s_log,
+				            _T("LoadCacheIndex: Failed to unlink file '%s' (%s)."),
+				            pathname.c_str(), ::strerror(savedErrno));
+			}
+			const std::string dirpath(GetDirectoryFromPath(pathname));
+			int retVal = ::rmdir(dirpath.c_str());
+			if ((retVal != 0) && (errno != ENOTEMPTY) && (errno != ENOENT))
+			{
+				int savedErrno = errno;
+				MojLogError(s_log,
+				            _T("LoadCacheIndex: Failed to rmdir directory '%s' (%s)."),
+				            dirpath.c_str(), ::strerror(savedErrno));
+			}
+			*changed = true;
+		}
+		++objIter;
+	}
+
+	return true;
+}
+
+// Flush written objects on a sync queue from now on rather than in
+// UnSubscribe.  Returns the queue's event fd, which polls readable when
+// FinishSyncs has objects to finish.
+int
+CFileCacheSet::StartSyncQueue()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_syncQueue == NULL)
+	{
+		unsigned int syncDelay = (m_syncDelay > 0) ? (unsigned int) m_syncDelay : 0;
+		m_syncQueue = new CSyncQueue(syncDelay);
+		MojLogInfo(s_log, _T("StartSyncQueue: Batching syncs for up to %u ms."),
+		           syncDelay);
+	}
+
+	return m_syncQueue->GetEventFd();
+}
+
+// Mark the objects the sync queue has flushed as written
+void
+CFileCacheSet::FinishSyncs()
+{
+
+	MojLogTrace(s_log);
+
+	syncRequests_t completed;
+	if ((m_syncQueue == NULL) || !m_syncQueue->GetCompleted(completed))
+	{
+		return;
+	}
+
+	syncRequests_t::const_iterator iter = completed.begin();
+	while (iter != completed.end())
+	{
+		CFileCache *fileCache = GetFileCacheForType((*iter).m_typeName);
+		if (fileCache != NULL)
+		{
+			fileCache->SyncDone((*iter).m_objId, (*iter).m_synced);
+		}
+		else
+		{
+			MojLogWarning(s_log,
+			              _T("FinishSyncs: No cache of type '%s' found for id '%llu'."),
+			              (*iter).m_typeName.c_str(), (*iter).m_objId);
+		}
+		++iter;
+	}
+}
+
+// Flush the objects still queued, finish them and go back to flushing
+// in UnSubscribe
+void
+CFileCacheSet::StopSyncQueue()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_syncQueue != NULL)
+	{
+		m_syncQueue->Stop();
+		FinishSyncs();
+		delete m_syncQueue;
+		m_syncQueue = NULL;
+	}
+}
+
+// Remove objects and sum directories on an I/O worker pool from now on
+// rather than on the calling thread.  Returns the pool's event fd,
+// which polls readable when RunIoCompletions has work to complete.
+int
+CFileCacheSet::StartIoPool()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_ioPool == NULL)
+	{
+		size_t ioThreads = (m_ioThreads > 1) ? (size_t) m_ioThreads : 1;
+		m_ioPool = new CIoWorkerPool(ioThreads);
+		MojLogInfo(s_log, _T("StartIoPool: Started %zu I/O threads."), ioThreads);
+	}
+
+	return m_ioPool->GetEventFd();
+}
+
+// Run the completions of the I/O work that has finished
+void
+CFileCacheSet::RunIoCompletions()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_ioPool != NULL)
+	{
+		m_ioPool->RunCompletions();
+	}
+}
+
+// Delete the objects left in the trash of each type when the service
+// last stopped, on the I/O worker pool if there is one.  The tree walk
+// skips the trash so nothing there is put back in the cache.
+void
+CFileCacheSet::SweepTrash()
+{
+
+	MojLogTrace(s_log);
+
+	try
+	{
+		fs::path pathname(GetBaseDirName());
+		fs::directory_iterator endIter;
+		fs::directory_iterator dirIter(pathname);
+		while (dirIter != endIter)
+		{
+			const std::string typeName(dirIter->path().filename().string());
+			const std::string trashDir(dirIter->path().string() + "/" +
+			                           s_trashDirName);
+			if (fs::is_directory(dirIter->status()) &&
+			        (::access(trashDir.c_str(), F_OK) == 0))
+			{
+				MojLogInfo(s_log, _T("SweepTrash: Sweeping '%s'."), trashDir.c_str());
+				if (m_ioPool != NULL)
+				{
+					m_ioPool->Post(typeName, [trashDir]()
+					{
+						std::string msgText;
+						if (!ReapTrash(trashDir, msgText))
+						{
+							MojLogError(s_log, _T("SweepTrash: %s"), msgText.c_str());
+						}
+					});
+				}
+				else
+				{
+					std::string msgText;
+					if (!ReapTrash(trashDir, msgText))
+					{
+						MojLogError(s_log, _T("SweepTrash: %s"), msgText.c_str());
+					}
+				}
+			}
+			++dirIter;
+		}
+	}
+	catch (const fs::filesystem_error &ex)
+	{
+		MojLogError(s_log, _T("SweepTrash: %s (%s)"), ex.what(),
+		            ex.code().message().c_str());
+	}
+}
+
+// Finish the queued I/O work, complete it and go back to doing the work
+// inline
+void
+CFileCacheSet::StopIoPool()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_ioPool != NULL)
+	{
+		m_ioPool->Stop();
+		m_ioPool->RunCompletions();
+		delete m_ioPool;
+		m_ioPool = NULL;
+	}
+}
+
+// Answer read-only requests on a pool of reader threads from now on.
+// The readers share the lock for reading and the main loop only takes
+// it for writing while it changes the cache.  Returns the pool's event
+// fd, or -1 if the requests are configured to stay on the main loop.
+int
+CFileCacheSet::StartReadPool()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_readThreads <= 0)
+	{
+		return -1;
+	}
+	if (m_readPool == NULL)
+	{
+		m_readPool = new CIoWorkerPool((size_t) m_readThreads);
+		MojLogInfo(s_log, _T("StartReadPool: Started %d reader threads."),
+		           m_readThreads);
+	}
+
+	return m_readPool->GetEventFd();
+}
+
+// Keep the readers out while the main loop changes the cache.  Only the
+// main loop calls this so the depth needs no lock of its own.  The lock
+// prefers writers, so this waits only for the requests already being
+// answered.
+void
+CFileCacheSet::LockForWrite()
+{
+
+	if ((m_writeDepth++ == 0) && (m_readPool != NULL))
+	{
+		m_lock.WriteLock();
+		m_writeLocked = true;
+	}
+}
+
+// Let the readers back in once the outermost change is done
+void
+CFileCacheSet::UnlockForWrite()
+{
+
+	if ((--m_writeDepth == 0) && m_writeLocked)
+	{
+		m_lock.Unlock();
+		m_writeLocked = false;
+	}
+}
+
+// Send the replies of the requests that have been answered
+void
+CFileCacheSet::RunReadCompletions()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_readPool != NULL)
+	{
+		m_readPool->RunCompletions();
+	}
+}
+
+// Answer the queued requests and go back to answering requests inline.
+// The lock has to be given up first if the main loop holds it, the
+// queued requests can't be answered until it does.
+void
+CFileCacheSet::StopReadPool()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_readPool != NULL)
+	{
+		if (m_writeLocked)
+		{
+			m_lock.Unlock();
+			m_writeLocked = false;
+		}
+		m_readPool->Stop();
+		m_readPool->RunCompletions();
+		delete m_readPool;
+		m_readPool = NULL;
+	}
+}
+
+// Track the size of objects being written from now on, validating them
+// as they change rather than walking them to check.  Returns the
+// tracker's inotify fd, which polls readable when ProcessDirSizeEvents
+// has events to process.
+int
+CFileCacheSet::StartDirSizeTracker()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_dirSizeTracker == NULL)
+	{
+		m_dirSizeTracker = new CDirSizeTracker();
+	}
+
+	return m_dirSizeTracker->GetFd();
+}
+
+// Update the tracked sizes from the queued events and validate the
+// objects that changed
+void
+CFileCacheSet::ProcessDirSizeEvents()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_dirSizeTracker == NULL)
+	{
+		return;
+	}
+
+	std::set<cachedObjectId_t> changed;
+	m_dirSizeTracker->ProcessEvents(changed);
+	std::set<cachedObjectId_t>::const_iterator iter = changed.begin();
+	while (iter != changed.end())
+	{
+		CCacheObject *cacheObject = m_idTable.Find(*iter);
+		if ((cacheObject != NULL) && !cacheObject->isWritten())
+		{
+			cacheObject->GetFileCache()->CheckSubscribedObject(*iter);
+		}
+		++iter;
+	}
+}
+
+// Go back to walking objects being written to find their size
+void
+CFileCacheSet::StopDirSizeTracker()
+{
+
+	MojLogTrace(s_log);
+
+	delete m_dirSizeTracker;
+	m_dirSizeTracker = NULL;
+}
+
+// Adapt the cache space between minSpace and maxSpace, leaving
+// reservedSpace free on the cache filesystem
+void
+CFileCacheSet::SetAdaptiveSpace(const cacheSize_t minSpace,
+                                const cacheSize_t maxSpace,
+                                const cacheSize_t reservedSpace)
+{
+
+	MojLogTrace(s_log);
+
+	if ((minSpace <= 0) && (maxSpace <= 0))
+	{
+		m_minCacheSpace = m_maxCacheSpace = 0;
+		return;
+	}
+	m_minCacheSpace = (minSpace > 0) ? minSpace : TotalCacheSpace();
+	m_maxCacheSpace = std::max((maxSpace > 0) ? maxSpace : TotalCacheSpace(),
+	                           m_minCacheSpace);
+	m_reservedFreeSpace = std::max(reservedSpace, (cacheSize_t) 0);
+	m_effectiveCacheSpace = std::min(std::max(TotalCacheSpace(), m_minCacheSpace),
+	                                 m_maxCacheSpace);
+	KeepGuaranteedSpace();
+	MojLogInfo(s_log,
+	           _T("SetAdaptiveSpace: Cache space adapted from '%lld' to '%lld' bytes, leaving '%lld' free."),
+	           m_minCacheSpace, m_maxCacheSpace, m_reservedFreeSpace);
+}
+
+// The loWatermarks can't be evicted below, so an adapted cache space
+// under their sum would turn away inserts the types are guaranteed
+void
+CFileCacheSet::KeepGuaranteedSpace()
+{
+
+	if (isAdaptiveSpace() && (m_effectiveCacheSpace < SumOfLoWatermarks()))
+	{
+		MojLogInfo(s_log,
+		           _T("KeepGuaranteedSpace: Cache space raised from '%lld' to the loWatermarks' '%lld' bytes."),
+		           m_effectiveCacheSpace, SumOfLoWatermarks());
+		m_effectiveCacheSpace = SumOfLoWatermarks();
+	}
+}
+
+// Scale the hiWatermark of a type as the cache space is adapted
+cacheSize_t
+CFileCacheSet::ScaleHiWatermark(const cacheSize_t hiWatermark)
+{
+
+	const cacheSize_t totalSpace = TotalCacheSpace();
+	if (!isAdaptiveSpace() || (totalSpace <= 0) ||
+	        (m_effectiveCacheSpace == totalSpace))
+	{
+		return hiWatermark;
+	}
+
+	return (cacheSize_t)((double) hiWatermark * (double) m_effectiveCacheSpace /
+	                     (double) totalSpace);
+}
+
+// Work out the space the cache can take now and clean up in the
+// background before inserts have to.  Memory and I/O pressure are
+// taken together, whichever is worse.
+cacheSize_t
+CFileCacheSet::AdaptCacheSpace()
+{
+
+	MojLogTrace(s_log);
+
+	if (!isAdaptiveSpace())
+	{
+		return 0;
+	}
+
+	const double pressure = std::max(GetPressure(s_memoryPressureFile),
+	                                  GetPressure(s_ioPressureFile));
+	const cacheSize_t space = ComputeCacheSpace(m_minCacheSpace,
+	                          m_maxCacheSpace, SumOfLoWatermarks(),
+	                          SumOfCacheSizes(),
+	                          GetFilesystemFreeSpace(GetBaseDirName()),
+	                          m_reservedFreeSpace, pressure);
+	if (space != m_effectiveCacheSpace)
+	{
+		MojLogInfo(s_log,
+		           _T("AdaptCacheSpace: Cache space changed from '%lld' to '%lld' bytes, pressure '%.1f'."),
+		           m_effectiveCacheSpace, space, pressure);
+		m_effectiveCacheSpace = space;
+	}
+
+	// Types over their scaled hiWatermark are cut back first, then the
+	// whole cache if it's nearly full
+	const cacheSize_t startSize = SumOfCacheSizes();
+	std::map<const std::string, CFileCache *>::const_iterator iter;
+	iter = m_cacheSet.begin();
+	while (iter != m_cacheSet.end())
+	{
+		CFileCache *fileCache = (*iter).second;
+		if (fileCache->GetCacheSize() >= fileCache->GetEffectiveHiWatermark())
+		{
+			fileCache->Cleanup(0);
+		}
+		++iter;
+	}
+	if (SumOfCacheSizes() > space / 100 * s_cleanupStartPercent)
+	{
+		(void) CleanupAllTypes(SumOfCacheSizes() -
+		                       space / 100 * s_cleanupTargetPercent);
+	}
+
+	const cacheSize_t cleanedSize = startSize - SumOfCacheSizes();
+	if (cleanedSize > 0)
+	{
+		MojLogInfo(s_log, _T("AdaptCacheSpace: Cleaned up '%lld' bytes."),
+		           cleanedSize);
+	}
+
+	return cleanedSize;
+}
+
 // Go through the different CFileCache objects and clean up each one.
 // This is meant to be called at service startup time, and it's part of
 // the fix for NOV-128944.
 void
 CFileCacheSet::CleanupAtStartup()
 {
-	if (SumOfCacheSizes() > TotalCacheSpace())
+	if (SumOfCacheSizes() > EffectiveCacheSpace())
 	{
-		cacheSize_t overRun = SumOfCacheSizes() - TotalCacheSpace();
-		MojLogWarning(s_log, _T("CleanupAtStartup: overRun = %d bytes"),
+		cacheSize_t overRun = SumOfCacheSizes() - EffectiveCacheSpace();
+		MojLogWarning(s_log, _T("CleanupAtStartup: overRun = %lld bytes"),
 		              overRun);
 		CleanupAllTypes(overRun);
 	}
@@ -18,13 +18,64 @@
 #define __FILE_CACHE_SET_H__
 
 #include "CacheBase.h"
+#include "CacheIndex.h"
 #include "CacheObject.h"
+#include "DedupTable.h"
+#include "DirScanner.h"
+#include "DirSizeTracker.h"
 #include "FileCache.h"
+#include "IoWorkerPool.h"
+#include "ObjectIdTable.h"
+#include "RwLock.h"
+#include "SyncQueue.h"
+
+#include <functional>
+
+// The function told the events for the streaming readers of an object
+typedef std::function<void (const cachedObjectId_t, const StreamEvent,
+                            const cacheSize_t)> streamCallback_t;
+
+// The function told the view of a compressed object is finished, with
+// the path of the view or an empty path if it couldn't be made
+typedef std::function<void (const cachedObjectId_t,
+                            const std::string &)> viewCallback_t;
 
 static const std::string s_totalCacheSpace("totalCacheSpace");
 static const std::string s_baseDirName("baseDirName");
+static const std::string s_lazyStartup("lazyStartup");
+static const std::string s_scanThreads("scanThreads");
+static const std::string s_maxCopies("maxCopies");
+static const std::string s_syncDelay("syncDelay");
+static const std::string s_ioThreads("ioThreads");
+static const std::string s_reserveSpace("reserveSpace");
+static const std::string s_readThreads("readThreads");
+static const std::string s_traceFile("traceFile");
+static const std::string s_dedupObjects("dedupObjects");
+static const std::string s_memoryDirName("memoryDirName");
+static const std::string s_memoryLoWatermark("memoryLoWatermark");
+static const std::string s_memoryHiWatermark("memoryHiWatermark");
+static const std::string s_memoryObjectSize("memoryObjectSize");
+static const std::string s_minCacheSpace("minCacheSpace");
+static const std::string s_maxCacheSpace("maxCacheSpace");
+static const std::string s_reservedFreeSpace("reservedFreeSpace");
+static const std::string s_prefetchAtStartup("prefetchAtStartup");
 static const std::string s_seqNumFilename(".sequenceNumber");
 
+// The number of CopyCacheObject copies run at once unless configured
+static const int s_defaultMaxCopies = 2;
+
+// The longest, in milliseconds, the flush of a written object waits
+// for others to batch with unless configured
+static const int s_defaultSyncDelay = 100;
+
+// The number of threads removing objects and summing directories off
+// the main loop unless configured
+static const int s_defaultIoThreads = 2;
+
+// The number of threads answering read-only requests off the main loop
+// unless configured, 0 keeps them on the main loop
+static const int s_defaultReadThreads = 2;
+
 inline ssize_t FC_getxattr(const char *path, const char *name,  void *value,
                            size_t size)
 {
@@ -35,6 +86,30 @@ inline ssize_t FC_getxattr(const char *path, const char *name,  void *value,
 #endif // #ifdef MOJ_MAC
 }
 
+// One object of a batch insert.  A size, cost or lifetime of 0 is
+// replaced by the default configured for the type.  On return m_objId
+// holds the id of the new object, or 0 with m_msgText explaining why
+// the object couldn't be inserted.
+struct CInsertRequest
+{
+	CInsertRequest() : m_size(0)
+		, m_cost(0)
+		, m_lifetime(0)
+		, m_objId(0)
+	{
+	}
+
+	std::string m_typeName;
+	std::string m_filename;
+	cacheSize_t m_size;
+	paramValue_t m_cost;
+	paramValue_t m_lifetime;
+	cachedObjectId_t m_objId;
+	std::string m_msgText;
+};
+
+typedef std::vector<CInsertRequest> insertRequests_t;
+
 class CFileCacheSet
 {
 public:
@@ -69,11 +144,8 @@ public:
 	// Get the configuration values for a cache type.
 	CCacheParamValues DescribeType(const std::string &typeName);
 
-	// Select the object from the best choice from each cache to remove
-	CFileCache *SelectCandidateToExpire(std::map < CFileCache *,
-	                                    const cachedObjectId_t > & m_cleanupMap);
-
-	// Cleanup all registered types
+	// Cleanup all registered types by expiring the lowest cost objects
+	// across all types until neededSpace has been freed
 	cacheSize_t CleanupAllTypes(cacheSize_t neededSpace);
 
 	// Insert an object into the cache and returns the object id of that
@@ -96,7 +168,15 @@ public:
 	                                   const cachedObjectId_t objectId,
 	                                   cacheSize_t size, paramValue_t cost,
 	                                   paramValue_t lifetime, bool written,
-	                                   bool isNew);
+	                                   bool isNew, bool compressed = false,
+	                                   cacheSize_t storedSize = 0,
+	                                   bool inMemory = false);
+
+	// Insert a batch of objects.  The space for all the objects of a
+	// type is found with one cleanup pass before any of them are
+	// inserted, the objects are then inserted in order.  The result
+	// for each object is returned in its request.
+	void InsertCacheObjects(insertRequests_t &requests);
 
 	// Request to change the size of an object.  This is only valid
 	// while the initial writable subscription is in effect.  If there
@@ -114,24 +194,46 @@ public:
 	// Pin an object in the cache by allowing a client to subscribe to
 	// the object.  This will guarantee the object will not be removed
 	// from the cache while the subscription is active.  Returns the
-	// file path associated with the objectId.
+	// file path associated with the objectId.  If stream points to
+	// true, a reader can subscribe to a file object while it is still
+	// being written, and stream is left true only if the subscription
+	// is such a streaming reader.  Its readers are told how the write
+	// goes through the stream callback.
 	const std::string SubscribeCacheObject(std::string &msgText,
-	                                       const cachedObjectId_t objId);
+	                                       const cachedObjectId_t objId,
+	                                       bool *stream = NULL);
 
 	// Remove the client subscription of an object.  This will remove
-	// the guarantee that the object will be kept in the cache.
+	// the guarantee that the object will be kept in the cache.  stream
+	// says the subscription was a streaming reader's.
 	void UnSubscribeCacheObject(const std::string &typeName,
-	                            const cachedObjectId_t objId);
+	                            const cachedObjectId_t objId,
+	                            const bool stream = false);
 
 	// This updates the access time without needing to subscribe, it's
 	// like using touch on an existing file
 	bool Touch(const cachedObjectId_t objId);
 
+	// Ask the kernel to read the file of a written object ahead of a
+	// client opening it, on the I/O worker pool if there is one.
+	// Returns false with msgText set if there is no such object or it
+	// can't be prefetched.  Objects kept in memory need no prefetch.
+	bool PrefetchCacheObject(std::string &msgText, const cachedObjectId_t objId);
+
+	// Prefetch the numObjects most recently used objects of each type.
+	// Returns the number of objects prefetched.
+	int PrefetchRecentObjects(const int numObjects);
+
+	// Prefetch the recent objects FileCache.conf asks to have warmed at
+	// startup, once the walk is complete.  Only the first call after
+	// the walk does anything.
+	void PrefetchAtStartup();
+
 	// This will remove an object id from the id map and make it an
 	// orphan to be cleaned up on expiration
 	void RemoveObjectFromIdMap(const cachedObjectId_t objId)
 	{
-		m_idMap.erase(objId);
+		m_idTable.Erase(objId);
 	}
 
 	// Get the current status of the cache as a whole.  The current
@@ -170,11 +272,145 @@ public:
 		return m_totalCacheSpace;
 	}
 
-	// Compute the sum of the loWatermarks for each of the configured caches
-	virtual cacheSize_t SumOfLoWatermarks();
+	// Returns true if the space the cache takes is adapted to the free
+	// space of its filesystem and the pressure on the system
+	bool isAdaptiveSpace() const
+	{
+		return m_maxCacheSpace > 0;
+	}
+
+	// Adapt the cache space between minSpace and maxSpace, leaving
+	// reservedSpace free on the cache filesystem.  A bound of 0 is the
+	// total configured cache space, both 0 turn the adapting off.  The
+	// space never goes below the sum of the loWatermarks, which the
+	// types are guaranteed.
+	void SetAdaptiveSpace(const cacheSize_t minSpace, const cacheSize_t maxSpace,
+	                      const cacheSize_t reservedSpace);
+
+	// The space the cache can take now, the total configured cache
+	// space unless it is adapted
+	cacheSize_t EffectiveCacheSpace()
+	{
+		return isAdaptiveSpace() ? m_effectiveCacheSpace : TotalCacheSpace();
+	}
+
+	// Scale the hiWatermark of a type as the cache space is adapted
+	cacheSize_t ScaleHiWatermark(const cacheSize_t hiWatermark);
+
+	// Work out the space the cache can take from the free space of its
+	// filesystem and the memory and I/O pressure, then clean up in the
+	// background any type over its scaled hiWatermark and the whole
+	// cache if it's nearly full, so inserts don't have to.  Returns the
+	// space cleaned up.  Does nothing unless the space is adapted.
+	cacheSize_t AdaptCacheSpace();
+
+	// Return the configured number of copies run at once
+	int GetMaxCopies() const
+	{
+		return m_maxCopies;
+	}
+
+	// Returns true if the space of file objects is allocated on disk
+	// when they are created and resized
+	bool GetReserveSpace() const
+	{
+		return m_reserveSpace;
+	}
+	void SetReserveSpace(const bool reserveSpace)
+	{
+		m_reserveSpace = reserveSpace;
+	}
+
+	// Returns true if written file objects with the same content as an
+	// object already cached are linked to its file rather than kept as
+	// a copy
+	bool GetDedupObjects() const
+	{
+		return m_dedupObjects;
+	}
+	void SetDedupObjects(const bool dedupObjects)
+	{
+		m_dedupObjects = dedupObjects;
+	}
+
+	// The directory memory objects keep their files in, empty unless a
+	// memory tier was configured in FileCache.conf
+	const std::string &GetMemoryDirName() const
+	{
+		return m_memoryDirName;
+	}
+
+	// Returns true if objects can be kept in memory
+	bool isMemoryTier() const
+	{
+		return !m_memoryDirName.empty() && (m_memoryHiWatermark > 0);
+	}
+
+	// Keep the objects of memory types, and any other file object of up
+	// to objectSize bytes unless it's 0, in dirName, a tmpfs directory,
+	// while they take no more than hiWatermark.  The directory must
+	// exist.  An empty dirName turns the memory tier off.
+	void SetMemoryTier(const std::string &dirName, const cacheSize_t loWatermark,
+	                   const cacheSize_t hiWatermark, const cacheSize_t objectSize)
+	{
+		m_memoryDirName = dirName;
+		m_memoryLoWatermark = loWatermark;
+		m_memoryHiWatermark = hiWatermark;
+		m_memoryObjectSize = objectSize;
+	}
+
+	// The space taken by the memory objects
+	cacheSize_t GetMemorySize() const
+	{
+		return m_memorySize;
+	}
+
+	// Called by memory objects as they are made, resized, moved out of
+	// memory or removed to keep the memory space up to date
+	void AddMemoryObject(CCacheObject *cacheObject);
+	void RemoveMemoryObject(CCacheObject *cacheObject);
+	void AdjustMemorySize(const cacheSize_t delta)
+	{
+		m_memorySize += delta;
+	}
+
+	// The objects sharing content, for checking the reference counts
+	const CDedupTable &GetDedupTable() const
+	{
+		return m_dedupTable;
+	}
+
+	// The file the client operations are traced to, empty unless
+	// tracing was turned on in FileCache.conf
+	const std::string &GetTraceFile() const
+	{
+		return m_traceFile;
+	}
+
+	// Return the sum of the loWatermarks for each of the configured caches
+	virtual cacheSize_t SumOfLoWatermarks()
+	{
+		return m_sumOfLoWatermarks;
+	}
+
+	// Return the sum of current sizes for each of the configured caches
+	virtual cacheSize_t SumOfCacheSizes()
+	{
+		return m_sumOfCacheSizes;
+	}
 
-	// Compute the sum of current sizes for each of the configured caches
-	virtual cacheSize_t SumOfCacheSizes();
+	// Called by each cache as its size or loWatermark changes to keep
+	// the sums up to date without walking the types
+	void UpdateTotals(const cacheSize_t sizeDelta,
+	                  const cacheSize_t loWatermarkDelta)
+	{
+		m_sumOfCacheSizes += sizeDelta;
+		m_sumOfLoWatermarks += loWatermarkDelta;
+	}
+
+	// Debug check that the running sums match the sums computed again
+	// from every type.  Returns false, logging the difference, if not.
+	bool CheckTotals();
 
 	// Get the type that cooresponds to an objectId
 	const std::string GetTypeForObjectId(const cachedObjectId_t objId);
@@ -182,7 +418,7 @@ public:
 	// Return the cache directory name
 	const std::string GetCacheDirectory()
 	{
-		return m_baseDirName;
+		return GetBaseDirName();
 	}
 
 	// Check if a type exists
@@ -191,9 +427,70 @@ public:
 	// Check if a type is a directory type
 	bool isTypeDirType(const std::string &typeName);
 
-	// locate and try to cleanup any orphans
+	// Cleanup the orphans each type has queued
 	void CleanupOrphans();
 
+	// Expire the objects whose type's eviction policy says they have
+	// outlived their lifetime.  Returns the number expired.
+	paramValue_t ExpireStaleObjects();
+
+	// Returns true if some type has orphans waiting to be cleaned up,
+	// including ones left to retry by CleanupOrphans
+	bool HasOrphans();
+
+	// Called by a type when it queues an orphan
+	void OrphanQueued()
+	{
+		if (m_orphanCallback)
+		{
+			m_orphanCallback();
+		}
+	}
+
+	// Set the function called whenever an orphan is queued, so the
+	// cleanup can be scheduled only when there is something to clean
+	void SetOrphanCallback(const std::function<void ()> &callback)
+	{
+		m_orphanCallback = callback;
+	}
+
+	// Called by an object being written to tell its streaming readers
+	// how much has been written, or that the write finished or failed
+	void NotifyStreamReaders(const cachedObjectId_t objId,
+	                         const StreamEvent event, const cacheSize_t size)
+	{
+		if (m_streamCallback)
+		{
+			m_streamCallback(objId, event, size);
+		}
+	}
+
+	// Set the function the events for streaming readers are passed to
+	void SetStreamCallback(const streamCallback_t &callback)
+	{
+		m_streamCallback = callback;
+	}
+
+	// Returns true if the object's file holds its data deflated, so it
+	// can only be read through a view
+	bool isCompressedObject(const cachedObjectId_t objId);
+
+	// Returns true if the view of a subscribed compressed object is
+	// still being made on the I/O pool
+	bool isViewPending(const cachedObjectId_t objId);
+
+	// Called on the main thread once the view of a compressed object
+	// has been made at viewPath on the I/O pool, made says if it was.
+	// The view callback is told whether it is ready.
+	void FinishView(const cachedObjectId_t objId, const std::string &viewPath,
+	                const bool made);
+
+	// Set the function told when a view is finished
+	void SetViewCallback(const viewCallback_t &callback)
+	{
+		m_viewCallback = callback;
+	}
+
 	// Validate a subscribed object.
 	void CheckSubscribedObject(const std::string &typeName,
 	                           const cachedObjectId_t objId);
@@ -201,13 +498,182 @@ public:
 	// Cleanup any unsubscribed directory types
 	void CleanupDirTypes();
 
-	// Walk the file cache directory tree to build the cache data
-	// structures.
-	int WalkDirTree();
+	// Build the cache data structures from the cache index or, if the
+	// index can't be used, by walking the file cache directory tree.
+	// With lazy set, a walk only loads the types and queues the object
+	// directories for ContinueWalkDirTree, loading a directory early
+	// if an object in it is looked up.
+	int WalkDirTree(bool lazy = false);
+
+	// Walk one object directory queued by a lazy WalkDirTree.  Once
+	// all are done this does the startup cleanup and returns false.
+	bool ContinueWalkDirTree();
+
+	// Returns false while a lazy walk still has directories queued
+	bool isWalkComplete()
+	{
+		return !m_walkInProgress;
+	}
+
+	// How long, in microseconds, the startup index load or tree walk
+	// took, or -1 while a lazy walk is still in progress
+	long long GetWalkDuration() const
+	{
+		return m_walkDuration;
+	}
+
+	// The counters kept for a type, or NULL if there is no such type
+	CCacheMetrics *GetTypeMetrics(const std::string &typeName);
+
+	// Count a subscribe to an object no longer in the cache against the
+	// type named in its pathname
+	void CountSubscribeMiss(const std::string &pathName);
+
+	// Returns true if FileCache.conf asks for lazy startup
+	bool isLazyStartup()
+	{
+		return m_lazyStartup;
+	}
+
+	// Write a snapshot of the cache index so the next start doesn't
+	// need to walk the directory tree.  A clean snapshot is written
+	// when the service shuts down.
+	bool WriteCacheIndex(bool clean = false);
+
+	// Returns true if the cache index journal holds changes that are
+	// not in the snapshot yet.
+	bool CacheIndexNeedsSnapshot();
+
+	// Record the current state of an object in the cache index journal
+	void JournalCacheObject(CCacheObject *cacheObject);
+
+	// Record the removal of an object in the cache index journal
+	void JournalCacheObjectRemoved(const cachedObjectId_t objId);
+
+	// Compress an object that has just been written if its type is
+	// configured to compress, then look for an object with the same
+	// content.  The object is compressed on the I/O pool when there is
+	// one and only if that saves space.  A memory object is left as it
+	// is unless it was written too big to stay in memory.
+	void CompressCacheObject(CCacheObject *cacheObject);
+
+	// Move memory objects to the cache directory.  Written objects that
+	// no longer belong in memory go first.  Then, if the memory objects
+	// and neededSpace take more than the memory hiWatermark, or the
+	// memory filesystem is running out of space, the least recently used
+	// go until the rest take no more than the memory loWatermark.  The
+	// content is copied on the I/O pool when there is one.  Returns the
+	// number of objects being moved.
+	paramValue_t DemoteMemoryObjects(const cacheSize_t neededSpace = 0);
+
+	// Look for an object with the same content as one that has just
+	// been written and, if there is one, link the new object to its
+	// file.  The content is hashed and compared on the I/O pool when
+	// there is one.  Does nothing unless dedupObjects is configured.
+	void DedupCacheObject(CCacheObject *cacheObject);
+
+	// Forget the content of a removed object.  If it was charged for a
+	// file other objects still link to, one of them is charged now.
+	void ReleaseContent(const cachedObjectId_t objId);
 
 	// Cleanup cache space at startup.
 	void CleanupAtStartup();
 
+	// Flush written objects on a sync queue from now on rather than in
+	// UnSubscribe.  Returns the queue's event fd, which polls readable
+	// when FinishSyncs has objects to finish.
+	int StartSyncQueue();
+
+	// The sync queue, or NULL if objects are flushed in UnSubscribe
+	CSyncQueue *GetSyncQueue()
+	{
+		return m_syncQueue;
+	}
+
+	// Mark the objects the sync queue has flushed as written
+	void FinishSyncs();
+
+	// Flush the objects still queued, finish them and go back to
+	// flushing in UnSubscribe
+	void StopSyncQueue();
+
+	// Remove objects and sum directories on an I/O worker pool from
+	// now on rather than on the calling thread.  Returns the pool's
+	// event fd, which polls readable when RunIoCompletions has work to
+	// complete.
+	int StartIoPool();
+
+	// The I/O worker pool, or NULL if the work is done inline
+	CIoWorkerPool *GetIoPool()
+	{
+		return m_ioPool;
+	}
+
+	// Run the completions of the I/O work that has finished
+	void RunIoCompletions();
+
+	// Delete the objects left in the trash of each type when the
+	// service last stopped, on the I/O worker pool if there is one
+	void SweepTrash();
+
+	// Finish the queued I/O work, complete it and go back to doing the
+	// work inline
+	void StopIoPool();
+
+	// Answer read-only requests on a pool of reader threads from now
+	// on.  The readers hold the set lock for reading while they look at
+	// the cache and the main loop holds it for writing, between
+	// LockForWrite and UnlockForWrite, while it changes it, so lookups
+	// only wait for the changes already being made.  Returns the pool's
+	// event fd, which polls readable when RunReadCompletions has
+	// replies to send, or -1 if the requests are configured to stay on
+	// the main loop.
+	int StartReadPool();
+
+	// The reader pool, or NULL if requests are answered inline
+	CIoWorkerPool *GetReadPool()
+	{
+		return m_readPool;
+	}
+
+	// The lock the readers hold while looking at the cache
+	CRwLock &GetLock()
+	{
+		return m_lock;
+	}
+
+	// Keep the readers out while the main loop changes the cache.  The
+	// calls nest and only the outermost takes the lock.  Without a
+	// reader pool there is no one to keep out and the lock isn't taken.
+	void LockForWrite();
+	void UnlockForWrite();
+
+	// Send the replies of the requests that have been answered
+	void RunReadCompletions();
+
+	// Answer the queued requests, give up the lock and go back to
+	// answering requests inline
+	void StopReadPool();
+
+	// Track the size of objects being written from now on, validating
+	// them as they change rather than walking them to check.  Returns
+	// the tracker's inotify fd, which polls readable when
+	// ProcessDirSizeEvents has events to process.
+	int StartDirSizeTracker();
+
+	// The directory size tracker, or NULL if sizes are found by walking
+	CDirSizeTracker *GetDirSizeTracker()
+	{
+		return m_dirSizeTracker;
+	}
+
+	// Update the tracked sizes from the queued events and validate the
+	// objects that changed
+	void ProcessDirSizeEvents();
+
+	// Go back to walking objects being written to find their size
+	void StopDirSizeTracker();
+
 	//Get Cache size
 	int GetCacheSize();
 
@@ -218,6 +684,20 @@ protected:
 private:
 
 	CFileCache *GetFileCacheForType(const std::string &typeName);
+	CCacheObject *GetCacheObjectForId(const cachedObjectId_t objId);
+	void CompressContent(const cachedObjectId_t objId,
+	                     const std::string &compressedPath,
+	                     const cacheSize_t storedSize);
+	bool BelongsInMemory(CFileCache *fileCache, const cacheSize_t size);
+	void StartDemotion(CCacheObject *cacheObject);
+	void DemoteContent(const cachedObjectId_t objId, const std::string &copyPath);
+	void MakeMemoryDir(bool clean);
+	void KeepGuaranteedSpace();
+	bool isDedupCandidate(const cachedObjectId_t objId, const cacheSize_t size,
+	                      const bool compressed);
+	void MatchContent(const cachedObjectId_t objId, const uint64_t hash);
+	void LinkContent(const cachedObjectId_t objId, const uint64_t hash,
+	                 const cachedObjectId_t owner);
 
 	void ReadConfig(const std::string &configFile);
 	void ReadSequenceNumber();
@@ -230,6 +710,9 @@ private:
 	    CONTINUE
 	};
 
+	bool LoadCacheIndex(bool *changed);
+	void JournalCacheType(const std::string &typeName);
+
 	bool isTopLevelDirectory(const std::string &pathname);
 	ProcessStatus CreateTypeIfNeeded(const std::string &pathname,
 	                                 const std::string &typeName,
@@ -237,23 +720,111 @@ private:
 	ProcessStatus CheckForSpecialFile(const std::string &pathname,
 	                                  std::set<std::string> &types);
 	ProcessStatus GetWritten(const std::string &pathname, int *written,
-	                         bool dirType);
+	                         bool dirType, const CScannedEntry *entry);
 	ProcessStatus GetSize(const std::string &pathname, const struct stat *sb,
-	                      cacheSize_t *size, bool dirType);
-	ProcessStatus GetFilename(const std::string &pathname, char *fileName);
-	ProcessStatus GetCost(const std::string &pathname, paramValue_t *cost);
-	ProcessStatus GetLifetime(const std::string &pathname, paramValue_t *lifetime);
-	int ProcessFiles(const std::string &filepath);
+	                      cacheSize_t *size, bool dirType,
+	                      const CScannedEntry *entry);
+	ProcessStatus GetFilename(const std::string &pathname, char *fileName,
+	                          const CScannedEntry *entry);
+	ProcessStatus GetCost(const std::string &pathname, paramValue_t *cost,
+	                      const CScannedEntry *entry);
+	ProcessStatus GetLifetime(const std::string &pathname, paramValue_t *lifetime,
+	                          const CScannedEntry *entry);
+	int ProcessFiles(const std::string &filepath,
+	                 const CScannedEntry *entry = NULL);
+	void MigrateAttributes(const std::string &pathname,
+	                       const CObjectRecord &record, mode_t mode);
 	bool FileTreeWalk(const std::string &dirName);
+	bool ProcessScannedDir(const scannedEntries_t &entries);
+	bool WalkTypeDirs(const std::string &dirName);
+	void WalkPendingDir(const std::string &dirName);
+	void WalkPendingDirsForObjectId(const cachedObjectId_t objId);
+	void WalkPendingDirsForType(const std::string &typeName);
+	void FinishWalkDirTree();
+	void StopDirScanner();
 	uint32_t GetRandomInteger(void);
 
 	std::map<const std::string, CFileCache *> m_cacheSet;
-	std::map<const cachedObjectId_t, const std::string> m_idMap;
+
+	// Every object that isn't an orphan, the object leads to the
+	// CFileCache of its type so an id is resolved with one lookup.
+	CObjectIdTable m_idTable;
 
 	cacheSize_t m_totalCacheSpace;
+
+	// The bounds of the adapted cache space, the free space it leaves
+	// and the space it's adapted to now
+	cacheSize_t m_minCacheSpace;
+	cacheSize_t m_maxCacheSpace;
+	cacheSize_t m_reservedFreeSpace;
+	cacheSize_t m_effectiveCacheSpace;
+	cacheSize_t m_sumOfCacheSizes;
+	cacheSize_t m_sumOfLoWatermarks;
 	std::string m_baseDirName;
 	sequenceNumber_t m_sequenceNumber;
+	CCacheIndex *m_cacheIndex;
+
+	// The object directories a lazy walk has not reached yet
+	std::set<std::string> m_pendingDirs;
+	bool m_walkInProgress;
+	bool m_walkFailed;
+	bool m_lazyStartup;
+	int m_scanThreads;
+	int m_maxCopies;
+	int m_syncDelay;
+	CSyncQueue *m_syncQueue;
+	int m_ioThreads;
+	CIoWorkerPool *m_ioPool;
+	int m_readThreads;
+	CIoWorkerPool *m_readPool;
+	CRwLock m_lock;
+	int m_writeDepth;
+	bool m_writeLocked;
+	bool m_reserveSpace;
+	bool m_dedupObjects;
+	CDedupTable m_dedupTable;
+	int m_prefetchAtStartup;
+	bool m_prefetchedAtStartup;
+	std::string m_memoryDirName;
+	cacheSize_t m_memoryLoWatermark;
+	cacheSize_t m_memoryHiWatermark;
+	cacheSize_t m_memoryObjectSize;
+	cacheSize_t m_memorySize;
+
+	// The objects kept in memory, and those being copied out of it
+	std::map<cachedObjectId_t, CCacheObject *> m_memoryObjects;
+	std::set<cachedObjectId_t> m_pendingDemotions;
+	std::string m_traceFile;
+	CDirSizeTracker *m_dirSizeTracker;
+	std::function<void ()> m_orphanCallback;
+	streamCallback_t m_streamCallback;
+	viewCallback_t m_viewCallback;
+	CDirScanner *m_dirScanner;
+	time_t m_walkStartTime;
+	long long m_walkStartMicros;
+	long long m_walkDuration;
 	static MojLogger s_log;
 };
 
+// Holds the lock of a cache set for writing for the life of the guard,
+// if the set has readers to keep out
+class CWriteLockGuard
+{
+public:
+
+	CWriteLockGuard(CFileCacheSet *cacheSet) : m_cacheSet(cacheSet)
+	{
+		m_cacheSet->LockForWrite();
+	}
+
+	~CWriteLockGuard()
+	{
+		m_cacheSet->UnlockForWrite();
+	}
+
+private:
+
+	CFileCacheSet *m_cacheSet;
+};
+
 #endif
@@ -0,0 +1,244 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "IoWorkerPool.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+MojLogger CIoWorkerPool::s_log(_T("filecache.ioworkerpool"));
+
+CIoWorkerPool::CIoWorkerPool(size_t numWorkers) : m_numWorkers(numWorkers)
+	, m_numRunning(0)
+	, m_eventFd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+	, m_stopping(false)
+{
+
+	MojLogTrace(s_log);
+
+	if (m_eventFd < 0)
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("CIoWorkerPool: Failed to create event fd (%s)."),
+		            ::strerror(savedErrno));
+	}
+	if (m_numWorkers < 1)
+	{
+		m_numWorkers = 1;
+	}
+	for (size_t i = 0; i < m_numWorkers; i++)
+	{
+		m_workers.push_back(std::thread(&CIoWorkerPool::Worker, this));
+	}
+}
+
+// Finishes the jobs still queued and stops the workers
+CIoWorkerPool::~CIoWorkerPool()
+{
+
+	MojLogTrace(s_log);
+
+	Stop();
+	if (m_eventFd >= 0)
+	{
+		::close(m_eventFd);
+	}
+}
+
+// Queue work to run on a worker with done to run on the main thread
+// after it.  An empty key means the job isn't ordered with others.
+void
+CIoWorkerPool::Post(const std::string &key, const ioWork_t &work,
+                    const ioWork_t &done)
+{
+
+	MojLogTrace(s_log);
+
+	CIoJob job;
+	job.m_key = key;
+	job.m_work = work;
+	job.m_done = done;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_queue.push_back(job);
+	m_cond.notify_all();
+}
+
+// Run the completions of the finished jobs and clear the event fd.
+// Returns the number of jobs completed.
+size_t
+CIoWorkerPool::RunCompletions()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_eventFd >= 0)
+	{
+		eventfd_t value;
+		(void) ::eventfd_read(m_eventFd, &value);
+	}
+
+	std::vector<CIoJob> completed;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		completed.swap(m_completed);
+	}
+
+	std::vector<CIoJob>::const_iterator iter = completed.begin();
+	while (iter != completed.end())
+	{
+		if ((*iter).m_done)
+		{
+			(*iter).m_done();
+		}
+		++iter;
+	}
+
+	return completed.size();
+}
+
+// Wait for the jobs posted with key to finish and run the completions
+// waiting.
+void
+CIoWorkerPool::Wait(const std::string &key)
+{
+
+	MojLogTrace(s_log);
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (HasJobsForKey(key))
+		{
+			MojLogInfo(s_log, _T("Wait: Waiting for work on '%s' to finish."),
+			           key.c_str());
+		}
+		while (HasJobsForKey(key))
+		{
+			m_cond.wait(lock);
+		}
+	}
+	RunCompletions();
+}
+
+// The number of jobs posted and not yet completed
+size_t
+CIoWorkerPool::GetNumPending()
+{
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_queue.size() + m_numRunning + m_completed.size();
+}
+
+// Finishes the jobs still queued and stops the workers.  The
+// completions are left for RunCompletions.
+void
+CIoWorkerPool::Stop()
+{
+
+	MojLogTrace(s_log);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+		m_cond.notify_all();
+	}
+	std::vector<std::thread>::iterator iter = m_workers.begin();
+	while (iter != m_workers.end())
+	{
+		if ((*iter).joinable())
+		{
+			(*iter).join();
+		}
+		++iter;
+	}
+	m_workers.clear();
+}
+
+// Returns true if a job with key is queued or running.  Must be called
+// with m_mutex held.
+bool
+CIoWorkerPool::HasJobsForKey(const std::string &key) const
+{
+
+	if (m_busyKeys.find(key) != m_busyKeys.end())
+	{
+		return true;
+	}
+	std::deque<CIoJob>::const_iterator iter = m_queue.begin();
+	while (iter != m_queue.end())
+	{
+		if ((*iter).m_key == key)
+		{
+			return true;
+		}
+		++iter;
+	}
+
+	return false;
+}
+
+// Take the oldest job whose key isn't already running, run it and
+// queue its completion.  When stopping, the workers leave once the
+// queue is empty.
+void
+CIoWorkerPool::Worker()
+{
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		std::deque<CIoJob>::iterator iter = m_queue.begin();
+		while ((iter != m_queue.end()) && !(*iter).m_key.empty() &&
+		        (m_busyKeys.find((*iter).m_key) != m_busyKeys.end()))
+		{
+			++iter;
+		}
+		if (iter == m_queue.end())
+		{
+			if (m_stopping && m_queue.empty())
+			{
+				break;
+			}
+			m_cond.wait(lock);
+			continue;
+		}
+
+		CIoJob job(*iter);
+		m_queue.erase(iter);
+		if (!job.m_key.empty())
+		{
+			m_busyKeys.insert(job.m_key);
+		}
+		m_numRunning++;
+		lock.unlock();
+
+		job.m_work();
+
+		lock.lock();
+		if (!job.m_key.empty())
+		{
+			m_busyKeys.erase(job.m_key);
+		}
+		m_numRunning--;
+		m_completed.push_back(job);
+		if (m_eventFd >= 0)
+		{
+			(void) ::eventfd_write(m_eventFd, 1);
+		}
+		m_cond.notify_all();
+	}
+}
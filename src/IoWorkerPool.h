@@ -0,0 +1,101 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __IO_WORKER_POOL_H__
+#define __IO_WORKER_POOL_H__
+
+#include "CacheBase.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+typedef std::function<void ()> ioWork_t;
+
+// A unit of work for the pool.  m_work runs on a worker thread and
+// m_done, if set, runs on the main thread once m_work has finished.
+struct CIoJob
+{
+	std::string m_key;
+	ioWork_t m_work;
+	ioWork_t m_done;
+};
+
+// Runs blocking filesystem work, such as removing objects and summing
+// directories, on a pool of worker threads so it doesn't hold up the
+// main loop.  The workers only touch the filesystem, all of the cache
+// bookkeeping stays on the main thread: a job's completion is queued
+// and run by RunCompletions, which the main loop calls whenever the
+// event fd polls readable.  Jobs posted with the same key, the type
+// name for the cache, run one at a time in the order they were posted.
+class CIoWorkerPool
+{
+public:
+
+	CIoWorkerPool(size_t numWorkers);
+
+	// Finishes the jobs still queued and stops the workers
+	~CIoWorkerPool();
+
+	// Queue work to run on a worker with done to run on the main thread
+	// after it.  An empty key means the job isn't ordered with others.
+	void Post(const std::string &key, const ioWork_t &work,
+	          const ioWork_t &done = ioWork_t());
+
+	// Run the completions of the finished jobs and clear the event fd.
+	// Returns the number of jobs completed.
+	size_t RunCompletions();
+
+	// Wait for the jobs posted with key to finish and run the
+	// completions waiting.  This blocks, so it is only for the rare
+	// cases where following work depends on the filesystem changes.
+	void Wait(const std::string &key);
+
+	// The number of jobs posted and not yet completed
+	size_t GetNumPending();
+
+	// An fd that polls readable while completions are waiting to run
+	int GetEventFd() const
+	{
+		return m_eventFd;
+	}
+
+	// Finishes the jobs still queued and stops the workers
+	void Stop();
+
+private:
+
+	void Worker();
+	bool HasJobsForKey(const std::string &key) const;
+
+	size_t m_numWorkers;
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::deque<CIoJob> m_queue;
+	std::set<std::string> m_busyKeys;
+	std::vector<CIoJob> m_completed;
+	size_t m_numRunning;
+	int m_eventFd;
+	bool m_stopping;
+	static MojLogger s_log;
+};
+
+#endif
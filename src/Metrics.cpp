@@ -0,0 +1,47 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Metrics.h"
+
+#include <time.h>
+
+// A monotonic clock in microseconds for timing requests
+long long
+GetMonotonicMicros()
+{
+
+	struct timespec tm;
+	::clock_gettime(CLOCK_MONOTONIC, &tm);
+
+	return tm.tv_sec * 1000000LL + tm.tv_nsec / 1000;
+}
+
+// Count a sample of usecs microseconds in the first bucket whose
+// bound is above it
+void
+CLatencyHistogram::Record(const long long usecs)
+{
+
+	const unsigned long long sample = (usecs > 0) ? (unsigned long long) usecs : 0;
+	size_t bucket = 0;
+	while ((bucket < (s_numLatencyBuckets - 1)) && (sample >= (1ULL << bucket)))
+	{
+		bucket++;
+	}
+	m_buckets[bucket].Add();
+	m_count.Add();
+	m_total.Add(sample);
+}
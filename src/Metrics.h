@@ -0,0 +1,126 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include "CacheBase.h"
+
+#include <atomic>
+
+// The number of latency buckets, bucket i counts the samples under
+// 2^i microseconds that didn't fit an earlier one and the last counts
+// everything slower
+static const size_t s_numLatencyBuckets = 24;
+
+// A monotonic clock in microseconds for timing requests
+long long GetMonotonicMicros();
+
+// A counter cheap enough to leave on in release builds.  Counts are
+// relaxed atomics, they are bumped on the main loop and the reader
+// threads and read by GetMetrics with no ordering between them.
+class CCounter
+{
+public:
+
+	CCounter() : m_value(0)
+	{
+	}
+
+	void Add(const unsigned long long delta = 1)
+	{
+		m_value.fetch_add(delta, std::memory_order_relaxed);
+	}
+
+	unsigned long long Get() const
+	{
+		return m_value.load(std::memory_order_relaxed);
+	}
+
+private:
+
+	CCounter(const CCounter &);
+	CCounter &operator=(const CCounter &);
+
+	std::atomic<unsigned long long> m_value;
+};
+
+// A histogram of request latencies in power of two buckets
+class CLatencyHistogram
+{
+public:
+
+	// Count a sample of usecs microseconds
+	void Record(const long long usecs);
+
+	// The number of samples in a bucket
+	unsigned long long GetBucket(const size_t bucket) const
+	{
+		return m_buckets[bucket].Get();
+	}
+
+	// The number of samples and their total in microseconds
+	unsigned long long GetCount() const
+	{
+		return m_count.Get();
+	}
+
+	unsigned long long GetTotal() const
+	{
+		return m_total.Get();
+	}
+
+private:
+
+	CCounter m_buckets[s_numLatencyBuckets];
+	CCounter m_count;
+	CCounter m_total;
+};
+
+// The counters kept for each type
+struct CCacheMetrics
+{
+	// Subscribes that found their object and that found it gone
+	CCounter m_subscribeHits;
+	CCounter m_subscribeMisses;
+
+	// Inserts turned away because no space could be freed
+	CCounter m_insertRejections;
+
+	// Objects evicted making space for the type itself and for the
+	// set as a whole, and the space the evictions freed
+	CCounter m_localEvictions;
+	CCounter m_globalEvictions;
+	CCounter m_bytesFreed;
+
+	// Written objects found to have the same content as another object
+	// and linked to its file, and the space that saved
+	CCounter m_dedupLinks;
+	CCounter m_bytesDeduped;
+
+	// Written objects replaced by their compressed content, and the
+	// space that saved
+	CCounter m_compressedObjects;
+	CCounter m_bytesCompressed;
+
+	// Memory objects moved to the cache directory
+	CCounter m_memoryDemotions;
+
+	// Objects whose file was read ahead of the client opening it
+	CCounter m_prefetches;
+};
+
+#endif
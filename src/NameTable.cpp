@@ -0,0 +1,233 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "NameTable.h"
+
+#include <stddef.h>
+
+// The smallest number of slots the hash table has, a power of two
+static const size_t s_minNameTableSlots = 16;
+
+CNameTable::CNameTable() : m_slots(s_minNameTableSlots, (CInternedName *) NULL)
+	, m_mask(s_minNameTableSlots - 1)
+	, m_size(0)
+	, m_heapBytes(0)
+{
+	for (size_t i = 0; i < s_numNamePools; i++)
+	{
+		m_pools[i] = NULL;
+	}
+}
+
+CNameTable::~CNameTable()
+{
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		if ((m_slots[i] != NULL) &&
+		        (GetBlockSize(m_slots[i]->m_length) > s_maxPooledNameSize))
+		{
+			::free(m_slots[i]);
+		}
+	}
+	for (size_t i = 0; i < s_numNamePools; i++)
+	{
+		delete m_pools[i];
+	}
+}
+
+// Get the stored copy of name, storing it if this is its first user.
+// Each call must be matched by a call to Release.
+const CInternedName *
+CNameTable::Intern(const std::string &name)
+{
+
+	uint32_t hash = Hash(name.data(), name.length());
+	size_t slot = hash & m_mask;
+	while (m_slots[slot] != NULL)
+	{
+		CInternedName *stored = m_slots[slot];
+		if ((stored->m_hash == hash) && (stored->m_length == name.length()) &&
+		        (::memcmp(stored->m_name, name.data(), name.length()) == 0))
+		{
+			stored->m_refCount++;
+			return stored;
+		}
+		slot = (slot + 1) & m_mask;
+	}
+
+	size_t blockSize = GetBlockSize(name.length());
+	void *block;
+	if (blockSize <= s_maxPooledNameSize)
+	{
+		size_t pool = blockSize / s_nameSizeStep - 1;
+		if (m_pools[pool] == NULL)
+		{
+			m_pools[pool] = new CSlabPool(blockSize);
+		}
+		block = m_pools[pool]->Allocate();
+	}
+	else
+	{
+		block = ::malloc(blockSize);
+		if (block == NULL)
+		{
+			throw std::bad_alloc();
+		}
+		m_heapBytes += blockSize;
+	}
+
+	CInternedName *stored = static_cast<CInternedName *>(block);
+	stored->m_refCount = 1;
+	stored->m_hash = hash;
+	stored->m_length = (uint32_t) name.length();
+	::memcpy(stored->m_name, name.data(), name.length());
+	stored->m_name[name.length()] = '\0';
+	m_slots[slot] = stored;
+	m_size++;
+
+	// Keep the table at most 70% full so probe sequences stay short
+	if (m_size * 10 > m_slots.size() * 7)
+	{
+		Grow();
+	}
+
+	return stored;
+}
+
+// Drop one user of a name, the name is freed with its last user
+void
+CNameTable::Release(const CInternedName *name)
+{
+
+	if ((name == NULL) || (--const_cast<CInternedName *>(name)->m_refCount > 0))
+	{
+		return;
+	}
+
+	size_t slot = name->m_hash & m_mask;
+	while (m_slots[slot] != name)
+	{
+		if (m_slots[slot] == NULL)
+		{
+			return;
+		}
+		slot = (slot + 1) & m_mask;
+	}
+
+	// Move back each following name whose home slot isn't between the
+	// freed slot and where it is stored so it can still be found.
+	size_t freeSlot = slot;
+	size_t next = slot;
+	while (true)
+	{
+		next = (next + 1) & m_mask;
+		if (m_slots[next] == NULL)
+		{
+			break;
+		}
+		size_t home = m_slots[next]->m_hash & m_mask;
+		bool reachable = (freeSlot <= next) ?
+		                 ((freeSlot < home) && (home <= next)) :
+		                 ((freeSlot < home) || (home <= next));
+		if (!reachable)
+		{
+			m_slots[freeSlot] = m_slots[next];
+			freeSlot = next;
+		}
+	}
+	m_slots[freeSlot] = NULL;
+	m_size--;
+
+	size_t blockSize = GetBlockSize(name->m_length);
+	if (blockSize <= s_maxPooledNameSize)
+	{
+		m_pools[blockSize / s_nameSizeStep - 1]->Free(const_cast<CInternedName *>
+		        (name));
+	}
+	else
+	{
+		m_heapBytes -= blockSize;
+		::free(const_cast<CInternedName *>(name));
+	}
+}
+
+// The bytes used by the names and their hash table
+size_t
+CNameTable::GetStoredBytes() const
+{
+
+	size_t bytes = m_heapBytes + m_slots.size() * sizeof(CInternedName *);
+	for (size_t i = 0; i < s_numNamePools; i++)
+	{
+		if (m_pools[i] != NULL)
+		{
+			bytes += m_pools[i]->GetReservedBytes();
+		}
+	}
+
+	return bytes;
+}
+
+// FNV-1a, names are short so a simple byte at a time hash is enough
+uint32_t
+CNameTable::Hash(const char *name, size_t length)
+{
+
+	uint32_t hash = 2166136261U;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= (uint8_t) name[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+// The size of the block holding a name of length characters, its
+// header and the terminating null
+size_t
+CNameTable::GetBlockSize(size_t length)
+{
+
+	size_t size = offsetof(CInternedName, m_name) + length + 1;
+
+	return (size + s_nameSizeStep - 1) & ~(s_nameSizeStep - 1);
+}
+
+// Double the number of slots and store every name again
+void
+CNameTable::Grow()
+{
+
+	std::vector<CInternedName *> slots(m_slots.size() * 2, (CInternedName *) NULL);
+	m_slots.swap(slots);
+	m_mask = m_slots.size() - 1;
+
+	std::vector<CInternedName *>::const_iterator iter = slots.begin();
+	while (iter != slots.end())
+	{
+		if (*iter != NULL)
+		{
+			size_t slot = (*iter)->m_hash & m_mask;
+			while (m_slots[slot] != NULL)
+			{
+				slot = (slot + 1) & m_mask;
+			}
+			m_slots[slot] = *iter;
+		}
+		++iter;
+	}
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __NAME_TABLE_H__
+#define __NAME_TABLE_H__
+
+#include "CacheBase.h"
+#include "SlabPool.h"
+
+// Names are stored in slab blocks of a multiple of this many bytes up
+// to s_maxPooledNameSize, longer names are allocated on the heap.
+static const size_t s_nameSizeStep = 8;
+static const size_t s_maxPooledNameSize = 128;
+static const size_t s_numNamePools = s_maxPooledNameSize / s_nameSizeStep;
+
+// A name stored once for every object using it.  The characters follow
+// the header and are null terminated.
+struct CInternedName
+{
+	uint32_t m_refCount;
+	uint32_t m_hash;
+	uint32_t m_length;
+	char m_name[4];
+
+	std::string GetString() const
+	{
+		return std::string(m_name, m_length);
+	}
+};
+
+// An interning table for object filenames.  Many objects of a type
+// share the same few names, so each distinct name is stored once with
+// a count of its users and each object only holds a pointer.  The
+// names live in slab blocks sized to fit them and are found through an
+// open addressing hash table.  A table must only be used from one
+// thread.
+class CNameTable
+{
+public:
+
+	CNameTable();
+
+	~CNameTable();
+
+	// Get the stored copy of name, storing it if this is its first
+	// user.  Each call must be matched by a call to Release.
+	const CInternedName *Intern(const std::string &name);
+
+	// Drop one user of a name, the name is freed with its last user
+	void Release(const CInternedName *name);
+
+	// The number of distinct names stored
+	size_t size() const
+	{
+		return m_size;
+	}
+
+	// The bytes used by the names and their hash table
+	size_t GetStoredBytes() const;
+
+private:
+
+	static uint32_t Hash(const char *name, size_t length);
+	static size_t GetBlockSize(size_t length);
+	void Grow();
+
+	std::vector<CInternedName *> m_slots;
+	size_t m_mask;
+	size_t m_size;
+	size_t m_heapBytes;
+	CSlabPool *m_pools[s_numNamePools];
+};
+
+#endif
@@ -0,0 +1,140 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ObjectIdTable.h"
+
+CObjectIdTable::CObjectIdTable() : m_slots(s_minIdTableSlots, value_type(0, NULL))
+	, m_mask(s_minIdTableSlots - 1)
+	, m_size(0)
+{
+}
+
+// Store the object for objId, replacing any object already stored for
+// it.  Returns false if objId is 0.
+bool
+CObjectIdTable::Insert(const cachedObjectId_t objId, CCacheObject *cacheObject)
+{
+
+	if (objId == 0)
+	{
+		return false;
+	}
+
+	// Keep the table at most 70% full so probe sequences stay short
+	if ((m_size + 1) * 10 > m_slots.size() * 7)
+	{
+		Grow();
+	}
+
+	size_t slot = Hash(objId) & m_mask;
+	while (m_slots[slot].first != 0)
+	{
+		if (m_slots[slot].first == objId)
+		{
+			m_slots[slot].second = cacheObject;
+			return true;
+		}
+		slot = (slot + 1) & m_mask;
+	}
+	m_slots[slot] = value_type(objId, cacheObject);
+	m_size++;
+
+	return true;
+}
+
+// Remove the object stored for objId.  Returns false if there was
+// none.
+bool
+CObjectIdTable::Erase(const cachedObjectId_t objId)
+{
+
+	if (objId == 0)
+	{
+		return false;
+	}
+
+	size_t slot = Hash(objId) & m_mask;
+	while (m_slots[slot].first != objId)
+	{
+		if (m_slots[slot].first == 0)
+		{
+			return false;
+		}
+		slot = (slot + 1) & m_mask;
+	}
+
+	// Move back each following entry whose home slot isn't between the
+	// freed slot and where it is stored so it can still be found.
+	size_t freeSlot = slot;
+	size_t next = slot;
+	while (true)
+	{
+		next = (next + 1) & m_mask;
+		if (m_slots[next].first == 0)
+		{
+			break;
+		}
+		size_t home = Hash(m_slots[next].first) & m_mask;
+		bool reachable = (freeSlot <= next) ?
+		                 ((freeSlot < home) && (home <= next)) :
+		                 ((freeSlot < home) || (home <= next));
+		if (!reachable)
+		{
+			m_slots[freeSlot] = m_slots[next];
+			freeSlot = next;
+		}
+	}
+	m_slots[freeSlot] = value_type(0, NULL);
+	m_size--;
+
+	return true;
+}
+
+// Remove every object and release the slots
+void
+CObjectIdTable::clear()
+{
+
+	std::vector<value_type> slots(s_minIdTableSlots, value_type(0, NULL));
+	m_slots.swap(slots);
+	m_mask = s_minIdTableSlots - 1;
+	m_size = 0;
+}
+
+// Double the number of slots and store every entry again
+void
+CObjectIdTable::Grow()
+{
+
+	std::vector<value_type> slots(m_slots.size() * 2, value_type(0, NULL));
+	m_slots.swap(slots);
+	m_mask = m_slots.size() - 1;
+
+	std::vector<value_type>::const_iterator iter = slots.begin();
+	while (iter != slots.end())
+	{
+		if ((*iter).first != 0)
+		{
+			size_t slot = Hash((*iter).first) & m_mask;
+			while (m_slots[slot].first != 0)
+			{
+				slot = (slot + 1) & m_mask;
+			}
+			m_slots[slot] = *iter;
+		}
+		++iter;
+	}
+}
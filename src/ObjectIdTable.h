@@ -0,0 +1,164 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __OBJECT_ID_TABLE_H__
+#define __OBJECT_ID_TABLE_H__
+
+#include "CacheBase.h"
+
+class CCacheObject;
+
+// The smallest number of slots a table is created with, it must be a
+// power of two.
+static const size_t s_minIdTableSlots = 16;
+
+// An open addressing hash table from object id to cache object.
+// Object ids are never 0 so a slot holding id 0 is free.  Collisions
+// are resolved by linear probing which usually keeps a lookup within
+// one cache line, and removals shift the following entries back so no
+// deleted markers are left to slow down later lookups.
+class CObjectIdTable
+{
+public:
+
+	typedef std::pair<cachedObjectId_t, CCacheObject *> value_type;
+
+	// Visits the objects of the table in no particular order.  The
+	// table must not be changed while it is being iterated.
+	class const_iterator
+	{
+	public:
+
+		const_iterator(const CObjectIdTable *table, size_t slot)
+			: m_table(table)
+			, m_slot(slot)
+		{
+			SkipFreeSlots();
+		}
+
+		const value_type &operator*() const
+		{
+			return m_table->m_slots[m_slot];
+		}
+
+		const value_type *operator->() const
+		{
+			return &m_table->m_slots[m_slot];
+		}
+
+		const_iterator &operator++()
+		{
+			++m_slot;
+			SkipFreeSlots();
+			return *this;
+		}
+
+		bool operator==(const const_iterator &other) const
+		{
+			return (m_slot == other.m_slot);
+		}
+
+		bool operator!=(const const_iterator &other) const
+		{
+			return (m_slot != other.m_slot);
+		}
+
+	private:
+
+		void SkipFreeSlots()
+		{
+			while ((m_slot < m_table->m_slots.size()) &&
+			       (m_table->m_slots[m_slot].first == 0))
+			{
+				++m_slot;
+			}
+		}
+
+		const CObjectIdTable *m_table;
+		size_t m_slot;
+	};
+
+	CObjectIdTable();
+
+	// Returns the object stored for objId or NULL if there is none
+	CCacheObject *Find(const cachedObjectId_t objId) const
+	{
+		size_t slot = Hash(objId) & m_mask;
+		while (m_slots[slot].first != 0)
+		{
+			if (m_slots[slot].first == objId)
+			{
+				return m_slots[slot].second;
+			}
+			slot = (slot + 1) & m_mask;
+		}
+
+		return NULL;
+	}
+
+	// Store the object for objId, replacing any object already stored
+	// for it.  Returns false if objId is 0.
+	bool Insert(const cachedObjectId_t objId, CCacheObject *cacheObject);
+
+	// Remove the object stored for objId.  Returns false if there was
+	// none.
+	bool Erase(const cachedObjectId_t objId);
+
+	// Remove every object and release the slots
+	void clear();
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+	bool empty() const
+	{
+		return (m_size == 0);
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(this, 0);
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(this, m_slots.size());
+	}
+
+private:
+
+	// The ids are a random value above a sequence number so the bits
+	// are mixed to spread both parts over the whole table.
+	static size_t Hash(cachedObjectId_t objId)
+	{
+		uint64_t x = (uint64_t) objId;
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		x = x ^ (x >> 31);
+
+		return (size_t) x;
+	}
+
+	void Grow();
+
+	std::vector<value_type> m_slots;
+	size_t m_mask;
+	size_t m_size;
+};
+
+#endif
@@ -0,0 +1,69 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "RwLock.h"
+
+MojLogger CRwLock::s_log(_T("filecache.rwlock"));
+
+CRwLock::CRwLock()
+{
+
+	MojLogTrace(s_log);
+
+	// Prefer writers so the main thread gets back in after a poll even
+	// while the read pool is busy
+	pthread_rwlockattr_t attr;
+	(void) ::pthread_rwlockattr_init(&attr);
+	(void) ::pthread_rwlockattr_setkind_np(&attr,
+	                                       PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+	int retVal = ::pthread_rwlock_init(&m_lock, &attr);
+	if (retVal != 0)
+	{
+		MojLogCritical(s_log, _T("CRwLock: Failed to create lock (%s)."),
+		               ::strerror(retVal));
+		abort();
+	}
+	(void) ::pthread_rwlockattr_destroy(&attr);
+}
+
+CRwLock::~CRwLock()
+{
+
+	MojLogTrace(s_log);
+
+	(void) ::pthread_rwlock_destroy(&m_lock);
+}
+
+void
+CRwLock::ReadLock()
+{
+
+	(void) ::pthread_rwlock_rdlock(&m_lock);
+}
+
+void
+CRwLock::WriteLock()
+{
+
+	(void) ::pthread_rwlock_wrlock(&m_lock);
+}
+
+void
+CRwLock::Unlock()
+{
+
+	(void) ::pthread_rwlock_unlock(&m_lock);
+}
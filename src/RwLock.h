@@ -0,0 +1,70 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __RW_LOCK_H__
+#define __RW_LOCK_H__
+
+#include "CacheBase.h"
+
+#include <pthread.h>
+
+// A reader/writer lock over the cache bookkeeping.  The main thread
+// holds it for writing while it changes the cache, so the read-only
+// requests run on the read pool never see the cache while it is
+// changing and only wait for the change in progress.  Waiting writers
+// go ahead of new readers so a steady stream of reads can't keep the
+// main thread out.
+class CRwLock
+{
+public:
+
+	CRwLock();
+	~CRwLock();
+
+	void ReadLock();
+	void WriteLock();
+	void Unlock();
+
+private:
+
+	CRwLock(const CRwLock &);
+	CRwLock &operator=(const CRwLock &);
+
+	pthread_rwlock_t m_lock;
+	static MojLogger s_log;
+};
+
+// Holds a CRwLock for reading for the life of the guard
+class CReadLockGuard
+{
+public:
+
+	CReadLockGuard(CRwLock &lock) : m_lock(lock)
+	{
+		m_lock.ReadLock();
+	}
+
+	~CReadLockGuard()
+	{
+		m_lock.Unlock();
+	}
+
+private:
+
+	CRwLock &m_lock;
+};
+
+#endif
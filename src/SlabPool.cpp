@@ -0,0 +1,93 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "SlabPool.h"
+
+// Blocks are rounded up to a multiple of 8 bytes so every block in a
+// slab is aligned and large enough to hold the free list link.
+CSlabPool::CSlabPool(size_t blockSize) : m_blockSize((blockSize + 7) & ~(size_t) 7)
+	, m_freeList(NULL)
+	, m_nextBlock(NULL)
+	, m_slabEnd(NULL)
+	, m_numBlocks(0)
+	, m_reservedBytes(0)
+{
+	if (m_blockSize < sizeof(CFreeBlock))
+	{
+		m_blockSize = sizeof(CFreeBlock);
+	}
+}
+
+CSlabPool::~CSlabPool()
+{
+	std::vector<void *>::iterator iter = m_slabs.begin();
+	while (iter != m_slabs.end())
+	{
+		::free(*iter);
+		++iter;
+	}
+}
+
+// Returns a block of GetBlockSize() bytes, aligned for any member up
+// to 8 bytes.  Throws std::bad_alloc if no slab can be added.
+void *
+CSlabPool::Allocate()
+{
+
+	void *block;
+	if (m_freeList != NULL)
+	{
+		block = m_freeList;
+		m_freeList = m_freeList->m_next;
+	}
+	else
+	{
+		// Blocks are handed out of a new slab in order so only the
+		// pages actually used become resident.
+		if (m_nextBlock + m_blockSize > m_slabEnd)
+		{
+			size_t slabSize = (m_blockSize > s_slabSize) ? m_blockSize : s_slabSize;
+			char *slab = static_cast<char *>(::malloc(slabSize));
+			if (slab == NULL)
+			{
+				throw std::bad_alloc();
+			}
+			m_slabs.push_back(slab);
+			m_reservedBytes += slabSize;
+			m_nextBlock = slab;
+			m_slabEnd = slab + slabSize;
+		}
+		block = m_nextBlock;
+		m_nextBlock += m_blockSize;
+	}
+	m_numBlocks++;
+
+	return block;
+}
+
+// Return a block from Allocate to the pool
+void
+CSlabPool::Free(void *block)
+{
+
+	if (block != NULL)
+	{
+		CFreeBlock *freeBlock = static_cast<CFreeBlock *>(block);
+		freeBlock->m_next = m_freeList;
+		m_freeList = freeBlock;
+		m_numBlocks--;
+	}
+}
@@ -0,0 +1,144 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __SLAB_POOL_H__
+#define __SLAB_POOL_H__
+
+#include "CacheBase.h"
+
+#include <new>
+
+// The size of each slab the pools carve their blocks out of
+static const size_t s_slabSize = 64 * 1024;
+
+// A pool of fixed size blocks carved out of large slabs.  Freed blocks
+// are kept on a free list for the next allocation, so an object costs
+// exactly its block size with no per allocation header, and neither
+// allocating nor freeing goes to the heap once the pool has grown.
+// Slabs are only returned when the pool is destroyed.  A pool must
+// only be used from one thread.
+class CSlabPool
+{
+public:
+
+	CSlabPool(size_t blockSize);
+
+	~CSlabPool();
+
+	// Returns a block of GetBlockSize() bytes, aligned for any member
+	// up to 8 bytes.  Throws std::bad_alloc if no slab can be added.
+	void *Allocate();
+
+	// Return a block from Allocate to the pool
+	void Free(void *block);
+
+	size_t GetBlockSize() const
+	{
+		return m_blockSize;
+	}
+
+	// The number of blocks in use
+	size_t GetNumBlocks() const
+	{
+		return m_numBlocks;
+	}
+
+	// The bytes held in slabs, whether or not they are in use
+	size_t GetReservedBytes() const
+	{
+		return m_reservedBytes;
+	}
+
+private:
+
+	struct CFreeBlock
+	{
+		CFreeBlock *m_next;
+	};
+
+	size_t m_blockSize;
+	std::vector<void *> m_slabs;
+	CFreeBlock *m_freeList;
+
+	// The part of the newest slab that has never been handed out
+	char *m_nextBlock;
+	char *m_slabEnd;
+	size_t m_numBlocks;
+	size_t m_reservedBytes;
+};
+
+// The pool shared by everything allocating blocks of Size bytes
+template <size_t Size>
+CSlabPool &GetSlabPool()
+{
+	static CSlabPool pool(Size);
+	return pool;
+}
+
+// A standard allocator that takes single elements from the slab pool
+// for their size, for node based containers like std::list and std::set
+// whose nodes are allocated one at a time.  Arrays go to the heap.
+template <class T>
+class CSlabAllocator
+{
+public:
+
+	typedef T value_type;
+
+	CSlabAllocator()
+	{
+	}
+
+	template <class U>
+	CSlabAllocator(const CSlabAllocator<U> &)
+	{
+	}
+
+	T *allocate(size_t n)
+	{
+		if (n == 1)
+		{
+			return static_cast<T *>(GetSlabPool<sizeof(T)>().Allocate());
+		}
+		return static_cast<T *>(::operator new(n * sizeof(T)));
+	}
+
+	void deallocate(T *ptr, size_t n)
+	{
+		if (n == 1)
+		{
+			GetSlabPool<sizeof(T)>().Free(ptr);
+		}
+		else
+		{
+			::operator delete(ptr);
+		}
+	}
+
+	template <class U>
+	bool operator==(const CSlabAllocator<U> &) const
+	{
+		return true;
+	}
+
+	template <class U>
+	bool operator!=(const CSlabAllocator<U> &) const
+	{
+		return false;
+	}
+};
+
+#endif
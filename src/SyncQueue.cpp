@@ -0,0 +1,243 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "SyncQueue.h"
+
+#include <chrono>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+MojLogger CSyncQueue::s_log(_T("filecache.syncqueue"));
+
+CSyncQueue::CSyncQueue(unsigned int maxDelay) : m_maxDelay(maxDelay)
+	, m_numSyncing(0)
+	, m_eventFd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+	, m_stopping(false)
+{
+
+	MojLogTrace(s_log);
+
+	if (m_eventFd < 0)
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("CSyncQueue: Failed to create event fd (%s)."),
+		            ::strerror(savedErrno));
+	}
+	m_worker = std::thread(&CSyncQueue::Worker, this);
+}
+
+// Flushes the requests still queued and stops the worker
+CSyncQueue::~CSyncQueue()
+{
+
+	MojLogTrace(s_log);
+
+	Stop();
+	if (m_eventFd >= 0)
+	{
+		::close(m_eventFd);
+	}
+}
+
+// Queue an object to be flushed
+void
+CSyncQueue::Add(const std::string &typeName, const cachedObjectId_t objId,
+                const std::string &pathname)
+{
+
+	MojLogTrace(s_log);
+
+	CSyncRequest request;
+	request.m_typeName = typeName;
+	request.m_objId = objId;
+	request.m_pathname = pathname;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_queue.push_back(request);
+	m_cond.notify_all();
+}
+
+// Move the flushed requests to completed and clear the event fd.
+// Returns false if nothing had been flushed.
+bool
+CSyncQueue::GetCompleted(syncRequests_t &completed)
+{
+
+	MojLogTrace(s_log);
+
+	if (m_eventFd >= 0)
+	{
+		eventfd_t value;
+		(void) ::eventfd_read(m_eventFd, &value);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	completed.swap(m_completed);
+	m_completed.clear();
+
+	return !completed.empty();
+}
+
+// The number of requests added and not yet collected
+size_t
+CSyncQueue::GetNumPending()
+{
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_queue.size() + m_numSyncing + m_completed.size();
+}
+
+// Flush a batch of requests, setting m_synced on each.  A large batch
+// is flushed with a single syncfs, which needs an fd on the filesystem
+// and so still opens each object to check it exists.
+void
+CSyncQueue::SyncBatch(syncRequests_t &batch)
+{
+
+	bool useSyncfs = (batch.size() >= s_syncfsBatchSize);
+	int syncfsFd = -1;
+	syncRequests_t::iterator iter = batch.begin();
+	while (iter != batch.end())
+	{
+#ifdef MOJ_MAC
+		int fd = ::open((*iter).m_pathname.c_str(), O_RDONLY);
+#else
+		int fd = ::open((*iter).m_pathname.c_str(), O_RDONLY | O_NOATIME);
+#endif // #ifdef MOJ_MAC
+		if (fd < 0)
+		{
+			int savedErrno = errno;
+			MojLogError(s_log, _T("SyncBatch: could not open '%s' for sync (%s)."),
+			            (*iter).m_pathname.c_str(), ::strerror(savedErrno));
+			(*iter).m_synced = false;
+		}
+		else if (useSyncfs)
+		{
+			(*iter).m_synced = true;
+			if (syncfsFd < 0)
+			{
+				syncfsFd = fd;
+				fd = -1;
+			}
+		}
+		else
+		{
+			(*iter).m_synced = (::fdatasync(fd) == 0);
+			if (!(*iter).m_synced)
+			{
+				int savedErrno = errno;
+				MojLogError(s_log, _T("SyncBatch: Failed to sync file '%s' (%s)."),
+				            (*iter).m_pathname.c_str(), ::strerror(savedErrno));
+			}
+		}
+		if (fd >= 0)
+		{
+			::close(fd);
+		}
+		++iter;
+	}
+
+	if (syncfsFd >= 0)
+	{
+#ifdef MOJ_MAC
+		bool synced = (::fsync(syncfsFd) == 0);
+#else
+		bool synced = (::syncfs(syncfsFd) == 0);
+#endif // #ifdef MOJ_MAC
+		if (!synced)
+		{
+			int savedErrno = errno;
+			MojLogError(s_log, _T("SyncBatch: Failed to sync filesystem (%s)."),
+			            ::strerror(savedErrno));
+			iter = batch.begin();
+			while (iter != batch.end())
+			{
+				(*iter).m_synced = false;
+				++iter;
+			}
+		}
+		::close(syncfsFd);
+	}
+	MojLogDebug(s_log, _T("SyncBatch: Flushed %zu objects%s."), batch.size(),
+	            useSyncfs ? " with syncfs" : "");
+}
+
+// Flushes any requests still queued and stops the worker
+void
+CSyncQueue::Stop()
+{
+
+	MojLogTrace(s_log);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+		m_cond.notify_all();
+	}
+	if (m_worker.joinable())
+	{
+		m_worker.join();
+	}
+}
+
+// Wait for requests, give them up to m_maxDelay to collect a batch and
+// flush it.  When stopping the queue is flushed without waiting.
+void
+CSyncQueue::Worker()
+{
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		if (m_queue.empty())
+		{
+			if (m_stopping)
+			{
+				break;
+			}
+			m_cond.wait(lock);
+			continue;
+		}
+
+		std::chrono::steady_clock::time_point deadline =
+		    std::chrono::steady_clock::now() + std::chrono::milliseconds(m_maxDelay);
+		while (!m_stopping && (m_queue.size() < s_maxSyncBatch) &&
+		        (m_cond.wait_until(lock, deadline) != std::cv_status::timeout))
+		{
+		}
+
+		syncRequests_t batch;
+		while (!m_queue.empty() && (batch.size() < s_maxSyncBatch))
+		{
+			batch.push_back(m_queue.front());
+			m_queue.pop_front();
+		}
+		m_numSyncing = batch.size();
+		lock.unlock();
+
+		SyncBatch(batch);
+
+		lock.lock();
+		m_completed.insert(m_completed.end(), batch.begin(), batch.end());
+		m_numSyncing = 0;
+		if (m_eventFd >= 0)
+		{
+			(void) ::eventfd_write(m_eventFd, 1);
+		}
+	}
+}
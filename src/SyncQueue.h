@@ -0,0 +1,108 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __SYNC_QUEUE_H__
+#define __SYNC_QUEUE_H__
+
+#include "CacheBase.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The most objects flushed in one batch
+static const size_t s_maxSyncBatch = 64;
+
+// Batches of at least this many objects are flushed with one syncfs
+// of the cache filesystem rather than an fdatasync of each object
+static const size_t s_syncfsBatchSize = 8;
+
+// An object waiting for its data to be flushed, and once flushed
+// whether that worked
+struct CSyncRequest
+{
+	CSyncRequest() : m_objId(0)
+		, m_synced(false)
+	{
+	}
+
+	std::string m_typeName;
+	cachedObjectId_t m_objId;
+	std::string m_pathname;
+	bool m_synced;
+};
+
+typedef std::vector<CSyncRequest> syncRequests_t;
+
+// Flushes the data of objects that have finished being written on a
+// worker thread, so a burst of objects completing together doesn't
+// stall the main loop with an fsync each.  Requests are held for up to
+// maxDelay milliseconds to collect a batch, which is then flushed with
+// a single syncfs or an fdatasync of each object.  Flushed requests
+// are collected by the main thread with GetCompleted, and the event fd
+// becomes readable whenever there are some to collect.
+class CSyncQueue
+{
+public:
+
+	CSyncQueue(unsigned int maxDelay);
+
+	// Flushes the requests still queued and stops the worker
+	~CSyncQueue();
+
+	// Queue an object to be flushed
+	void Add(const std::string &typeName, const cachedObjectId_t objId,
+	         const std::string &pathname);
+
+	// Move the flushed requests to completed and clear the event fd.
+	// Returns false if nothing had been flushed.
+	bool GetCompleted(syncRequests_t &completed);
+
+	// The number of requests added and not yet collected
+	size_t GetNumPending();
+
+	// An fd that polls readable while flushed requests are waiting to
+	// be collected
+	int GetEventFd() const
+	{
+		return m_eventFd;
+	}
+
+	// Flush a batch of requests, setting m_synced on each
+	static void SyncBatch(syncRequests_t &batch);
+
+	// Flushes any requests still queued and stops the worker
+	void Stop();
+
+private:
+
+	void Worker();
+
+	unsigned int m_maxDelay;
+	std::thread m_worker;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::deque<CSyncRequest> m_queue;
+	syncRequests_t m_completed;
+	size_t m_numSyncing;
+	int m_eventFd;
+	bool m_stopping;
+	static MojLogger s_log;
+};
+
+#endif
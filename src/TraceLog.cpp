@@ -0,0 +1,400 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "TraceLog.h"
+#include "Metrics.h"
+
+#include <sstream>
+
+MojLogger CTraceLog::s_log(_T("filecache.tracelog"));
+
+// The names of the operations in a trace, in TraceOp order
+static const char *const s_traceOpNames[] =
+{
+	"None",
+	"Config",
+	"DefineType",
+	"ChangeType",
+	"DeleteType",
+	"Insert",
+	"Resize",
+	"Expire",
+	"Subscribe",
+	"UnSubscribe",
+	"Touch"
+};
+static const size_t s_numTraceOps =
+    sizeof(s_traceOpNames) / sizeof(s_traceOpNames[0]);
+
+// The name of an operation as it is written in a trace
+const char *
+GetTraceOpName(const TraceOp op)
+{
+
+	return ((size_t) op < s_numTraceOps) ? s_traceOpNames[op] : s_traceOpNames[0];
+}
+
+// Formats a record as a line of a trace, without the newline
+std::string
+FormatTraceRecord(const CTraceRecord &record)
+{
+
+	std::ostringstream line;
+	line << record.m_micros << " " << GetTraceOpName(record.m_op);
+	switch (record.m_op)
+	{
+		case TraceConfig:
+			line << " " << record.m_size;
+			break;
+
+		case TraceDefineType:
+		case TraceChangeType:
+			line << " " << record.m_typeName << " " << record.m_loWatermark
+			     << " " << record.m_hiWatermark << " " << record.m_size
+			     << " " << record.m_cost << " " << record.m_lifetime;
+			if (record.m_op == TraceDefineType)
+			{
+				line << " " << (record.m_dirType ? 1 : 0);
+			}
+			if (!record.m_policy.empty())
+			{
+				line << " " << record.m_policy;
+			}
+			break;
+
+		case TraceDeleteType:
+			line << " " << record.m_typeName;
+			break;
+
+		case TraceInsert:
+			line << " " << record.m_typeName << " " << record.m_size << " "
+			     << record.m_cost << " " << record.m_lifetime << " "
+			     << record.m_objId;
+			break;
+
+		case TraceResize:
+			line << " " << record.m_objId << " " << record.m_size;
+			break;
+
+		case TraceUnSubscribe:
+			line << " " << record.m_typeName << " " << record.m_objId;
+			break;
+
+		case TraceExpire:
+		case TraceSubscribe:
+		case TraceTouch:
+			line << " " << record.m_objId;
+			break;
+
+		default:
+			break;
+	}
+
+	return line.str();
+}
+
+// Parses a line of a trace.  Returns false if it isn't a record.
+bool
+ParseTraceRecord(const std::string &line, CTraceRecord &record)
+{
+
+	std::istringstream fields(line);
+	std::string opName;
+	record = CTraceRecord();
+	if (!(fields >> record.m_micros >> opName))
+	{
+		return false;
+	}
+	for (size_t i = 1; i < s_numTraceOps; i++)
+	{
+		if (opName == s_traceOpNames[i])
+		{
+			record.m_op = (TraceOp) i;
+			break;
+		}
+	}
+
+	int dirType = 0;
+	bool hasPolicy = false;
+	switch (record.m_op)
+	{
+		case TraceConfig:
+			fields >> record.m_size;
+			break;
+
+		case TraceDefineType:
+			fields >> record.m_typeName >> record.m_loWatermark
+			       >> record.m_hiWatermark >> record.m_size >> record.m_cost
+			       >> record.m_lifetime >> dirType;
+			record.m_dirType = (dirType != 0);
+			hasPolicy = true;
+			break;
+
+		case TraceChangeType:
+			fields >> record.m_typeName >> record.m_loWatermark
+			       >> record.m_hiWatermark >> record.m_size >> record.m_cost
+			       >> record.m_lifetime;
+			hasPolicy = true;
+			break;
+
+		case TraceDeleteType:
+			fields >> record.m_typeName;
+			break;
+
+		case TraceInsert:
+			fields >> record.m_typeName >> record.m_size >> record.m_cost
+			       >> record.m_lifetime >> record.m_objId;
+			break;
+
+		case TraceResize:
+			fields >> record.m_objId >> record.m_size;
+			break;
+
+		case TraceUnSubscribe:
+			fields >> record.m_typeName >> record.m_objId;
+			break;
+
+		case TraceExpire:
+		case TraceSubscribe:
+		case TraceTouch:
+			fields >> record.m_objId;
+			break;
+
+		default:
+			return false;
+	}
+	if (fields.fail())
+	{
+		return false;
+	}
+
+	// Traces written before there were eviction policies don't have one
+	if (hasPolicy)
+	{
+		fields >> record.m_policy;
+	}
+
+	return true;
+}
+
+CTraceLog::CTraceLog() : m_file(NULL)
+	, m_startMicros(0)
+{
+
+	MojLogTrace(s_log);
+}
+
+// Closes the trace
+CTraceLog::~CTraceLog()
+{
+
+	MojLogTrace(s_log);
+
+	if (m_file != NULL)
+	{
+		::fclose(m_file);
+	}
+}
+
+// Start appending to the trace at pathname.  The trace is line
+// buffered so the records written survive the service being killed.
+bool
+CTraceLog::Open(const std::string &pathname, const cacheSize_t totalCacheSpace)
+{
+
+	MojLogTrace(s_log);
+
+	if (m_file != NULL)
+	{
+		::fclose(m_file);
+	}
+	m_file = ::fopen(pathname.c_str(), "a");
+	if (m_file == NULL)
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("Open: Failed to open trace '%s' (%s)."),
+		            pathname.c_str(), ::strerror(savedErrno));
+		return false;
+	}
+	(void) ::setvbuf(m_file, NULL, _IOLBF, 0);
+	m_startMicros = GetMonotonicMicros();
+	MojLogInfo(s_log, _T("Open: Tracing to '%s'."), pathname.c_str());
+
+	CTraceRecord record;
+	record.m_op = TraceConfig;
+	record.m_size = totalCacheSpace;
+	Write(record);
+
+	return true;
+}
+
+void
+CTraceLog::DefineType(const std::string &typeName,
+                      const CCacheParamValues &params, bool dirType)
+{
+
+	if (m_file != NULL)
+	{
+		CTraceRecord record;
+		record.m_op = TraceDefineType;
+		record.m_typeName = typeName;
+		record.m_loWatermark = params.GetLoWatermark();
+		record.m_hiWatermark = params.GetHiWatermark();
+		record.m_size = params.GetSize();
+		record.m_cost = params.GetCost();
+		record.m_lifetime = params.GetLifetime();
+		record.m_dirType = dirType;
+		record.m_policy = params.GetPolicy();
+		Write(record);
+	}
+}
+
+void
+CTraceLog::ChangeType(const std::string &typeName,
+                      const CCacheParamValues &params)
+{
+
+	if (m_file != NULL)
+	{
+		CTraceRecord record;
+		record.m_op = TraceChangeType;
+		record.m_typeName = typeName;
+		record.m_loWatermark = params.GetLoWatermark();
+		record.m_hiWatermark = params.GetHiWatermark();
+		record.m_size = params.GetSize();
+		record.m_cost = params.GetCost();
+		record.m_lifetime = params.GetLifetime();
+		record.m_policy = params.GetPolicy();
+		Write(record);
+	}
+}
+
+void
+CTraceLog::DeleteType(const std::string &typeName)
+{
+
+	if (m_file != NULL)
+	{
+		CTraceRecord record;
+		record.m_op = TraceDeleteType;
+		record.m_typeName = typeName;
+		Write(record);
+	}
+}
+
+void
+CTraceLog::Insert(const std::string &typeName, cacheSize_t size,
+                  paramValue_t cost, paramValue_t lifetime,
+                  const cachedObjectId_t objId)
+{
+
+	if (m_file != NULL)
+	{
+		CTraceRecord record;
+		record.m_op = TraceInsert;
+		record.m_typeName = typeName;
+		record.m_size = size;
+		record.m_cost = cost;
+		record.m_lifetime = lifetime;
+		record.m_objId = objId;
+		Write(record);
+	}
+}
+
+void
+CTraceLog::Resize(const cachedObjectId_t objId, cacheSize_t size)
+{
+
+	if (m_file != NULL)
+	{
+		CTraceRecord record;
+		record.m_op = TraceResize;
+		record.m_objId = objId;
+		record.m_size = size;
+		Write(record);
+	}
+}
+
+void
+CTraceLog::Expire(const cachedObjectId_t objId)
+{
+
+	if (m_file != NULL)
+	{
+		CTraceRecord record;
+		record.m_op = TraceExpire;
+		record.m_objId = objId;
+		Write(record);
+	}
+}
+
+void
+CTraceLog::Subscribe(const cachedObjectId_t objId)
+{
+
+	if (m_file != NULL)
+	{
+		CTraceRecord record;
+		record.m_op = TraceSubscribe;
+		record.m_objId = objId;
+		Write(record);
+	}
+}
+
+void
+CTraceLog::UnSubscribe(const std::string &typeName,
+                       const cachedObjectId_t objId)
+{
+
+	if (m_file != NULL)
+	{
+		CTraceRecord record;
+		record.m_op = TraceUnSubscribe;
+		record.m_typeName = typeName;
+		record.m_objId = objId;
+		Write(record);
+	}
+}
+
+void
+CTraceLog::Touch(const cachedObjectId_t objId)
+{
+
+	if (m_file != NULL)
+	{
+		CTraceRecord record;
+		record.m_op = TraceTouch;
+		record.m_objId = objId;
+		Write(record);
+	}
+}
+
+// Stamp a record with the time since the trace started and append it
+void
+CTraceLog::Write(CTraceRecord &record)
+{
+
+	record.m_micros = GetMonotonicMicros() - m_startMicros;
+	const std::string line(FormatTraceRecord(record));
+	if (::fprintf(m_file, "%s\n", line.c_str()) < 0)
+	{
+		int savedErrno = errno;
+		MojLogError(s_log, _T("Write: Failed to write trace, tracing stopped (%s)."),
+		            ::strerror(savedErrno));
+		::fclose(m_file);
+		m_file = NULL;
+	}
+}
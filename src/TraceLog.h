@@ -0,0 +1,135 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __TRACE_LOG_H__
+#define __TRACE_LOG_H__
+
+#include "CacheBase.h"
+
+#include <stdio.h>
+
+// The operations recorded in a trace
+enum TraceOp
+{
+	TraceNone,
+	TraceConfig,
+	TraceDefineType,
+	TraceChangeType,
+	TraceDeleteType,
+	TraceInsert,
+	TraceResize,
+	TraceExpire,
+	TraceSubscribe,
+	TraceUnSubscribe,
+	TraceTouch
+};
+
+// One operation of a trace.  Only the fields the operation uses are
+// set, the values are the ones the client asked for so a replay makes
+// the same calls.  The eviction policy of a type is only written when
+// the client set one.  The id of an insert is the one it was given, 0 if
+// it failed, so later operations on the object can be matched to the
+// object a replay inserts.
+struct CTraceRecord
+{
+	CTraceRecord()
+		: m_micros(0)
+		, m_op(TraceNone)
+		, m_objId(0)
+		, m_loWatermark(0)
+		, m_hiWatermark(0)
+		, m_size(0)
+		, m_cost(0)
+		, m_lifetime(0)
+		, m_dirType(false)
+	{
+	}
+
+	long long m_micros;
+	TraceOp m_op;
+	std::string m_typeName;
+	cachedObjectId_t m_objId;
+	cacheSize_t m_loWatermark;
+	cacheSize_t m_hiWatermark;
+	cacheSize_t m_size;
+	paramValue_t m_cost;
+	paramValue_t m_lifetime;
+	bool m_dirType;
+	std::string m_policy;
+};
+
+// The name of an operation as it is written in a trace
+const char *GetTraceOpName(const TraceOp op);
+
+// Formats a record as a line of a trace, without the newline.  The
+// line is the time in microseconds since the trace started, the
+// operation name and its fields separated by spaces.
+std::string FormatTraceRecord(const CTraceRecord &record);
+
+// Parses a line of a trace.  Returns false if it isn't a record.
+bool ParseTraceRecord(const std::string &line, CTraceRecord &record);
+
+// Records the operations the clients ask for in a trace file that can
+// be replayed against a CFileCacheSet to compare eviction policies and
+// optimizations on a real workload.  Tracing is off unless the trace
+// is opened, every call is then a no-op.  It is only called from the
+// main loop.
+class CTraceLog
+{
+public:
+
+	CTraceLog();
+
+	// Closes the trace
+	~CTraceLog();
+
+	// Start appending to the trace at pathname.  The first record is
+	// the total cache space the operations ran against.
+	bool Open(const std::string &pathname, const cacheSize_t totalCacheSpace);
+
+	bool IsOpen() const
+	{
+		return (m_file != NULL);
+	}
+
+	void DefineType(const std::string &typeName,
+	                const CCacheParamValues &params, bool dirType);
+	void ChangeType(const std::string &typeName,
+	                const CCacheParamValues &params);
+	void DeleteType(const std::string &typeName);
+	void Insert(const std::string &typeName, cacheSize_t size,
+	            paramValue_t cost, paramValue_t lifetime,
+	            const cachedObjectId_t objId);
+	void Resize(const cachedObjectId_t objId, cacheSize_t size);
+	void Expire(const cachedObjectId_t objId);
+	void Subscribe(const cachedObjectId_t objId);
+	void UnSubscribe(const std::string &typeName,
+	                 const cachedObjectId_t objId);
+	void Touch(const cachedObjectId_t objId);
+
+private:
+
+	CTraceLog(const CTraceLog &);
+	CTraceLog &operator=(const CTraceLog &);
+
+	void Write(CTraceRecord &record);
+
+	FILE *m_file;
+	long long m_startMicros;
+	static MojLogger s_log;
+};
+
+#endif
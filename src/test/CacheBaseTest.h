@@ -95,12 +95,53 @@ public:
 		TS_ASSERT(typeName.length() == 0);
 	}
 
+	void testFindTypeNameInPath()
+	{
+		const char *typeName = NULL;
+		size_t length = 0;
+		TS_ASSERT(FindTypeNameInPath(s_baseTestDirName, goodPath2.c_str(),
+		                             &typeName, &length));
+		TS_ASSERT_EQUALS(length, (size_t) 4);
+		TS_ASSERT_SAME_DATA(typeName, "type", 4);
+		TS_ASSERT(!FindTypeNameInPath(s_baseTestDirName, badPath3.c_str(),
+		                              &typeName, &length));
+		TS_ASSERT(!FindTypeNameInPath(s_baseTestDirName,
+		                              s_baseTestDirName.c_str(), &typeName, &length));
+
+		TS_ASSERT(PathHasTypeName(s_baseTestDirName, goodPath2.c_str(), "type"));
+		TS_ASSERT(!PathHasTypeName(s_baseTestDirName, goodPath2.c_str(), "typ"));
+		TS_ASSERT(!PathHasTypeName(s_baseTestDirName, goodPath2.c_str(), ""));
+		TS_ASSERT(PathHasTypeName(s_baseTestDirName, badPath3.c_str(), ""));
+	}
+
+	void testGetDirectoryFromPath()
+	{
+		TS_ASSERT_EQUALS(GetDirectoryFromPath(goodPath1),
+		                 std::string("/dir/subdir1/.../type/A"));
+		TS_ASSERT_EQUALS(GetDirectoryFromPath(badPath4), std::string(""));
+
+		char dirpath[64];
+		TS_ASSERT_EQUALS(GetDirectoryFromPath(goodPath1.c_str(), dirpath,
+		                                      sizeof(dirpath)), (size_t) 23);
+		TS_ASSERT_SAME_DATA(dirpath, "/dir/subdir1/.../type/A", 24);
+		TS_ASSERT_EQUALS(GetDirectoryFromPath(badPath4.c_str(), dirpath,
+		                                      sizeof(dirpath)), (size_t) 0);
+		TS_ASSERT_EQUALS(GetDirectoryFromPath(goodPath1.c_str(), dirpath, 23),
+		                 (size_t) 0);
+		TS_ASSERT_SAME_DATA(dirpath, "", 1);
+	}
+
 	void testGetFileExtension()
 	{
 		TS_ASSERT_SAME_DATA(GetFileExtension(goodPath1.c_str()).c_str(),
 		                    ".ext", 4);
 		TS_ASSERT_SAME_DATA(GetFileExtension(badPath4.c_str()).c_str(),
 		                    "", 1);
+		TS_ASSERT_SAME_DATA(GetFileExtension("/dir.subdir/file").c_str(),
+		                    "", 1);
+		const char *filePath = "file.tar.gz";
+		TS_ASSERT_EQUALS(FindFileExtension(filePath), filePath + 8);
+		TS_ASSERT_EQUALS(*FindFileExtension(badPath4.c_str()), '\0');
 	}
 
 	void testBuildPathname()
@@ -114,6 +155,22 @@ public:
 		                    (unsigned int) goodPath2.length());
 		pathname = BuildPathname(0, dirBase, type, file, false);
 		TS_ASSERT_SAME_DATA(pathname.c_str(), "", 1);
+
+		// The buffer version builds the same path and refuses buffers
+		// too small to hold it
+		char buffer[s_maxPathnameLength];
+		TS_ASSERT_EQUALS(BuildPathname(buffer, sizeof(buffer), objId, dirBase,
+		                               type, file.c_str(), false), goodPath2.length());
+		TS_ASSERT_SAME_DATA(buffer, goodPath2.c_str(),
+		                    (unsigned int) goodPath2.length() + 1);
+		TS_ASSERT_EQUALS(BuildPathname(buffer, goodPath2.length(), objId,
+		                               dirBase, type, file.c_str(), false), (size_t) 0);
+		TS_ASSERT_EQUALS(BuildPathname(buffer, sizeof(buffer), objId, dirBase,
+		                               type, NULL, false), goodPath2.length() - 4);
+
+		char encodedId[s_numChars];
+		EncodeObjectId(objId, encodedId);
+		TS_ASSERT_SAME_DATA(encodedId, "ABCDEFGHI", s_numChars);
 	}
 
 	void testCacheParamValuesConstructor()
@@ -204,6 +261,340 @@ public:
 		CleanupDir(pathname, msgText);
 		TS_ASSERT_EQUALS(::access(pathname.c_str(), F_OK), -1);
 	}
+
+	void testMoveToTrash()
+	{
+		FILE *fp;
+		char tempbase[20] = "/tmp/test/fooXXXXXX";
+		std::string typeDir(::mkdtemp(tempbase));
+		std::string dirname(typeDir + "/A");
+		TS_ASSERT(::mkdir(dirname.c_str(), 0700) == 0);
+		std::string filename(dirname + "/BCDEFGHI.ext");
+		TS_ASSERT((fp = fopen(filename.c_str(), "w")) != NULL);
+		::fclose(fp);
+
+		// The trash is created on first use and the object keeps a name
+		// unique to its id
+		std::string trashPath;
+		TS_ASSERT(MoveToTrash(filename, trashPath));
+		TS_ASSERT_EQUALS(trashPath, typeDir + "/.trash/ABCDEFGHI.ext");
+		TS_ASSERT_EQUALS(::access(filename.c_str(), F_OK), -1);
+		TS_ASSERT_EQUALS(::access(trashPath.c_str(), F_OK), 0);
+		TS_ASSERT(IsTrashPath(typeDir + "/.trash"));
+		TS_ASSERT(!IsTrashPath(typeDir + "/.trashed"));
+		TS_ASSERT(!IsTrashPath(trashPath));
+
+		// Moving something that isn't there fails
+		TS_ASSERT(!MoveToTrash(filename, trashPath));
+
+		std::string msgText;
+		TS_ASSERT(ReapTrash(trashPath, msgText));
+		TS_ASSERT_EQUALS(::access(trashPath.c_str(), F_OK), -1);
+		TS_ASSERT(CleanupDir(typeDir, msgText));
+	}
+
+	void testHashAndCompareFiles()
+	{
+		char tempbase[20] = "/tmp/test/fooXXXXXX";
+		std::string dirname(::mkdtemp(tempbase));
+		const std::string names[4] = { "/empty", "/abc", "/big1", "/big2" };
+		std::string data[4];
+		data[1] = "abc";
+		data[2].assign(200001, 'x');
+		data[3] = data[2];
+		data[3][150000] = 'y';
+		for (int i = 0; i < 4; i++)
+		{
+			FILE *fp = fopen((dirname + names[i]).c_str(), "w");
+			TS_ASSERT(fp != NULL);
+			::fwrite(data[i].data(), 1, data[i].size(), fp);
+			::fclose(fp);
+		}
+
+		// The published XXH64 values for seed 0
+		uint64_t hash;
+		std::string msgText;
+		TS_ASSERT(HashFile(dirname + "/empty", hash, msgText));
+		TS_ASSERT_EQUALS(hash, 0xef46db3751d8e999ULL);
+		TS_ASSERT(HashFile(dirname + "/abc", hash, msgText));
+		TS_ASSERT_EQUALS(hash, 0x44bc2cf5ad770999ULL);
+		uint64_t hash2;
+		TS_ASSERT(HashFile(dirname + "/big1", hash, msgText));
+		TS_ASSERT(HashFile(dirname + "/big2", hash2, msgText));
+		TS_ASSERT_DIFFERS(hash, hash2);
+		TS_ASSERT(!HashFile(dirname + "/missing", hash, msgText));
+
+		TS_ASSERT(CompareFiles(dirname + "/big1", dirname + "/big1"));
+		TS_ASSERT(!CompareFiles(dirname + "/big1", dirname + "/big2"));
+		TS_ASSERT(!CompareFiles(dirname + "/abc", dirname + "/empty"));
+		TS_ASSERT(!CompareFiles(dirname + "/abc", dirname + "/missing"));
+
+		// A link to be renamed over an object is made in the trash
+		::mkdir((dirname + "/A").c_str(), 0700);
+		std::string linkPath;
+		TS_ASSERT(LinkToTrash(dirname + "/abc", dirname + "/A/BCDEFGHI.ext",
+		                      linkPath));
+		TS_ASSERT_EQUALS(linkPath, dirname + "/.trash/ABCDEFGHI.ext.link");
+		TS_ASSERT(CompareFiles(dirname + "/abc", linkPath));
+		TS_ASSERT(!LinkToTrash(dirname + "/missing", dirname + "/A/BCDEFGHJ.ext",
+		                       linkPath));
+		TS_ASSERT(CleanupDir(dirname, msgText));
+	}
+
+	void testBlockSize()
+	{
+		TS_ASSERT_EQUALS(GetBlockSize(), s_blockSize);
+		TS_ASSERT(GetFilesystemBlockSize("/tmp") >= 512);
+		TS_ASSERT_EQUALS(GetFilesystemBlockSize("/tmp/test/missing"), -1);
+
+		// Space is accounted in whatever block size is set
+		SetBlockSize(1024);
+		TS_ASSERT_EQUALS(GetFilesystemFileSize(1), 2048);
+		TS_ASSERT_EQUALS(GetFilesystemFileSize(1025), 3072);
+		SetBlockSize(s_blockSize);
+		TS_ASSERT_EQUALS(GetFilesystemFileSize(1), 2 * s_blockSize);
+	}
+
+	void testReserveFileSpace()
+	{
+		FILE *fp;
+		char tempbase[20] = "/tmp/test/fooXXXXXX";
+		std::string dirname(::mkdtemp(tempbase));
+		std::string filename(dirname + "/reserved.ext");
+		TS_ASSERT((fp = fopen(filename.c_str(), "w")) != NULL);
+		::fclose(fp);
+
+		// The space is allocated but the file stays empty until written
+		std::string msgText;
+		struct stat buf;
+		if (ReserveFileSpace(filename, 100000, msgText))
+		{
+			TS_ASSERT_EQUALS(::stat(filename.c_str(), &buf), 0);
+			TS_ASSERT_EQUALS(buf.st_size, 0);
+			TS_ASSERT(buf.st_blocks * 512 >= 100000);
+
+			TS_ASSERT((fp = fopen(filename.c_str(), "r+")) != NULL);
+			::fwrite("data", 1, 4, fp);
+			::fclose(fp);
+			TS_ASSERT(ReleaseFileSpace(filename, msgText));
+			TS_ASSERT_EQUALS(::stat(filename.c_str(), &buf), 0);
+			TS_ASSERT_EQUALS(buf.st_size, 4);
+			TS_ASSERT(buf.st_blocks * 512 < 100000);
+		}
+		else
+		{
+			TS_ASSERT_EQUALS(errno, EOPNOTSUPP);
+		}
+		TS_ASSERT(!ReserveFileSpace(dirname + "/missing.ext", 100, msgText));
+		TS_ASSERT(CleanupDir(dirname, msgText));
+	}
+
+	void testObjectRecord()
+	{
+		CObjectRecord record;
+		record.m_filename = "file.ext";
+		record.m_size = 123456;
+		record.m_cost = 7;
+		record.m_lifetime = 86400;
+		record.m_written = true;
+		const std::string value(PackObjectRecord(record));
+		TS_ASSERT_EQUALS(value.length(), s_objectRecordHeaderSize + 8);
+
+		CObjectRecord unpacked;
+		TS_ASSERT(UnpackObjectRecord(value.data(), value.length(), unpacked));
+		TS_ASSERT_EQUALS(unpacked.m_filename, record.m_filename);
+		TS_ASSERT_EQUALS(unpacked.m_size, record.m_size);
+		TS_ASSERT_EQUALS(unpacked.m_cost, record.m_cost);
+		TS_ASSERT_EQUALS(unpacked.m_lifetime, record.m_lifetime);
+		TS_ASSERT(unpacked.m_written);
+		TS_ASSERT(!unpacked.m_dirType);
+
+		// Truncated records and unknown versions are rejected
+		TS_ASSERT(!UnpackObjectRecord(value.data(), value.length() - 1, unpacked));
+		std::string newer(value);
+		newer[0] = (char)(s_objectRecordVersion + 1);
+		TS_ASSERT(!UnpackObjectRecord(newer.data(), newer.length(), unpacked));
+
+		// Sizes past 2 GB keep all their bits
+		record.m_size = 6LL << 30;
+		const std::string large(PackObjectRecord(record));
+		TS_ASSERT(UnpackObjectRecord(large.data(), large.length(), unpacked));
+		TS_ASSERT_EQUALS(unpacked.m_size, 6LL << 30);
+		TS_ASSERT_EQUALS(GetFilesystemFileSize(6LL << 30),
+		                 (6LL << 30) + s_blockSize);
+
+		// A compressed object's record ends with its stored size
+		record.m_compressed = true;
+		record.m_storedSize = 4321;
+		const std::string compressed(PackObjectRecord(record));
+		TS_ASSERT_EQUALS(compressed.length(), large.length() + s_objectRecordStoredSize);
+		TS_ASSERT(UnpackObjectRecord(compressed.data(), compressed.length(),
+		                             unpacked));
+		TS_ASSERT(unpacked.m_compressed);
+		TS_ASSERT_EQUALS(unpacked.m_storedSize, 4321);
+		TS_ASSERT_EQUALS(unpacked.m_filename, record.m_filename);
+		TS_ASSERT(!UnpackObjectRecord(compressed.data(), large.length(), unpacked));
+	}
+
+	void testCopyFile()
+	{
+		char tempbase[20] = "/tmp/test/fooXXXXXX";
+		std::string dirname(::mkdtemp(tempbase));
+		std::string data;
+		while (data.size() < 100000)
+		{
+			data += "a line of text " + std::to_string(data.size()) + "\n";
+		}
+		FILE *fp = fopen((dirname + "/text").c_str(), "w");
+		TS_ASSERT(fp != NULL);
+		::fwrite(data.data(), 1, data.size(), fp);
+		::fclose(fp);
+
+		std::string msgText;
+		cacheSize_t size = -1;
+		TS_ASSERT(CopyFile(dirname + "/text", dirname + "/copy", size, msgText));
+		TS_ASSERT_EQUALS(size, (cacheSize_t) data.size());
+		TS_ASSERT(CompareFiles(dirname + "/text", dirname + "/copy"));
+
+		// A failed copy leaves nothing behind
+		TS_ASSERT(!CopyFile(dirname + "/missing", dirname + "/bad", size,
+		                    msgText));
+		TS_ASSERT(!msgText.empty());
+		TS_ASSERT(::access((dirname + "/bad").c_str(), F_OK) != 0);
+		TS_ASSERT(GetFilesystemFreeSpace(dirname) > 0);
+		TS_ASSERT_EQUALS(GetFilesystemFreeSpace(dirname + "/missing"),
+		                 (cacheSize_t) -1);
+		TS_ASSERT(CleanupDir(dirname, msgText));
+	}
+
+	void testPrefetchFile()
+	{
+		char tempbase[20] = "/tmp/test/fooXXXXXX";
+		std::string dirname(::mkdtemp(tempbase));
+		const std::string pathname(dirname + "/prefetched");
+		FILE *fp = fopen(pathname.c_str(), "w");
+		TS_ASSERT(fp != NULL);
+		::fputs("prefetched", fp);
+		::fclose(fp);
+
+		std::string msgText;
+		TS_ASSERT(PrefetchFile(pathname, msgText));
+		TS_ASSERT(msgText.empty());
+		TS_ASSERT(!PrefetchFile(dirname + "/missing", msgText));
+		TS_ASSERT(!msgText.empty());
+		TS_ASSERT(CleanupDir(dirname, msgText));
+	}
+
+	void testComputeCacheSpace()
+	{
+		const cacheSize_t mb = 1024 * 1024;
+
+		// The cache grows into the free space less what's reserved,
+		// within its bounds
+		TS_ASSERT_EQUALS(ComputeCacheSpace(10 * mb, 100 * mb, 0, 20 * mb, 50 * mb,
+		                                   10 * mb, -1), 60 * mb);
+		TS_ASSERT_EQUALS(ComputeCacheSpace(10 * mb, 100 * mb, 0, 20 * mb, 500 * mb,
+		                                   10 * mb, -1), 100 * mb);
+		TS_ASSERT_EQUALS(ComputeCacheSpace(10 * mb, 100 * mb, 0, 2 * mb, 5 * mb,
+		                                   10 * mb, -1), 10 * mb);
+		TS_ASSERT_EQUALS(ComputeCacheSpace(10 * mb, 100 * mb, 0, 20 * mb, -1,
+		                                   10 * mb, -1), 100 * mb);
+
+		// Pressure cuts it towards the lower bound
+		TS_ASSERT_EQUALS(ComputeCacheSpace(10 * mb, 100 * mb, 0, 20 * mb, -1,
+		                                   10 * mb, s_pressureLow), 100 * mb);
+		TS_ASSERT_EQUALS(ComputeCacheSpace(10 * mb, 100 * mb, 0, 20 * mb, -1,
+		                                   10 * mb, (s_pressureLow + s_pressureHigh) / 2), 55 * mb);
+		TS_ASSERT_EQUALS(ComputeCacheSpace(10 * mb, 100 * mb, 0, 20 * mb, -1,
+		                                   10 * mb, 100.0), 10 * mb);
+
+		// and neither goes below the space the types are guaranteed
+		TS_ASSERT_EQUALS(ComputeCacheSpace(10 * mb, 100 * mb, 30 * mb, 2 * mb,
+		                                   5 * mb, 10 * mb, -1), 30 * mb);
+		TS_ASSERT_EQUALS(ComputeCacheSpace(10 * mb, 100 * mb, 30 * mb, 20 * mb,
+		                                   -1, 10 * mb, (s_pressureLow + s_pressureHigh) / 2), 65 * mb);
+		TS_ASSERT_EQUALS(ComputeCacheSpace(10 * mb, 20 * mb, 30 * mb, 20 * mb,
+		                                   -1, 10 * mb, 100.0), 30 * mb);
+
+		char tempbase[20] = "/tmp/test/fooXXXXXX";
+		std::string dirname(::mkdtemp(tempbase));
+		FILE *fp = fopen((dirname + "/pressure").c_str(), "w");
+		TS_ASSERT(fp != NULL);
+		::fputs("some avg10=12.50 avg60=3.00 avg300=1.00 total=1234\n"
+		        "full avg10=2.00 avg60=1.00 avg300=0.50 total=567\n", fp);
+		::fclose(fp);
+		TS_ASSERT_EQUALS(GetPressure(dirname + "/pressure"), 12.5);
+		TS_ASSERT_EQUALS(GetPressure(dirname + "/missing"), -1.0);
+		std::string msgText;
+		TS_ASSERT(CleanupDir(dirname, msgText));
+	}
+
+	void testCompressFile()
+	{
+		char tempbase[20] = "/tmp/test/fooXXXXXX";
+		std::string dirname(::mkdtemp(tempbase));
+		std::string data;
+		while (data.size() < 200000)
+		{
+			data += "a line of text that repeats " + std::to_string(data.size() % 7) +
+			        "\n";
+		}
+		const std::string names[2] = { "/empty", "/text" };
+		const std::string contents[2] = { std::string(), data };
+		for (int i = 0; i < 2; i++)
+		{
+			FILE *fp = fopen((dirname + names[i]).c_str(), "w");
+			TS_ASSERT(fp != NULL);
+			::fwrite(contents[i].data(), 1, contents[i].size(), fp);
+			::fclose(fp);
+
+			std::string msgText;
+			cacheSize_t storedSize = -1;
+			cacheSize_t size = -1;
+			const std::string compressedPath(dirname + names[i] + ".z");
+			const std::string viewPath(dirname + names[i] + ".view");
+			TS_ASSERT(CompressFile(dirname + names[i], compressedPath, storedSize,
+			                       msgText));
+			TS_ASSERT(storedSize > 0);
+			TS_ASSERT(DecompressFile(compressedPath, viewPath, size, msgText));
+			TS_ASSERT_EQUALS(size, (cacheSize_t) contents[i].size());
+			TS_ASSERT(CompareFiles(dirname + names[i], viewPath));
+		}
+		struct stat buf;
+		TS_ASSERT_EQUALS(::stat((dirname + "/text.z").c_str(), &buf), 0);
+		TS_ASSERT(buf.st_size < (off_t) data.size() / 10);
+
+		// Damaged and truncated data is rejected and leaves nothing
+		// behind
+		std::string msgText;
+		cacheSize_t size;
+		TS_ASSERT(!DecompressFile(dirname + "/text", dirname + "/bad", size,
+		                          msgText));
+		TS_ASSERT(!msgText.empty());
+		TS_ASSERT(::access((dirname + "/bad").c_str(), F_OK) != 0);
+		TS_ASSERT_EQUALS(::truncate((dirname + "/text.z").c_str(),
+		                            buf.st_size / 2), 0);
+		TS_ASSERT(!DecompressFile(dirname + "/text.z", dirname + "/bad", size,
+		                          msgText));
+		TS_ASSERT(::access((dirname + "/bad").c_str(), F_OK) != 0);
+		TS_ASSERT(!CompressFile(dirname + "/missing", dirname + "/bad", size,
+		                        msgText));
+
+		// The compressed file is made in the trash and the view of an
+		// object is under the views in the trash
+		::mkdir((dirname + "/A").c_str(), 0700);
+		std::string trashPath;
+		TS_ASSERT(MakeTrashPath(dirname + "/A/BCDEFGHI.ext", ".z", trashPath));
+		TS_ASSERT_EQUALS(trashPath, dirname + "/.trash/ABCDEFGHI.ext.z");
+		std::string viewPath;
+		TS_ASSERT(GetViewPath(dirname + "/A/BCDEFGHI.ext", viewPath));
+		TS_ASSERT_EQUALS(viewPath, dirname + "/.trash/.views/A/BCDEFGHI.ext");
+		TS_ASSERT(::access((dirname + "/.trash/.views").c_str(), F_OK) != 0);
+		TS_ASSERT(GetViewPath(dirname + "/A/BCDEFGHI.ext", viewPath, true));
+		TS_ASSERT_EQUALS(::access((dirname + "/.trash/.views/A").c_str(), F_OK), 0);
+		TS_ASSERT(!GetViewPath("BCDEFGHI.ext", viewPath));
+		TS_ASSERT(CleanupDir(dirname, msgText));
+	}
 };
 
 #endif
@@ -0,0 +1,206 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __CACHEINDEXTEST_H__
+#define __CACHEINDEXTEST_H__
+
+#include <cxxtest/TestSuite.h>
+#include "CacheIndex.h"
+#include "TestObjects.h"
+
+class CacheIndexTest : public CxxTest::TestSuite
+{
+
+	std::string dirName;
+	indexedTypes_t types;
+	indexedObjects_t objects;
+
+public:
+
+	void setUp()
+	{
+		::mkdir(s_baseTestDirName.c_str(), s_dirPerms);
+		dirName = s_baseTestDirName + "/indextest";
+		::mkdir(dirName.c_str(), s_dirPerms);
+
+		types.clear();
+		objects.clear();
+		CIndexedType &type = types["indextype"];
+		type.m_typeName = "indextype";
+		type.m_params = CCacheParamValues(10 * s_blockSize, 20 * s_blockSize, 100,
+		                                  2, 3);
+		type.m_params.SetCompress(1);
+		type.m_params.SetMemory(1);
+		type.m_dirType = false;
+		for (cachedObjectId_t id = 1; id <= 3; id++)
+		{
+			CIndexedObject &object = objects[id];
+			object.m_id = id;
+			object.m_typeName = "indextype";
+			object.m_filename = "file.ext";
+			object.m_size = (cacheSize_t)(1000 * id);
+			object.m_cost = 10;
+			object.m_lifetime = 20;
+			object.m_written = true;
+		}
+		objects[3].m_compressed = true;
+		objects[3].m_storedSize = 700;
+		objects[1].m_inMemory = true;
+	}
+
+	void tearDown()
+	{
+		::unlink((dirName + "/" + s_indexFilename).c_str());
+		::unlink((dirName + "/" + s_journalFilename).c_str());
+		::rmdir(dirName.c_str());
+	}
+
+	void testChecksum()
+	{
+		// The standard CRC-32 check value
+		TS_ASSERT_EQUALS(ComputeChecksum("123456789", 9), 0xCBF43926);
+	}
+
+	void testLoadMissingIndex()
+	{
+		CCacheIndex index(dirName);
+		indexedTypes_t loadedTypes;
+		indexedObjects_t loadedObjects;
+		TS_ASSERT(!index.Load(loadedTypes, loadedObjects));
+	}
+
+	void testSnapshot()
+	{
+		CCacheIndex index(dirName);
+		TS_ASSERT(index.WriteSnapshot(types, objects, true));
+		TS_ASSERT(!index.isOpen());
+
+		CCacheIndex loaded(dirName);
+		indexedTypes_t loadedTypes;
+		indexedObjects_t loadedObjects;
+		TS_ASSERT(loaded.Load(loadedTypes, loadedObjects));
+		TS_ASSERT_EQUALS(loaded.GetNumJournalRecords(), (uint32_t) 0);
+		TS_ASSERT_EQUALS(loadedTypes.size(), (size_t) 1);
+		const CIndexedType &type = loadedTypes["indextype"];
+		TS_ASSERT(type.m_params == types["indextype"].m_params);
+		TS_ASSERT(!type.m_dirType);
+		TS_ASSERT_EQUALS(type.m_params.GetCompress(), 1);
+		TS_ASSERT_EQUALS(type.m_params.GetMemory(), 1);
+		TS_ASSERT_EQUALS(loadedObjects.size(), (size_t) 3);
+		TS_ASSERT_EQUALS(loadedObjects[2].m_size, 2000);
+		TS_ASSERT_EQUALS(loadedObjects[2].m_cost, 10);
+		TS_ASSERT_EQUALS(loadedObjects[2].m_lifetime, 20);
+		TS_ASSERT_EQUALS(loadedObjects[2].m_filename, std::string("file.ext"));
+		TS_ASSERT(loadedObjects[2].m_written);
+		TS_ASSERT(!loadedObjects[2].m_compressed);
+		TS_ASSERT(loadedObjects[3].m_compressed);
+		TS_ASSERT_EQUALS(loadedObjects[3].m_storedSize, 700);
+		TS_ASSERT(loadedObjects[1].m_inMemory);
+		TS_ASSERT(!loadedObjects[2].m_inMemory);
+	}
+
+	void testJournal()
+	{
+		CCacheIndex index(dirName);
+		TS_ASSERT(index.WriteSnapshot(types, objects));
+		TS_ASSERT(index.isOpen());
+
+		CIndexedObject object = objects[3];
+		object.m_id = 4;
+		object.m_written = false;
+		TS_ASSERT(index.JournalObject(object));
+		TS_ASSERT(index.JournalRemoveObject(1));
+		CIndexedType type;
+		type.m_typeName = "othertype";
+		type.m_dirType = true;
+		TS_ASSERT(index.JournalType(type));
+		TS_ASSERT(index.JournalDeleteType("othertype"));
+		TS_ASSERT_EQUALS(index.GetNumJournalRecords(), (uint32_t) 4);
+
+		// The journal was written during this boot so it is replayed
+		// even though the snapshot isn't clean.
+		CCacheIndex loaded(dirName);
+		indexedTypes_t loadedTypes;
+		indexedObjects_t loadedObjects;
+		TS_ASSERT(loaded.Load(loadedTypes, loadedObjects));
+		TS_ASSERT_EQUALS(loaded.GetNumJournalRecords(), (uint32_t) 4);
+		TS_ASSERT_EQUALS(loadedTypes.size(), (size_t) 1);
+		TS_ASSERT_EQUALS(loadedObjects.size(), (size_t) 3);
+		TS_ASSERT(loadedObjects.find(1) == loadedObjects.end());
+		TS_ASSERT(!loadedObjects[4].m_written);
+	}
+
+	void testStaleJournal()
+	{
+		CCacheIndex index(dirName);
+		TS_ASSERT(index.WriteSnapshot(types, objects));
+		TS_ASSERT(index.JournalRemoveObject(1));
+		std::string journal(dirName + "/" + s_journalFilename);
+		std::string saved(journal + ".saved");
+		TS_ASSERT_EQUALS(::rename(journal.c_str(), saved.c_str()), 0);
+
+		// A journal left over from the previous snapshot is ignored
+		TS_ASSERT(index.WriteSnapshot(types, objects, true));
+		TS_ASSERT_EQUALS(::rename(saved.c_str(), journal.c_str()), 0);
+		CCacheIndex loaded(dirName);
+		indexedTypes_t loadedTypes;
+		indexedObjects_t loadedObjects;
+		TS_ASSERT(loaded.Load(loadedTypes, loadedObjects));
+		TS_ASSERT_EQUALS(loadedObjects.size(), (size_t) 3);
+	}
+
+	void testCorruption()
+	{
+		CCacheIndex index(dirName);
+		TS_ASSERT(index.WriteSnapshot(types, objects));
+		TS_ASSERT(index.JournalRemoveObject(1));
+
+		// A torn journal record fails validation
+		std::string journal(dirName + "/" + s_journalFilename);
+		struct stat buf;
+		TS_ASSERT_EQUALS(::stat(journal.c_str(), &buf), 0);
+		TS_ASSERT_EQUALS(::truncate(journal.c_str(), buf.st_size - 1), 0);
+		CCacheIndex loaded(dirName);
+		indexedTypes_t loadedTypes;
+		indexedObjects_t loadedObjects;
+		TS_ASSERT(!loaded.Load(loadedTypes, loadedObjects));
+
+		// So does a damaged snapshot
+		TS_ASSERT(index.WriteSnapshot(types, objects, true));
+		std::string snapshot(dirName + "/" + s_indexFilename);
+		FILE *fp = ::fopen(snapshot.c_str(), "r+");
+		TS_ASSERT(fp != NULL);
+		::fseek(fp, 20, SEEK_SET);
+		::fputc('X', fp);
+		::fclose(fp);
+		TS_ASSERT(!loaded.Load(loadedTypes, loadedObjects));
+	}
+
+	void testInvalidate()
+	{
+		CCacheIndex index(dirName);
+		TS_ASSERT(index.WriteSnapshot(types, objects));
+		index.Invalidate();
+		TS_ASSERT(!index.isOpen());
+		TS_ASSERT(!index.JournalRemoveObject(1));
+		TS_ASSERT_EQUALS(::access((dirName + "/" + s_indexFilename).c_str(),
+		                          F_OK), -1);
+		TS_ASSERT_EQUALS(::access((dirName + "/" + s_journalFilename).c_str(),
+		                          F_OK), -1);
+	}
+};
+
+#endif
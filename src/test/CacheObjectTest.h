@@ -18,6 +18,7 @@
 #define __CACHEOBJECTTEST_H__
 
 #include <cxxtest/TestSuite.h>
+#include <limits>
 #include <cxxtest/GlobalFixture.h>
 #include "CacheObject.h"
 #include "FileCache.h"
@@ -96,6 +97,21 @@ class CacheObjectTest : public CxxTest::TestSuite
 	CFileCacheSet *fileCacheSet;
 	std::string msgText;
 
+	// Read back the packed attribute record of an object
+	CObjectRecord GetObjectRecord(const std::string &pathname)
+	{
+		CObjectRecord record;
+		char value[s_maxObjectRecordSize];
+		ssize_t size = FC_getxattr(pathname.c_str(), s_objectAttrName, value,
+		                           sizeof(value));
+		TS_ASSERT(size > 0);
+		if (size > 0)
+		{
+			TS_ASSERT(UnpackObjectRecord(value, (size_t) size, record));
+		}
+		return record;
+	}
+
 public:
 
 	CacheObjectTest()
@@ -248,28 +264,29 @@ public:
 		fileName[0] = '\0';
 
 		// Now validate all the set extened attr
-		FC_getxattr(pathname.c_str(), "user.f", fileName, maxLength);
+		::strncpy(fileName, GetObjectRecord(pathname).m_filename.c_str(),
+		          maxLength - 1);
 		TS_ASSERT_EQUALS(strlen(fileName), filenameLength);
 		TS_ASSERT_SAME_DATA(fileName, filename, (unsigned int) filenameLength);
 
 		cacheSize_t sz = 0;
-		FC_getxattr(pathname.c_str(), "user.s", &sz, sizeof(sz));
+		sz = GetObjectRecord(pathname).m_size;
 		TS_ASSERT_EQUALS(sz, 123);
 
 		paramValue_t val = 9;
-		FC_getxattr(pathname.c_str(), "user.c", &val, sizeof(val));
+		val = GetObjectRecord(pathname).m_cost;
 		TS_ASSERT_EQUALS(val, 0);
 
 		val = 9;
-		FC_getxattr(pathname.c_str(), "user.l", &val, sizeof(val));
+		val = GetObjectRecord(pathname).m_lifetime;
 		TS_ASSERT_EQUALS(val, 1);
 
 		int wrt = 9;
-		FC_getxattr(pathname.c_str(), "user.w", &wrt, sizeof(wrt));
+		wrt = GetObjectRecord(pathname).m_written ? 1 : 0;
 		TS_ASSERT_EQUALS(wrt, 0);
 
 		val = 9;
-		FC_getxattr(pathname.c_str(), "user.d", &val, sizeof(val));
+		val = GetObjectRecord(pathname).m_dirType ? 1 : 0;
 		TS_ASSERT_EQUALS(val, 0);
 	}
 
@@ -291,28 +308,29 @@ public:
 		fileName[0] = '\0';
 
 		// Now validate all the set extened attr
-		FC_getxattr(pathname.c_str(), "user.f", fileName, maxLength);
+		::strncpy(fileName, GetObjectRecord(pathname).m_filename.c_str(),
+		          maxLength - 1);
 		TS_ASSERT_EQUALS(strlen(fileName), filenameLength);
 		TS_ASSERT_SAME_DATA(fileName, filename, (unsigned int) filenameLength);
 
 		cacheSize_t sz = 0;
-		FC_getxattr(pathname.c_str(), "user.s", &sz, sizeof(sz));
+		sz = GetObjectRecord(pathname).m_size;
 		TS_ASSERT_EQUALS(sz, 123);
 
 		paramValue_t val = 9;
-		FC_getxattr(pathname.c_str(), "user.c", &val, sizeof(val));
+		val = GetObjectRecord(pathname).m_cost;
 		TS_ASSERT_EQUALS(val, 0);
 
 		val = 9;
-		FC_getxattr(pathname.c_str(), "user.l", &val, sizeof(val));
+		val = GetObjectRecord(pathname).m_lifetime;
 		TS_ASSERT_EQUALS(val, 1);
 
 		int wrt = 9;
-		FC_getxattr(pathname.c_str(), "user.w", &wrt, sizeof(wrt));
+		wrt = GetObjectRecord(pathname).m_written ? 1 : 0;
 		TS_ASSERT_EQUALS(wrt, 0);
 
 		val = 9;
-		FC_getxattr(pathname.c_str(), "user.d", &val, sizeof(val));
+		val = GetObjectRecord(pathname).m_dirType ? 1 : 0;
 		TS_ASSERT_EQUALS(val, 1);
 	}
 
@@ -335,7 +353,7 @@ public:
 
 		// validate the size attr
 		cacheSize_t sz = 0;
-		FC_getxattr(pathname.c_str(), "user.s", &sz, sizeof(sz));
+		sz = GetObjectRecord(pathname).m_size;
 		TS_ASSERT_EQUALS(sz, 54321);
 
 		// Before the subscribe, we shouldn't have write permissions
@@ -365,7 +383,7 @@ public:
 		// Write to the file so it stays around
 		FILE *fp = ::fopen(pathname.c_str(), "w");
 		TS_ASSERT(fp != NULL);
-		::fwrite(&sz, sizeof(sz), 1, fp);
+		::fwrite(&sz, sizeof(int32_t), 1, fp);
 		::fclose(fp);
 
 		// Now unsubscribe and make sure the post write cleanup happens
@@ -383,13 +401,13 @@ public:
 		struct stat buf;
 		::stat(pathname.c_str(), &buf);
 		TS_ASSERT_EQUALS(buf.st_size, 4);
-		FC_getxattr(pathname.c_str(), "user.s", &sz, sizeof(sz));
+		sz = GetObjectRecord(pathname).m_size;
 		TS_ASSERT_EQUALS(sz, 4);
 
 		// Additionally the written attribute should now be set to 1 on
 		// the file.
 		int wrt = 9;
-		FC_getxattr(pathname.c_str(), "user.w", &wrt, sizeof(wrt));
+		wrt = GetObjectRecord(pathname).m_written ? 1 : 0;
 		TS_ASSERT_EQUALS(wrt, 1);
 
 		// The file should no longer be writable.
@@ -439,14 +457,14 @@ public:
 
 		// Validate the size attribute
 		cacheSize_t sz = 0;
-		FC_getxattr(pathname.c_str(), "user.s", &sz, sizeof(sz));
+		sz = GetObjectRecord(pathname).m_size;
 		TS_ASSERT_EQUALS(sz, 1);
 
 		// Make sure resize fails (returns the original size) as there is
 		// no subscription
 		TS_ASSERT_EQUALS(co->Resize(10), 1);
 		sz = 0;
-		FC_getxattr(pathname.c_str(), "user.s", &sz, sizeof(sz));
+		sz = GetObjectRecord(pathname).m_size;
 		TS_ASSERT_EQUALS(sz, 1);
 
 		// Now subscribe so the file is writable and can be resized
@@ -458,13 +476,13 @@ public:
 
 		// and the size attribute should be updated to reflect that.
 		sz = 0;
-		FC_getxattr(pathname.c_str(), "user.s", &sz, sizeof(sz));
+		sz = GetObjectRecord(pathname).m_size;
 		TS_ASSERT_EQUALS(sz, 10);
 
 		// Write to the file so it stays around
 		FILE *fp = ::fopen(pathname.c_str(), "w");
 		TS_ASSERT(fp != NULL);
-		::fwrite(&sz, sizeof(sz), 1, fp);
+		::fwrite(&sz, sizeof(int32_t), 1, fp);
 		::fclose(fp);
 
 		// When we unsubscribe, the size will be reset to match the actual
@@ -475,7 +493,7 @@ public:
 		TS_ASSERT_EQUALS(co->GetSubscriptionCount(), 0);
 		TS_ASSERT_EQUALS(co->GetSize(), 4);
 		sz = 0;
-		FC_getxattr(pathname.c_str(), "user.s", &sz, sizeof(sz));
+		sz = GetObjectRecord(pathname).m_size;
 		TS_ASSERT_EQUALS(sz, 4);
 
 		// At this point a resize should fail again since there is no
@@ -530,6 +548,15 @@ public:
 		TS_ASSERT_EQUALS(co->GetCacheCost(), 2);
 		TS_ASSERT_EQUALS(co->Expire(), true);
 		delete co;
+
+		// A cost of 255 for a 4 TB object overflows a 32 bit cost so it
+		// is capped instead of wrapping
+		co = new CCacheObject(fileCache, 786951, filename, 4LL << 40, 255, 1);
+		TS_ASSERT_EQUALS(co->Initialize(true), true);
+		TS_ASSERT_EQUALS(co->GetCacheCost(::time(0) + 1),
+		                 std::numeric_limits<paramValue_t>::max());
+		TS_ASSERT_EQUALS(co->Expire(), true);
+		delete co;
 	}
 
 	void testUnsubscribeDirType()
@@ -0,0 +1,92 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __DEDUPTABLETEST_H__
+#define __DEDUPTABLETEST_H__
+
+#include <cxxtest/TestSuite.h>
+#include "DedupTable.h"
+
+class DedupTableTest : public CxxTest::TestSuite
+{
+
+public:
+
+	void testAddAndLink()
+	{
+		CDedupTable table;
+		TS_ASSERT(table.Add(0x1234, 1));
+		TS_ASSERT(!table.Add(0x1234, 1));
+		TS_ASSERT(!table.Add(0x1234, 0));
+		TS_ASSERT(table.Link(1, 2));
+		TS_ASSERT(table.Link(1, 3));
+		// Only an owner can be linked to and an object is only in once
+		TS_ASSERT(!table.Link(2, 4));
+		TS_ASSERT(!table.Link(1, 3));
+		TS_ASSERT_EQUALS(table.GetNumObjects(), (size_t) 3);
+		TS_ASSERT_EQUALS(table.GetOwner(3), (cachedObjectId_t) 1);
+		TS_ASSERT_EQUALS(table.GetOwner(4), (cachedObjectId_t) 0);
+		TS_ASSERT_EQUALS(table.GetRefCount(1), (size_t) 3);
+		TS_ASSERT_EQUALS(table.GetRefCount(2), (size_t) 3);
+		TS_ASSERT_EQUALS(table.GetRefCount(4), (size_t) 0);
+
+		// Different content with the same hash is kept apart
+		TS_ASSERT(table.Add(0x1234, 5));
+		std::vector<cachedObjectId_t> owners;
+		table.Find(0x1234, owners);
+		TS_ASSERT_EQUALS(owners.size(), (size_t) 2);
+		TS_ASSERT_EQUALS(owners[0], (cachedObjectId_t) 1);
+		TS_ASSERT_EQUALS(owners[1], (cachedObjectId_t) 5);
+		owners.clear();
+		table.Find(0x5678, owners);
+		TS_ASSERT(owners.empty());
+
+		table.Clear();
+		TS_ASSERT_EQUALS(table.GetNumObjects(), (size_t) 0);
+	}
+
+	void testRemove()
+	{
+		CDedupTable table;
+		TS_ASSERT(table.Add(0x1234, 1));
+		TS_ASSERT(table.Link(1, 2));
+		TS_ASSERT(table.Link(1, 3));
+		TS_ASSERT(table.Link(1, 4));
+
+		// Removing a link leaves the owner alone
+		TS_ASSERT_EQUALS(table.Remove(3), (cachedObjectId_t) 0);
+		TS_ASSERT_EQUALS(table.GetRefCount(1), (size_t) 3);
+
+		// Removing the owner hands the group to the oldest link
+		TS_ASSERT_EQUALS(table.Remove(1), (cachedObjectId_t) 2);
+		TS_ASSERT_EQUALS(table.GetOwner(4), (cachedObjectId_t) 2);
+		TS_ASSERT_EQUALS(table.GetRefCount(4), (size_t) 2);
+		std::vector<cachedObjectId_t> owners;
+		table.Find(0x1234, owners);
+		TS_ASSERT_EQUALS(owners.size(), (size_t) 1);
+		TS_ASSERT_EQUALS(owners[0], (cachedObjectId_t) 2);
+
+		TS_ASSERT_EQUALS(table.Remove(2), (cachedObjectId_t) 4);
+		TS_ASSERT_EQUALS(table.Remove(4), (cachedObjectId_t) 0);
+		TS_ASSERT_EQUALS(table.Remove(4), (cachedObjectId_t) 0);
+		owners.clear();
+		table.Find(0x1234, owners);
+		TS_ASSERT(owners.empty());
+		TS_ASSERT_EQUALS(table.GetNumObjects(), (size_t) 0);
+	}
+};
+
+#endif
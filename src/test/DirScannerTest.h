@@ -0,0 +1,172 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __DIRSCANNERTEST_H__
+#define __DIRSCANNERTEST_H__
+
+#include <cxxtest/TestSuite.h>
+#include "DirScanner.h"
+#include "TestObjects.h"
+
+class DirScannerTest : public CxxTest::TestSuite
+{
+
+	std::string dirName;
+	std::vector<std::string> subDirs;
+
+public:
+
+	void setUp()
+	{
+		::mkdir(s_baseTestDirName.c_str(), s_dirPerms);
+		dirName = s_baseTestDirName + "/scantest";
+		::mkdir(dirName.c_str(), s_dirPerms);
+
+		subDirs.clear();
+		for (int i = 0; i < 8; i++)
+		{
+			std::string subDir(dirName + "/" + (char)('A' + i));
+			::mkdir(subDir.c_str(), s_dirPerms);
+			subDirs.push_back(subDir);
+			for (int j = 0; j < 3; j++)
+			{
+				std::string pathname(subDir + "/" + (char)('a' + j) + ".ext");
+				FILE *fp = ::fopen(pathname.c_str(), "w");
+				::fwrite("data", 1, (size_t)(j + 1), fp);
+				::fclose(fp);
+				int written = j;
+				::setxattr(pathname.c_str(), "user.w", &written, sizeof(written), 0);
+				::setxattr(pathname.c_str(), "user.f", "file.ext", 8, 0);
+			}
+		}
+		::mkdir((subDirs[0] + "/dir.ext").c_str(), s_dirPerms);
+	}
+
+	void tearDown()
+	{
+		for (size_t i = 0; i < subDirs.size(); i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				::unlink((subDirs[i] + "/" + (char)('a' + j) + ".ext").c_str());
+			}
+			::rmdir((subDirs[i] + "/dir.ext").c_str());
+			::rmdir(subDirs[i].c_str());
+		}
+		::rmdir(dirName.c_str());
+	}
+
+	void testScanDir()
+	{
+		scannedEntries_t entries;
+		TS_ASSERT(CDirScanner::ScanDir(subDirs[0], entries));
+		TS_ASSERT_EQUALS(entries.size(), (size_t) 4);
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			const CScannedEntry &entry = entries[i];
+			TS_ASSERT_EQUALS(entry.m_statErrno, 0);
+			if (entry.m_pathname == subDirs[0] + "/dir.ext")
+			{
+				TS_ASSERT(S_ISDIR(entry.m_stat.st_mode));
+				continue;
+			}
+
+			TS_ASSERT(S_ISREG(entry.m_stat.st_mode));
+			int written = -1;
+			TS_ASSERT_EQUALS(entry.GetAttribute("user.w", &written, sizeof(written)),
+			                 (ssize_t) sizeof(written));
+			TS_ASSERT_EQUALS((off_t) written + 1, entry.m_stat.st_size);
+			char fileName[s_maxFilenameLength];
+			TS_ASSERT_EQUALS(entry.GetAttribute("user.f", fileName,
+			                                    sizeof(fileName)), 8);
+			TS_ASSERT_SAME_DATA(fileName, "file.ext", 8);
+
+			// Errors are returned the way getxattr returns them
+			TS_ASSERT_EQUALS(entry.GetAttribute("user.f", fileName, 4), -1);
+			TS_ASSERT_EQUALS(errno, ERANGE);
+			TS_ASSERT_EQUALS(entry.GetAttribute("user.s", fileName,
+			                                    sizeof(fileName)), -1);
+			TS_ASSERT_EQUALS(errno, ENODATA);
+		}
+
+		TS_ASSERT(!CDirScanner::ScanDir(dirName + "/missing", entries));
+	}
+
+	void testPackedAttributes()
+	{
+		std::string pathname(subDirs[1] + "/a.ext");
+		CObjectRecord record;
+		record.m_filename = "packed.ext";
+		record.m_size = 1;
+		record.m_written = true;
+		const std::string value(PackObjectRecord(record));
+		TS_ASSERT_EQUALS(::setxattr(pathname.c_str(), s_objectAttrName,
+		                            value.data(), value.length(), 0), 0);
+
+		// The packed record takes the place of the separate attributes
+		CScannedEntry entry;
+		entry.m_pathname = pathname;
+		entry.ReadAttributes();
+		TS_ASSERT(entry.m_packed);
+		int written = 0;
+		TS_ASSERT_EQUALS(entry.GetAttribute("user.w", &written, sizeof(written)),
+		                 (ssize_t) sizeof(written));
+		TS_ASSERT_EQUALS(written, 1);
+		char fileName[s_maxFilenameLength];
+		TS_ASSERT_EQUALS(entry.GetAttribute("user.f", fileName,
+		                                    sizeof(fileName)), 11);
+		TS_ASSERT_SAME_DATA(fileName, "packed.ext", 11);
+		cacheSize_t size = 0;
+		TS_ASSERT_EQUALS(entry.GetAttribute("user.s", &size, sizeof(size)),
+		                 (ssize_t) sizeof(size));
+		TS_ASSERT_EQUALS(size, 1);
+
+		// A damaged record is treated as missing attributes
+		TS_ASSERT_EQUALS(::setxattr(pathname.c_str(), s_objectAttrName,
+		                            value.data(), 4, 0), 0);
+		CScannedEntry damaged;
+		damaged.m_pathname = pathname;
+		damaged.ReadAttributes();
+		TS_ASSERT(!damaged.m_packed);
+		TS_ASSERT_EQUALS(damaged.GetAttribute("user.w", &written,
+		                                      sizeof(written)), -1);
+		::removexattr(pathname.c_str(), s_objectAttrName);
+	}
+
+	void testGetEntries()
+	{
+		std::set<std::string> dirNames(subDirs.begin(), subDirs.end());
+		CDirScanner scanner(3);
+		scanner.Start(dirNames);
+
+		// Directories are taken out of order as well as in order
+		scannedEntries_t entries;
+		TS_ASSERT(scanner.GetEntries(subDirs[7], entries));
+		TS_ASSERT_EQUALS(entries.size(), (size_t) 3);
+		for (size_t i = 0; i < subDirs.size() - 1; i++)
+		{
+			entries.clear();
+			TS_ASSERT(scanner.GetEntries(subDirs[i], entries));
+			TS_ASSERT_EQUALS(entries.size(), (size_t)(i == 0 ? 4 : 3));
+		}
+
+		// Each directory is only handed out once
+		TS_ASSERT(!scanner.GetEntries(subDirs[0], entries));
+		TS_ASSERT(!scanner.GetEntries(dirName, entries));
+	}
+};
+
+#endif
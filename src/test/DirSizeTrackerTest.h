@@ -0,0 +1,130 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __DIRSIZETRACKERTEST_H__
+#define __DIRSIZETRACKERTEST_H__
+
+#include <cxxtest/TestSuite.h>
+#include "DirSizeTracker.h"
+#include "TestObjects.h"
+
+class DirSizeTrackerTest : public CxxTest::TestSuite
+{
+
+	std::string dirName;
+
+	void WriteFile(const std::string &pathname, size_t size)
+	{
+		std::string data(size, 'x');
+		FILE *fp = ::fopen(pathname.c_str(), "w");
+		::fwrite(data.data(), 1, data.size(), fp);
+		::fclose(fp);
+	}
+
+public:
+
+	void setUp()
+	{
+		::mkdir(s_baseTestDirName.c_str(), s_dirPerms);
+		dirName = s_baseTestDirName + "/sizetest";
+		::mkdir(dirName.c_str(), s_dirPerms);
+	}
+
+	void tearDown()
+	{
+		std::string msgText;
+		CleanupDir(dirName, msgText);
+	}
+
+	void testSumDir()
+	{
+		WriteFile(dirName + "/a.ext", 10);
+		WriteFile(dirName + "/b.ext", 5000);
+		TS_ASSERT_EQUALS(SumDir(dirName), GetFilesystemFileSize(0) +
+		                 GetFilesystemFileSize(10) + GetFilesystemFileSize(5000));
+		TS_ASSERT_EQUALS(SumDir(dirName + "/missing"), -1);
+	}
+
+	void testTrack()
+	{
+		CDirSizeTracker tracker;
+		std::set<cachedObjectId_t> changed;
+		TS_ASSERT(tracker.GetFd() >= 0);
+		WriteFile(dirName + "/a.ext", 10);
+		TS_ASSERT(tracker.Track(1, dirName));
+		TS_ASSERT_EQUALS(tracker.GetNumTracked(), (size_t) 1);
+		TS_ASSERT_EQUALS(tracker.GetSize(1), SumDir(dirName));
+		TS_ASSERT_EQUALS(tracker.GetSize(2), -1);
+
+		// Files and directories written after tracking starts are
+		// counted once their events are processed
+		WriteFile(dirName + "/b.ext", 5000);
+		std::string subDir(dirName + "/sub");
+		TS_ASSERT_EQUALS(::mkdir(subDir.c_str(), s_dirPerms), 0);
+		tracker.ProcessEvents(changed);
+		WriteFile(subDir + "/c.ext", 9000);
+		WriteFile(subDir + "/d.ext", 1);
+		tracker.ProcessEvents(changed);
+		TS_ASSERT_EQUALS(tracker.GetSize(1), SumDir(dirName));
+
+		// Files grow and are removed
+		WriteFile(dirName + "/a.ext", 20000);
+		::unlink((subDir + "/d.ext").c_str());
+		tracker.ProcessEvents(changed);
+		TS_ASSERT_EQUALS(tracker.GetSize(1), SumDir(dirName));
+
+		// Removing a directory removes everything counted below it
+		std::string msgText;
+		TS_ASSERT(CleanupDir(subDir, msgText));
+		tracker.ProcessEvents(changed);
+		TS_ASSERT_EQUALS(tracker.GetSize(1), SumDir(dirName));
+
+		tracker.Untrack(1);
+		TS_ASSERT_EQUALS(tracker.GetSize(1), -1);
+		TS_ASSERT_EQUALS(tracker.GetNumTracked(), (size_t) 0);
+		WriteFile(dirName + "/e.ext", 10);
+		tracker.ProcessEvents(changed);
+		TS_ASSERT_EQUALS(tracker.GetSize(1), -1);
+	}
+
+	void testTrackFile()
+	{
+		// A file object is tracked by itself and reported when written
+		CDirSizeTracker tracker;
+		std::set<cachedObjectId_t> changed;
+		const std::string pathname(dirName + "/a.ext");
+		WriteFile(pathname, 10);
+		TS_ASSERT(tracker.Track(7, pathname));
+		TS_ASSERT_EQUALS(tracker.GetSize(7), GetFilesystemFileSize(10));
+		tracker.ProcessEvents(changed);
+		TS_ASSERT(changed.empty());
+
+		WriteFile(pathname, 9000);
+		tracker.ProcessEvents(changed);
+		TS_ASSERT_EQUALS(changed.size(), (size_t) 1);
+		TS_ASSERT(changed.count(7) == 1);
+		TS_ASSERT_EQUALS(tracker.GetSize(7), GetFilesystemFileSize(9000));
+	}
+
+	void testTrackMissing()
+	{
+		CDirSizeTracker tracker;
+		TS_ASSERT(!tracker.Track(1, dirName + "/missing"));
+		TS_ASSERT_EQUALS(tracker.GetSize(1), -1);
+	}
+};
+
+#endif
@@ -18,6 +18,8 @@
 #define __FILECACHESETTEST_H__
 
 #include <cxxtest/TestSuite.h>
+#include <atomic>
+#include <poll.h>
 #include "FileCache.h"
 #include "FileCacheSet.h"
 #include "TestObjects.h"
@@ -103,7 +105,7 @@ public:
 		                 curObjId++);
 		// 4097 is the default size from above so it is expected to
 		// provide a size that's really 8192 (2 4096 blocks)
-		int size = GetFilesystemFileSize(4097);
+		cacheSize_t size = GetFilesystemFileSize(4097);
 		TS_ASSERT_EQUALS(fileCacheSet->InsertCacheObject(msgText, typeName,
 		                 fileName, 123),
 		                 curObjId++);
@@ -111,6 +113,30 @@ public:
 		TS_ASSERT_EQUALS(fileCacheSet->DeleteType(msgText, typeName), size);
 	}
 
+	void testInsertCacheObjects()
+	{
+		CCacheParamValues params(10000, 20000, 4097, 1, 1);
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		insertRequests_t requests(3);
+		requests[0].m_typeName = typeName;
+		requests[0].m_filename = fileName;
+		requests[1].m_typeName = typeName + "123";
+		requests[1].m_filename = fileName;
+		requests[2].m_typeName = typeName;
+		requests[2].m_filename = fileName;
+		requests[2].m_size = 123;
+		fileCacheSet->InsertCacheObjects(requests);
+
+		// Each request gets its own result, in order
+		TS_ASSERT_EQUALS(requests[0].m_objId, curObjId++);
+		TS_ASSERT_EQUALS(requests[0].m_size, 4097);
+		TS_ASSERT_EQUALS(requests[1].m_objId, (cachedObjectId_t) 0);
+		TS_ASSERT(!requests[1].m_msgText.empty());
+		TS_ASSERT_EQUALS(requests[2].m_objId, curObjId++);
+		TS_ASSERT_EQUALS(fileCacheSet->DeleteType(msgText, typeName),
+		                 GetFilesystemFileSize(4097) + GetFilesystemFileSize(123));
+	}
+
 	void testResizeFailureCase()
 	{
 		CCacheParamValues params(10000, 20000, 100, 1, 1);
@@ -162,6 +188,153 @@ public:
 		                 GetFilesystemFileSize(4096));
 	}
 
+	void testSyncQueue()
+	{
+		CCacheParamValues params(10000, 20000, 100, 1, 1);
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		int eventFd = fileCacheSet->StartSyncQueue();
+		TS_ASSERT(eventFd >= 0);
+		TS_ASSERT_EQUALS(fileCacheSet->InsertCacheObject(msgText, typeName,
+		                 fileName, 123),
+		                 curObjId);
+		const std::string pathname(fileCacheSet->SubscribeCacheObject(msgText,
+		                           curObjId));
+		TS_ASSERT_LESS_THAN((size_t) 7, pathname.length());
+		FILE *fp = ::fopen(pathname.c_str(), "w");
+		TS_ASSERT(fp != NULL);
+		::fwrite(&curObjId, sizeof(curObjId), 1, fp);
+		::fclose(fp);
+
+		// The object isn't written until its flush has been finished
+		fileCacheSet->UnSubscribeCacheObject(typeName, curObjId++);
+		struct stat statBuf;
+		TS_ASSERT_EQUALS(::stat(pathname.c_str(), &statBuf), 0);
+		TS_ASSERT(statBuf.st_mode & S_IWUSR);
+
+		struct pollfd pfd;
+		pfd.fd = eventFd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		TS_ASSERT_EQUALS(::poll(&pfd, 1, 5000), 1);
+		fileCacheSet->FinishSyncs();
+		TS_ASSERT_EQUALS(::stat(pathname.c_str(), &statBuf), 0);
+		TS_ASSERT(!(statBuf.st_mode & S_IWUSR));
+
+		fileCacheSet->StopSyncQueue();
+		TS_ASSERT(fileCacheSet->GetSyncQueue() == NULL);
+		TS_ASSERT_EQUALS(fileCacheSet->DeleteType(msgText, typeName),
+		                 GetFilesystemFileSize(4096));
+	}
+
+	void testIoPool()
+	{
+		CCacheParamValues params(10000, 20000, 100, 1, 1);
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		TS_ASSERT(fileCacheSet->StartIoPool() >= 0);
+		TS_ASSERT_EQUALS(fileCacheSet->InsertCacheObject(msgText, typeName,
+		                 fileName, 123),
+		                 curObjId);
+		const std::string pathname(fileCacheSet->SubscribeCacheObject(msgText,
+		                           curObjId));
+		TS_ASSERT_LESS_THAN((size_t) 7, pathname.length());
+		fileCacheSet->UnSubscribeCacheObject(typeName, curObjId++);
+
+		// The bookkeeping is done at once, the files are removed by the
+		// pool behind it
+		std::string typeDir(s_baseTestDirName + "/" + typeName);
+		TS_ASSERT_EQUALS(fileCacheSet->DeleteType(msgText, typeName),
+		                 GetFilesystemFileSize(4096));
+		TS_ASSERT_EQUALS(fileCacheSet->GetTypes().size(), (size_t) 0);
+		fileCacheSet->GetIoPool()->Wait(typeName);
+		TS_ASSERT_EQUALS(::access(pathname.c_str(), F_OK), -1);
+		TS_ASSERT_EQUALS(::access(typeDir.c_str(), F_OK), -1);
+
+		fileCacheSet->StopIoPool();
+		TS_ASSERT(fileCacheSet->GetIoPool() == NULL);
+	}
+
+	void testReadPool()
+	{
+		CCacheParamValues params(10000, 20000, 100, 1, 1);
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		int readFd = fileCacheSet->StartReadPool();
+		TS_ASSERT(readFd >= 0);
+
+		// A reader runs while nothing is changing the set
+		std::atomic<int> numTypes(-1);
+		CFileCacheSet *cacheSet = fileCacheSet;
+		fileCacheSet->GetReadPool()->Post(std::string(), [cacheSet, &numTypes]()
+		{
+			CReadLockGuard guard(cacheSet->GetLock());
+			numTypes = (int) cacheSet->GetTypes().size();
+		});
+		struct pollfd pfd;
+		pfd.fd = readFd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		TS_ASSERT_EQUALS(::poll(&pfd, 1, 5000), 1);
+		TS_ASSERT_EQUALS(numTypes.load(), 1);
+		fileCacheSet->RunReadCompletions();
+
+		// and waits until the outermost change is done
+		numTypes = -1;
+		fileCacheSet->LockForWrite();
+		fileCacheSet->LockForWrite();
+		fileCacheSet->GetReadPool()->Post(std::string(), [cacheSet, &numTypes]()
+		{
+			CReadLockGuard guard(cacheSet->GetLock());
+			numTypes = (int) cacheSet->GetTypes().size();
+		});
+		pfd.revents = 0;
+		TS_ASSERT_EQUALS(::poll(&pfd, 1, 50), 0);
+		fileCacheSet->UnlockForWrite();
+		TS_ASSERT_EQUALS(::poll(&pfd, 1, 50), 0);
+		TS_ASSERT_EQUALS(numTypes.load(), -1);
+		fileCacheSet->UnlockForWrite();
+		TS_ASSERT_EQUALS(::poll(&pfd, 1, 5000), 1);
+		TS_ASSERT_EQUALS(numTypes.load(), 1);
+		fileCacheSet->RunReadCompletions();
+		TS_ASSERT_EQUALS(fileCacheSet->GetReadPool()->GetNumPending(), (size_t) 0);
+
+		fileCacheSet->StopReadPool();
+		TS_ASSERT(fileCacheSet->GetReadPool() == NULL);
+		TS_ASSERT_EQUALS(fileCacheSet->DeleteType(msgText, typeName), 0);
+	}
+
+	void testMetrics()
+	{
+		CCacheParamValues params(10000, 20000, 100, 1, 1);
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		CCacheMetrics *metrics = fileCacheSet->GetTypeMetrics(typeName);
+		TS_ASSERT(metrics != NULL);
+		TS_ASSERT(fileCacheSet->GetTypeMetrics("missing") == NULL);
+
+		// An object larger than the type is turned away
+		TS_ASSERT_EQUALS(fileCacheSet->InsertCacheObject(msgText, typeName,
+		                 fileName, 30000), (cachedObjectId_t) 0);
+		TS_ASSERT_EQUALS(metrics->m_insertRejections.Get(), 1ULL);
+
+		TS_ASSERT_EQUALS(fileCacheSet->InsertCacheObject(msgText, typeName,
+		                 fileName, 123),
+		                 curObjId);
+		msgText.clear();
+		const std::string pathname(fileCacheSet->SubscribeCacheObject(msgText,
+		                           curObjId));
+		TS_ASSERT_LESS_THAN((size_t) 7, pathname.length());
+		TS_ASSERT_EQUALS(metrics->m_subscribeHits.Get(), 1ULL);
+		fileCacheSet->UnSubscribeCacheObject(typeName, curObjId++);
+
+		// Misses are counted against the type in the pathname
+		fileCacheSet->CountSubscribeMiss(pathname);
+		fileCacheSet->CountSubscribeMiss(fileCacheSet->GetBaseDirName() +
+		                                 "/missing/0/1.ext");
+		TS_ASSERT_EQUALS(metrics->m_subscribeMisses.Get(), 1ULL);
+		TS_ASSERT_EQUALS(metrics->m_localEvictions.Get(), 0ULL);
+
+		TS_ASSERT_EQUALS(fileCacheSet->DeleteType(msgText, typeName),
+		                 GetFilesystemFileSize(4096));
+	}
+
 	void testResize()
 	{
 		CCacheParamValues params(10000, 20000, 100, 1, 1);
@@ -339,6 +512,670 @@ public:
 		TS_ASSERT(fileCacheSet->isTypeDirType(typeName));
 		TS_ASSERT_EQUALS(fileCacheSet->DeleteType(msgText, typeName), 0);
 	}
+
+	void testTotals()
+	{
+		// The running sums, not the ones the test set overrides
+		const cacheSize_t sizes = fileCacheSet->CFileCacheSet::SumOfCacheSizes();
+		const cacheSize_t lwms = fileCacheSet->CFileCacheSet::SumOfLoWatermarks();
+		TS_ASSERT(fileCacheSet->CheckTotals());
+
+		CCacheParamValues params(10000, 20000, 100, 1, 1);
+		std::string type2(typeName + "2");
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		TS_ASSERT(fileCacheSet->DefineType(msgText, type2, &params));
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfLoWatermarks(),
+		                 lwms + 2 * GetFilesystemFileSize(10000));
+		TS_ASSERT(fileCacheSet->CheckTotals());
+
+		// Inserts, resizes and expires are all counted as they happen
+		cachedObjectId_t objId1 = fileCacheSet->InsertCacheObject(msgText,
+		                          typeName, fileName, 123);
+		cachedObjectId_t objId2 = fileCacheSet->InsertCacheObject(msgText,
+		                          type2, fileName, 5000);
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfCacheSizes(),
+		                 sizes + GetFilesystemFileSize(123) +
+		                 GetFilesystemFileSize(5000));
+		TS_ASSERT(fileCacheSet->CheckTotals());
+		const std::string pathname(fileCacheSet->SubscribeCacheObject(msgText,
+		                           objId1));
+		TS_ASSERT_EQUALS(fileCacheSet->Resize(objId1, 9000), 9000);
+		TS_ASSERT(fileCacheSet->CheckTotals());
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId1);
+		TS_ASSERT(fileCacheSet->CheckTotals());
+		TS_ASSERT(fileCacheSet->ExpireCacheObject(objId2));
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfCacheSizes(),
+		                 sizes + GetFilesystemFileSize(0));
+		TS_ASSERT(fileCacheSet->CheckTotals());
+
+		// Changing a loWatermark and deleting the types take them out
+		CCacheParamValues changed(20000, 30000, 100, 1, 1);
+		TS_ASSERT(fileCacheSet->ChangeType(msgText, type2, &changed));
+		TS_ASSERT(fileCacheSet->CheckTotals());
+		TS_ASSERT_EQUALS(fileCacheSet->DeleteType(msgText, typeName),
+		                 GetFilesystemFileSize(0));
+		TS_ASSERT_EQUALS(fileCacheSet->DeleteType(msgText, type2), 0);
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfCacheSizes(), sizes);
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfLoWatermarks(), lwms);
+		TS_ASSERT(fileCacheSet->CheckTotals());
+	}
+
+	void testDedup()
+	{
+		const cacheSize_t sizes = fileCacheSet->CFileCacheSet::SumOfCacheSizes();
+		CCacheParamValues params(10000, 40000, 100, 1, 1);
+		std::string type2(typeName + "2");
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		TS_ASSERT(fileCacheSet->DefineType(msgText, type2, &params));
+		fileCacheSet->SetDedupObjects(true);
+
+		// The same content is written to an object of each type and
+		// something else to a third object
+		const char *contents[3] = { "the same", "the same", "different" };
+		const std::string types[3] = { typeName, type2, typeName };
+		cachedObjectId_t objIds[3];
+		std::string pathnames[3];
+		struct stat bufs[3];
+		for (int i = 0; i < 3; i++)
+		{
+			objIds[i] = fileCacheSet->InsertCacheObject(msgText, types[i],
+			                                            fileName, 123);
+			TS_ASSERT(objIds[i] != 0);
+			msgText.clear();
+			pathnames[i] = fileCacheSet->SubscribeCacheObject(msgText, objIds[i]);
+			FILE *fp = ::fopen(pathnames[i].c_str(), "w");
+			TS_ASSERT(fp != NULL);
+			::fputs(contents[i], fp);
+			::fclose(fp);
+			fileCacheSet->UnSubscribeCacheObject(types[i], objIds[i]);
+			TS_ASSERT_EQUALS(::stat(pathnames[i].c_str(), &bufs[i]), 0);
+		}
+		TS_ASSERT_EQUALS(bufs[0].st_ino, bufs[1].st_ino);
+		TS_ASSERT_DIFFERS(bufs[0].st_ino, bufs[2].st_ino);
+		const CDedupTable &table = fileCacheSet->GetDedupTable();
+		TS_ASSERT_EQUALS(table.GetRefCount(objIds[0]), (size_t) 2);
+		TS_ASSERT_EQUALS(table.GetRefCount(objIds[1]), (size_t) 2);
+		TS_ASSERT_EQUALS(table.GetRefCount(objIds[2]), (size_t) 1);
+
+		// Only the first copy is charged for the shared file
+		const cacheSize_t size = GetFilesystemFileSize(8);
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfCacheSizes(),
+		                 sizes + size + GetFilesystemFileSize(9));
+		TS_ASSERT(fileCacheSet->CheckTotals());
+		CCacheMetrics *metrics = fileCacheSet->GetTypeMetrics(type2);
+		TS_ASSERT_EQUALS(metrics->m_dedupLinks.Get(), 1ULL);
+		TS_ASSERT_EQUALS(metrics->m_bytesDeduped.Get(), (unsigned long long) size);
+
+		// Each object keeps its own record on the shared file
+		TS_ASSERT(FC_getxattr(pathnames[0].c_str(), s_objectAttrName, NULL, 0) < 0);
+		TS_ASSERT(FC_getxattr(pathnames[0].c_str(),
+		                      GetLinkAttrName(objIds[0]).c_str(), NULL, 0) > 0);
+		TS_ASSERT(FC_getxattr(pathnames[1].c_str(),
+		                      GetLinkAttrName(objIds[1]).c_str(), NULL, 0) > 0);
+		scannedEntries_t entries;
+		const std::string dirname(pathnames[1].substr(0, pathnames[1].rfind('/')));
+		TS_ASSERT(CDirScanner::ScanDir(dirname, entries));
+		bool scanned = false;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].m_pathname == pathnames[1])
+			{
+				TS_ASSERT(entries[i].m_packed);
+				TS_ASSERT_EQUALS(entries[i].m_record.m_size, 8);
+				scanned = true;
+			}
+		}
+		TS_ASSERT(scanned);
+
+		// Expiring the object charged for the file charges the link
+		// instead, which still has the content
+		TS_ASSERT(fileCacheSet->ExpireCacheObject(objIds[0]));
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfCacheSizes(),
+		                 sizes + size + GetFilesystemFileSize(9));
+		TS_ASSERT(fileCacheSet->CheckTotals());
+		TS_ASSERT_EQUALS(table.GetRefCount(objIds[1]), (size_t) 1);
+		TS_ASSERT_EQUALS(table.GetOwner(objIds[1]), objIds[1]);
+		char buf[16] = { 0 };
+		FILE *fp = ::fopen(pathnames[1].c_str(), "r");
+		TS_ASSERT(fp != NULL);
+		TS_ASSERT(::fgets(buf, sizeof(buf), fp) != NULL);
+		::fclose(fp);
+		TS_ASSERT_EQUALS(std::string(buf), std::string(contents[1]));
+
+		fileCacheSet->SetDedupObjects(false);
+		TS_ASSERT(fileCacheSet->DeleteType(msgText, typeName) > 0);
+		TS_ASSERT(fileCacheSet->DeleteType(msgText, type2) > 0);
+		TS_ASSERT_EQUALS(table.GetNumObjects(), (size_t) 0);
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfCacheSizes(), sizes);
+	}
+
+	void testCompress()
+	{
+		const cacheSize_t sizes = fileCacheSet->CFileCacheSet::SumOfCacheSizes();
+		CCacheParamValues params(100000, 400000, 50000, 1, 1);
+		params.SetCompress(1);
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		TS_ASSERT_EQUALS(fileCacheSet->DescribeType(typeName).GetCompress(), 1);
+
+		// Text that compresses well and a small object that can't save a
+		// block
+		std::string text;
+		while (text.size() < 40000)
+		{
+			text += "the same line again\n";
+		}
+		const std::string contents[2] = { text, "tiny" };
+		cachedObjectId_t objIds[2];
+		std::string pathnames[2];
+		for (int i = 0; i < 2; i++)
+		{
+			objIds[i] = fileCacheSet->InsertCacheObject(msgText, typeName,
+			                                            fileName, 50000);
+			TS_ASSERT(objIds[i] != 0);
+			msgText.clear();
+			pathnames[i] = fileCacheSet->SubscribeCacheObject(msgText, objIds[i]);
+			FILE *fp = ::fopen(pathnames[i].c_str(), "w");
+			TS_ASSERT(fp != NULL);
+			::fwrite(contents[i].data(), 1, contents[i].size(), fp);
+			::fclose(fp);
+			fileCacheSet->UnSubscribeCacheObject(typeName, objIds[i]);
+		}
+
+		// The type is charged for the compressed file, the object keeps
+		// the size of its content
+		struct stat buf;
+		TS_ASSERT_EQUALS(::stat(pathnames[0].c_str(), &buf), 0);
+		TS_ASSERT(buf.st_size < (off_t) text.size() / 10);
+		TS_ASSERT_EQUALS(fileCacheSet->CachedObjectSize(objIds[0]),
+		                 (cacheSize_t) text.size());
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfCacheSizes(),
+		                 sizes + GetFilesystemFileSize(buf.st_size) +
+		                 GetFilesystemFileSize(4));
+		TS_ASSERT(fileCacheSet->CheckTotals());
+		CCacheMetrics *metrics = fileCacheSet->GetTypeMetrics(typeName);
+		TS_ASSERT_EQUALS(metrics->m_compressedObjects.Get(), 1ULL);
+		TS_ASSERT_EQUALS(metrics->m_bytesCompressed.Get(),
+		                 (unsigned long long)(GetFilesystemFileSize(text.size()) -
+		                                      GetFilesystemFileSize(buf.st_size)));
+
+		// The record says how big the compressed file is, so the walk
+		// accepts it
+		scannedEntries_t entries;
+		const std::string dirname(pathnames[0].substr(0, pathnames[0].rfind('/')));
+		TS_ASSERT(CDirScanner::ScanDir(dirname, entries));
+		bool scanned = false;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].m_pathname == pathnames[0])
+			{
+				TS_ASSERT(entries[i].m_record.m_compressed);
+				TS_ASSERT_EQUALS(entries[i].m_record.m_storedSize,
+				                 (cacheSize_t) buf.st_size);
+				TS_ASSERT_EQUALS(entries[i].m_record.m_size, (cacheSize_t) text.size());
+				scanned = true;
+			}
+		}
+		TS_ASSERT(scanned);
+
+		// Only the deflated object is kept out of batch subscribes and
+		// raw copies
+		TS_ASSERT(fileCacheSet->isCompressedObject(objIds[0]));
+		TS_ASSERT(!fileCacheSet->isCompressedObject(objIds[1]));
+
+		// Subscribers share a view of the content that goes with the
+		// last of them
+		msgText.clear();
+		const std::string view(fileCacheSet->SubscribeCacheObject(msgText,
+		                       objIds[0]));
+		TS_ASSERT_DIFFERS(view, pathnames[0]);
+		TS_ASSERT(view.find("/.trash/.views/") != std::string::npos);
+		TS_ASSERT_EQUALS(fileCacheSet->SubscribeCacheObject(msgText, objIds[0]),
+		                 view);
+		const cacheSize_t chargedSizes = fileCacheSet->CFileCacheSet::SumOfCacheSizes();
+		TS_ASSERT_EQUALS(chargedSizes, sizes + GetFilesystemFileSize(buf.st_size) +
+		                 GetFilesystemFileSize(4) + GetFilesystemFileSize(text.size()));
+		std::string viewed;
+		FILE *fp = ::fopen(view.c_str(), "r");
+		TS_ASSERT(fp != NULL);
+		char block[4096];
+		size_t length;
+		while ((length = ::fread(block, 1, sizeof(block), fp)) > 0)
+		{
+			viewed.append(block, length);
+		}
+		::fclose(fp);
+		TS_ASSERT_EQUALS(viewed, text);
+		fileCacheSet->UnSubscribeCacheObject(typeName, objIds[0]);
+		TS_ASSERT_EQUALS(::access(view.c_str(), F_OK), 0);
+		fileCacheSet->UnSubscribeCacheObject(typeName, objIds[0]);
+		TS_ASSERT(::access(view.c_str(), F_OK) != 0);
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfCacheSizes(),
+		                 chargedSizes - GetFilesystemFileSize(text.size()));
+		TS_ASSERT(fileCacheSet->CheckTotals());
+
+		// The small object is left as it was
+		msgText.clear();
+		TS_ASSERT_EQUALS(fileCacheSet->SubscribeCacheObject(msgText, objIds[1]),
+		                 pathnames[1]);
+		fileCacheSet->UnSubscribeCacheObject(typeName, objIds[1]);
+
+		TS_ASSERT(fileCacheSet->DeleteType(msgText, typeName) > 0);
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfCacheSizes(), sizes);
+	}
+
+	void testMemoryTier()
+	{
+		const cacheSize_t sizes = fileCacheSet->CFileCacheSet::SumOfCacheSizes();
+		char tempbase[20] = "/tmp/test/memXXXXXX";
+		const std::string memoryDir(::mkdtemp(tempbase));
+		fileCacheSet->SetMemoryTier(memoryDir, 20000, 40000, 0);
+		TS_ASSERT(fileCacheSet->isMemoryTier());
+		CCacheParamValues params(100000, 400000, 50000, 1, 1);
+		params.SetMemory(1);
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		TS_ASSERT_EQUALS(fileCacheSet->DescribeType(typeName).GetMemory(), 1);
+
+		// The object is written in memory through a link at its usual
+		// path and has no record until it's moved out
+		const std::string content("memory content\n");
+		cachedObjectId_t objId = fileCacheSet->InsertCacheObject(msgText,
+		                         typeName, fileName, 1000);
+		TS_ASSERT(objId != 0);
+		msgText.clear();
+		const std::string pathname(fileCacheSet->SubscribeCacheObject(msgText,
+		                           objId));
+		struct stat buf;
+		TS_ASSERT_EQUALS(::lstat(pathname.c_str(), &buf), 0);
+		TS_ASSERT(S_ISLNK(buf.st_mode));
+		char target[1024];
+		ssize_t length = ::readlink(pathname.c_str(), target, sizeof(target) - 1);
+		TS_ASSERT(length > 0);
+		const std::string memoryPath(target, length > 0 ? (size_t) length : 0);
+		TS_ASSERT_EQUALS(memoryPath.find(memoryDir + "/" + typeName + "/"),
+		                 (size_t) 0);
+		FILE *fp = ::fopen(pathname.c_str(), "w");
+		TS_ASSERT(fp != NULL);
+		::fwrite(content.data(), 1, content.size(), fp);
+		::fclose(fp);
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+		TS_ASSERT(fileCacheSet->GetMemorySize() > 0);
+		TS_ASSERT(FC_getxattr(pathname.c_str(), s_objectAttrName, NULL, 0) < 0);
+
+		// An object too big for the memory tier goes to the cache
+		// directory
+		cachedObjectId_t bigId = fileCacheSet->InsertCacheObject(msgText,
+		                         typeName, fileName, 50000);
+		TS_ASSERT(bigId != 0);
+		msgText.clear();
+		const std::string bigPath(fileCacheSet->SubscribeCacheObject(msgText,
+		                          bigId));
+		TS_ASSERT_EQUALS(::lstat(bigPath.c_str(), &buf), 0);
+		TS_ASSERT(S_ISREG(buf.st_mode));
+		fileCacheSet->UnSubscribeCacheObject(typeName, bigId);
+
+		// When the type stops being memory backed its objects are moved
+		// to the cache directory with their content
+		params.SetMemory(0);
+		TS_ASSERT(fileCacheSet->ChangeType(msgText, typeName, &params));
+		TS_ASSERT_EQUALS(fileCacheSet->GetMemorySize(), 0);
+		TS_ASSERT_EQUALS(::lstat(pathname.c_str(), &buf), 0);
+		TS_ASSERT(S_ISREG(buf.st_mode));
+		TS_ASSERT(::access(memoryPath.c_str(), F_OK) != 0);
+		TS_ASSERT(FC_getxattr(pathname.c_str(), s_objectAttrName, NULL, 0) > 0);
+		std::string moved;
+		fp = ::fopen(pathname.c_str(), "r");
+		TS_ASSERT(fp != NULL);
+		char block[4096];
+		size_t count;
+		while ((count = ::fread(block, 1, sizeof(block), fp)) > 0)
+		{
+			moved.append(block, count);
+		}
+		::fclose(fp);
+		TS_ASSERT_EQUALS(moved, content);
+		CCacheMetrics *metrics = fileCacheSet->GetTypeMetrics(typeName);
+		TS_ASSERT_EQUALS(metrics->m_memoryDemotions.Get(), 1ULL);
+		TS_ASSERT(fileCacheSet->CheckTotals());
+
+		TS_ASSERT(fileCacheSet->DeleteType(msgText, typeName) > 0);
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfCacheSizes(), sizes);
+		fileCacheSet->SetMemoryTier("", 0, 0, 0);
+		TS_ASSERT(CleanupDir(memoryDir, msgText));
+	}
+
+	void testStreamSubscribe()
+	{
+		CCacheParamValues params(100000, 400000, 50000, 1, 1);
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		std::vector<std::pair<StreamEvent, cacheSize_t> > events;
+		fileCacheSet->SetStreamCallback([&events](const cachedObjectId_t,
+		                                const StreamEvent event, const cacheSize_t size)
+		{
+			events.push_back(std::make_pair(event, size));
+		});
+
+		// Without a writer there is nothing to stream
+		cachedObjectId_t objId = fileCacheSet->InsertCacheObject(msgText, typeName,
+		                         fileName, 10000);
+		TS_ASSERT(objId != 0);
+		bool stream = true;
+		msgText.clear();
+		TS_ASSERT(fileCacheSet->SubscribeCacheObject(msgText, objId,
+		          &stream).empty());
+		TS_ASSERT(!msgText.empty());
+		TS_ASSERT(!stream);
+
+		// Readers share the file with its writer, another writer can't
+		msgText.clear();
+		const std::string pathname(fileCacheSet->SubscribeCacheObject(msgText,
+		                           objId));
+		TS_ASSERT(!pathname.empty());
+		stream = true;
+		TS_ASSERT_EQUALS(fileCacheSet->SubscribeCacheObject(msgText, objId,
+		                 &stream), pathname);
+		TS_ASSERT(msgText.empty());
+		TS_ASSERT(stream);
+		TS_ASSERT(fileCacheSet->SubscribeCacheObject(msgText, objId).empty());
+		msgText.clear();
+
+		// The readers are told as the object is written and resized
+		FILE *fp = ::fopen(pathname.c_str(), "w");
+		TS_ASSERT(fp != NULL);
+		::fwrite("streamed", 1, 8, fp);
+		::fflush(fp);
+		fileCacheSet->CheckSubscribedObject(typeName, objId);
+		TS_ASSERT_EQUALS(events.size(), (size_t) 1);
+		TS_ASSERT_EQUALS(events[0].first, StreamEventProgress);
+		TS_ASSERT_EQUALS(events[0].second, 8);
+		TS_ASSERT_EQUALS(fileCacheSet->Resize(objId, 20000), 20000);
+		::fwrite(" content", 1, 8, fp);
+		::fclose(fp);
+		fileCacheSet->CheckSubscribedObject(typeName, objId);
+		TS_ASSERT_EQUALS(events.back().first, StreamEventProgress);
+		TS_ASSERT_EQUALS(events.back().second, 16);
+
+		// A reader leaving doesn't finish the write, the writer does
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId, true);
+		TS_ASSERT_EQUALS(fileCacheSet->CachedObjectSize(objId), 20000);
+		stream = true;
+		TS_ASSERT_EQUALS(fileCacheSet->SubscribeCacheObject(msgText, objId,
+		                 &stream), pathname);
+		TS_ASSERT(stream);
+		events.clear();
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+		TS_ASSERT_EQUALS(events.size(), (size_t) 1);
+		TS_ASSERT_EQUALS(events[0].first, StreamEventWritten);
+		TS_ASSERT_EQUALS(events[0].second, 16);
+		TS_ASSERT_EQUALS(fileCacheSet->CachedObjectSize(objId), 16);
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId, true);
+
+		// Once written it's subscribed as usual
+		stream = true;
+		TS_ASSERT_EQUALS(fileCacheSet->SubscribeCacheObject(msgText, objId,
+		                 &stream), pathname);
+		TS_ASSERT(!stream);
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+
+		// Expiring an object being written fails its readers, it goes
+		// when they have all let go
+		cachedObjectId_t failedId = fileCacheSet->InsertCacheObject(msgText,
+		                            typeName, fileName, 10000);
+		msgText.clear();
+		const std::string failedPath(fileCacheSet->SubscribeCacheObject(msgText,
+		                             failedId));
+		stream = true;
+		TS_ASSERT_EQUALS(fileCacheSet->SubscribeCacheObject(msgText, failedId,
+		                 &stream), failedPath);
+		events.clear();
+		TS_ASSERT(!fileCacheSet->ExpireCacheObject(failedId));
+		TS_ASSERT_EQUALS(events.size(), (size_t) 1);
+		TS_ASSERT_EQUALS(events[0].first, StreamEventFailed);
+		fileCacheSet->UnSubscribeCacheObject(typeName, failedId);
+		fileCacheSet->UnSubscribeCacheObject(typeName, failedId, true);
+		TS_ASSERT_EQUALS(events.size(), (size_t) 1);
+		fileCacheSet->CleanupOrphans();
+		TS_ASSERT(::access(failedPath.c_str(), F_OK) != 0);
+
+		fileCacheSet->SetStreamCallback(streamCallback_t());
+		TS_ASSERT(fileCacheSet->DeleteType(msgText, typeName) > 0);
+	}
+
+	void testAdaptiveSpace()
+	{
+		CCacheParamValues params(100000, 400000, 50000, 1, 1);
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		const cacheSize_t total = fileCacheSet->TotalCacheSpace();
+		TS_ASSERT(!fileCacheSet->isAdaptiveSpace());
+		TS_ASSERT_EQUALS(fileCacheSet->EffectiveCacheSpace(), total);
+		TS_ASSERT_EQUALS(fileCacheSet->AdaptCacheSpace(), 0);
+
+		// Reserving more than the filesystem has shrinks the cache to
+		// its lower bound and the hiWatermarks with it
+		fileCacheSet->SetAdaptiveSpace(total / 2, total * 2, (cacheSize_t) 1 << 60);
+		TS_ASSERT(fileCacheSet->isAdaptiveSpace());
+		TS_ASSERT_EQUALS(fileCacheSet->EffectiveCacheSpace(), total);
+		TS_ASSERT_EQUALS(fileCacheSet->AdaptCacheSpace(), 0);
+		TS_ASSERT_EQUALS(fileCacheSet->EffectiveCacheSpace(), total / 2);
+		TS_ASSERT_EQUALS(fileCacheSet->ScaleHiWatermark(400000), 200000);
+
+		// With nothing reserved it can grow to its upper bound
+		fileCacheSet->SetAdaptiveSpace(total / 2, total * 2, 0);
+		(void) fileCacheSet->AdaptCacheSpace();
+		TS_ASSERT(fileCacheSet->EffectiveCacheSpace() >= total / 2);
+		TS_ASSERT(fileCacheSet->EffectiveCacheSpace() <= total * 2);
+
+		// Bounds under the sum of the loWatermarks are raised to it, as
+		// the types can't be cleaned up below them
+		const cacheSize_t lwms = fileCacheSet->SumOfLoWatermarks();
+		fileCacheSet->SetAdaptiveSpace(lwms / 4, lwms / 2, (cacheSize_t) 1 << 60);
+		TS_ASSERT_EQUALS(fileCacheSet->EffectiveCacheSpace(), lwms);
+		TS_ASSERT_EQUALS(fileCacheSet->AdaptCacheSpace(), 0);
+		TS_ASSERT_EQUALS(fileCacheSet->EffectiveCacheSpace(), lwms);
+		TS_ASSERT(fileCacheSet->ChangeType(msgText, typeName, &params));
+		TS_ASSERT_EQUALS(fileCacheSet->EffectiveCacheSpace(), lwms);
+
+		fileCacheSet->SetAdaptiveSpace(0, 0, 0);
+		TS_ASSERT(!fileCacheSet->isAdaptiveSpace());
+		TS_ASSERT_EQUALS(fileCacheSet->EffectiveCacheSpace(), total);
+		TS_ASSERT_EQUALS(fileCacheSet->ScaleHiWatermark(400000), 400000);
+		TS_ASSERT(fileCacheSet->DeleteType(msgText, typeName) >= 0);
+	}
+
+	void testPrefetch()
+	{
+		CCacheParamValues params(100000, 400000, 50000, 1, 1);
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		cachedObjectId_t objIds[2];
+		for (int i = 0; i < 2; i++)
+		{
+			objIds[i] = fileCacheSet->InsertCacheObject(msgText, typeName,
+			            fileName, 100);
+			TS_ASSERT(objIds[i] != 0);
+		}
+
+		// Only written objects can be prefetched
+		TS_ASSERT(!fileCacheSet->PrefetchCacheObject(msgText, objIds[0]));
+		TS_ASSERT(!msgText.empty());
+		msgText.clear();
+		TS_ASSERT(!fileCacheSet->PrefetchCacheObject(msgText, 12345));
+		TS_ASSERT(!msgText.empty());
+		msgText.clear();
+		TS_ASSERT_EQUALS(fileCacheSet->PrefetchRecentObjects(5), 0);
+
+		for (int i = 0; i < 2; i++)
+		{
+			const std::string pathname(fileCacheSet->SubscribeCacheObject(msgText,
+			                           objIds[i]));
+			TS_ASSERT(!pathname.empty());
+			FILE *fp = ::fopen(pathname.c_str(), "w");
+			TS_ASSERT(fp != NULL);
+			::fwrite("prefetched", 1, 10, fp);
+			::fclose(fp);
+			fileCacheSet->UnSubscribeCacheObject(typeName, objIds[i]);
+		}
+		TS_ASSERT(fileCacheSet->PrefetchCacheObject(msgText, objIds[0]));
+		TS_ASSERT(msgText.empty());
+		TS_ASSERT_EQUALS(fileCacheSet->PrefetchRecentObjects(0), 0);
+		TS_ASSERT_EQUALS(fileCacheSet->PrefetchRecentObjects(1), 1);
+		TS_ASSERT_EQUALS(fileCacheSet->PrefetchRecentObjects(5), 2);
+		CCacheMetrics *metrics = fileCacheSet->GetTypeMetrics(typeName);
+		TS_ASSERT(metrics != NULL);
+		TS_ASSERT_EQUALS(metrics->m_prefetches.Get(), 4ULL);
+
+		fileCacheSet->ExpireCacheObject(objIds[0]);
+		fileCacheSet->ExpireCacheObject(objIds[1]);
+		TS_ASSERT(fileCacheSet->DeleteType(msgText, typeName) >= 0);
+	}
+
+	void testIoPoolObjectDir()
+	{
+		CCacheParamValues params(10000, 20000, 100, 1, 1);
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		TS_ASSERT(fileCacheSet->StartIoPool() >= 0);
+		cachedObjectId_t objId = fileCacheSet->InsertCacheObject(msgText,
+		                         typeName, fileName, 123);
+		TS_ASSERT(objId != 0);
+		const std::string pathname(fileCacheSet->SubscribeCacheObject(msgText,
+		                           objId));
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+
+		// The emptied directory goes before the removal is queued, not
+		// under an object made in it later
+		TS_ASSERT(fileCacheSet->ExpireCacheObject(objId));
+		TS_ASSERT_EQUALS(::access(GetDirectoryFromPath(pathname).c_str(), F_OK), -1);
+		objId = fileCacheSet->InsertCacheObject(msgText, typeName, fileName, 123);
+		TS_ASSERT(objId != 0);
+		const std::string newPathname(fileCacheSet->SubscribeCacheObject(msgText,
+		                              objId));
+		fileCacheSet->GetIoPool()->Wait(typeName);
+		TS_ASSERT_EQUALS(::access(newPathname.c_str(), F_OK), 0);
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+
+		TS_ASSERT(fileCacheSet->DeleteType(msgText, typeName) >= 0);
+		fileCacheSet->StopIoPool();
+	}
+
+	void testIoPoolView()
+	{
+		const cacheSize_t sizes = fileCacheSet->CFileCacheSet::SumOfCacheSizes();
+		char tempbase[20] = "/tmp/test/memXXXXXX";
+		const std::string memoryDir(::mkdtemp(tempbase));
+		fileCacheSet->SetMemoryTier(memoryDir, 20000, 40000, 0);
+		CCacheParamValues params(100000, 400000, 50000, 1, 1);
+		params.SetCompress(1);
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		TS_ASSERT(fileCacheSet->StartIoPool() >= 0);
+		std::string text;
+		while (text.size() < 40000)
+		{
+			text += "the same line again\n";
+		}
+		const cachedObjectId_t objId = fileCacheSet->InsertCacheObject(msgText,
+		                               typeName, fileName, 50000);
+		TS_ASSERT(objId != 0);
+		msgText.clear();
+		const std::string pathname(fileCacheSet->SubscribeCacheObject(msgText,
+		                           objId));
+		FILE *fp = ::fopen(pathname.c_str(), "w");
+		TS_ASSERT(fp != NULL);
+		::fwrite(text.data(), 1, text.size(), fp);
+		::fclose(fp);
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+		fileCacheSet->GetIoPool()->Wait(typeName);
+		const cacheSize_t compressedSizes =
+		    fileCacheSet->CFileCacheSet::SumOfCacheSizes();
+		TS_ASSERT(compressedSizes < sizes + GetFilesystemFileSize(text.size()));
+
+		// The view is made in memory on the pool and the subscriber is
+		// told once it's ready, it's charged until it's released
+		std::string finishedView;
+		fileCacheSet->SetViewCallback([&finishedView](const cachedObjectId_t,
+		                              const std::string &viewPath)
+		{
+			finishedView = viewPath;
+		});
+		msgText.clear();
+		const std::string view(fileCacheSet->SubscribeCacheObject(msgText, objId));
+		TS_ASSERT(view.compare(0, memoryDir.size(), memoryDir) == 0);
+		TS_ASSERT(fileCacheSet->isViewPending(objId));
+		fileCacheSet->GetIoPool()->Wait(typeName);
+		TS_ASSERT(!fileCacheSet->isViewPending(objId));
+		TS_ASSERT_EQUALS(finishedView, view);
+		TS_ASSERT_EQUALS(::access(view.c_str(), F_OK), 0);
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfCacheSizes(),
+		                 compressedSizes + GetFilesystemFileSize(text.size()));
+		TS_ASSERT_EQUALS(fileCacheSet->GetMemorySize(),
+		                 GetFilesystemFileSize(text.size()));
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+		fileCacheSet->GetIoPool()->Wait(typeName);
+		TS_ASSERT(::access(view.c_str(), F_OK) != 0);
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfCacheSizes(),
+		                 compressedSizes);
+		TS_ASSERT_EQUALS(fileCacheSet->GetMemorySize(), 0);
+
+		// A view nobody waits for any more is removed once it's made
+		finishedView = "none";
+		msgText.clear();
+		(void) fileCacheSet->SubscribeCacheObject(msgText, objId);
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+		fileCacheSet->GetIoPool()->Wait(typeName);
+		TS_ASSERT(finishedView.empty());
+		fileCacheSet->GetIoPool()->Wait(typeName);
+		TS_ASSERT(::access(view.c_str(), F_OK) != 0);
+		TS_ASSERT_EQUALS(fileCacheSet->CFileCacheSet::SumOfCacheSizes(),
+		                 compressedSizes);
+
+		fileCacheSet->SetViewCallback(viewCallback_t());
+		TS_ASSERT(fileCacheSet->DeleteType(msgText, typeName) >= 0);
+		fileCacheSet->StopIoPool();
+		fileCacheSet->SetMemoryTier("", 0, 0, 0);
+		TS_ASSERT_EQUALS(::rmdir(memoryDir.c_str()), 0);
+	}
+
+	void testSubscribeWhileSyncing()
+	{
+		CCacheParamValues params(10000, 20000, 100, 1, 1);
+		TS_ASSERT(fileCacheSet->DefineType(msgText, typeName, &params));
+		int eventFd = fileCacheSet->StartSyncQueue();
+		TS_ASSERT(eventFd >= 0);
+		const cachedObjectId_t objId = fileCacheSet->InsertCacheObject(msgText,
+		                               typeName, fileName, 123);
+		TS_ASSERT(objId != 0);
+		const std::string pathname(fileCacheSet->SubscribeCacheObject(msgText,
+		                           objId));
+		FILE *fp = ::fopen(pathname.c_str(), "w");
+		TS_ASSERT(fp != NULL);
+		::fwrite(&objId, sizeof(objId), 1, fp);
+		::fclose(fp);
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+
+		// Nobody can take the object over while its flush is queued
+		msgText.clear();
+		TS_ASSERT(fileCacheSet->SubscribeCacheObject(msgText, objId).empty());
+		TS_ASSERT(!msgText.empty());
+
+		struct pollfd pfd;
+		pfd.fd = eventFd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		TS_ASSERT_EQUALS(::poll(&pfd, 1, 5000), 1);
+		fileCacheSet->FinishSyncs();
+		struct stat statBuf;
+		TS_ASSERT_EQUALS(::stat(pathname.c_str(), &statBuf), 0);
+		TS_ASSERT(!(statBuf.st_mode & S_IWUSR));
+		TS_ASSERT_EQUALS(fileCacheSet->CachedObjectSize(objId),
+		                 (cacheSize_t) sizeof(objId));
+
+		// Once written it is read like any other object
+		msgText.clear();
+		TS_ASSERT_EQUALS(fileCacheSet->SubscribeCacheObject(msgText, objId),
+		                 pathname);
+		TS_ASSERT(msgText.empty());
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+
+		fileCacheSet->StopSyncQueue();
+		TS_ASSERT(fileCacheSet->DeleteType(msgText, typeName) > 0);
+	}
 };
 
 #endif
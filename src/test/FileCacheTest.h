@@ -17,6 +17,7 @@
 #ifndef __FILECACHETEST_H__
 #define __FILECACHETEST_H__
 
+#include <fstream>
 #include <cxxtest/TestSuite.h>
 #include "FileCache.h"
 #include "FileCacheSet.h"
@@ -237,6 +238,10 @@ public:
 		fc3->UnSubscribe(objId + 2);
 		TS_ASSERT_EQUALS(fc3->CleanupCache(&cleanedId), 1004);
 		TS_ASSERT_EQUALS(cleanedId, objId + 4);
+		TS_ASSERT_EQUALS(fc3->GetMetrics().m_localEvictions.Get(), 3ULL);
+		TS_ASSERT_EQUALS(fc3->GetMetrics().m_bytesFreed.Get(),
+		                 (unsigned long long) (GetFilesystemFileSize(1001) +
+		                         GetFilesystemFileSize(1003) + GetFilesystemFileSize(1004)));
 
 		std::string dirname(s_baseTestDirName + "/" + type3);
 		TS_ASSERT_EQUALS(::access(dirname.c_str(), F_OK), 0);
@@ -312,8 +317,78 @@ public:
 		TS_ASSERT_EQUALS(::access(dirname.c_str(), F_OK), -1);
 	}
 
+	void testGetCheapestCandidate()
+	{
+		int i;
+
+		std::string type10(typeName + "10");
+		CFileCache *fc10 = new CFileCache(fileCacheSet, type10);
+		CCacheParamValues params(100, 200000, 100, 1, 1);
+		TS_ASSERT_EQUALS(fc10->Configure(&params), true);
+
+		// Costs 100 * 10 pages, 100 * 2 pages and 50 * 10 pages
+		paramValue_t costs[3] = { 100, 100, 50 };
+		cacheSize_t sizes[3] = { 10 * s_blockSize, 2 * s_blockSize,
+		                         10 * s_blockSize
+		                       };
+		for (i = 1; i <= 3; i++)
+		{
+			CCacheObject *co = new CCacheObject(fc10, (objId + i), filename,
+			                                    sizes[i - 1], costs[i - 1], 1);
+			TS_ASSERT(co->Initialize(true));
+			TS_ASSERT_EQUALS(fc10->Insert(co), i);
+		}
+		// The LRU candidate is the first inserted but scored 100 seconds
+		// from now the cheapest is the second (100 * 2 / 100) then the
+		// third (50 * 10 / 100) and last the first (100 * 10 / 100).
+		time_t later = ::time(0) + 100;
+		paramValue_t cost = -1;
+		TS_ASSERT_EQUALS(fc10->GetCleanupCandidate(), (objId + 1));
+		TS_ASSERT_EQUALS(fc10->GetCheapestCandidate(later, &cost), (objId + 2));
+		TS_ASSERT_EQUALS(cost, 2);
+		TS_ASSERT(fc10->Expire(objId + 2));
+		TS_ASSERT_EQUALS(fc10->GetCheapestCandidate(later, &cost), (objId + 3));
+		TS_ASSERT_EQUALS(cost, 5);
+		TS_ASSERT(fc10->Expire(objId + 3));
+		TS_ASSERT_EQUALS(fc10->GetCheapestCandidate(later, &cost), (objId + 1));
+		TS_ASSERT_EQUALS(cost, 10);
+		TS_ASSERT(fc10->Expire(objId + 1));
+		TS_ASSERT_EQUALS(fc10->GetCheapestCandidate(later, &cost),
+		                 (cachedObjectId_t) 0);
+
+		delete fc10;
+	}
+
 	void testCleanupOrphanedObjects()
 	{
+		std::string type6(typeName + "6");
+		CFileCache *fc6 = new CFileCache(fileCacheSet, type6);
+		CCacheParamValues params(10000, 20000, 100, 1, 1);
+		TS_ASSERT_EQUALS(fc6->Configure(&params), true);
+
+		CCacheObject *co = new CCacheObject(fc6, objId, filename, 1000);
+		TS_ASSERT(co->Initialize(true));
+		TS_ASSERT_EQUALS(fc6->Insert(co), 1);
+
+		// A subscribed object can't be removed when it expires so it is
+		// queued as an orphan
+		fc6->Subscribe(msgText, objId);
+		TS_ASSERT_EQUALS(fc6->Expire(objId), false);
+		TS_ASSERT_EQUALS(fc6->GetNumOrphans(), (size_t) 1);
+
+		// While it is still subscribed it is dropped from the queue
+		fc6->CleanupOrphanedObjects();
+		TS_ASSERT_EQUALS(fc6->GetNumOrphans(), (size_t) 0);
+		TS_ASSERT(fc6->isCachedObject(objId));
+
+		// and queued again by the last unsubscribe, then removed
+		fc6->UnSubscribe(objId);
+		TS_ASSERT_EQUALS(fc6->GetNumOrphans(), (size_t) 1);
+		fc6->CleanupOrphanedObjects();
+		TS_ASSERT_EQUALS(fc6->GetNumOrphans(), (size_t) 0);
+		TS_ASSERT(!fc6->isCachedObject(objId));
+
+		delete fc6;
 	}
 
 	void testGetCacheStatus()
@@ -325,7 +400,7 @@ public:
 		CCacheParamValues params(10000, 20000, 100, 1, 1);
 		TS_ASSERT_EQUALS(fc5->Configure(&params), true);
 
-		int size = 0;
+		cacheSize_t size = 0;
 		for (i = 1; i <= 5; i++)
 		{
 			CCacheObject *co = new CCacheObject(fc5, (objId + i), filename,
@@ -372,6 +447,19 @@ public:
 		fileCache->Expire(oid);
 	}
 
+	void testIsCachedObject()
+	{
+
+		cachedObjectId_t oid = 657484;
+		TS_ASSERT(!fileCache->isCachedObject(oid));
+		CCacheObject *co = new CCacheObject(fileCache, oid, filename, 12345);
+		TS_ASSERT_EQUALS(co->Initialize(true), true);
+		TS_ASSERT_EQUALS(fileCache->Insert(co), 2);
+		TS_ASSERT(fileCache->isCachedObject(oid));
+		fileCache->Expire(oid);
+		TS_ASSERT(!fileCache->isCachedObject(oid));
+	}
+
 	void testUpdateObject()
 	{
 		// We'll use Touch instead of the private UpdateObject here as
@@ -416,6 +504,37 @@ public:
 		TS_ASSERT_EQUALS(::access(dirname.c_str(), F_OK), -1);
 	}
 
+	void testExpireFromMiddleOfCacheList()
+	{
+		// Expiring an object that is neither the head nor the tail of
+		// the cache list must leave the order of the others intact.
+		int i;
+
+		std::string type9(typeName + "9");
+		CFileCache *fc9 = new CFileCache(fileCacheSet, type9);
+		CCacheParamValues params(100, 20000, 100, 1, 1);
+		TS_ASSERT_EQUALS(fc9->Configure(&params), true);
+
+		for (i = 1; i <= 4; i++)
+		{
+			CCacheObject *co = new CCacheObject(fc9, (objId + i), filename,
+			                                    (s_blockSize + i));
+			TS_ASSERT(co->Initialize(true));
+			TS_ASSERT_EQUALS(fc9->Insert(co), i);
+		}
+		TS_ASSERT(fc9->Expire(objId + 2));
+		fc9->Touch(objId + 1);
+		TS_ASSERT_EQUALS(fc9->GetCleanupCandidate(), (objId + 3));
+		TS_ASSERT(fc9->Expire(objId + 3));
+		TS_ASSERT_EQUALS(fc9->GetCleanupCandidate(), (objId + 4));
+		TS_ASSERT(fc9->Expire(objId + 4));
+		TS_ASSERT_EQUALS(fc9->GetCleanupCandidate(), (objId + 1));
+		TS_ASSERT(fc9->Expire(objId + 1));
+		TS_ASSERT_EQUALS(fc9->GetCleanupCandidate(), (cachedObjectId_t) 0);
+
+		delete fc9;
+	}
+
 	void testConfig()
 	{
 		// Create a cache, configure it, delete the cache with a file
@@ -456,6 +575,93 @@ public:
 		TS_ASSERT_EQUALS(::access(dirname.c_str(), F_OK), -1);
 	}
 
+	void testEvictionPolicy()
+	{
+		int i;
+
+		std::string type11(typeName + "11");
+		CFileCache *fc11 = new CFileCache(fileCacheSet, type11);
+		TS_ASSERT_EQUALS(fc11->GetPolicyName(), s_defaultPolicy);
+		CCacheParamValues params(100, 20000, 100, 1, 1);
+		params.SetPolicy("mru");
+		TS_ASSERT_EQUALS(fc11->Configure(&params), false);
+		params.SetPolicy(s_2qPolicy);
+		TS_ASSERT_EQUALS(fc11->Configure(&params), true);
+		CCacheParamValues described;
+		fc11->Describe(described);
+		TS_ASSERT_EQUALS(described.GetPolicy(), s_2qPolicy);
+
+		for (i = 1; i <= 4; i++)
+		{
+			CCacheObject *co = new CCacheObject(fc11, (objId + i), filename,
+			                                    (s_blockSize + i), 1, 1, true);
+			TS_ASSERT(co->Initialize(true));
+			TS_ASSERT_EQUALS(fc11->Insert(co), i);
+		}
+		// A hit moves objId + 1 to the hot list so the objects only seen
+		// once, including the ones inserted after it, go first
+		fc11->Touch(objId + 1);
+		for (i = 5; i <= 6; i++)
+		{
+			CCacheObject *co = new CCacheObject(fc11, (objId + i), filename,
+			                                    (s_blockSize + i), 1, 1, true);
+			TS_ASSERT(co->Initialize(true));
+			TS_ASSERT_EQUALS(fc11->Insert(co), i);
+		}
+		for (i = 2; i <= 6; i++)
+		{
+			TS_ASSERT_EQUALS(fc11->GetCleanupCandidate(), (objId + i));
+			TS_ASSERT(fc11->Expire(fc11->GetCleanupCandidate()));
+		}
+		TS_ASSERT_EQUALS(fc11->GetCleanupCandidate(), (objId + 1));
+
+		// Changing the policy keeps the objects and is written to the
+		// config file
+		params.SetPolicy(s_lruPolicy);
+		TS_ASSERT_EQUALS(fc11->Configure(&params), true);
+		TS_ASSERT_EQUALS(fc11->GetPolicyName(), s_lruPolicy);
+		TS_ASSERT_EQUALS(fc11->GetCleanupCandidate(), (objId + 1));
+		std::string config(s_baseTestDirName + "/" + type11 + "/Type.defaults");
+		std::ifstream file(config.c_str());
+		std::string contents((std::istreambuf_iterator<char>(file)),
+		                     std::istreambuf_iterator<char>());
+		TS_ASSERT(contents.find("evictionPolicy lru") != std::string::npos);
+		TS_ASSERT(fc11->Expire(objId + 1));
+		delete fc11;
+	}
+
+	void testTtlPolicy()
+	{
+		int i;
+
+		std::string type12(typeName + "12");
+		CFileCache *fc12 = new CFileCache(fileCacheSet, type12);
+		CCacheParamValues params(100, 20000, 100, 1, 1);
+		params.SetPolicy(s_ttlPolicy);
+		TS_ASSERT_EQUALS(fc12->Configure(&params), true);
+
+		// The object with the shortest lifetime goes first whatever
+		// order they were inserted or used in
+		const paramValue_t lifetimes[] = { 300, 100, 200 };
+		for (i = 1; i <= 3; i++)
+		{
+			CCacheObject *co = new CCacheObject(fc12, (objId + i), filename,
+			                                    (s_blockSize + i), 1,
+			                                    lifetimes[i - 1], true);
+			TS_ASSERT(co->Initialize(true));
+			TS_ASSERT_EQUALS(fc12->Insert(co), i);
+		}
+		fc12->Touch(objId + 2);
+		TS_ASSERT_EQUALS(fc12->GetCleanupCandidate(), (objId + 2));
+		TS_ASSERT(fc12->Expire(fc12->GetCleanupCandidate()));
+		TS_ASSERT_EQUALS(fc12->GetCleanupCandidate(), (objId + 3));
+		TS_ASSERT(fc12->Expire(fc12->GetCleanupCandidate()));
+		TS_ASSERT_EQUALS(fc12->GetCleanupCandidate(), (objId + 1));
+		TS_ASSERT(fc12->Expire(fc12->GetCleanupCandidate()));
+		TS_ASSERT_EQUALS(fc12->GetCleanupCandidate(), (cachedObjectId_t) 0);
+		delete fc12;
+	}
+
 	void testExpire()
 	{
 		TS_ASSERT_EQUALS(::access(pathname.c_str(), F_OK), 0);
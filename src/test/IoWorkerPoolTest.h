@@ -0,0 +1,107 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __IOWORKERPOOLTEST_H__
+#define __IOWORKERPOOLTEST_H__
+
+#include <cxxtest/TestSuite.h>
+#include <atomic>
+#include <chrono>
+#include <poll.h>
+#include "IoWorkerPool.h"
+
+class IoWorkerPoolTest : public CxxTest::TestSuite
+{
+
+public:
+
+	void testCompletions()
+	{
+		CIoWorkerPool pool(2);
+		TS_ASSERT(pool.GetEventFd() >= 0);
+		TS_ASSERT_EQUALS(pool.RunCompletions(), (size_t) 0);
+
+		// The work runs on a worker, the completion only when asked
+		std::thread::id mainThread = std::this_thread::get_id();
+		std::atomic<bool> ranOnWorker(false);
+		int done = 0;
+		pool.Post("", [&ranOnWorker, mainThread]()
+		{
+			ranOnWorker = (std::this_thread::get_id() != mainThread);
+		}, [&done]()
+		{
+			done++;
+		});
+
+		struct pollfd pfd;
+		pfd.fd = pool.GetEventFd();
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		TS_ASSERT_EQUALS(::poll(&pfd, 1, 5000), 1);
+		TS_ASSERT(ranOnWorker);
+		TS_ASSERT_EQUALS(done, 0);
+		TS_ASSERT_EQUALS(pool.GetNumPending(), (size_t) 1);
+		TS_ASSERT_EQUALS(pool.RunCompletions(), (size_t) 1);
+		TS_ASSERT_EQUALS(done, 1);
+		TS_ASSERT_EQUALS(pool.GetNumPending(), (size_t) 0);
+	}
+
+	void testKeyOrder()
+	{
+		// Jobs with the same key run in order even with free workers
+		CIoWorkerPool pool(4);
+		std::vector<int> order;
+		for (int i = 0; i < 20; i++)
+		{
+			pool.Post("type", [&order, i]()
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+				order.push_back(i);
+			});
+		}
+		pool.Wait("type");
+		TS_ASSERT_EQUALS(order.size(), (size_t) 20);
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			TS_ASSERT_EQUALS(order[i], (int) i);
+		}
+		TS_ASSERT_EQUALS(pool.GetNumPending(), (size_t) 0);
+	}
+
+	void testStop()
+	{
+		// Stopping runs the queued work and leaves the completions
+		CIoWorkerPool pool(1);
+		std::atomic<int> worked(0);
+		int done = 0;
+		for (int i = 0; i < 5; i++)
+		{
+			pool.Post("", [&worked]()
+			{
+				worked++;
+			}, [&done]()
+			{
+				done++;
+			});
+		}
+		pool.Stop();
+		TS_ASSERT_EQUALS(worked.load(), 5);
+		TS_ASSERT_EQUALS(pool.RunCompletions(), (size_t) 5);
+		TS_ASSERT_EQUALS(done, 5);
+	}
+};
+
+#endif
@@ -0,0 +1,65 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __METRICSTEST_H__
+#define __METRICSTEST_H__
+
+#include <cxxtest/TestSuite.h>
+#include "Metrics.h"
+
+class MetricsTest : public CxxTest::TestSuite
+{
+
+public:
+
+	void testCounter()
+	{
+		CCounter counter;
+		TS_ASSERT_EQUALS(counter.Get(), 0ULL);
+		counter.Add();
+		counter.Add(41);
+		TS_ASSERT_EQUALS(counter.Get(), 42ULL);
+	}
+
+	void testLatencyHistogram()
+	{
+		CLatencyHistogram latency;
+		latency.Record(0);
+		latency.Record(1);
+		latency.Record(3);
+		latency.Record(1000);
+		latency.Record(-5);
+		latency.Record(1LL << 40);
+		TS_ASSERT_EQUALS(latency.GetCount(), 6ULL);
+		TS_ASSERT_EQUALS(latency.GetTotal(), 1004ULL + (1ULL << 40));
+
+		// Bucket i counts the samples under 2^i not in an earlier one
+		TS_ASSERT_EQUALS(latency.GetBucket(0), 2ULL);
+		TS_ASSERT_EQUALS(latency.GetBucket(1), 1ULL);
+		TS_ASSERT_EQUALS(latency.GetBucket(2), 1ULL);
+		TS_ASSERT_EQUALS(latency.GetBucket(10), 1ULL);
+		TS_ASSERT_EQUALS(latency.GetBucket(s_numLatencyBuckets - 1), 1ULL);
+	}
+
+	void testMonotonicMicros()
+	{
+		long long start = GetMonotonicMicros();
+		TS_ASSERT(start > 0);
+		TS_ASSERT(GetMonotonicMicros() >= start);
+	}
+};
+
+#endif
@@ -0,0 +1,95 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __NAMETABLETEST_H__
+#define __NAMETABLETEST_H__
+
+#include <cxxtest/TestSuite.h>
+#include "NameTable.h"
+
+class NameTableTest : public CxxTest::TestSuite
+{
+
+public:
+
+	void testIntern()
+	{
+		CNameTable table;
+		const std::string name("testfile.ext");
+		const CInternedName *first = table.Intern(name);
+		TS_ASSERT_EQUALS(first->GetString(), name);
+		TS_ASSERT_EQUALS(first->m_name[name.length()], '\0');
+
+		// The same name is shared, a different one isn't
+		const CInternedName *second = table.Intern(std::string("testfile.ext"));
+		TS_ASSERT_EQUALS(first, second);
+		TS_ASSERT_EQUALS(first->m_refCount, (uint32_t) 2);
+		const CInternedName *other = table.Intern(std::string("other.ext"));
+		TS_ASSERT_DIFFERS(first, other);
+		TS_ASSERT_EQUALS(table.size(), (size_t) 2);
+
+		// Empty and heap allocated names work the same way
+		const CInternedName *empty = table.Intern(std::string());
+		TS_ASSERT_EQUALS(empty->m_length, (uint32_t) 0);
+		const std::string longName(s_maxFilenameLength, 'x');
+		const CInternedName *stored = table.Intern(longName);
+		TS_ASSERT_EQUALS(stored->GetString(), longName);
+		TS_ASSERT_EQUALS(table.Intern(longName), stored);
+		table.Release(stored);
+		table.Release(stored);
+		table.Release(empty);
+		TS_ASSERT_EQUALS(table.size(), (size_t) 2);
+
+		table.Release(first);
+		TS_ASSERT_EQUALS(table.size(), (size_t) 2);
+		table.Release(second);
+		TS_ASSERT_EQUALS(table.size(), (size_t) 1);
+		TS_ASSERT_EQUALS(table.Intern(std::string("other.ext")), other);
+		table.Release(other);
+		table.Release(other);
+		TS_ASSERT_EQUALS(table.size(), (size_t) 0);
+	}
+
+	void testManyNames()
+	{
+		CNameTable table;
+		std::vector<const CInternedName *> names;
+		char name[32];
+		for (int i = 0; i < 3000; i++)
+		{
+			::snprintf(name, sizeof(name), "name-%d.ext", i);
+			names.push_back(table.Intern(std::string(name)));
+		}
+		TS_ASSERT_EQUALS(table.size(), names.size());
+
+		// Releasing some names must leave the others reachable
+		for (size_t i = 0; i < names.size(); i += 3)
+		{
+			table.Release(names[i]);
+		}
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			if (i % 3 != 0)
+			{
+				::snprintf(name, sizeof(name), "name-%d.ext", (int) i);
+				TS_ASSERT_EQUALS(table.Intern(std::string(name)), names[i]);
+				TS_ASSERT_EQUALS(names[i]->m_refCount, (uint32_t) 2);
+			}
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,122 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __OBJECTIDTABLETEST_H__
+#define __OBJECTIDTABLETEST_H__
+
+#include <cxxtest/TestSuite.h>
+#include "ObjectIdTable.h"
+
+// The table never dereferences the objects so the tests store made up
+// pointers derived from the id.
+static CCacheObject *
+TestObjectForId(cachedObjectId_t objId)
+{
+	return (CCacheObject *)(uintptr_t)(objId * 8);
+}
+
+class ObjectIdTableTest : public CxxTest::TestSuite
+{
+
+public:
+
+	void testInsertFind()
+	{
+		CObjectIdTable table;
+		TS_ASSERT(table.empty());
+		TS_ASSERT(table.Find(1) == NULL);
+		TS_ASSERT(table.Insert(1, TestObjectForId(1)));
+		TS_ASSERT(table.Insert(17, TestObjectForId(17)));
+		TS_ASSERT_EQUALS(table.size(), (size_t) 2);
+		TS_ASSERT(table.Find(1) == TestObjectForId(1));
+		TS_ASSERT(table.Find(17) == TestObjectForId(17));
+		TS_ASSERT(table.Find(2) == NULL);
+
+		// Inserting an id again replaces its object
+		TS_ASSERT(table.Insert(1, TestObjectForId(2)));
+		TS_ASSERT_EQUALS(table.size(), (size_t) 2);
+		TS_ASSERT(table.Find(1) == TestObjectForId(2));
+
+		// Id 0 marks a free slot so it can't be stored
+		TS_ASSERT(!table.Insert(0, TestObjectForId(1)));
+		TS_ASSERT(table.Find(0) == NULL);
+		TS_ASSERT(!table.Erase(0));
+	}
+
+	void testGrowAndErase()
+	{
+		// Ids are built like GetNextCachedObjectId builds them
+		CObjectIdTable table;
+		std::vector<cachedObjectId_t> ids;
+		srand48(1);
+		for (cachedObjectId_t seq = 1; seq <= 5000; seq++)
+		{
+			ids.push_back(((cachedObjectId_t) lrand48() << 22) + seq);
+			TS_ASSERT(table.Insert(ids.back(), TestObjectForId(seq)));
+		}
+		TS_ASSERT_EQUALS(table.size(), ids.size());
+
+		// Removing every other id must leave the rest reachable
+		for (size_t i = 0; i < ids.size(); i += 2)
+		{
+			TS_ASSERT(table.Erase(ids[i]));
+		}
+		TS_ASSERT(!table.Erase(ids[0]));
+		TS_ASSERT_EQUALS(table.size(), ids.size() / 2);
+		for (size_t i = 0; i < ids.size(); i++)
+		{
+			CCacheObject *expected = (i % 2) ? TestObjectForId(i + 1) : NULL;
+			TS_ASSERT(table.Find(ids[i]) == expected);
+		}
+
+		// Iteration visits each remaining object once
+		std::set<cachedObjectId_t> visited;
+		CObjectIdTable::const_iterator iter = table.begin();
+		while (iter != table.end())
+		{
+			TS_ASSERT(table.Find((*iter).first) == (*iter).second);
+			visited.insert((*iter).first);
+			++iter;
+		}
+		TS_ASSERT_EQUALS(visited.size(), table.size());
+
+		table.clear();
+		TS_ASSERT(table.empty());
+		TS_ASSERT(table.begin() == table.end());
+		TS_ASSERT(table.Find(ids[1]) == NULL);
+	}
+
+	void testCollidingErase()
+	{
+		// Consecutive ids wrap around the end of the smallest table
+		CObjectIdTable table;
+		for (cachedObjectId_t id = 1; id <= 11; id++)
+		{
+			TS_ASSERT(table.Insert(id, TestObjectForId(id)));
+		}
+		for (cachedObjectId_t id = 1; id <= 11; id++)
+		{
+			TS_ASSERT(table.Erase(id));
+			for (cachedObjectId_t other = id + 1; other <= 11; other++)
+			{
+				TS_ASSERT(table.Find(other) == TestObjectForId(other));
+			}
+		}
+		TS_ASSERT(table.empty());
+	}
+};
+
+#endif
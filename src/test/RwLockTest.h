@@ -0,0 +1,93 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __RWLOCKTEST_H__
+#define __RWLOCKTEST_H__
+
+#include <cxxtest/TestSuite.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "RwLock.h"
+
+class RwLockTest : public CxxTest::TestSuite
+{
+
+public:
+
+	void testSharedReaders()
+	{
+		// Readers hold the lock together
+		CRwLock lock;
+		std::atomic<int> numHolding(0);
+		std::atomic<int> maxHolding(0);
+		std::vector<std::thread> readers;
+		for (int i = 0; i < 4; i++)
+		{
+			readers.push_back(std::thread([&lock, &numHolding, &maxHolding]()
+			{
+				CReadLockGuard guard(lock);
+				int holding = ++numHolding;
+				while (holding > maxHolding)
+				{
+					maxHolding = holding;
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+				numHolding--;
+			}));
+		}
+		for (size_t i = 0; i < readers.size(); i++)
+		{
+			readers[i].join();
+		}
+		TS_ASSERT(maxHolding > 1);
+	}
+
+	void testWriterExcludes()
+	{
+		// A reader waits for the writer to let go
+		CRwLock lock;
+		std::atomic<bool> read(false);
+		lock.WriteLock();
+		std::thread reader([&lock, &read]()
+		{
+			CReadLockGuard guard(lock);
+			read = true;
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		TS_ASSERT(!read);
+		lock.Unlock();
+		reader.join();
+		TS_ASSERT(read);
+
+		// And the writer waits for the readers
+		std::atomic<bool> written(false);
+		lock.ReadLock();
+		std::thread writer([&lock, &written]()
+		{
+			lock.WriteLock();
+			written = true;
+			lock.Unlock();
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		TS_ASSERT(!written);
+		lock.Unlock();
+		writer.join();
+		TS_ASSERT(written);
+	}
+};
+
+#endif
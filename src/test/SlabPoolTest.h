@@ -0,0 +1,81 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __SLABPOOLTEST_H__
+#define __SLABPOOLTEST_H__
+
+#include <cxxtest/TestSuite.h>
+#include "SlabPool.h"
+
+class SlabPoolTest : public CxxTest::TestSuite
+{
+
+public:
+
+	void testAllocate()
+	{
+		// Block sizes are rounded up so every block stays aligned
+		CSlabPool pool(20);
+		TS_ASSERT_EQUALS(pool.GetBlockSize(), (size_t) 24);
+		TS_ASSERT_EQUALS(pool.GetReservedBytes(), (size_t) 0);
+
+		std::set<char *> blocks;
+		size_t numBlocks = 2 * (s_slabSize / pool.GetBlockSize());
+		for (size_t i = 0; i < numBlocks; i++)
+		{
+			char *block = static_cast<char *>(pool.Allocate());
+			TS_ASSERT_EQUALS((uintptr_t) block % 8, (uintptr_t) 0);
+			::memset(block, 0xa5, pool.GetBlockSize());
+			blocks.insert(block);
+		}
+		TS_ASSERT_EQUALS(blocks.size(), numBlocks);
+		TS_ASSERT_EQUALS(pool.GetNumBlocks(), numBlocks);
+		TS_ASSERT_EQUALS(pool.GetReservedBytes(), 2 * s_slabSize);
+
+		// Freed blocks are reused before another slab is added
+		char *block = *blocks.begin();
+		pool.Free(block);
+		TS_ASSERT_EQUALS(pool.GetNumBlocks(), numBlocks - 1);
+		TS_ASSERT_EQUALS(pool.Allocate(), (void *) block);
+		TS_ASSERT_EQUALS(pool.GetReservedBytes(), 2 * s_slabSize);
+
+		std::set<char *>::iterator iter = blocks.begin();
+		while (iter != blocks.end())
+		{
+			pool.Free(*iter);
+			++iter;
+		}
+		TS_ASSERT_EQUALS(pool.GetNumBlocks(), (size_t) 0);
+	}
+
+	void testAllocator()
+	{
+		std::list<int, CSlabAllocator<int> > values;
+		for (int i = 0; i < 1000; i++)
+		{
+			values.push_back(i);
+		}
+		TS_ASSERT_EQUALS(values.size(), (size_t) 1000);
+		TS_ASSERT_EQUALS(values.back(), 999);
+		std::set<int, std::less<int>, CSlabAllocator<int> > sorted(values.begin(),
+		        values.end());
+		TS_ASSERT_EQUALS(*sorted.begin(), 0);
+		sorted.erase(0);
+		TS_ASSERT_EQUALS(*sorted.begin(), 1);
+	}
+};
+
+#endif
@@ -0,0 +1,154 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __SYNCQUEUETEST_H__
+#define __SYNCQUEUETEST_H__
+
+#include <cxxtest/TestSuite.h>
+#include <poll.h>
+#include "SyncQueue.h"
+#include "TestObjects.h"
+
+class SyncQueueTest : public CxxTest::TestSuite
+{
+
+	std::string dirName;
+	std::vector<std::string> pathnames;
+
+	// Wait for the queue to flush and collect everything it has
+	// until numExpected requests have come back
+	size_t Collect(CSyncQueue &queue, syncRequests_t &completed,
+	               size_t numExpected)
+	{
+		completed.clear();
+		while (completed.size() < numExpected)
+		{
+			struct pollfd pfd;
+			pfd.fd = queue.GetEventFd();
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			if (::poll(&pfd, 1, 5000) <= 0)
+			{
+				break;
+			}
+
+			syncRequests_t batch;
+			if (queue.GetCompleted(batch))
+			{
+				completed.insert(completed.end(), batch.begin(), batch.end());
+			}
+		}
+
+		return completed.size();
+	}
+
+public:
+
+	void setUp()
+	{
+		::mkdir(s_baseTestDirName.c_str(), s_dirPerms);
+		dirName = s_baseTestDirName + "/synctest";
+		::mkdir(dirName.c_str(), s_dirPerms);
+
+		pathnames.clear();
+		for (int i = 0; i < 12; i++)
+		{
+			std::string pathname(dirName + "/" + (char)('a' + i) + ".ext");
+			FILE *fp = ::fopen(pathname.c_str(), "w");
+			::fwrite("data", 1, 4, fp);
+			::fclose(fp);
+			pathnames.push_back(pathname);
+		}
+	}
+
+	void tearDown()
+	{
+		for (size_t i = 0; i < pathnames.size(); i++)
+		{
+			::unlink(pathnames[i].c_str());
+		}
+		::rmdir(dirName.c_str());
+	}
+
+	void testSyncBatch()
+	{
+		// A small batch is flushed object by object and a missing
+		// file fails without affecting the others
+		syncRequests_t batch(3);
+		batch[0].m_pathname = pathnames[0];
+		batch[1].m_pathname = dirName + "/missing.ext";
+		batch[2].m_pathname = pathnames[1];
+		CSyncQueue::SyncBatch(batch);
+		TS_ASSERT(batch[0].m_synced);
+		TS_ASSERT(!batch[1].m_synced);
+		TS_ASSERT(batch[2].m_synced);
+
+		// A large batch is flushed with a single syncfs
+		batch.clear();
+		batch.resize(pathnames.size());
+		for (size_t i = 0; i < pathnames.size(); i++)
+		{
+			batch[i].m_pathname = pathnames[i];
+		}
+		TS_ASSERT(batch.size() >= s_syncfsBatchSize);
+		CSyncQueue::SyncBatch(batch);
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			TS_ASSERT(batch[i].m_synced);
+		}
+	}
+
+	void testQueue()
+	{
+		CSyncQueue queue(10);
+		TS_ASSERT(queue.GetEventFd() >= 0);
+		syncRequests_t completed;
+		TS_ASSERT(!queue.GetCompleted(completed));
+
+		for (size_t i = 0; i < pathnames.size(); i++)
+		{
+			queue.Add("type", (cachedObjectId_t)(i + 1), pathnames[i]);
+		}
+		queue.Add("type", 100, dirName + "/missing.ext");
+		TS_ASSERT_EQUALS(queue.GetNumPending(), pathnames.size() + 1);
+
+		TS_ASSERT_EQUALS(Collect(queue, completed, pathnames.size() + 1),
+		                 pathnames.size() + 1);
+		TS_ASSERT_EQUALS(queue.GetNumPending(), (size_t) 0);
+		for (size_t i = 0; i < completed.size(); i++)
+		{
+			TS_ASSERT_EQUALS(completed[i].m_typeName, std::string("type"));
+			TS_ASSERT_EQUALS(completed[i].m_synced, completed[i].m_objId != 100);
+		}
+	}
+
+	void testStop()
+	{
+		// Stopping flushes whatever is still queued
+		CSyncQueue queue(60000);
+		queue.Add("type", 1, pathnames[0]);
+		queue.Add("type", 2, pathnames[1]);
+		queue.Stop();
+		syncRequests_t completed;
+		TS_ASSERT(queue.GetCompleted(completed));
+		TS_ASSERT_EQUALS(completed.size(), (size_t) 2);
+		TS_ASSERT(completed[0].m_synced);
+		TS_ASSERT(completed[1].m_synced);
+		TS_ASSERT_EQUALS(queue.GetNumPending(), (size_t) 0);
+	}
+};
+
+#endif
@@ -0,0 +1,157 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __TRACELOGTEST_H__
+#define __TRACELOGTEST_H__
+
+#include <cxxtest/TestSuite.h>
+#include "TraceLog.h"
+#include "TestObjects.h"
+
+#include <fstream>
+
+class TraceLogTest : public CxxTest::TestSuite
+{
+
+	std::string traceFile;
+
+	CTraceRecord RoundTrip(const CTraceRecord &record)
+	{
+		CTraceRecord parsed;
+		TS_ASSERT(ParseTraceRecord(FormatTraceRecord(record), parsed));
+		TS_ASSERT_EQUALS(parsed.m_micros, record.m_micros);
+		TS_ASSERT_EQUALS(parsed.m_op, record.m_op);
+		return parsed;
+	}
+
+public:
+
+	void setUp()
+	{
+		::mkdir(s_baseTestDirName.c_str(), s_dirPerms);
+		traceFile = s_baseTestDirName + "/test.trace";
+		::unlink(traceFile.c_str());
+	}
+
+	void tearDown()
+	{
+		::unlink(traceFile.c_str());
+	}
+
+	void testFormatAndParse()
+	{
+		CTraceRecord record;
+		record.m_micros = 1234;
+		record.m_op = TraceDefineType;
+		record.m_typeName = "type1";
+		record.m_loWatermark = 10000;
+		record.m_hiWatermark = 5000000000LL;
+		record.m_size = 100;
+		record.m_cost = 5;
+		record.m_lifetime = 60;
+		record.m_dirType = true;
+		CTraceRecord parsed = RoundTrip(record);
+		TS_ASSERT_EQUALS(parsed.m_typeName, record.m_typeName);
+		TS_ASSERT_EQUALS(parsed.m_loWatermark, record.m_loWatermark);
+		TS_ASSERT_EQUALS(parsed.m_hiWatermark, record.m_hiWatermark);
+		TS_ASSERT_EQUALS(parsed.m_size, record.m_size);
+		TS_ASSERT_EQUALS(parsed.m_cost, record.m_cost);
+		TS_ASSERT_EQUALS(parsed.m_lifetime, record.m_lifetime);
+		TS_ASSERT(parsed.m_dirType);
+
+		record = CTraceRecord();
+		record.m_micros = 99;
+		record.m_op = TraceInsert;
+		record.m_typeName = "type1";
+		record.m_size = 3000000000LL;
+		record.m_cost = 1;
+		record.m_lifetime = 2;
+		record.m_objId = 42;
+		parsed = RoundTrip(record);
+		TS_ASSERT_EQUALS(parsed.m_typeName, record.m_typeName);
+		TS_ASSERT_EQUALS(parsed.m_size, record.m_size);
+		TS_ASSERT_EQUALS(parsed.m_objId, record.m_objId);
+
+		record = CTraceRecord();
+		record.m_op = TraceUnSubscribe;
+		record.m_typeName = "type1";
+		record.m_objId = 42;
+		parsed = RoundTrip(record);
+		TS_ASSERT_EQUALS(parsed.m_typeName, record.m_typeName);
+		TS_ASSERT_EQUALS(parsed.m_objId, record.m_objId);
+
+		record = CTraceRecord();
+		record.m_op = TraceTouch;
+		record.m_objId = 7;
+		parsed = RoundTrip(record);
+		TS_ASSERT_EQUALS(parsed.m_objId, record.m_objId);
+	}
+
+	void testParseInvalid()
+	{
+		CTraceRecord record;
+		TS_ASSERT(!ParseTraceRecord("", record));
+		TS_ASSERT(!ParseTraceRecord("garbage", record));
+		TS_ASSERT(!ParseTraceRecord("12 Unknown 1", record));
+		TS_ASSERT(!ParseTraceRecord("12 Insert type1", record));
+		TS_ASSERT(!ParseTraceRecord("x Touch 1", record));
+	}
+
+	void testWrite()
+	{
+		CTraceLog trace;
+		TS_ASSERT(!trace.IsOpen());
+		trace.Touch(1);
+
+		TS_ASSERT(trace.Open(traceFile, 1000000));
+		TS_ASSERT(trace.IsOpen());
+		CCacheParamValues params(10000, 20000, 100, 5, 60);
+		trace.DefineType("type1", params, false);
+		trace.Insert("type1", 100, 5, 60, 1);
+		trace.Subscribe(1);
+		trace.UnSubscribe("type1", 1);
+		trace.Expire(1);
+		trace.DeleteType("type1");
+
+		// Every line is a record, the first one the configuration
+		std::ifstream infile(traceFile.c_str());
+		std::string line;
+		std::vector<TraceOp> ops;
+		CTraceRecord record;
+		while (std::getline(infile, line))
+		{
+			TS_ASSERT(ParseTraceRecord(line, record));
+			if (ops.empty())
+			{
+				TS_ASSERT_EQUALS(record.m_size, 1000000);
+			}
+			ops.push_back(record.m_op);
+		}
+		TS_ASSERT_EQUALS(ops.size(), (size_t) 7);
+		if (ops.size() == 7)
+		{
+			TS_ASSERT_EQUALS(ops[0], TraceConfig);
+			TS_ASSERT_EQUALS(ops[1], TraceDefineType);
+			TS_ASSERT_EQUALS(ops[2], TraceInsert);
+			TS_ASSERT_EQUALS(ops[3], TraceSubscribe);
+			TS_ASSERT_EQUALS(ops[4], TraceUnSubscribe);
+			TS_ASSERT_EQUALS(ops[5], TraceExpire);
+			TS_ASSERT_EQUALS(ops[6], TraceDeleteType);
+		}
+	}
+};
+
+#endif
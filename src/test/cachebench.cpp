@@ -0,0 +1,614 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks CFileCacheSet in-process, without the bus, and prints the
+// throughput and latency percentiles of each operation.
+//
+//   cachebench [-d dir] [-n numObjects]
+//     Inserts, writes, subscribes to and touches numObjects objects,
+//     times starting up from the cache index and from a tree walk and
+//     then inserts under space pressure so the types evict locally and
+//     globally.  Last it reads a hot set while a scan goes through a
+//     type too small for both, once with each eviction policy.
+//     Without -n it runs with 10k, 100k and 1M objects.
+//
+//   cachebench [-d dir] [-p policy] -r traceFile
+//     Replays a trace recorded with traceFile in FileCache.conf, with
+//     every type using policy if one is given.  Records run back to
+//     back rather than at their recorded times.
+//
+// The cache lives in dir, /tmp/cachebench unless given, which is
+// emptied first.  It should be on the filesystem the service uses for
+// the file costs to be representative.  The cache sets are leaked
+// rather than deleted so their types aren't cleaned up while timing.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#include "CacheIndex.h"
+#include "FileCacheSet.h"
+#include "TraceLog.h"
+
+static const char *const s_defaultBenchDir = "/tmp/cachebench";
+static const char *const s_benchFilename = "bench.dat";
+
+static long long
+NowNsec()
+{
+
+	struct timespec tm;
+	::clock_gettime(CLOCK_MONOTONIC, &tm);
+
+	return tm.tv_sec * 1000000000LL + tm.tv_nsec;
+}
+
+// A cache set rooted at the benchmark directory with a given amount of
+// space, so nothing is read from the installed configuration
+class CBenchFileCacheSet : public CFileCacheSet
+{
+public:
+
+	CBenchFileCacheSet(const std::string &dirName, cacheSize_t totalCacheSpace)
+		: CFileCacheSet(false)
+		, m_dirName(dirName)
+		, m_totalCacheSpace(totalCacheSpace)
+	{
+	}
+
+	std::string &GetBaseDirName()
+	{
+		return m_dirName;
+	}
+
+	cacheSize_t TotalCacheSpace()
+	{
+		return m_totalCacheSpace;
+	}
+
+private:
+
+	std::string m_dirName;
+	cacheSize_t m_totalCacheSpace;
+};
+
+// The latencies of one operation
+class CSamples
+{
+public:
+
+	CSamples() : m_total(0)
+	{
+	}
+
+	void Add(long long nsecs)
+	{
+		m_samples.push_back(nsecs);
+		m_total += nsecs;
+	}
+
+	// Print the throughput and the latency percentiles in microseconds
+	void Report(const std::string &name)
+	{
+		if (m_samples.empty())
+		{
+			return;
+		}
+		std::sort(m_samples.begin(), m_samples.end());
+		printf("  %-18s %9zu ops %11.0f ops/s  p50 %9.1f  p90 %9.1f  p99 %9.1f  max %9.1f us\n",
+		       name.c_str(), m_samples.size(),
+		       (double) m_samples.size() * 1e9 / (double)(m_total > 0 ? m_total : 1),
+		       Percentile(0.50), Percentile(0.90), Percentile(0.99),
+		       (double) m_samples.back() / 1000.0);
+	}
+
+private:
+
+	double Percentile(double fraction) const
+	{
+		size_t index = (size_t)(fraction * (double)(m_samples.size() - 1));
+		return (double) m_samples[index] / 1000.0;
+	}
+
+	std::vector<long long> m_samples;
+	long long m_total;
+};
+
+// Empty the benchmark directory and create it again
+static bool
+ResetDir(const std::string &dirName)
+{
+
+	std::string msgText;
+	if ((::access(dirName.c_str(), F_OK) == 0) && !CleanupDir(dirName, msgText))
+	{
+		fprintf(stderr, "cachebench: %s\n", msgText.c_str());
+		return false;
+	}
+	if (::mkdir(dirName.c_str(), s_dirPerms) != 0)
+	{
+		perror(dirName.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+// Print the counters of a type
+static void
+ReportMetrics(CFileCacheSet *fileCacheSet, const std::string &typeName)
+{
+
+	const CCacheMetrics *metrics = fileCacheSet->GetTypeMetrics(typeName);
+	if (metrics != NULL)
+	{
+		printf("  %-18s %s, rejected %llu, evicted %llu local %llu global, freed %llu bytes\n",
+		       typeName.c_str(), fileCacheSet->DescribeType(typeName).GetPolicy().c_str(),
+		       metrics->m_insertRejections.Get(),
+		       metrics->m_localEvictions.Get(), metrics->m_globalEvictions.Get(),
+		       metrics->m_bytesFreed.Get());
+	}
+}
+
+// Time starting a cache set on the directory, from the index if there
+// is one and otherwise walking the tree
+static void
+TimeStartup(const std::string &dirName, cacheSize_t totalCacheSpace,
+            const std::string &name)
+{
+
+	CSamples samples;
+	CFileCacheSet *fileCacheSet = new CBenchFileCacheSet(dirName, totalCacheSpace);
+	long long start = NowNsec();
+	fileCacheSet->WalkDirTree(false);
+	samples.Add(NowNsec() - start);
+	samples.Report(name);
+
+	cacheSize_t size = 0;
+	paramValue_t numObjects = 0;
+	cacheSize_t availSpace = 0;
+	(void) fileCacheSet->GetCacheStatus(&size, &numObjects, &availSpace);
+	printf("  %-20s %d objects found\n", "", (int) numObjects);
+}
+
+// Subscribe to an object the way the service does, with an empty
+// message that is only set if the subscribe fails
+static const std::string
+Subscribe(CFileCacheSet *fileCacheSet, const cachedObjectId_t objId)
+{
+
+	std::string msgText;
+
+	return fileCacheSet->SubscribeCacheObject(msgText, objId);
+}
+
+// Insert an object and write it by subscribing and unsubscribing
+static cachedObjectId_t
+InsertWritten(CFileCacheSet *fileCacheSet, const std::string &typeName)
+{
+
+	std::string msgText;
+	cachedObjectId_t objId = fileCacheSet->InsertCacheObject(msgText, typeName,
+	                         s_benchFilename, 1);
+	if (objId > 0)
+	{
+		(void) Subscribe(fileCacheSet, objId);
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+	}
+
+	return objId;
+}
+
+// With each eviction policy, read a hot set of half the objects a type
+// has room for while a scan of numObjects objects used once goes
+// through it, reading one hot object every four scanned ones so the
+// hot objects are used less recently than the type can hold.
+static void
+RunPolicies(const std::string &dirName, int numObjects)
+{
+
+	const std::string policies[] = {s_costPolicy, s_lruPolicy, s_2qPolicy, s_ttlPolicy};
+	const cacheSize_t blockSize = GetFilesystemFileSize(1);
+	const int capacity = numObjects / 4 + 1;
+	const int numHot = capacity / 2;
+	const std::string typeName("scan");
+	printf("  %d hot objects read during a scan of %d:\n", numHot, numObjects);
+	for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+	{
+		if (!ResetDir(dirName))
+		{
+			return;
+		}
+		CFileCacheSet *fileCacheSet = new CBenchFileCacheSet(dirName,
+		        4 * (cacheSize_t) capacity * blockSize);
+		fileCacheSet->WalkDirTree(false);
+		std::string msgText;
+		CCacheParamValues params(blockSize, (cacheSize_t) capacity * blockSize,
+		                         1, 1, 1);
+		params.SetPolicy(policies[i]);
+		if (!fileCacheSet->DefineType(msgText, typeName, &params))
+		{
+			fprintf(stderr, "cachebench: %s\n", msgText.c_str());
+			return;
+		}
+
+		// The hot objects are read once before the scan starts
+		std::vector<cachedObjectId_t> hot;
+		for (int j = 0; j < numHot; j++)
+		{
+			cachedObjectId_t objId = InsertWritten(fileCacheSet, typeName);
+			if (objId > 0)
+			{
+				(void) Subscribe(fileCacheSet, objId);
+				fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+				hot.push_back(objId);
+			}
+		}
+		if (hot.empty())
+		{
+			return;
+		}
+
+		int hits = 0;
+		int reads = 0;
+		for (int j = 0; j < numObjects; j++)
+		{
+			(void) InsertWritten(fileCacheSet, typeName);
+			if ((j % 4) == 3)
+			{
+				cachedObjectId_t objId = hot[(size_t) reads % hot.size()];
+				reads++;
+				if (!Subscribe(fileCacheSet, objId).empty())
+				{
+					fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+					hits++;
+				}
+			}
+		}
+		printf("  %-18s %d of %d hot reads hit, hit ratio %.3f\n",
+		       policies[i].c_str(), hits, reads, (double) hits / (double) reads);
+	}
+}
+
+static void
+RunSuite(const std::string &dirName, int numObjects)
+{
+
+	printf("%d objects:\n", numObjects);
+	if (!ResetDir(dirName))
+	{
+		return;
+	}
+
+	// Room for every object so nothing is evicted until asked to be
+	const std::string typeName("bench");
+	const cacheSize_t blockSize = GetFilesystemFileSize(1);
+	const cacheSize_t numBlocks = (cacheSize_t) numObjects + 1;
+	const cacheSize_t totalCacheSpace = 2 * numBlocks * blockSize;
+	CFileCacheSet *fileCacheSet = new CBenchFileCacheSet(dirName, totalCacheSpace);
+	fileCacheSet->WalkDirTree(false);
+	std::string msgText;
+	CCacheParamValues params(numBlocks * blockSize, totalCacheSpace, 1, 1, 1);
+	if (!fileCacheSet->DefineType(msgText, typeName, &params))
+	{
+		fprintf(stderr, "cachebench: %s\n", msgText.c_str());
+		return;
+	}
+
+	CSamples inserts;
+	std::vector<cachedObjectId_t> ids;
+	for (int i = 0; i < numObjects; i++)
+	{
+		long long start = NowNsec();
+		cachedObjectId_t objId = fileCacheSet->InsertCacheObject(msgText, typeName,
+		                         s_benchFilename, 1);
+		inserts.Add(NowNsec() - start);
+		if (objId > 0)
+		{
+			ids.push_back(objId);
+		}
+	}
+	inserts.Report("insert");
+	if (ids.empty())
+	{
+		return;
+	}
+
+	// The first subscription creates the file and unsubscribing it
+	// marks it written
+	CSamples writes;
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		long long start = NowNsec();
+		(void) Subscribe(fileCacheSet, ids[i]);
+		fileCacheSet->UnSubscribeCacheObject(typeName, ids[i]);
+		writes.Add(NowNsec() - start);
+	}
+	writes.Report("write");
+
+	CSamples subscribes;
+	CSamples touches;
+	srand48(numObjects);
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		cachedObjectId_t objId = ids[(size_t) lrand48() % ids.size()];
+		long long start = NowNsec();
+		(void) Subscribe(fileCacheSet, objId);
+		fileCacheSet->UnSubscribeCacheObject(typeName, objId);
+		subscribes.Add(NowNsec() - start);
+
+		objId = ids[(size_t) lrand48() % ids.size()];
+		start = NowNsec();
+		(void) fileCacheSet->Touch(objId);
+		touches.Add(NowNsec() - start);
+	}
+	subscribes.Report("subscribe");
+	touches.Report("touch");
+
+	fileCacheSet->WriteCacheIndex(true);
+	TimeStartup(dirName, totalCacheSpace, "startup index");
+	CCacheIndex(dirName).Invalidate();
+	TimeStartup(dirName, totalCacheSpace, "startup walk");
+
+	// Under pressure: the small type evicts its own objects once it
+	// reaches its hiWatermark, the large one only fits by evicting
+	// from the set as a whole
+	if (!ResetDir(dirName))
+	{
+		return;
+	}
+	const cacheSize_t pressureSpace = (numBlocks + 2) * blockSize;
+	fileCacheSet = new CBenchFileCacheSet(dirName, pressureSpace);
+	fileCacheSet->WalkDirTree(false);
+	const std::string localType("local");
+	const std::string globalType("global");
+	CCacheParamValues localParams(blockSize, (numBlocks / 4 + 1) * blockSize, 1, 1, 1);
+	CCacheParamValues globalParams(blockSize, 2 * pressureSpace, 1, 1, 1);
+	if (!fileCacheSet->DefineType(msgText, localType, &localParams) ||
+	        !fileCacheSet->DefineType(msgText, globalType, &globalParams))
+	{
+		fprintf(stderr, "cachebench: %s\n", msgText.c_str());
+		return;
+	}
+	CSamples pressured;
+	for (int i = 0; i < 2 * numObjects; i++)
+	{
+		long long start = NowNsec();
+		(void) fileCacheSet->InsertCacheObject(msgText,
+		                                       (i % 2) ? globalType : localType,
+		                                       s_benchFilename, 1);
+		pressured.Add(NowNsec() - start);
+	}
+	pressured.Report("insert pressured");
+	ReportMetrics(fileCacheSet, localType);
+	ReportMetrics(fileCacheSet, globalType);
+
+	RunPolicies(dirName, std::max(numObjects / 10, 100));
+}
+
+// Replay a trace against a fresh cache set.  The ids in the trace are
+// mapped to the ids the replay's inserts are given, an operation on an
+// object the replay doesn't have, because it was never inserted or has
+// been evicted, is a miss.
+static void
+RunReplay(const std::string &dirName, const std::string &traceFile,
+          const std::string &policy)
+{
+
+	std::ifstream trace(traceFile.c_str());
+	if (!trace)
+	{
+		perror(traceFile.c_str());
+		return;
+	}
+	if (!ResetDir(dirName))
+	{
+		return;
+	}
+
+	CFileCacheSet *fileCacheSet = NULL;
+	std::map<cachedObjectId_t, cachedObjectId_t> ids;
+	std::map<cachedObjectId_t, int> subscriptions;
+	std::map<std::string, CSamples> samples;
+	std::vector<std::string> typeNames;
+	unsigned long long hits = 0;
+	unsigned long long misses = 0;
+	size_t numRecords = 0;
+	std::string line;
+	while (std::getline(trace, line))
+	{
+		CTraceRecord record;
+		if (!ParseTraceRecord(line, record))
+		{
+			continue;
+		}
+		if (fileCacheSet == NULL)
+		{
+			cacheSize_t totalCacheSpace = (record.m_op == TraceConfig) ?
+			                              record.m_size : s_defaultCacheSpace;
+			fileCacheSet = new CBenchFileCacheSet(dirName, totalCacheSpace);
+			fileCacheSet->WalkDirTree(false);
+		}
+		numRecords++;
+
+		cachedObjectId_t objId = 0;
+		std::map<cachedObjectId_t, cachedObjectId_t>::const_iterator idIter;
+		idIter = ids.find(record.m_objId);
+		if (idIter != ids.end())
+		{
+			objId = (*idIter).second;
+		}
+
+		std::string msgText;
+		CCacheParamValues params(record.m_loWatermark, record.m_hiWatermark,
+		                         record.m_size, record.m_cost,
+		                         record.m_lifetime);
+		params.SetPolicy(policy.empty() ? record.m_policy : policy);
+		long long start = NowNsec();
+		switch (record.m_op)
+		{
+			case TraceDefineType:
+				if (fileCacheSet->DefineType(msgText, record.m_typeName, &params,
+				                             record.m_dirType))
+				{
+					typeNames.push_back(record.m_typeName);
+				}
+				break;
+
+			case TraceChangeType:
+				(void) fileCacheSet->ChangeType(msgText, record.m_typeName, &params);
+				break;
+
+			case TraceDeleteType:
+				(void) fileCacheSet->DeleteType(msgText, record.m_typeName);
+				break;
+
+			case TraceInsert:
+				objId = fileCacheSet->InsertCacheObject(msgText, record.m_typeName,
+				                                        s_benchFilename,
+				                                        record.m_size,
+				                                        record.m_cost,
+				                                        record.m_lifetime);
+				if ((record.m_objId > 0) && (objId > 0))
+				{
+					ids[record.m_objId] = objId;
+				}
+				break;
+
+			case TraceResize:
+				(void) fileCacheSet->Resize(objId, record.m_size);
+				break;
+
+			case TraceExpire:
+				(void) fileCacheSet->ExpireCacheObject(objId);
+				break;
+
+			case TraceSubscribe:
+				if ((objId > 0) &&
+				        !Subscribe(fileCacheSet, objId).empty())
+				{
+					subscriptions[objId]++;
+					hits++;
+				}
+				else
+				{
+					misses++;
+				}
+				break;
+
+			case TraceUnSubscribe:
+				if (subscriptions[objId] > 0)
+				{
+					subscriptions[objId]--;
+					fileCacheSet->UnSubscribeCacheObject(record.m_typeName, objId);
+				}
+				break;
+
+			case TraceTouch:
+				(void) fileCacheSet->Touch(objId);
+				break;
+
+			default:
+				continue;
+		}
+		samples[GetTraceOpName(record.m_op)].Add(NowNsec() - start);
+	}
+
+	printf("%zu records from '%s':\n", numRecords, traceFile.c_str());
+	std::map<std::string, CSamples>::iterator iter = samples.begin();
+	while (iter != samples.end())
+	{
+		(*iter).second.Report((*iter).first);
+		++iter;
+	}
+	if ((hits + misses) > 0)
+	{
+		printf("  %-18s %llu hits, %llu misses, hit ratio %.3f\n", "subscribe",
+		       hits, misses, (double) hits / (double)(hits + misses));
+	}
+	for (size_t i = 0; (fileCacheSet != NULL) && (i < typeNames.size()); i++)
+	{
+		ReportMetrics(fileCacheSet, typeNames[i]);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+
+	std::string dirName(s_defaultBenchDir);
+	std::string traceFile;
+	std::string policy;
+	int numObjects = 0;
+	int opt;
+	while ((opt = ::getopt(argc, argv, "d:n:p:r:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'd':
+				dirName = optarg;
+				break;
+
+			case 'n':
+				numObjects = atoi(optarg);
+				break;
+
+			case 'p':
+				policy = optarg;
+				break;
+
+			case 'r':
+				traceFile = optarg;
+				break;
+
+			default:
+				fprintf(stderr,
+				        "usage: %s [-d dir] [-n numObjects | [-p policy] -r traceFile]\n",
+				        argv[0]);
+				return 1;
+		}
+	}
+
+	if (!policy.empty() && !CEvictionPolicy::isPolicy(policy))
+	{
+		fprintf(stderr, "cachebench: No eviction policy named '%s'.\n",
+		        policy.c_str());
+		return 1;
+	}
+	if (!traceFile.empty())
+	{
+		RunReplay(dirName, traceFile, policy);
+	}
+	else if (numObjects > 0)
+	{
+		RunSuite(dirName, numObjects);
+	}
+	else
+	{
+		for (numObjects = 10000; numObjects <= 1000000; numObjects *= 10)
+		{
+			RunSuite(dirName, numObjects);
+		}
+	}
+
+	return 0;
+}
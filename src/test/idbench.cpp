@@ -0,0 +1,113 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Measures the throughput of resolving an object id to its cache
+// object.  The maps the file cache used to go through (id to type
+// name, type name to CFileCache, then id to CCacheObject in the type)
+// are compared with the CObjectIdTable lookup that replaced them.
+// Only the lookup structures are built, no objects or files are
+// created, and the ids are made the way GetNextCachedObjectId makes
+// them.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ObjectIdTable.h"
+
+static const int s_numLookups = 2000000;
+static const int s_numTypes = 8;
+
+static long long
+NowNsec()
+{
+
+	struct timespec tm;
+	::clock_gettime(CLOCK_MONOTONIC, &tm);
+
+	return tm.tv_sec * 1000000000LL + tm.tv_nsec;
+}
+
+static void
+RunLookupBenchmark(int numObjects)
+{
+
+	// The objects are never dereferenced so made up pointers will do
+	std::vector<cachedObjectId_t> ids;
+	std::map<const cachedObjectId_t, const std::string> idMap;
+	std::map<const std::string, int> cacheSet;
+	std::vector<std::map<cachedObjectId_t, CCacheObject *> > cachedObjects(
+	    s_numTypes);
+	CObjectIdTable idTable;
+	srand48(numObjects);
+	for (int i = 1; i <= numObjects; i++)
+	{
+		cachedObjectId_t objId = ((cachedObjectId_t) lrand48() << 22) + i;
+		CCacheObject *object = (CCacheObject *)(uintptr_t)(i * 8);
+		int type = i % s_numTypes;
+		std::stringstream typeName;
+		typeName << "benchtype" << type;
+		ids.push_back(objId);
+		idMap.insert(std::map < const cachedObjectId_t,
+		             const std::string >::value_type(objId, typeName.str()));
+		cacheSet[typeName.str()] = type;
+		cachedObjects[type][objId] = object;
+		idTable.Insert(objId, object);
+	}
+
+	// Look up random objects so the accesses are spread over the whole
+	// structure and mostly miss the processor caches.
+	std::vector<cachedObjectId_t> lookups(s_numLookups);
+	for (int i = 0; i < s_numLookups; i++)
+	{
+		lookups[i] = ids[lrand48() % numObjects];
+	}
+
+	uintptr_t check = 0;
+	long long startTime = NowNsec();
+	for (int i = 0; i < s_numLookups; i++)
+	{
+		const std::string typeName((*idMap.find(lookups[i])).second);
+		int type = (*cacheSet.find(typeName)).second;
+		check += (uintptr_t)(*cachedObjects[type].find(lookups[i])).second;
+	}
+	long long mapElapsed = NowNsec() - startTime;
+
+	startTime = NowNsec();
+	for (int i = 0; i < s_numLookups; i++)
+	{
+		check -= (uintptr_t) idTable.Find(lookups[i]);
+	}
+	long long tableElapsed = NowNsec() - startTime;
+
+	printf("%9d objects: maps %7.1f ns/lookup (%6.2f M/s), "
+	       "id table %6.1f ns/lookup (%6.2f M/s)%s\n", numObjects,
+	       (double) mapElapsed / s_numLookups,
+	       s_numLookups * 1000.0 / mapElapsed,
+	       (double) tableElapsed / s_numLookups,
+	       s_numLookups * 1000.0 / tableElapsed,
+	       (check == 0) ? "" : " MISMATCH");
+}
+
+int
+main(int argc, char **argv)
+{
+
+	RunLookupBenchmark(100000);
+	RunLookupBenchmark(1000000);
+
+	return 0;
+}
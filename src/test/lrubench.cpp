@@ -0,0 +1,81 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Measures the cost of CFileCache::Touch as the number of objects in a
+// type grows.  Objects are only inserted in the in-memory structures
+// (no backing files are created) so only the LRU maintenance and the
+// id lookup are timed.  The objects are intentionally leaked at exit.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "FileCache.h"
+#include "TestObjects.h"
+
+static const int s_numTouches = 200000;
+
+static long long
+NowNsec()
+{
+
+	struct timespec tm;
+	::clock_gettime(CLOCK_MONOTONIC, &tm);
+
+	return tm.tv_sec * 1000000000LL + tm.tv_nsec;
+}
+
+static void
+RunTouchBenchmark(CFileCacheSet *fileCacheSet, int numObjects)
+{
+
+	CFileCache *fileCache = new CFileCache(fileCacheSet, "lrubench");
+	for (int i = 1; i <= numObjects; i++)
+	{
+		fileCache->Insert(new CCacheObject(fileCache, (cachedObjectId_t) i,
+		                                   "bench.dat", 1));
+	}
+
+	// Touch random objects so the accesses are spread over the whole
+	// list rather than hitting the head.
+	srand48(numObjects);
+	long long startTime = NowNsec();
+	for (int i = 0; i < s_numTouches; i++)
+	{
+		cachedObjectId_t objId = (cachedObjectId_t)(lrand48() % numObjects) + 1;
+		fileCache->Touch(objId);
+	}
+	long long elapsed = NowNsec() - startTime;
+
+	printf("%9d objects: %8.1f ns/Touch\n", numObjects,
+	       (double) elapsed / s_numTouches);
+}
+
+int
+main(int argc, char **argv)
+{
+
+	CTestFileCacheSet *fileCacheSet = new CTestFileCacheSet();
+
+	int numObjects = 1000;
+	while (numObjects <= 1000000)
+	{
+		RunTouchBenchmark(fileCacheSet, numObjects);
+		numObjects *= 10;
+	}
+
+	return 0;
+}
@@ -0,0 +1,107 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Reports the resident memory used for each cached object.  Objects
+// are only inserted in the in-memory structures of a type (no backing
+// files are created), so the figure covers the CCacheObject, its
+// filename and the per type LRU list, eviction index and id table
+// entries.  Each case runs in its own process so the resident size of
+// one doesn't hide the other.  The objects are intentionally leaked at
+// exit.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+
+#include "FileCache.h"
+#include "TestObjects.h"
+
+static const int s_numObjects = 1000000;
+
+static long
+ResidentBytes()
+{
+
+	long size = 0;
+	long resident = 0;
+	FILE *fp = ::fopen("/proc/self/statm", "r");
+	if (fp != NULL)
+	{
+		if (::fscanf(fp, "%ld %ld", &size, &resident) != 2)
+		{
+			resident = 0;
+		}
+		::fclose(fp);
+	}
+
+	return resident * ::sysconf(_SC_PAGESIZE);
+}
+
+// With uniqueNames set every object gets its own filename, like a
+// downloader naming objects after their URL, otherwise the objects
+// share a few names, like thumbnails all named for their format.
+static void
+RunMemoryReport(bool uniqueNames)
+{
+
+	CTestFileCacheSet *fileCacheSet = new CTestFileCacheSet();
+	CFileCache *fileCache = new CFileCache(fileCacheSet, "membench");
+
+	long startBytes = ResidentBytes();
+	char filename[64];
+	for (int i = 1; i <= s_numObjects; i++)
+	{
+		if (uniqueNames)
+		{
+			::snprintf(filename, sizeof(filename), "thumbnail-%08d.jpg", i);
+		}
+		else
+		{
+			::snprintf(filename, sizeof(filename), "thumbnail-%d.jpg", i % 4);
+		}
+		fileCache->Insert(new CCacheObject(fileCache, (cachedObjectId_t) i,
+		                                   filename, 1));
+	}
+	long usedBytes = ResidentBytes() - startBytes;
+
+	printf("%9d objects, %s names: %6.1f bytes/object\n", s_numObjects,
+	       uniqueNames ? "unique" : "shared",
+	       (double) usedBytes / s_numObjects);
+}
+
+int
+main(int argc, char **argv)
+{
+
+	bool uniqueNames = false;
+	for (int i = 0; i < 2; i++)
+	{
+		pid_t pid = ::fork();
+		if (pid == 0)
+		{
+			RunMemoryReport(uniqueNames);
+			::fflush(stdout);
+			::_exit(0);
+		}
+		if (pid > 0)
+		{
+			::waitpid(pid, NULL, 0);
+		}
+		uniqueNames = !uniqueNames;
+	}
+
+	return 0;
+}
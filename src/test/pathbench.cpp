@@ -0,0 +1,337 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Compares the pathname helpers in CacheBase.cpp with the string
+// building versions they replaced, which are kept here as Legacy*.
+// Each helper is run over the same set of object paths and the time
+// per call is reported.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <vector>
+
+#include "CacheBase.h"
+
+static const int s_numPaths = 1000;
+static const int s_numRounds = 1000;
+
+static const std::string s_benchDirBase("/var/file-cache");
+static const std::string s_benchType("com.palm.thumbnails");
+static const std::string s_benchFile("thumbnail.jpg");
+
+static long long
+NowNsec()
+{
+
+	struct timespec tm;
+	::clock_gettime(CLOCK_MONOTONIC, &tm);
+
+	return tm.tv_sec * 1000000000LL + tm.tv_nsec;
+}
+
+static cachedObjectId_t
+LegacyGetObjectIdFromPath(const char *filePath)
+{
+
+	long endPos;
+	const char *endChar = rindex(filePath, (int)'.');
+	if (endChar == NULL)
+	{
+		endPos = (int) strlen(filePath);
+	}
+	else
+	{
+		endPos = endChar - filePath;
+	}
+
+	long curPos = endPos - s_numChars - 1;
+	int i = 0;
+	bool foundDelimiter = false;
+	cachedObjectId_t objectId = 0;
+	while (curPos < endPos)
+	{
+		if (strncmp(&(filePath[curPos]), "/", 1))
+		{
+			const char *indexChar = index(s_charMapping, (int) filePath[curPos]);
+			if (indexChar == NULL)
+			{
+				return 0;
+			}
+			cachedObjectId_t value = (cachedObjectId_t)(indexChar - s_charMapping);
+			int shiftValue = (s_numChars - i - 1) * s_maskSize;
+			objectId += (value << shiftValue);
+			i++;
+		}
+		else
+		{
+			if (i == s_dirChars)
+			{
+				foundDelimiter = true;
+			}
+			else
+			{
+				curPos = endPos;
+			}
+		}
+		curPos++;
+	}
+
+	if (!foundDelimiter || (i != s_numChars))
+	{
+		objectId = 0;
+	}
+
+	return objectId;
+}
+
+static const std::string
+LegacyGetTypeNameFromPath(const std::string &baseDirName,
+                          const std::string &filePath)
+{
+
+	std::string typeName;
+	if (baseDirName == filePath.substr(0, baseDirName.length()))
+	{
+		std::string::size_type startPos = baseDirName.length() + 1;
+		std::string::size_type endPos = filePath.find('/', startPos);
+		if ((endPos != std::string::npos) && (endPos > startPos))
+		{
+			typeName = filePath.substr(startPos, endPos - startPos);
+		}
+	}
+
+	return typeName;
+}
+
+static const std::string
+LegacyGetDirectoryFromPath(const std::string &pathname)
+{
+
+	std::string dirpath;
+	std::string::size_type endPos = pathname.rfind('/');
+	if ((endPos != std::string::npos) && (endPos > 0))
+	{
+		dirpath = pathname.substr(0, endPos);
+	}
+
+	return dirpath;
+}
+
+static const std::string
+LegacyGetFileExtension(const char *filePath)
+{
+
+	std::string tmp(filePath);
+	std::string extension("");
+	std::string::size_type startPos = tmp.find_last_of("./");
+	if ((startPos != std::string::npos) && (tmp[startPos] == '.'))
+	{
+		extension = tmp.substr(startPos);
+	}
+
+	return extension;
+}
+
+static std::string
+LegacyBuildPathname(const cachedObjectId_t objectId,
+                    const std::string &basePath, const std::string &typeName,
+                    const std::string &fileName)
+{
+
+	if (objectId == 0)
+	{
+		return std::string("");
+	}
+
+	std::string pathname(basePath);
+	pathname += std::string("/") + typeName + std::string("/");
+	for (int i = (s_numChars - 1); i > (s_numChars - s_dirChars - 1); i--)
+	{
+		pathname += GetCharNFromObjectId(objectId, i);
+	}
+	pathname += std::string("/");
+	for (int i = (s_numChars - s_dirChars - 1); i >= 0; i--)
+	{
+		pathname += GetCharNFromObjectId(objectId, i);
+	}
+	if (!fileName.empty())
+	{
+		pathname += LegacyGetFileExtension(fileName.c_str());
+	}
+
+	return pathname;
+}
+
+// Print the time per call for a pass over all the paths, and return a
+// value computed from the results so the calls can't be optimized away
+static void
+Report(const char *name, long long startTime, size_t check)
+{
+
+	long long elapsed = NowNsec() - startTime;
+	printf("%-32s %7.1f ns/call (check %zu)\n", name,
+	       (double) elapsed / ((double) s_numPaths * s_numRounds), check);
+}
+
+int
+main(int argc, char **argv)
+{
+
+	std::vector<cachedObjectId_t> ids;
+	std::vector<std::string> paths;
+	srand48(1);
+	for (int i = 0; i < s_numPaths; i++)
+	{
+		cachedObjectId_t objId = ((cachedObjectId_t) lrand48() << 22) |
+		                         (cachedObjectId_t) i;
+		ids.push_back(objId);
+		paths.push_back(BuildPathname(objId, s_benchDirBase, s_benchType,
+		                              s_benchFile));
+	}
+
+	size_t check = 0;
+	long long startTime = NowNsec();
+	for (int r = 0; r < s_numRounds; r++)
+	{
+		for (int i = 0; i < s_numPaths; i++)
+		{
+			check += LegacyBuildPathname(ids[i], s_benchDirBase, s_benchType,
+			                             s_benchFile).length();
+		}
+	}
+	Report("LegacyBuildPathname", startTime, check);
+
+	check = 0;
+	startTime = NowNsec();
+	for (int r = 0; r < s_numRounds; r++)
+	{
+		for (int i = 0; i < s_numPaths; i++)
+		{
+			check += BuildPathname(ids[i], s_benchDirBase, s_benchType,
+			                       s_benchFile).length();
+		}
+	}
+	Report("BuildPathname (string)", startTime, check);
+
+	check = 0;
+	startTime = NowNsec();
+	char pathname[s_maxPathnameLength];
+	for (int r = 0; r < s_numRounds; r++)
+	{
+		for (int i = 0; i < s_numPaths; i++)
+		{
+			check += BuildPathname(pathname, sizeof(pathname), ids[i],
+			                       s_benchDirBase, s_benchType, s_benchFile.c_str());
+		}
+	}
+	Report("BuildPathname (buffer)", startTime, check);
+
+	check = 0;
+	startTime = NowNsec();
+	for (int r = 0; r < s_numRounds; r++)
+	{
+		for (int i = 0; i < s_numPaths; i++)
+		{
+			check += (size_t) LegacyGetObjectIdFromPath(paths[i].c_str());
+		}
+	}
+	Report("LegacyGetObjectIdFromPath", startTime, check);
+
+	check = 0;
+	startTime = NowNsec();
+	for (int r = 0; r < s_numRounds; r++)
+	{
+		for (int i = 0; i < s_numPaths; i++)
+		{
+			check += (size_t) GetObjectIdFromPath(paths[i].c_str());
+		}
+	}
+	Report("GetObjectIdFromPath", startTime, check);
+
+	// The request handlers pass the MojString data, so the legacy
+	// version converts from a char pointer as they did
+	check = 0;
+	startTime = NowNsec();
+	for (int r = 0; r < s_numRounds; r++)
+	{
+		for (int i = 0; i < s_numPaths; i++)
+		{
+			check += (LegacyGetTypeNameFromPath(s_benchDirBase,
+			                                    paths[i].c_str()) == s_benchType);
+		}
+	}
+	Report("LegacyGetTypeNameFromPath ==", startTime, check);
+
+	check = 0;
+	startTime = NowNsec();
+	for (int r = 0; r < s_numRounds; r++)
+	{
+		for (int i = 0; i < s_numPaths; i++)
+		{
+			check += PathHasTypeName(s_benchDirBase, paths[i].c_str(), s_benchType);
+		}
+	}
+	Report("PathHasTypeName", startTime, check);
+
+	check = 0;
+	startTime = NowNsec();
+	for (int r = 0; r < s_numRounds; r++)
+	{
+		for (int i = 0; i < s_numPaths; i++)
+		{
+			check += LegacyGetDirectoryFromPath(paths[i]).length();
+		}
+	}
+	Report("LegacyGetDirectoryFromPath", startTime, check);
+
+	check = 0;
+	startTime = NowNsec();
+	char dirpath[s_maxPathnameLength];
+	for (int r = 0; r < s_numRounds; r++)
+	{
+		for (int i = 0; i < s_numPaths; i++)
+		{
+			check += GetDirectoryFromPath(paths[i].c_str(), dirpath, sizeof(dirpath));
+		}
+	}
+	Report("GetDirectoryFromPath (buffer)", startTime, check);
+
+	check = 0;
+	startTime = NowNsec();
+	for (int r = 0; r < s_numRounds; r++)
+	{
+		for (int i = 0; i < s_numPaths; i++)
+		{
+			check += LegacyGetFileExtension(paths[i].c_str()).length();
+		}
+	}
+	Report("LegacyGetFileExtension", startTime, check);
+
+	check = 0;
+	startTime = NowNsec();
+	for (int r = 0; r < s_numRounds; r++)
+	{
+		for (int i = 0; i < s_numPaths; i++)
+		{
+			check += strlen(FindFileExtension(paths[i].c_str()));
+		}
+	}
+	Report("FindFileExtension", startTime, check);
+
+	return 0;
+}